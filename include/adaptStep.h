@@ -0,0 +1,53 @@
+/**
+ * \file adaptStep.h
+ *
+ * \brief Header file for adaptStep.c : adaptive timestep controller of the native engine
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef ADAPTSTEP_H_INCLUDED
+#define ADAPTSTEP_H_INCLUDED
+
+#include <stdint.h>
+
+#include "global.h"
+
+/**
+ * @brief State of the adaptive timestep controller : the timestep of the METHOD keyword is the largest one,
+ *  reduced so that no atom moves by more than maxdisp in one step, and growing back by at most a factor growth per step.
+ *
+ * Blocks of numSteps steps given to doNsteps last numSteps times the largest timestep whatever the steps taken,
+ *  so that the frames of the trajectory and the energies stay equally spaced in time.
+ */
+typedef struct
+{
+  double maxdisp;     ///< largest displacement of an atom in one step in nm, 0 if the timestep is constant
+  double dtmax;       ///< timestep of the METHOD keyword in ps
+  double dtmin;       ///< smallest timestep in ps
+  double growth;      ///< largest growth factor of the timestep from one step to the next
+  double friction;    ///< friction in ps^-1, for the overdamped integrators
+  uint8_t overdamped; ///< 1 for BROWNIAN and BROWNIAN_LM : the displacement is F dt/(m friction) instead of v dt + F dt^2/(2m)
+
+  double dt;          ///< timestep of the last step, before its clipping to the end of the block
+
+  uint64_t nsteps;    ///< steps taken since the last adapt_report
+  uint64_t nreduced;  ///< steps shorter than dtmax since the last adapt_report
+  uint64_t nfloor;    ///< steps for which dtmin was used although too large since the last adapt_report
+  double dtlow;       ///< shortest step since the last adapt_report
+} ADAPT_STEP;
+
+void adapt_init(ADAPT_STEP* a, const DATA* dat);
+
+double adapt_next(ADAPT_STEP* a, double v2max, double a2max, double remaining);
+
+void adapt_report(ADAPT_STEP* a, double duration);
+
+#endif // ADAPTSTEP_H_INCLUDED
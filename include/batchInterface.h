@@ -0,0 +1,78 @@
+/**
+ * \file batchInterface.h
+ *
+ * \brief Header file for batchInterface.c : independent replicas of the same small cluster integrated in lockstep
+ *        by the native engine (REPLICAS keyword)
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef BATCHINTERFACE_H_INCLUDED
+#define BATCHINTERFACE_H_INCLUDED
+
+#include "global.h"
+#include "engine.h"
+#include "ljForces.h"
+
+/**
+ * @brief Data of the batched native engine : nrep replicas of the same natom atoms, stored interleaved so that
+ *  the value of atom i of replica r is at [i*stride+r] ; the stride is nrep rounded up to a multiple of LJ_BATCH_LANES,
+ *  the padding lanes being copies of the first replica without noise, never written to the outputs.
+ *  Same units than the native engine (nm, ps, amu, kJ/mol).
+ */
+typedef struct
+{
+  uint32_t natom;         ///< Number of atoms of each replica
+  uint32_t nrep;          ///< Number of replicas
+  uint32_t stride;        ///< nrep rounded up to a multiple of LJ_BATCH_LANES
+
+  double *x,*y,*z;        ///< positions in nm, interleaved
+  double *vx,*vy,*vz;     ///< velocities in nm/ps, interleaved
+  double *fx,*fy,*fz;     ///< forces in kJ/mol/nm, interleaved, always consistent with the positions
+  double *mass;           ///< masses in amu, interleaved (the update kernels work elementwise)
+  double *amass;          ///< masses in amu of the natom atoms, for the minimisers
+  uint32_t *type;         ///< species of the natom atoms, the same in all the replicas
+  const SPECIES* sp;      ///< species table with the mixed LJ parameters, owned by DATA
+  double *gauss;          ///< normal random numbers of one step, interleaved, size 3*natom*stride
+  double *gprev;          ///< normal random numbers of the previous step for BROWNIAN_LM, NULL otherwise
+  double *graw;           ///< normal random numbers of each replica before interleaving, size 3*natom*nrep
+  double *epot;           ///< potential energy of each replica, size stride
+
+  DATA *rdat;             ///< one random numbers generator per replica, seeded from the one of DATA
+  double *mbuf;           ///< scratch positions and forces of the minimisations, size 6*natom*nrep
+
+  uint32_t nthreads;      ///< number of threads, sharing the groups of replicas
+  LJ_CUTS cuts;           ///< cuton/cutoff parameters
+
+  double time;            ///< current simulation time in ps, the same for all the replicas
+
+  INTEGRATORS integrator; ///< Langevin, Brownian or BAOAB
+  double T;               ///< Temperature in K
+  double friction;        ///< friction in ps^-1
+  double timestep;        ///< timestep in ps
+
+  MINIMISERS minimiser;   ///< FIRE or LBFGS
+  uint32_t minimHistory;  ///< number of corrections kept by L-BFGS
+} MyBatchData;
+
+MyBatchData* init_batch(ATOM atoms[], DATA* dat);
+
+void doNsteps_batch(MyBatchData* bat, int numSteps);
+
+void getState_batch(MyBatchData* bat, uint32_t r, int wantEnergy,
+                    double* timeInPs, ENERGIES* energies, ATOM atoms[]);
+
+void minimise_batch(MyBatchData* bat, double tolerance, int maxSteps);
+
+void infos_batch(const MyBatchData* bat);
+
+void terminate_batch(MyBatchData* bat);
+
+#endif // BATCHINTERFACE_H_INCLUDED
@@ -0,0 +1,27 @@
+/**
+ * \file bench.h
+ *
+ * \brief Header file for bench.c : benchmarks of the native engine, run with the -bench command line option
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef BENCH_H_INCLUDED
+#define BENCH_H_INCLUDED
+
+#include "global.h"
+
+/// run the benchmark called name ("all" for all of them) with systems of at most nmax atoms
+void run_bench(DATA *dat, const char name[], uint32_t nmax);
+
+/// print the list of available benchmarks
+void list_bench();
+
+#endif // BENCH_H_INCLUDED
@@ -0,0 +1,90 @@
+/**
+ * \file cellGrid.h
+ *
+ * \brief Header file for cellGrid.c : a hashed linked-cell grid without bounding box
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef CELLGRID_H_INCLUDED
+#define CELLGRID_H_INCLUDED
+
+#include <stdint.h>
+#include <math.h>
+
+/**
+ * @brief A linked-cell grid where the (unbounded) integer cell coordinates are hashed into a fixed number of buckets.
+ *
+ * Atoms are chained in the bucket of their cell (head/next linked lists) ; as several cells may share a bucket,
+ * the exact cell coordinates of each atom are stored and must be compared when looping over a cell.
+ * The grid is unit agnostic : cells are of size cellSize in the unit of the coordinates given.
+ * In a periodic box (see cellgrid_set_box) each edge is split in nc cells of at least cellSize, and the cell coordinates
+ * are those of the image of the atom in the box, from 0 to nc-1.
+ */
+typedef struct
+{
+  double   cellSize;    ///< edge of a cubic cell
+  double   invCellSize; ///< 1/cellSize
+  uint32_t natom;       ///< capacity in atoms
+  uint32_t nbuckets;    ///< number of hash buckets : a power of 2
+  uint32_t mask;        ///< nbuckets-1
+  int32_t  *head;       ///< first atom of each bucket, -1 if empty
+  int32_t  *next;       ///< next atom in the same bucket, -1 if last
+  int32_t  *cx,*cy,*cz; ///< integer cell coordinates of each atom
+
+  uint8_t  periodic;    ///< 1 in a periodic box, 0 for unbounded cell coordinates
+  int32_t  nc[3];       ///< periodic box : number of cells along each edge
+  double   invc[3];     ///< periodic box : inverse of the edges of the cells
+} CELLGRID;
+
+/// the 13 neighbouring cells visited by half-shell loops, in addition to the cell itself
+extern const int32_t cellgrid_half_shell[13][3];
+
+CELLGRID* cellgrid_alloc(uint32_t natom, double cellSize);
+void cellgrid_free(CELLGRID* g);
+
+void cellgrid_set_box(CELLGRID* g, const double box[3]);
+
+void cellgrid_clear(CELLGRID* g);
+void cellgrid_insert(CELLGRID* g, uint32_t i, double x, double y, double z);
+void cellgrid_build(CELLGRID* g, uint32_t n, const double x[], const double y[], const double z[]);
+
+/// integer coordinate of the cell containing the coordinate v
+static inline int32_t cellgrid_coord(const CELLGRID* g, double v)
+{
+  return (int32_t) floor(v*g->invCellSize);
+}
+
+/// periodic box : integer coordinate along the edge d of the cell containing the image in the box of the coordinate v
+static inline int32_t cellgrid_pcoord(const CELLGRID* g, double v, uint32_t d)
+{
+  const int32_t c = (int32_t) floor(v*g->invc[d]) % g->nc[d];
+  return (c < 0) ? c + g->nc[d] : c;
+}
+
+/// periodic box : coordinate c along the edge d of a neighbouring cell, from -1 to nc, brought back in the box
+static inline int32_t cellgrid_pwrap(const CELLGRID* g, int32_t c, uint32_t d)
+{
+  return (c < 0) ? c + g->nc[d] : ((c >= g->nc[d]) ? c - g->nc[d] : c);
+}
+
+/// minimum image of the component d of a separation vector, in a periodic box of edge L (invL = 1/L)
+static inline double cellgrid_image(double d, double L, double invL)
+{
+  return d - L*nearbyint(d*invL);
+}
+
+/// bucket of the cell (cx,cy,cz)
+static inline uint32_t cellgrid_hash(const CELLGRID* g, int32_t cx, int32_t cy, int32_t cz)
+{
+  return (((uint32_t)cx*73856093u) ^ ((uint32_t)cy*19349663u) ^ ((uint32_t)cz*83492791u)) & g->mask;
+}
+
+#endif // CELLGRID_H_INCLUDED
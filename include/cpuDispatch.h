@@ -0,0 +1,196 @@
+/**
+ * \file cpuDispatch.h
+ *
+ * \brief Header file for cpuDispatch.c : selection at run time of the SSE2, AVX2 or AVX-512 variants of the hot kernels
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef CPUDISPATCH_H_INCLUDED
+#define CPUDISPATCH_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ljForces.h"
+
+/**
+ * \def KERNEL_NAME(f,isa)
+ * \brief Name of the variant of kernel f compiled for the instruction set isa, e.g. langevin_update_avx2
+ */
+#define KERNEL_NAME_(f,isa) f##_##isa
+#define KERNEL_NAME(f,isa)  KERNEL_NAME_(f,isa)
+
+/// prototypes of the kernels compiled for one instruction set, see ljKernelSimd.c and vecKernels.c
+#define KERNEL_PROTOTYPES(isa)                                                                                  \
+  const char* KERNEL_NAME(lj_kernel_isa,isa)();                                                                 \
+  double KERNEL_NAME(lj_rows_neighlist,isa)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,                  \
+                                            const double x[], const double y[], const double z[],               \
+                                            const uint32_t type[], const SPECIES* sp, const LJ_CUTS* cuts,        \
+                                            double fx[], double fy[], double fz[]);                             \
+  double KERNEL_NAME(lj_rows_neighlist_full,isa)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,             \
+                                                 const double x[], const double y[], const double z[],          \
+                                                 const uint32_t type[], const SPECIES* sp, const LJ_CUTS* cuts,   \
+                                                 double fx[], double fy[], double fz[]);                        \
+  double KERNEL_NAME(lj_tile_allpairs,isa)(uint32_t ibeg, uint32_t iend, uint32_t jbeg, uint32_t jend,           \
+                                           const double x[], const double y[], const double z[],                \
+                                           const uint32_t type[], const SPECIES* sp, const LJ_CUTS* cuts,         \
+                                           double fx[], double fy[], double fz[]);                              \
+  double KERNEL_NAME(lj_energy_rows_neighlist,isa)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,           \
+                                                   const double x[], const double y[], const double z[],        \
+                                                   const uint32_t type[], const SPECIES* sp,                    \
+                                                   const LJ_CUTS* cuts);                                        \
+  double KERNEL_NAME(lj_energy_tile_allpairs,isa)(uint32_t ibeg, uint32_t iend, uint32_t jbeg, uint32_t jend,    \
+                                                  const double x[], const double y[], const double z[],         \
+                                                  const uint32_t type[], const SPECIES* sp,                     \
+                                                  const LJ_CUTS* cuts);                                         \
+  double KERNEL_NAME(lj_rows_neighlist_mixed,isa)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,            \
+                                                  const float xyzt[], const SPECIES* sp, const LJ_CUTS* cuts,   \
+                                                  float f4[]);                                                  \
+  double KERNEL_NAME(lj_rows_neighlist_table,isa)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,            \
+                                                  const double x[], const double y[], const double z[],         \
+                                                  const uint32_t type[], const LJ_TABLE* tab,                   \
+                                                  double fx[], double fy[], double fz[]);                       \
+  void KERNEL_NAME(lj_batch_allpairs,isa)(uint32_t n, uint32_t stride, uint32_t rbeg, uint32_t rend,           \
+                                          const double x[], const double y[], const double z[],                 \
+                                          const uint32_t type[], const SPECIES* sp, const LJ_CUTS* cuts,          \
+                                          double fx[], double fy[], double fz[], double epot[]);                \
+  void KERNEL_NAME(langevin_update,isa)(uint32_t n, const double* restrict mass,                                \
+                                        double dt, double vscale, double fscale, double nscale,                 \
+                                        const double* restrict fx, const double* restrict fy, const double* restrict fz, \
+                                        const double* restrict gx, const double* restrict gy, const double* restrict gz, \
+                                        double* restrict vx, double* restrict vy, double* restrict vz,          \
+                                        double* restrict x, double* restrict y, double* restrict z);            \
+  void KERNEL_NAME(brownian_update,isa)(uint32_t n, const double* restrict mass,                                \
+                                        double dt, double friction, double kT,                                  \
+                                        const double* restrict fx, const double* restrict fy, const double* restrict fz, \
+                                        const double* restrict gx, const double* restrict gy, const double* restrict gz, \
+                                        double* restrict vx, double* restrict vy, double* restrict vz,          \
+                                        double* restrict x, double* restrict y, double* restrict z);            \
+  void KERNEL_NAME(brownian_lm_update,isa)(uint32_t n, const double* restrict mass,                             \
+                                           double dt, double friction, double kT,                               \
+                                           const double* restrict fx, const double* restrict fy, const double* restrict fz, \
+                                           const double* restrict gx, const double* restrict gy, const double* restrict gz, \
+                                           const double* restrict hx, const double* restrict hy, const double* restrict hz, \
+                                           double* restrict vx, double* restrict vy, double* restrict vz,       \
+                                           double* restrict x, double* restrict y, double* restrict z);         \
+  void KERNEL_NAME(baoab_update,isa)(uint32_t n, const double* restrict mass,                                   \
+                                     double kick, double hdt, double vscale, double nscale,                     \
+                                     const double* restrict fx, const double* restrict fy, const double* restrict fz, \
+                                     const double* restrict gx, const double* restrict gy, const double* restrict gz, \
+                                     double* restrict vx, double* restrict vy, double* restrict vz,             \
+                                     double* restrict x, double* restrict y, double* restrict z);               \
+  void KERNEL_NAME(kick_update,isa)(uint32_t n, const double* restrict mass, double kick,                       \
+                                    const double* restrict fx, const double* restrict fy, const double* restrict fz, \
+                                    double* restrict vx, double* restrict vy, double* restrict vz);             \
+  void KERNEL_NAME(gauss_transform,isa)(double* restrict u, uint32_t h);                                        \
+  void KERNEL_NAME(sum_xyz,isa)(const double* restrict p, size_t stride, uint32_t n, double s[3]);              \
+  void KERNEL_NAME(shift_xyz,isa)(double* restrict p, size_t stride, uint32_t n, const double s[3]);
+
+KERNEL_PROTOTYPES(sse2)
+#ifdef HAVE_KERNELS_AVX2
+KERNEL_PROTOTYPES(avx2)
+#endif
+#ifdef HAVE_KERNELS_AVX512
+KERNEL_PROTOTYPES(avx512)
+#endif
+
+/**
+ * @brief The variants of the hot kernels in use : pointers to the functions compiled for one instruction set
+ */
+typedef struct
+{
+  const char* name;   ///< name of the instruction set, as given to kernels_select
+
+  const char* (*lj_kernel_isa)();
+
+  double (*lj_rows_neighlist)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                              const double x[], const double y[], const double z[],
+                              const uint32_t type[], const SPECIES* sp, const LJ_CUTS* cuts,
+                              double fx[], double fy[], double fz[]);
+
+  double (*lj_rows_neighlist_full)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                   const double x[], const double y[], const double z[],
+                                   const uint32_t type[], const SPECIES* sp, const LJ_CUTS* cuts,
+                                   double fx[], double fy[], double fz[]);
+
+  double (*lj_tile_allpairs)(uint32_t ibeg, uint32_t iend, uint32_t jbeg, uint32_t jend,
+                             const double x[], const double y[], const double z[],
+                             const uint32_t type[], const SPECIES* sp, const LJ_CUTS* cuts,
+                             double fx[], double fy[], double fz[]);
+
+  double (*lj_energy_rows_neighlist)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                     const double x[], const double y[], const double z[],
+                                     const uint32_t type[], const SPECIES* sp, const LJ_CUTS* cuts);
+
+  double (*lj_energy_tile_allpairs)(uint32_t ibeg, uint32_t iend, uint32_t jbeg, uint32_t jend,
+                                    const double x[], const double y[], const double z[],
+                                    const uint32_t type[], const SPECIES* sp, const LJ_CUTS* cuts);
+
+  double (*lj_rows_neighlist_mixed)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                    const float xyzt[], const SPECIES* sp, const LJ_CUTS* cuts,
+                                    float f4[]);
+
+  double (*lj_rows_neighlist_table)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                    const double x[], const double y[], const double z[],
+                                    const uint32_t type[], const LJ_TABLE* tab,
+                                    double fx[], double fy[], double fz[]);
+
+  void (*lj_batch_allpairs)(uint32_t n, uint32_t stride, uint32_t rbeg, uint32_t rend,
+                            const double x[], const double y[], const double z[],
+                            const uint32_t type[], const SPECIES* sp, const LJ_CUTS* cuts,
+                            double fx[], double fy[], double fz[], double epot[]);
+
+  void (*langevin_update)(uint32_t n, const double* restrict mass,
+                          double dt, double vscale, double fscale, double nscale,
+                          const double* restrict fx, const double* restrict fy, const double* restrict fz,
+                          const double* restrict gx, const double* restrict gy, const double* restrict gz,
+                          double* restrict vx, double* restrict vy, double* restrict vz,
+                          double* restrict x, double* restrict y, double* restrict z);
+
+  void (*brownian_update)(uint32_t n, const double* restrict mass,
+                          double dt, double friction, double kT,
+                          const double* restrict fx, const double* restrict fy, const double* restrict fz,
+                          const double* restrict gx, const double* restrict gy, const double* restrict gz,
+                          double* restrict vx, double* restrict vy, double* restrict vz,
+                          double* restrict x, double* restrict y, double* restrict z);
+
+  void (*brownian_lm_update)(uint32_t n, const double* restrict mass,
+                             double dt, double friction, double kT,
+                             const double* restrict fx, const double* restrict fy, const double* restrict fz,
+                             const double* restrict gx, const double* restrict gy, const double* restrict gz,
+                             const double* restrict hx, const double* restrict hy, const double* restrict hz,
+                             double* restrict vx, double* restrict vy, double* restrict vz,
+                             double* restrict x, double* restrict y, double* restrict z);
+
+  void (*baoab_update)(uint32_t n, const double* restrict mass,
+                       double kick, double hdt, double vscale, double nscale,
+                       const double* restrict fx, const double* restrict fy, const double* restrict fz,
+                       const double* restrict gx, const double* restrict gy, const double* restrict gz,
+                       double* restrict vx, double* restrict vy, double* restrict vz,
+                       double* restrict x, double* restrict y, double* restrict z);
+
+  void (*kick_update)(uint32_t n, const double* restrict mass, double kick,
+                      const double* restrict fx, const double* restrict fy, const double* restrict fz,
+                      double* restrict vx, double* restrict vy, double* restrict vz);
+
+  void (*gauss_transform)(double* restrict u, uint32_t h);
+
+  void (*sum_xyz)(const double* restrict p, size_t stride, uint32_t n, double s[3]);
+  void (*shift_xyz)(double* restrict p, size_t stride, uint32_t n, const double s[3]);
+} KERNELS;
+
+/// the kernels in use : by default the SSE2 ones until kernels_select is called
+extern KERNELS kernels;
+
+int32_t kernels_supported(const char name[]);
+int32_t kernels_select(const char name[]);
+
+#endif // CPUDISPATCH_H_INCLUDED
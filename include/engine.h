@@ -0,0 +1,106 @@
+/**
+ * \file engine.h
+ *
+ * \brief Header file for engine.c : a common interface to the force/integration backends (OpenMM or native)
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef ENGINE_H_INCLUDED
+#define ENGINE_H_INCLUDED
+
+#include "global.h"
+
+typedef enum
+{
+  AUTO  = -1, //< AUTO   : let OpenMM find the fastest platform (or NATIVE if built without OpenMM)
+  REF   = 0,  //< REF    : on cpu, not optimised, nor parallellised
+  CPU   = 1,  //< CPU    : on cpu, optimised, parallellised with OpenMP
+  CUDA  = 2,  //< CUDA   : on nvidia gpu only probably the fastest
+  OCL   = 3,  //< OCL    : on cpu or gpu or any accelerating device available
+  NATIVE= 4   //< NATIVE : built-in Lennard-Jones engine, OpenMM not used at all
+} PLATFORMS;
+
+extern const char* ommPlatformName[4];
+
+typedef enum
+{
+  LANGEVIN = 0,     //< code will use a Langevin integrator
+  BROWNIAN = 1,     //< code will use a Brownian integrator (i.e. overdamped Langevin)
+  BAOAB    = 2,     //< code will use the BAOAB splitting of the Langevin dynamics (Leimkuhler and Matthews)
+  BROWNIAN_LM = 3   //< code will use the Leimkuhler-Matthews overdamped Langevin integrator
+} INTEGRATORS;
+
+extern const char* integratorsName[4];
+
+typedef enum
+{
+  PREC_DEFAULT = -1,  //< not given : double precision for the native engine, the default of the platform for OpenMM
+  SINGLE = 0,         //< SINGLE : everything in single precision (OpenMM) ; same as MIXED for the native engine
+  MIXED  = 1,         //< MIXED  : forces in single precision, accumulation and integration in double precision
+  DOUBLE = 2          //< DOUBLE : everything in double precision
+} PRECISIONS;
+
+extern const char* precisionsName[3];
+
+typedef enum
+{
+  NO_MINIM = -1,  //< NONE  : no local energy minimisation
+  FIRE     = 0,   //< FIRE  : FIRE minimiser of minimiser.c, running on the forces of the engine (default)
+  LOCAL    = 1,   //< LOCAL : the engine's own minimiser, OpenMM_LocalEnergyMinimizer or steepest descent for NATIVE
+  LBFGS    = 2    //< LBFGS : L-BFGS minimiser of minimiser.c with a More-Thuente line search, for tight tolerances
+} MINIMISERS;
+
+extern const char* minimisersName[3];
+
+typedef enum
+{
+  NO_REORDER = 0, //< NONE    : atoms keep the order of the ATOM keywords
+  MORTON     = 1, //< MORTON  : atoms sorted along the Morton (Z-order) curve, cheaper keys
+  HILBERT    = 2  //< HILBERT : atoms sorted along the Hilbert curve, better locality
+} REORDERS;
+
+extern const char* reordersName[3];
+
+/**
+ * @brief A backend used for computing energies/forces and for integrating the equations of motion.
+ *
+ * The run_md function only sees this structure : the backend specific data (MyOpenMMData or MyNativeData)
+ * is hidden behind the \b data pointer and the function pointers redirect to the proper implementation.
+ */
+typedef struct
+{
+  void*       data;           ///< backend specific data
+  const char* platformName;   ///< name of the platform effectively used
+
+  /// perform numSteps integration steps
+  void (*doNsteps)(void* data, int numSteps);
+  /// copy positions (in angstroems), time, energies and temperature back to the caller
+  void (*getState)(void* data, int wantEnergy,
+                   double* timeInPs, ENERGIES* energies, double* currentTemperature,
+                   ATOM atoms[], DATA* dat);
+  /// potential energy only (kJ/mol), of the current positions if atoms is NULL, else of the given positions (angstroems) without changing the state
+  double (*getEnergy)(void* data, const ATOM atoms[]);
+  /// local energy minimisation with the algorithm of the MINIMIZE keyword : tolerance in kJ/mol/nm, maxSteps = 0 means until convergence
+  void (*minimise)(void* data, double tolerance, int maxSteps);
+  /// drops from the forces and the integration the atoms flagged in evap (order of the ATOM list), which keep their positions ;
+  ///  NULL for the OpenMM platforms, with which EVAPORATION is an error
+  void (*evaporate)(void* data, const uint8_t evap[]);
+  /// print to the info log some details about the backend
+  void (*infos)(const void* data);
+  /// free the backend specific data
+  void (*terminate)(void* data);
+} ENGINE;
+
+ENGINE* init_engine(ATOM atoms[], DATA* dat);
+
+void terminate_engine(ENGINE* eng);
+
+#endif // ENGINE_H_INCLUDED
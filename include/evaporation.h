@@ -0,0 +1,31 @@
+/**
+ * \file evaporation.h
+ *
+ * \brief Header file for evaporation.c : detection of the atoms evaporated from the cluster (EVAPORATION keyword)
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef EVAPORATION_H_INCLUDED
+#define EVAPORATION_H_INCLUDED
+
+#include <stdint.h>
+
+#include "global.h"
+
+void evaporation_init(DATA* dat);
+
+uint32_t evaporation_update(const ATOM at[], DATA* dat);
+
+int32_t evaporation_stop(const DATA* dat);
+
+void evaporation_free(DATA* dat);
+
+#endif // EVAPORATION_H_INCLUDED
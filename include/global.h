@@ -54,6 +54,12 @@
  */
 #define X12(a)  X6(a)*X6(a)
 
+/**
+ * \def BOLTZ
+ * \brief The Boltzmann constant in kJ/mol/K, i.e. in the units used by OpenMM and by the native engine
+ */
+#define BOLTZ   0.00831446261815324
+
 //define where is the null file
 #ifdef __unix__
 #define NULLFILE "/dev/null"
@@ -64,6 +70,32 @@
 /// if stdout has been redirected to a file from command line call ( -o option)
 extern uint32_t is_stdout_redirected;
 
+/**
+ * @brief A structure holding the mass charge and Lennard-Jones parameters for a given atom type
+ * See http://www.sklogwiki.org/SklogWiki/index.php/Lennard-Jones_model
+ */
+typedef struct
+{
+  char sym[4];    ///< atomic symbol
+  double mass;    ///< atomic mass
+  double charge;  ///< atomic charge ; unused in current code
+  double sig ;    ///< L-J sigma parameter
+  double eps ;    ///< L-J epsilon parameter
+} PARAMS;
+
+/**
+ * @brief The species table : parameters of each species, and the Lennard-Jones parameters of each couple
+ *  of species mixed with the Lorentz-Berthelot rules once for all, so that pair kernels only look them up.
+ *  Atoms refer to their species by its index in this table.
+ */
+typedef struct
+{
+  uint32_t n;       ///< number of species
+  PARAMS  *pars;    ///< parameters of each species, size n
+  double  *sigij;   ///< sigma_ij = (sigma_i+sigma_j)/2 in nm, n x n matrix
+  double  *epsij;   ///< epsilon_ij = sqrt(epsilon_i*epsilon_j) in kJ/mol, n x n matrix
+} SPECIES;
+
 /**
  * @brief This structure holds useful variables used across the simulations,
  * it is almost always passed by pointer from one function to another one .
@@ -72,21 +104,57 @@ typedef struct
 {
   uint32_t natom ;    ///< Number of atoms
   
-  uint8_t  platform;  ///< The OpenMM platform desired by the user ; by default fastest chosen by openMM itself
+  int8_t   platform;  ///< The platform desired by the user (see PLATFORMS in engine.h) ; by default fastest chosen by openMM itself
   
-  uint8_t  method;    ///< MD integration method string : 'LANGEVIN' or 'BROWNIAN' (case insensitive)
+  uint8_t  method;    ///< MD integration method string : 'LANGEVIN', 'BROWNIAN', 'BAOAB' or 'BROWNIAN_LM' (case insensitive)
   
   uint64_t nsteps ;   ///< Number of steps as a 64 bits integer to allow really long simulations (i.e. more than 2 billions)
 
+  uint32_t nthreads;  ///< Number of threads for the native engine and the OpenMM CPU platform ; by default the cpus of the affinity mask
+  uint32_t replicas;  ///< Number of independent replicas of the cluster integrated in lockstep by the native engine, 1 by default
+
+  int8_t   precision; ///< floating point precision of the forces (see PRECISIONS in engine.h) ; by default the one of the platform
+
   double inid ;       ///< An initial distance term used when randomly assigning coordinates to atoms when generating a cluster
   
   double T ;          ///< Temperature : in Kelvin
   uint8_t integrator; ///< The type on integrator used : Langevin (0) or Brownian (1)
   double friction ;   ///< Friction for Langevin/Brownian integrator : in ps^-1
   double timestep;    ///< Timestep for Langevin/Brownian integrator : in ps
+
+  double adaptDisp;   ///< adaptive timestep : largest displacement of an atom in one step in nm, 0 for a constant timestep
+  double adaptDtMin;  ///< adaptive timestep : smallest timestep in ps, 0 for timestep/1000
+  double adaptGrowth; ///< adaptive timestep : largest growth factor of the timestep from one step to the next
   
   double cuton;       ///< cuton value for non-bonded  interactions
   double cutoff;      ///< cutoff value for non-bonded interactions
+  uint8_t  pbc;       ///< 1 for periodic boundary conditions (NONBOND PBC BOX a b c), 0 for an isolated cluster (NONBOND NOPBC)
+  double box[3];      ///< edges of the orthorhombic periodic box in nm, used if pbc is 1
+  double skin;        ///< skin added to the cutoff for the Verlet neighbour lists of the native engine, 0 for no lists
+  uint32_t tableBins; ///< number of bins of the tabulated pair potentials of the native engine, 0 for the analytic potential
+  uint8_t  domains;   ///< 1 if the native engine splits the half neighbour list in one domain per thread (NONBOND ... DOMAINS YES)
+  uint8_t  octree;    ///< 1 if the native engine builds its neighbour lists from an adaptive octree (NONBOND ... OCTREE YES)
+
+  uint32_t respaSteps; ///< r-RESPA : the outer part of the interaction is evaluated every respaSteps steps, 0 for no splitting
+  double   respaSplit; ///< r-RESPA : distance in nm splitting the interaction in an inner and an outer part
+  double   respaHeal;  ///< r-RESPA : width in nm of the switching region ending at respaSplit
+
+  int8_t   reorder;      ///< native engine : space filling curve along which the atoms are sorted in memory (see REORDERS in engine.h)
+  uint32_t reorderEvery; ///< native engine : the atoms are sorted again every reorderEvery steps
+
+  int8_t   minimiser; ///< local energy minimisation at startup and after each block of TRSAVE steps (see MINIMISERS in engine.h) ; FIRE by default
+  double   minimTol;  ///< rms force tolerance of the minimisations in kJ/mol/nm
+  uint32_t minimMaxIter; ///< maximum number of iterations of a minimisation, 0 means until convergence
+  uint32_t minimHistory; ///< number of corrections kept by the L-BFGS minimiser
+  uint8_t  minimBlocks;  ///< 1 if a minimisation follows each block of TRSAVE steps (default), 0 for the startup one only
+
+  uint8_t  evapCheck;  ///< 1 if the evaporated atoms are looked for after each block of TRSAVE steps (EVAPORATION keyword)
+  double   evapRadius; ///< evaporation : atoms closer than this distance in nm are connected, 0 for the cutoff
+  double   evapStop;   ///< evaporation : the run stops once more than this fraction of the atoms evaporated, 0 to never stop
+  uint8_t  *evap;      ///< evaporation : 1 for the atoms (order of the ATOM keywords) dropped from the engine, NULL if not checked
+  uint32_t nevap;      ///< evaporation : number of evaporated atoms
+
+  SPECIES species;    ///< the species table, built from the PARAMS keywords
 
 #ifndef STDRAND
   dsfmt_t dsfmt;      ///< A structure used by the dSFMT random numbers generator
@@ -96,19 +164,6 @@ typedef struct
   double *rn ;        ///< to avoid calling too often dSFMT, numbers are "cached" i.e. stored in an array ; see rand.c and rand.h
 } DATA;
 
-/**
- * @brief A structure holding the mass charge and Lennard-Jones parameters for a given atom type
- * See http://www.sklogwiki.org/SklogWiki/index.php/Lennard-Jones_model
- */
-typedef struct
-{
-  char sym[4];    ///< atomic symbol
-  double mass;    ///< atomic mass
-  double charge;  ///< atomic charge ; unused in current code
-  double sig ;    ///< L-J sigma parameter
-  double eps ;    ///< L-J epsilon parameter
-} PARAMS;
-
 /**
  * @brief A structure representing the center of mass of a system, simply a point in
  * a 3-Dim space
@@ -129,8 +184,7 @@ typedef struct
     struct {double x,y,z;};         ///< X,Y,Z coordinates in anonymous struct so accessible atomically
     struct {double x,y,z;}xyz;      ///< X,Y,Z coordinates but wrapped as a named structure : for mapping it later to OpenMM Vec3 type
   };
-  char sym[4] ;   ///< atomic symbol
-  PARAMS pars;   ///< substructure containing FF parameters
+  uint32_t type;  ///< index of the species of the atom in DATA::species
 } ATOM;
 
 /**
@@ -20,6 +20,9 @@
 #define FILENAME_MAX    4096
 #endif
 
+/// the AKMA time unit of CHARMM in ps, in which the timestep of a dcd header is given
+#define AKMA_TIME_PS    0.04888821
+
 /// structure containing files path and frequency of writing, for things related to the simulation (errors handled separately)
 typedef struct
 {
@@ -49,13 +52,15 @@ extern FILE *crdfile;
 extern FILE *traj;
 extern FILE *efile;
 
-//pointer to the desired IO function
-void (*write_traj)(ATOM at[], DATA *dat, uint64_t when);
+//pointer to the desired IO function, initialised in main.c
+extern void (*write_traj)(ATOM at[], DATA *dat, uint64_t when);
 
 //read or write coordinates or trajectory files
 void read_xyz(ATOM at[], DATA *dat, FILE *inpf);
 void write_xyz(ATOM at[], DATA *dat, uint64_t when, FILE *outf);
 void write_dcd(ATOM at[], DATA *dat, uint64_t when);
+void write_dcd_to(ATOM at[], DATA *dat, FILE *f, uint32_t *header_empty);
+void write_dcd_nframes(uint32_t nframes);
 
 // BUG : restart file 
 // void write_rst(ATOM at[], DATA *dat, uint32_t meth);
@@ -0,0 +1,221 @@
+/**
+ * \file ljForces.h
+ *
+ * \brief Header file for ljForces.c : Lennard-Jones energy and forces used by the native engine
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef LJFORCES_H_INCLUDED
+#define LJFORCES_H_INCLUDED
+
+#include <math.h>
+
+#include "global.h"
+#include "cellGrid.h"
+#include "neighList.h"
+#include "neighDomains.h"
+#include "ljTable.h"
+
+/**
+ * @brief Cuton/cutoff parameters of the non-bonded interactions, in nm.
+ *
+ * The switching function is the one of OpenMM's NonbondedForce::setUseSwitchingFunction :
+ * for cuton < r < cutoff the LJ energy is multiplied by S(t) = 1 - 10 t^3 + 15 t^4 - 6 t^5 with t = (r-cuton)/(cutoff-cuton)
+ */
+typedef struct
+{
+  double cuton;     ///< switching distance
+  double cutoff;    ///< cutoff distance, INFINITY if no cutoff
+  double cuton2;    ///< cuton squared
+  double cutoff2;   ///< cutoff squared
+  double swInv;     ///< 1/(cutoff-cuton)
+  uint8_t useSwitch;///< 1 if the switching function is applied between cuton and cutoff
+} LJ_CUTS;
+
+void lj_init_cuts(LJ_CUTS* cuts, double cuton, double cutoff);
+
+double lj_forces_allpairs(uint32_t n,
+                          const double x[], const double y[], const double z[],
+                          const uint32_t type[], const SPECIES* sp,
+                          const LJ_CUTS* cuts,
+                          double fx[], double fy[], double fz[]);
+
+/**
+ * \def LJ_ALLPAIRS_TILE
+ * \brief Number of atoms of the blocks of lj_forces_allpairs_tiled : two blocks of coordinates, forces and species (~26 kB) fit in L1
+ */
+#define LJ_ALLPAIRS_TILE 256
+
+/**
+ * \def LJ_ALLPAIRS_NMAX
+ * \brief Up to this number of atoms the tiled all-pairs kernel is faster than the neighbour lists, even with a cutoff (see -bench allpairs)
+ */
+#define LJ_ALLPAIRS_NMAX 192
+
+double lj_forces_allpairs_tiled(uint32_t n,
+                                const double x[], const double y[], const double z[],
+                                const uint32_t type[], const SPECIES* sp,
+                                const LJ_CUTS* cuts,
+                                double fx[], double fy[], double fz[],
+                                double tbuf[], uint32_t nthreads);
+
+/**
+ * \def LJ_BATCH_LANES
+ * \brief The replicas of a batch (see batchInterface.c) are processed by groups of this many, the widest SIMD width
+ *  (AVX-512) : their number is padded to a multiple of it
+ */
+#define LJ_BATCH_LANES 8
+
+void lj_forces_batch(uint32_t n, uint32_t stride,
+                     const double x[], const double y[], const double z[],
+                     const uint32_t type[], const SPECIES* sp,
+                     const LJ_CUTS* cuts,
+                     double fx[], double fy[], double fz[], double epot[],
+                     uint32_t nthreads);
+
+double lj_energy_allpairs_tiled(uint32_t n,
+                                const double x[], const double y[], const double z[],
+                                const uint32_t type[], const SPECIES* sp,
+                                const LJ_CUTS* cuts, uint32_t nthreads);
+
+double lj_forces_cellgrid(const CELLGRID* grid, uint32_t n,
+                          const double x[], const double y[], const double z[],
+                          const uint32_t type[], const SPECIES* sp,
+                          const LJ_CUTS* cuts,
+                          double fx[], double fy[], double fz[]);
+
+double lj_forces_cellgrid_omp(const CELLGRID* grid, uint32_t n,
+                              const double x[], const double y[], const double z[],
+                              const uint32_t type[], const SPECIES* sp,
+                              const LJ_CUTS* cuts,
+                              double fx[], double fy[], double fz[],
+                              double tbuf[], uint32_t nthreads);
+
+double lj_forces_neighlist(const NEIGHLIST* nl, uint32_t n,
+                           const double x[], const double y[], const double z[],
+                           const uint32_t type[], const SPECIES* sp,
+                           const LJ_CUTS* cuts,
+                           double fx[], double fy[], double fz[]);
+
+double lj_forces_neighlist_omp(const NEIGHLIST* nl, uint32_t n,
+                               const double x[], const double y[], const double z[],
+                               const uint32_t type[], const SPECIES* sp,
+                               const LJ_CUTS* cuts, const LJ_TABLE* tab,
+                               double fx[], double fy[], double fz[],
+                               double tbuf[], uint32_t nthreads);
+
+double lj_forces_neighdomains(const NEIGHDOMAINS* nd, uint32_t n,
+                              const double x[], const double y[], const double z[],
+                              const SPECIES* sp, const LJ_CUTS* cuts, const LJ_TABLE* tab,
+                              double fx[], double fy[], double fz[]);
+
+double lj_forces_neighlist_full(const NEIGHLIST* nl, uint32_t n,
+                                const double x[], const double y[], const double z[],
+                                const uint32_t type[], const SPECIES* sp,
+                                const LJ_CUTS* cuts,
+                                double fx[], double fy[], double fz[],
+                                uint32_t nthreads);
+
+double lj_energy_neighlist(const NEIGHLIST* nl, uint32_t n,
+                           const double x[], const double y[], const double z[],
+                           const uint32_t type[], const SPECIES* sp,
+                           const LJ_CUTS* cuts, uint32_t nthreads);
+
+// SIMD kernels, see ljKernelSimd.c : the variant for the cpu is selected at run time, see cpuDispatch.c
+const char* lj_simd_isa();
+
+double lj_rows_neighlist_simd(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                              const double x[], const double y[], const double z[],
+                              const uint32_t type[], const SPECIES* sp,
+                              const LJ_CUTS* cuts,
+                              double fx[], double fy[], double fz[]);
+
+double lj_forces_neighlist_simd(const NEIGHLIST* nl, uint32_t n,
+                                const double x[], const double y[], const double z[],
+                                const uint32_t type[], const SPECIES* sp,
+                                const LJ_CUTS* cuts,
+                                double fx[], double fy[], double fz[]);
+
+void lj_pack_mixed(uint32_t n, const double x[], const double y[], const double z[], const uint32_t type[], float xyzt[]);
+
+double lj_forces_neighlist_mixed(const NEIGHLIST* nl, uint32_t n, const float xyzt[],
+                                 const SPECIES* sp, const LJ_CUTS* cuts,
+                                 float f4buf[], double fx[], double fy[], double fz[],
+                                 uint32_t nthreads);
+
+double lj_forces_neighlist_table(const NEIGHLIST* nl, uint32_t n,
+                                 const double x[], const double y[], const double z[],
+                                 const uint32_t type[], const LJ_TABLE* tab,
+                                 double fx[], double fy[], double fz[]);
+
+/**
+ * @brief Lennard-Jones interaction of one pair of atoms, with the OpenMM switching function
+ *
+ * @param r2 squared distance between the two atoms (nm^2)
+ * @param sig sigma_ij of the pair (nm)
+ * @param eps epsilon_ij of the pair (kJ/mol)
+ * @param cuts cuton/cutoff parameters
+ * @param ener the pair energy is added to this variable
+ * @return F/r, so that the force on atom i is (F/r)*(r_i-r_j) ; 0 beyond the cutoff
+ */
+static inline double lj_pair(double r2, double sig, double eps, const LJ_CUTS* cuts, double* ener)
+{
+  if (r2 >= cuts->cutoff2)
+    return 0.0;
+
+  const double s2  = sig*sig/r2;
+  const double s6  = s2*s2*s2;
+  const double e   = 4.0*eps*(s6*s6-s6);
+  double fr        = 24.0*eps*(2.0*s6*s6-s6)/r2;
+
+  if (cuts->useSwitch && r2 > cuts->cuton2)
+  {
+    const double r  = sqrt(r2);
+    const double t  = (r-cuts->cuton)*cuts->swInv;
+    const double sw = 1.0 + t*t*t*(-10.0 + t*(15.0 - t*6.0));
+    const double dsw= t*t*(-30.0 + t*(60.0 - t*30.0))*cuts->swInv;
+    fr = sw*fr - e*dsw/r;
+    *ener += sw*e;
+  }
+  else
+    *ener += e;
+
+  return fr;
+}
+
+/**
+ * @brief Energy only version of \b #lj_pair
+ *
+ * @param r2 squared distance between the two atoms (nm^2)
+ * @param sig sigma_ij of the pair (nm)
+ * @param eps epsilon_ij of the pair (kJ/mol)
+ * @param cuts cuton/cutoff parameters
+ * @return the pair energy, 0 beyond the cutoff
+ */
+static inline double lj_pair_energy(double r2, double sig, double eps, const LJ_CUTS* cuts)
+{
+  if (r2 >= cuts->cutoff2)
+    return 0.0;
+
+  const double s2  = sig*sig/r2;
+  const double s6  = s2*s2*s2;
+  const double e   = 4.0*eps*(s6*s6-s6);
+
+  if (cuts->useSwitch && r2 > cuts->cuton2)
+  {
+    const double t  = (sqrt(r2)-cuts->cuton)*cuts->swInv;
+    return (1.0 + t*t*t*(-10.0 + t*(15.0 - t*6.0)))*e;
+  }
+
+  return e;
+}
+
+#endif // LJFORCES_H_INCLUDED
@@ -0,0 +1,90 @@
+/**
+ * \file ljTable.h
+ *
+ * \brief Header file for ljTable.c : tabulated pair potentials, cubic splines of the energy and of F/r on r^2
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef LJTABLE_H_INCLUDED
+#define LJTABLE_H_INCLUDED
+
+#include <stdint.h>
+
+#include "global.h"
+
+/**
+ * \def LJ_TABLE_NCOEF
+ * \brief Number of coefficients per bin : a,b,c,d of the energy then a,b,c,d of F/r, so that one lookup reads one cache line
+ */
+#define LJ_TABLE_NCOEF 8
+
+/**
+ * @brief A pair potential which can be tabulated : returns F/r for the squared distance r2 and adds the energy to ener
+ */
+typedef double (*PAIR_POTENTIAL)(double r2, const void* par, double* ener);
+
+/**
+ * @brief Tables of the pair potentials of all the couples of species, on a common uniform grid in r^2.
+ *
+ * On the bin k, with t = (r^2-s0)*invh - k in [0,1), the energy is a+t*(b+t*(c+t*d)), same for F/r.
+ * The cubics are Hermite interpolants of the values and derivatives at the ends of the bins,
+ * so that the energy and the forces are continuous.
+ * Below s0 the cubics are not extrapolated : the potential of the couple is evaluated directly.
+ */
+typedef struct
+{
+  uint32_t ntypes;  ///< number of species, the table of the couple (a,b) has the index a*ntypes+b
+  uint32_t nbins;   ///< number of bins of each table
+  double s0;        ///< smallest r^2 tabulated, in nm^2
+  double s1;        ///< largest r^2 tabulated : the cutoff squared
+  double invh;      ///< inverse of the width of the bins
+  double *coef;     ///< ntypes*ntypes*nbins*LJ_TABLE_NCOEF coefficients
+  PAIR_POTENTIAL* pot;  ///< potential of each couple, NULL if not set, evaluated for r^2 < s0
+  const void** par;     ///< parameters of each potential, which have to live as long as the tables
+  void* owned;          ///< parameters allocated by lj_table_build, freed with the tables
+} LJ_TABLE;
+
+LJ_TABLE* lj_table_alloc(uint32_t ntypes, uint32_t nbins, double rmin, double cutoff);
+void lj_table_free(LJ_TABLE* tab);
+
+void lj_table_set_pair(LJ_TABLE* tab, uint32_t a, uint32_t b, PAIR_POTENTIAL pot, const void* par);
+
+LJ_TABLE* lj_table_build(const SPECIES* sp, double cuton, double cutoff, uint32_t nbins);
+
+/**
+ * @brief Interpolated pair interaction
+ *
+ * @param tab The tables
+ * @param pair Index of the couple of species, a*ntypes+b
+ * @param r2 squared distance between the two atoms (nm^2)
+ * @param ener the pair energy is added to this variable
+ * @return F/r, 0 beyond the cutoff
+ */
+static inline double lj_table_pair(const LJ_TABLE* tab, uint32_t pair, double r2, double* ener)
+{
+  if (r2 >= tab->s1)
+    return 0.0;
+
+  if (r2 < tab->s0)
+    return (tab->pot[pair] != NULL) ? tab->pot[pair](r2,tab->par[pair],ener) : 0.0;
+
+  const double u = (r2 - tab->s0)*tab->invh;
+  uint32_t k = (uint32_t) u;
+  k = (k < tab->nbins) ? k : tab->nbins-1;
+  const double t = u - (double) k;
+
+  const double* c = tab->coef + ((size_t)pair*tab->nbins + k)*LJ_TABLE_NCOEF;
+
+  *ener += c[0] + t*(c[1] + t*(c[2] + t*c[3]));
+  return   c[4] + t*(c[5] + t*(c[6] + t*c[7]));
+}
+
+#endif // LJTABLE_H_INCLUDED
@@ -0,0 +1,104 @@
+/**
+ * \file minimiser.h
+ *
+ * \brief Header file for minimiser.c : local energy minimisers shared by the engines
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef MINIMISER_H_INCLUDED
+#define MINIMISER_H_INCLUDED
+
+#include <stdint.h>
+
+#include "engine.h"
+
+/**
+ * @brief The system seen by a minimiser : positions and forces as a structure of arrays, and a function which
+ *  evaluates the forces of the current positions.
+ *
+ * The engines give their own arrays when they can (native engine) or copies (OpenMM), so that the minimiser
+ * works on the forces of the engine without rebuilding anything.
+ */
+typedef struct
+{
+  uint32_t n;                   ///< number of atoms
+  double *x,*y,*z;              ///< positions in nm, updated in place
+  const double *fx,*fy,*fz;     ///< forces in kJ/mol/nm, filled by forces()
+  const double *mass;           ///< masses in amu
+
+  /// evaluates the forces of the current positions x,y,z into fx,fy,fz and returns the potential energy
+  double (*forces)(void* ctx);
+  void* ctx;                    ///< passed to forces()
+} MINIM_SYS;
+
+/**
+ * @brief Parameters of the FIRE minimiser, see fire_default_params
+ */
+typedef struct
+{
+  double tolerance;   ///< convergence when the root mean square of the force components is below, in kJ/mol/nm
+  uint32_t maxIter;   ///< maximum number of iterations, 0 means until convergence
+
+  double dt0;         ///< initial timestep in ps
+  double dtmax;       ///< largest timestep
+  double dtmin;       ///< smallest timestep
+  double maxmove;     ///< largest displacement of an atom in one iteration, in nm
+  uint32_t ndelay;    ///< iterations after a restart before the timestep may grow
+  uint32_t nnegmax;   ///< stop after this number of successive uphill iterations
+  double finc;        ///< timestep growth factor
+  double fdec;        ///< timestep reduction factor at a restart
+  double alpha0;      ///< initial mixing coefficient
+  double falpha;      ///< mixing coefficient decrease factor
+} FIRE_PARAMS;
+
+/**
+ * @brief Parameters of the L-BFGS minimiser and of its More-Thuente line search, see lbfgs_default_params
+ */
+typedef struct
+{
+  double tolerance;   ///< convergence when the root mean square of the force components is below, in kJ/mol/nm
+  uint32_t maxIter;   ///< maximum number of iterations, 0 means until convergence
+  uint32_t history;   ///< number of corrections (s,y) kept for the inverse Hessian approximation
+
+  double ftol;        ///< sufficient decrease parameter of the line search
+  double gtol;        ///< curvature parameter of the line search
+  double xtol;        ///< relative width of the bracketing interval under which the line search stops
+  double epsf;        ///< relative energy error tolerated by the approximate Wolfe conditions
+  uint32_t maxfev;    ///< maximum force evaluations in one line search
+  double maxmove;     ///< largest displacement of an atom at the first iteration, in nm
+  double maxstep;     ///< largest displacement of an atom in one line search, in nm
+} LBFGS_PARAMS;
+
+/**
+ * @brief Outcome of a minimisation
+ */
+typedef struct
+{
+  uint32_t iter;      ///< number of iterations done
+  uint32_t nforces;   ///< number of force evaluations
+  double epot;        ///< final potential energy in kJ/mol
+  double frms;        ///< final root mean square of the force components in kJ/mol/nm
+  uint8_t converged;  ///< 1 if frms is below the tolerance
+} MINIM_STATS;
+
+void fire_default_params(FIRE_PARAMS* p, double tolerance, uint32_t maxIter);
+
+void fire_minimise(MINIM_SYS* sys, const FIRE_PARAMS* p, MINIM_STATS* stats);
+
+void lbfgs_default_params(LBFGS_PARAMS* p, double tolerance, uint32_t maxIter, uint32_t history);
+
+void lbfgs_minimise(MINIM_SYS* sys, const LBFGS_PARAMS* p, MINIM_STATS* stats);
+
+double minim_force_rms(const MINIM_SYS* sys);
+
+void minim_run(MINIM_SYS* sys, MINIMISERS algo, double tolerance, uint32_t maxIter, uint32_t history, MINIM_STATS* stats);
+
+#endif // MINIMISER_H_INCLUDED
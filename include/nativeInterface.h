@@ -0,0 +1,104 @@
+/**
+ * \file nativeInterface.h
+ *
+ * \brief Header file for nativeInterface.c : the built-in Lennard-Jones engine (PLATFORM NATIVE)
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef NATIVEINTERFACE_H_INCLUDED
+#define NATIVEINTERFACE_H_INCLUDED
+
+#include "global.h"
+#include "engine.h"
+#include "ljForces.h"
+#include "cellGrid.h"
+#include "neighList.h"
+#include "neighDomains.h"
+#include "adaptStep.h"
+#include "spaceCurve.h"
+
+/**
+ * @brief Data of the native engine : particles are stored as a structure of arrays,
+ *  using the same units than OpenMM (nm, ps, amu, kJ/mol)
+ */
+typedef struct
+{
+  uint32_t natom;         ///< Number of atoms integrated, the evaporated ones being stored after them (EVAPORATION)
+
+  double *x,*y,*z;        ///< positions in nm
+  double *vx,*vy,*vz;     ///< velocities in nm/ps
+  double *fx,*fy,*fz;     ///< forces in kJ/mol/nm, always consistent with the positions
+  double *mass;           ///< masses in amu
+  uint32_t *type;         ///< species of the atoms
+  const SPECIES* sp;      ///< species table with the mixed LJ parameters, owned by DATA
+  double *gauss;          ///< normal random numbers of one step, size 3*natom
+  double *gprev;          ///< normal random numbers of the previous step for BROWNIAN_LM, size 3*natom, NULL otherwise
+  float *xyzt;            ///< single precision positions and species packed by atom for the mixed precision forces, NULL in double precision
+  float *f4buf;           ///< per thread packed single precision force buffers (nthreads*4*natom) for the mixed precision forces
+
+  uint32_t nthreads;      ///< number of threads used for the forces
+  double *tbuf;           ///< per thread force buffers of size (nthreads-1)*3*natom, NULL if single threaded
+
+  LJ_CUTS cuts;           ///< cuton/cutoff parameters
+  CELLGRID* grid;         ///< cell grid for the pair search when SKIN is 0, NULL otherwise, if no cutoff (NONBOND NOPBC NOCUT) or for small systems
+  NEIGHLIST* nlist;       ///< Verlet neighbour list when SKIN is not 0, NULL otherwise, if no cutoff or for small systems
+  NEIGHDOMAINS* domains;  ///< nlist split in one domain per thread (NONBOND ... DOMAINS YES), NULL for the per thread buffers
+  LJ_TABLE* table;        ///< tabulated pair potentials when TABLE is given, NULL for the analytic potential
+
+  ADAPT_STEP adapt;       ///< adaptive timestep controller, adapt.maxdisp being 0 for a constant timestep
+
+  uint32_t respaSteps;    ///< r-RESPA : outer forces every respaSteps steps with BAOAB, 0 without splitting
+  LJ_CUTS icuts;          ///< r-RESPA : the inner part is the interaction switched off from SPLIT-HEAL to SPLIT
+  NEIGHLIST* ilist;       ///< neighbour list of the inner part up to respaSplit, NULL without splitting
+  double *fin;            ///< inner forces then outer forces, size 6*natom, NULL without splitting
+
+  REORDERS reorder;       ///< space filling curve along which the atoms are sorted in memory, NO_REORDER for the input order
+  uint32_t reorderEvery;  ///< the atoms are sorted again every reorderEvery steps
+  uint32_t sinceReorder;  ///< steps since the last sort
+  uint64_t nreorder;      ///< number of sorts since the start
+  uint32_t *perm;         ///< index in the ATOM list of each atom of the engine, NULL without reordering nor evaporation
+
+  double *epos;           ///< scratch positions (and forces with TABLE) of getEnergy_native, size 6*natom, NULL until first used
+  NEIGHLIST* elist;       ///< neighbour list of the positions given to getEnergy_native, NULL until first used
+
+  double epot;            ///< potential energy of the current positions
+  double time;            ///< current simulation time in ps
+
+  INTEGRATORS integrator; ///< Langevin, Brownian or BAOAB
+  double T;               ///< Temperature in K
+  double friction;        ///< friction in ps^-1
+  double timestep;        ///< timestep in ps
+
+  MINIMISERS minimiser;   ///< FIRE, LBFGS, or LOCAL for the steepest descent
+  uint32_t minimHistory;  ///< number of corrections kept by L-BFGS
+
+  DATA* dat;              ///< access to the random numbers generator
+} MyNativeData;
+
+MyNativeData* init_native(ATOM atoms[], DATA* dat);
+
+void doNsteps_native(MyNativeData* nat, int numSteps);
+
+void getState_native(MyNativeData* nat, int wantEnergy,
+                     double* timeInPs, ENERGIES* energies, double* currentTemperature,
+                     ATOM atoms[], DATA* dat);
+
+double getEnergy_native(MyNativeData* nat, const ATOM atoms[]);
+
+void minimise_native(MyNativeData* nat, double tolerance, int maxSteps);
+
+void evaporate_native(MyNativeData* nat, const uint8_t evap[]);
+
+void infos_native(const MyNativeData* nat);
+
+void terminate_native(MyNativeData* nat);
+
+#endif // NATIVEINTERFACE_H_INCLUDED
@@ -0,0 +1,65 @@
+/**
+ * \file neighDomains.h
+ *
+ * \brief Header file for neighDomains.c : half neighbour lists split in one domain per thread for a conflict free
+ *        accumulation of the reaction forces
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef NEIGHDOMAINS_H_INCLUDED
+#define NEIGHDOMAINS_H_INCLUDED
+
+#include <stdint.h>
+
+#include "neighList.h"
+
+/**
+ * @brief The rows ibeg to iend-1 of a half neighbour list, owned by one thread, renumbered locally : the own atoms are
+ *  0 to nown-1 and the other atoms they interact with (the halo) follow, so that the pair kernels accumulate all the
+ *  forces of the domain, reaction forces included, in the local arrays of the thread.
+ */
+typedef struct
+{
+  uint32_t ibeg, iend;    ///< atoms owned by the domain
+  uint32_t nown;          ///< iend-ibeg
+  uint32_t nhalo;         ///< number of atoms of the other domains in the rows of this one
+  uint32_t *halo;         ///< their indices, increasing
+  uint32_t *hstart;       ///< size ndom+1 : halo[hstart[u]] to halo[hstart[u+1]-1] are owned by the domain u
+
+  NEIGHLIST rows;         ///< the rows of the domain with the local indices (only start and list are used)
+  uint32_t lcapacity;     ///< allocated size of the local arrays
+  double *x,*y,*z;        ///< local copy of the positions, own atoms then halo
+  double *fx,*fy,*fz;     ///< local forces, own atoms then halo
+  uint32_t *type;         ///< local copy of the species
+
+  uint64_t *mark;         ///< bitmap of the halo atoms while splitting, natom bits
+  uint32_t *rank;         ///< number of marked bits before each word of mark
+} NEIGHDOMAIN;
+
+/**
+ * @brief A half neighbour list split in domains of consecutive rows, one per thread, with about the same number of pairs
+ *  (see neighdomains_update and lj_forces_neighdomains)
+ */
+typedef struct
+{
+  uint32_t natom;         ///< number of atoms
+  uint32_t ndom;          ///< number of domains
+  NEIGHDOMAIN *dom;       ///< the domains
+  uint64_t nbuild;        ///< nbuild of the neighbour list when last split
+  uint64_t nhalo;         ///< total number of halo atoms of the last split
+} NEIGHDOMAINS;
+
+NEIGHDOMAINS* neighdomains_alloc(uint32_t natom, uint32_t ndom);
+void neighdomains_free(NEIGHDOMAINS* nd);
+
+void neighdomains_update(NEIGHDOMAINS* nd, const NEIGHLIST* nl, const uint32_t type[]);
+
+#endif // NEIGHDOMAINS_H_INCLUDED
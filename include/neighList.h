@@ -0,0 +1,71 @@
+/**
+ * \file neighList.h
+ *
+ * \brief Header file for neighList.c : Verlet neighbour lists with a skin
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef NEIGHLIST_H_INCLUDED
+#define NEIGHLIST_H_INCLUDED
+
+#include <stdint.h>
+
+#include "cellGrid.h"
+#include "octree.h"
+
+/**
+ * @brief A half Verlet neighbour list (each pair i<j stored once, in the list of i), or a full one (each pair stored
+ *  in the lists of both atoms, see neighlist_alloc_full), stored in compressed rows :
+ *  the neighbours of atom i are list[start[i]] to list[start[i+1]-1].
+ *
+ * The list contains all the pairs closer than cutoff+skin when it was built, so it remains valid
+ * as long as no atom moved by more than skin/2.
+ *
+ * In a periodic box (see neighlist_set_box) the distances are those of the minimum image, which the kernels must
+ * use as well ; the coordinates are never wrapped, so that the displacements since the last build stay meaningful.
+ */
+typedef struct
+{
+  uint32_t natom;     ///< number of atoms
+  double   cutoff;    ///< cutoff of the interactions
+  double   skin;      ///< skin added to the cutoff
+  double   rlist2;    ///< (cutoff+skin)^2
+  uint8_t  full;      ///< 1 for a full list, in which the row of an atom holds all its neighbours
+  uint8_t  stale;     ///< 1 if the list has to be rebuilt at the next update whatever the displacements, see neighlist_invalidate
+  uint8_t  periodic;  ///< 1 in a periodic orthorhombic box, see neighlist_set_box
+  double   box[3];    ///< edges of the periodic box
+  double   ibox[3];   ///< inverse of the edges of the periodic box
+  double   *xw;       ///< periodic box : scratch for the coordinates wrapped in the box when building, size 3*natom
+
+  uint32_t *start;    ///< size natom+1 : first neighbour of each atom in list
+  uint32_t *list;     ///< the neighbours
+  uint32_t capacity;  ///< allocated size of list
+
+  double *x0,*y0,*z0; ///< positions at the last build
+  CELLGRID* grid;     ///< cell grid with cells of size cutoff+skin, used when building
+  OCTREE*   tree;     ///< adaptive octree used instead of the grid when building, NULL otherwise (see neighlist_set_octree)
+
+  uint64_t nbuild;    ///< number of builds since allocation
+  uint64_t nupdate;   ///< number of calls to neighlist_update since allocation
+} NEIGHLIST;
+
+NEIGHLIST* neighlist_alloc(uint32_t natom, double cutoff, double skin);
+NEIGHLIST* neighlist_alloc_full(uint32_t natom, double cutoff, double skin);
+void neighlist_free(NEIGHLIST* nl);
+
+void neighlist_set_box(NEIGHLIST* nl, const double box[3]);
+void neighlist_set_octree(NEIGHLIST* nl);
+
+void neighlist_build(NEIGHLIST* nl, const double x[], const double y[], const double z[]);
+int32_t neighlist_update(NEIGHLIST* nl, const double x[], const double y[], const double z[]);
+void neighlist_invalidate(NEIGHLIST* nl);
+
+#endif // NEIGHLIST_H_INCLUDED
@@ -0,0 +1,100 @@
+/**
+ * \file octree.h
+ *
+ * \brief Header file for octree.c : an adaptive octree of the atoms, split by occupancy and updated incrementally
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef OCTREE_H_INCLUDED
+#define OCTREE_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// default number of atoms above which a leaf is split, see octree_alloc
+#define OCTREE_LEAF_MAX 16
+
+/// a cubic node of the octree : a leaf holding a linked list of atoms, or 8 children stored consecutively
+typedef struct
+{
+  double   lo[3];   ///< lower corner of the cube
+  double   edge;    ///< edge of the cube
+  int32_t  child;   ///< first of the 8 children, -1 for a leaf ; for a free group of 8 nodes, the next free group
+  int32_t  parent;  ///< parent node, -1 for the root
+  uint32_t count;   ///< number of atoms in the subtree
+  int32_t  head;    ///< leaf : first atom, -1 if empty
+  int32_t  slot;    ///< non empty leaf : its index in the rows of octree_near_leaves
+} OCTNODE;
+
+/**
+ * @brief An octree whose leaves hold at most leafMax atoms, unless their children would be smaller than minEdge :
+ *  dense regions end up in small leaves and sparse ones in large leaves, so that the memory follows the number of
+ *  atoms whatever the extent of the system (a droplet and the atoms evaporated far away from it).
+ *
+ * The root (node 0) grows when an atom leaves it and shrinks when the atoms gather in one of its children.
+ * octree_update only moves the atoms which left the cube of their leaf, splitting the leaves which became too full
+ * and merging the nodes which became too empty. The tree is unit agnostic.
+ */
+typedef struct
+{
+  uint32_t natom;       ///< capacity in atoms
+  uint32_t nbuilt;      ///< number of atoms at the last octree_build, 0 if never built
+  uint32_t leafMax;     ///< a leaf with more atoms is split ...
+  double   minEdge;     ///< ... unless its children would have an edge smaller than this
+
+  OCTNODE  *nodes;      ///< the nodes, the root first
+  uint32_t nnodes;      ///< nodes in use or in the free groups
+  uint32_t capacity;    ///< allocated nodes
+  int32_t  freeGroup;   ///< first free group of 8 nodes, -1 if none
+
+  int32_t  *leaf;       ///< leaf of each atom
+  int32_t  *next,*prev; ///< atoms of a leaf, doubly linked so that an atom is unlinked in constant time
+
+  uint32_t nleaves;     ///< non empty leaves found by octree_near_leaves
+  int32_t  *leaves;     ///< the non empty leaves
+  uint32_t *lstart;     ///< size nleaves+1 : first near leaf of each leaf in lnear
+  int32_t  *lnear;      ///< the leaves closer than the search distance of each non empty leaf, itself included
+  uint32_t lcapacity;   ///< allocated size of leaves and lstart
+  uint32_t ncapacity;   ///< allocated size of lnear
+  int32_t  *stack;      ///< traversal scratch
+  uint32_t scapacity;   ///< allocated size of stack
+
+  uint64_t nbuild;      ///< number of builds from scratch
+  uint64_t nupdate;     ///< number of incremental updates
+  uint64_t nmoved;      ///< atoms moved to another leaf by the incremental updates
+} OCTREE;
+
+/// squared distance from a point to the cube of a node, 0 inside
+static inline double octree_point_dist2(const OCTNODE* nd, double x, double y, double z)
+{
+  const double p[3] = {x, y, z};
+  double d2 = 0.0;
+  for(uint32_t d=0; d<3; d++)
+  {
+    const double below = nd->lo[d] - p[d];
+    const double above = p[d] - (nd->lo[d]+nd->edge);
+    d2 += (below > 0.0) ? below*below : ((above > 0.0) ? above*above : 0.0);
+  }
+  return d2;
+}
+
+OCTREE* octree_alloc(uint32_t natom, double minEdge, uint32_t leafMax);
+void octree_free(OCTREE* t);
+
+void octree_build(OCTREE* t, uint32_t n, const double x[], const double y[], const double z[]);
+void octree_update(OCTREE* t, uint32_t n, const double x[], const double y[], const double z[]);
+
+void octree_near_leaves(OCTREE* t, double r);
+
+uint32_t octree_depth(const OCTREE* t);
+size_t octree_memory(const OCTREE* t);
+
+#endif // OCTREE_H_INCLUDED
@@ -18,6 +18,7 @@
 #define OMMINTERFACE_H_INCLUDED
 
 #include "global.h"
+#include "engine.h"
 #include "OpenMMCWrapper.h"
 
 typedef struct {
@@ -25,27 +26,13 @@ typedef struct {
   OpenMM_Context*     context;
   OpenMM_Integrator*  integrator;
   const char*         platformName;
+  OpenMM_Context*     econtext;     ///< second context for the energies of other positions (getEnergy_omm), NULL until first used
+  OpenMM_Integrator*  eintegrator;  ///< integrator of econtext, never used for integrating
+  OpenMM_Vec3Array*   epos;         ///< positions in nm given to econtext
+  MINIMISERS          minimiser;    ///< FIRE or LBFGS on the forces of context, or LOCAL for OpenMM_LocalEnergyMinimizer
+  uint32_t            minimHistory; ///< number of corrections kept by L-BFGS
 } MyOpenMMData;
 
-typedef enum
-{
-  AUTO= -1, //< AUTO : let OpenMM find the fastest platform
-  REF = 0,  //< REF  : on cpu, not optimised, nor parallellised
-  CPU = 1,  //< CPU  : on cpu, optimised, parallellised with OpenMP
-  CUDA= 2,  //< OCL  : on cpu or gpu or any accelerating device available
-  OCL = 3   //< CUDA : on nvidia gpu only probably the fastest
-} PLATFORMS;
-
-extern const char* ommPlatformName[4];
-
-typedef enum
-{
-  LANGEVIN = 0,     //< code will use a Langevin integrator from OpenMM
-  BROWNIAN = 1      //< code will use a Brownian integrator (i.e. overdamped Langevin) from OpenMM
-} INTEGRATORS;
-
-extern const char* integratorsName[2];
-
 MyOpenMMData* init_omm(ATOM atoms[], DATA* dat);
 
 void doNsteps_omm(MyOpenMMData* omm, int numSteps);
@@ -54,6 +41,10 @@ void getState_omm(MyOpenMMData* omm, int wantEnergy,
                   double* timeInPs, ENERGIES* energies, double* currentTemperature,
                   ATOM atoms[], DATA* dat);
 
+double getEnergy_omm(MyOpenMMData* omm, const ATOM atoms[]);
+
+void minimise_omm(MyOpenMMData* omm, double tolerance, int maxSteps);
+
 void infos_omm(const MyOpenMMData* omm);
 
 void terminate_omm(MyOpenMMData* omm);
@@ -20,7 +20,10 @@
 double get_next(DATA *dat);
 
 /// get a normally distributed random number
-// double get_BoxMuller(DATA *dat);
+double get_BoxMuller(DATA *dat);
+
+/// fill an array with normally distributed random numbers
+void get_BoxMuller_array(DATA *dat, double g[], uint32_t n);
 
 /// if we want to test the random numbers generators
 // void test_norm_distrib(DATA *dat, uint32_t n);
@@ -0,0 +1,32 @@
+/**
+ * \file spaceCurve.h
+ *
+ * \brief Header file for spaceCurve.c : ordering of the atoms along a Morton or Hilbert space filling curve
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef SPACECURVE_H_INCLUDED
+#define SPACECURVE_H_INCLUDED
+
+#include <stdint.h>
+
+#include "engine.h"
+
+/// bits per coordinate of the keys : 3*SFC_BITS bits in a 64 bits key
+#define SFC_BITS 21
+
+uint64_t sfc_morton_key(uint32_t ix, uint32_t iy, uint32_t iz);
+uint64_t sfc_hilbert_key(uint32_t ix, uint32_t iy, uint32_t iz);
+
+void sfc_order(uint32_t n, const double x[], const double y[], const double z[],
+               REORDERS curve, uint32_t order[]);
+
+#endif // SPACECURVE_H_INCLUDED
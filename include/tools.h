@@ -16,17 +16,36 @@
 #ifndef TOOLS_H_INCLUDED
 #define TOOLS_H_INCLUDED
 
+#include "cellGrid.h"
+
 /// fill a coordinates vector with one two or three random numbers
 void get_vector(DATA *dat,int32_t mv_direction, double vec[3]);
 
 ///build an initial cluster of atoms for starting simulation
 void build_cluster(ATOM at[], DATA *dat, uint32_t from, uint32_t to, int32_t mode);
 ///check if some atoms are too close from each other
-int32_t  no_conflict(ATOM at[],uint32_t i);
+int32_t  no_conflict(ATOM at[], const SPECIES* sp, const CELLGRID* grid, uint32_t i);
 
 ///get centre of mass of the system
 CM getCM(ATOM at[],DATA *dat);
 ///recentre the system to origin
 void recentre(ATOM at[], DATA *dat);
+///wrap the coordinates in the periodic box
+void wrap_box(ATOM at[], DATA *dat);
+
+///index of a species in the species table, -1 if not found
+int32_t species_find(const SPECIES* sp, const char sym[]);
+///removes the species of the table used by none of the atoms
+void species_compact(SPECIES* sp, ATOM at[], uint32_t natom);
+///mixed Lennard-Jones parameters of all the couples of species
+void species_mix(SPECIES* sp);
+///free the species table
+void species_free(SPECIES* sp);
+
+///number of cpus available to the process
+uint32_t get_ncpus_affinity();
+
+///wall clock time in seconds
+double get_wtime();
 
 #endif // TOOLS_H_INCLUDED
@@ -0,0 +1,111 @@
+/**
+ * \file adaptStep.c
+ *
+ * \brief Adaptive timestep controller of the native engine : the timestep is reduced when an atom would move
+ *  too far in one step (close contacts of random initial structures, hot collisions) and grows back afterwards.
+ *  The engine only gives the largest squared velocity and acceleration of its atoms.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <math.h>
+
+#include "global.h"
+#include "logger.h"
+#include "engine.h"
+#include "adaptStep.h"
+
+/**
+ * @brief Initialises the controller from the ADAPTIVE keyword and the integrator of the METHOD keyword
+ */
+void adapt_init(ADAPT_STEP* a, const DATA* dat)
+{
+  a->maxdisp    = dat->adaptDisp;
+  a->dtmax      = dat->timestep;
+  a->dtmin      = (dat->adaptDtMin > 0.0) ? dat->adaptDtMin : 1.0e-3*dat->timestep;
+  a->growth     = dat->adaptGrowth;
+  a->friction   = dat->friction;
+  a->overdamped = (dat->integrator == BROWNIAN || dat->integrator == BROWNIAN_LM);
+
+  a->dt = a->dtmax;
+
+  a->nsteps   = 0;
+  a->nreduced = 0;
+  a->nfloor   = 0;
+  a->dtlow    = a->dtmax;
+}
+
+/**
+ * @brief Length of the next step
+ *
+ * @param a The controller, updated
+ * @param v2max Largest squared velocity of an atom in (nm/ps)^2, unused by the overdamped integrators
+ * @param a2max Largest squared acceleration F/m of an atom in (nm/ps^2)^2
+ * @param remaining Time left until the end of the block in ps : the step is clipped to it, and a remainder
+ *  shorter than one step is shared between the last two steps of the block
+ * @return The timestep in ps
+ */
+double adapt_next(ADAPT_STEP* a, double v2max, double a2max, double remaining)
+{
+  const double d  = a->maxdisp;
+  const double ac = sqrt(a2max);
+
+  // the largest dt for which the displacement of the fastest atom stays below maxdisp
+  double dlim = INFINITY;
+  if(a->overdamped)
+  {
+    if(ac > 0.0)
+      dlim = d*a->friction/ac;
+  }
+  else
+  {
+    // root of v dt + a dt^2/2 = d, written without cancellation
+    const double v = sqrt(v2max);
+    if(v > 0.0 || ac > 0.0)
+      dlim = 2.0*d/(v + sqrt(v*v + 2.0*ac*d));
+  }
+
+  double dt = fmin(fmin(dlim,a->growth*a->dt),a->dtmax);
+  if(dt < a->dtmin)
+  {
+    dt = a->dtmin;
+    a->nfloor++;
+  }
+  a->dt = dt;
+
+  // tolerance for the rounding errors of the time accumulated by the engine
+  if(remaining <= (1.0+1.0e-9)*dt)
+    dt = remaining;
+  else if(remaining < 2.0*dt)
+    dt = 0.5*remaining;
+
+  a->nsteps++;
+  a->nreduced += (dt < (1.0-1.0e-9)*a->dtmax);
+  a->dtlow = fmin(a->dtlow,dt);
+
+  return dt;
+}
+
+/**
+ * @brief Logs the steps taken for a block of the given duration, and resets the counters
+ */
+void adapt_report(ADAPT_STEP* a, double duration)
+{
+  LOG_PRINT(LOG_INFO,"Adaptive timestep : %"PRIu64" steps for %lf ps, %"PRIu64" shorter than %lf ps, shortest %le ps\n",
+            a->nsteps,duration,a->nreduced,a->dtmax,a->dtlow);
+  if(a->nfloor > 0)
+    LOG_PRINT(LOG_WARNING,"Warning : adaptive timestep : %"PRIu64" steps at the smallest timestep %le ps would have required a shorter one\n",
+              a->nfloor,a->dtmin);
+
+  a->nsteps   = 0;
+  a->nreduced = 0;
+  a->nfloor   = 0;
+  a->dtlow    = a->dtmax;
+}
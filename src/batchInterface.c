@@ -0,0 +1,479 @@
+/**
+ * \file batchInterface.c
+ *
+ * \brief Independent replicas of the same small cluster integrated in lockstep by the native engine (REPLICAS keyword) :
+ *        one replica per SIMD lane, instead of one process per trajectory.
+ *
+ * \details The positions, velocities and forces of the replicas are interleaved (see MyBatchData), so that the same
+ *          atom of SIMD_W replicas is one vector : the pair kernel lj_batch_allpairs visits all the pairs of SIMD_W
+ *          replicas at once without any gather, and the elementwise update kernels of the native engine run
+ *          unchanged on the natom*stride values. Each replica has its own random numbers generator, seeded from the
+ *          one of DATA, so that its trajectory does not depend on the number of replicas nor of threads.
+ *          The integrators are the ones of nativeInterface.c, without the options meant for large systems
+ *          (neighbour lists, tables, RESPA, adaptive timestep, reordering).
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "global.h"
+#include "logger.h"
+#include "rand.h"
+#include "cpuDispatch.h"
+#include "minimiser.h"
+#include "batchInterface.h"
+
+// -----------------------------------------------------------------------------
+//              COMPUTE FORCES AND ENERGIES FOR THE CURRENT POSITIONS
+// -----------------------------------------------------------------------------
+static void forces_batch(MyBatchData* bat)
+{
+  lj_forces_batch(bat->natom,bat->stride,bat->x,bat->y,bat->z,bat->type,bat->sp,&(bat->cuts),
+                  bat->fx,bat->fy,bat->fz,bat->epot,bat->nthreads);
+}
+
+// -----------------------------------------------------------------------------
+//     NORMAL RANDOM NUMBERS OF ONE STEP, FROM THE GENERATOR OF EACH REPLICA
+// -----------------------------------------------------------------------------
+static void noise_batch(MyBatchData* bat, double g[])
+{
+  const uint32_t n  = bat->natom;
+  const uint32_t nr = bat->nrep;
+  const size_t ns = (size_t)n*bat->stride;
+
+  // rand() of the C library is shared by all the replicas
+#if defined(_OPENMP) && !defined(STDRAND)
+  #pragma omp parallel for num_threads(bat->nthreads) schedule(static) if(bat->nthreads > 1)
+#endif
+  for(uint32_t r=0; r<nr; r++)
+  {
+    double* gr = bat->graw + (size_t)r*3*n;
+    get_BoxMuller_array(&(bat->rdat[r]),gr,3*n);
+    // the padding lanes keep a zero noise
+    for(uint32_t c=0; c<3; c++)
+      for(uint32_t i=0; i<n; i++)
+        g[c*ns + (size_t)i*bat->stride + r] = gr[c*n+i];
+  }
+}
+
+/* --------------------------------------------------------------------------
+ *                      INITIALIZE BATCH DATA STRUCTURES
+ * --------------------------------------------------------------------------
+ */
+MyBatchData* init_batch(ATOM atoms[], DATA* dat)
+{
+  MyBatchData* bat = (MyBatchData*)malloc(sizeof(MyBatchData));
+
+  const uint32_t n  = dat->natom;
+  const uint32_t nr = dat->replicas;
+  const uint32_t st = (nr+LJ_BATCH_LANES-1)/LJ_BATCH_LANES*LJ_BATCH_LANES;
+  const size_t ns = (size_t)n*st;
+
+  bat->natom  = n;
+  bat->nrep   = nr;
+  bat->stride = st;
+
+  bat->x  = calloc(ns,sizeof(double));
+  bat->y  = calloc(ns,sizeof(double));
+  bat->z  = calloc(ns,sizeof(double));
+  bat->vx = calloc(ns,sizeof(double));
+  bat->vy = calloc(ns,sizeof(double));
+  bat->vz = calloc(ns,sizeof(double));
+  bat->fx = calloc(ns,sizeof(double));
+  bat->fy = calloc(ns,sizeof(double));
+  bat->fz = calloc(ns,sizeof(double));
+  bat->mass  = calloc(ns,sizeof(double));
+  bat->amass = calloc(n,sizeof(double));
+  bat->type  = calloc(n,sizeof(uint32_t));
+  bat->sp    = &(dat->species);
+  bat->gauss = calloc(3*ns,sizeof(double));
+  bat->gprev = NULL;
+  bat->graw  = malloc(3*(size_t)n*nr*sizeof(double));
+  bat->epot  = calloc(st,sizeof(double));
+  bat->mbuf  = NULL;
+
+  bat->integrator = (INTEGRATORS) dat->integrator;
+  bat->T        = dat->T;
+  bat->friction = dat->friction;
+  bat->timestep = dat->timestep;
+  bat->time     = 0.0;
+  bat->minimiser = (MINIMISERS) dat->minimiser;
+  bat->minimHistory = dat->minimHistory;
+  bat->nthreads = (dat->nthreads > 0) ? dat->nthreads : 1;
+
+  if((bat->integrator == BROWNIAN || bat->integrator == BROWNIAN_LM) && !(bat->friction > 0.0))
+  {
+    LOG_PRINT(LOG_ERROR,"Error : the Brownian integrator requires a strictly positive friction (%lf given)\n",bat->friction);
+    exit(-1);
+  }
+
+  // the all-pairs batch kernel has no periodic images
+  if(dat->pbc)
+  {
+    LOG_PRINT(LOG_ERROR,"Error : REPLICAS are isolated clusters : NONBOND PBC is not available\n");
+    exit(-1);
+  }
+
+  if(bat->minimiser == LOCAL)
+  {
+    LOG_PRINT(LOG_WARNING,"Warning : MINIMIZE LOCAL is not available with REPLICAS : using FIRE\n");
+    bat->minimiser = FIRE;
+  }
+
+  if(n > LJ_ALLPAIRS_NMAX)
+    LOG_PRINT(LOG_WARNING,"Warning : REPLICAS visits all the pairs of each replica, slow for %d atoms (meant for up to %d)\n",
+              n,LJ_ALLPAIRS_NMAX);
+
+  // the options of the native engine for large systems do not apply to the replicas
+  if(dat->platform != NATIVE && dat->platform != AUTO)
+    LOG_PRINT(LOG_WARNING,"Warning : REPLICAS runs on the NATIVE platform only : platform %d ignored\n",dat->platform);
+  if(dat->tableBins > 0 || dat->precision == SINGLE || dat->precision == MIXED || dat->domains || dat->octree)
+    LOG_PRINT(LOG_WARNING,"Warning : REPLICAS visits all the pairs in double precision : TABLE, PRECISION, DOMAINS and OCTREE ignored\n");
+  if(dat->respaSteps > 1 || dat->adaptDisp > 0.0 || dat->reorder != NO_REORDER)
+    LOG_PRINT(LOG_WARNING,"Warning : REPLICAS uses a constant timestep and the separate force and update kernels : "
+              "RESPA, ADAPTIVE and REORDER ignored\n");
+  if(dat->evapCheck)
+    LOG_PRINT(LOG_WARNING,"Warning : EVAPORATION is not available with REPLICAS : ignored\n");
+
+  lj_init_cuts(&(bat->cuts),dat->cuton,dat->cutoff);
+
+  /*
+   * one generator per replica, keyed by two numbers of the main generator and the index of the replica :
+   *  the trajectories only depend on the seed of the command line
+   */
+  bat->rdat = calloc(nr,sizeof(DATA));
+  for(uint32_t r=0; r<nr; r++)
+  {
+    DATA* rd = &(bat->rdat[r]);
+    rd->nrn = 2048;
+    rd->rn  = calloc(rd->nrn,sizeof(double));
+#ifndef STDRAND
+    uint32_t key[3];
+    key[0] = (uint32_t)(4294967296.0*get_next(dat));
+    key[1] = (uint32_t)(4294967296.0*get_next(dat));
+    key[2] = r;
+    rd->seeds = NULL;
+    dsfmt_init_by_array(&(rd->dsfmt),key,3);
+#endif
+  }
+
+  // coordinates are in angstroems in the ATOM list but the engine works in nm ; all the lanes start from the same positions
+  for(uint32_t i=0; i<n; i++)
+  {
+    bat->type[i]  = atoms[i].type;
+    bat->amass[i] = bat->sp->pars[atoms[i].type].mass;
+    for(uint32_t r=0; r<st; r++)
+    {
+      const size_t k = (size_t)i*st+r;
+      bat->x[k] = 0.1*atoms[i].x;
+      bat->y[k] = 0.1*atoms[i].y;
+      bat->z[k] = 0.1*atoms[i].z;
+      bat->mass[k] = bat->amass[i];
+    }
+  }
+
+  // velocities of each replica at the initial temperature (Maxwell-Boltzmann), without centre of mass motion
+  for(uint32_t r=0; r<nr; r++)
+  {
+    DATA* rd = &(bat->rdat[r]);
+    double px=0.0, py=0.0, pz=0.0, mtot=0.0;
+    for(uint32_t i=0; i<n; i++)
+    {
+      const size_t k = (size_t)i*st+r;
+      const double sd = sqrt(BOLTZ*bat->T/bat->amass[i]);
+      bat->vx[k] = sd*get_BoxMuller(rd);
+      bat->vy[k] = sd*get_BoxMuller(rd);
+      bat->vz[k] = sd*get_BoxMuller(rd);
+      px += bat->amass[i]*bat->vx[k];
+      py += bat->amass[i]*bat->vy[k];
+      pz += bat->amass[i]*bat->vz[k];
+      mtot += bat->amass[i];
+    }
+    for(uint32_t i=0; i<n; i++)
+    {
+      const size_t k = (size_t)i*st+r;
+      bat->vx[k] -= px/mtot;
+      bat->vy[k] -= py/mtot;
+      bat->vz[k] -= pz/mtot;
+    }
+  }
+
+  // the Leimkuhler-Matthews scheme needs the noise of the step before the first one
+  if(bat->integrator == BROWNIAN_LM)
+  {
+    bat->gprev = calloc(3*ns,sizeof(double));
+    noise_batch(bat,bat->gprev);
+  }
+
+  forces_batch(bat);
+
+  return bat;
+}
+
+// -----------------------------------------------------------------------------
+//                  TAKE MULTIPLE STEPS FOR ALL THE REPLICAS
+// -----------------------------------------------------------------------------
+/**
+ * @brief The integrators of the native engine (see steps_native), each kernel updating all the replicas at once
+ *
+ * @param bat Batch data
+ * @param numSteps Number of steps
+ */
+void doNsteps_batch(MyBatchData* bat, int numSteps)
+{
+  const uint32_t ns = bat->natom*bat->stride;
+  const double kT   = BOLTZ*bat->T;
+  const double dt   = bat->timestep;
+
+  switch(bat->integrator)
+  {
+    case LANGEVIN:
+    {
+      const double vscale = exp(-dt*bat->friction);
+      const double fscale = (bat->friction > 0.0) ? (1.0-vscale)/bat->friction : dt;
+      const double nscale = sqrt(kT*(1.0-vscale*vscale));
+
+      for(int s=0; s<numSteps; s++)
+      {
+        noise_batch(bat,bat->gauss);
+        kernels.langevin_update(ns,bat->mass,dt,vscale,fscale,nscale,
+                                bat->fx,bat->fy,bat->fz,
+                                bat->gauss,bat->gauss+ns,bat->gauss+2*(size_t)ns,
+                                bat->vx,bat->vy,bat->vz,
+                                bat->x,bat->y,bat->z);
+        forces_batch(bat);
+        bat->time += dt;
+      }
+      break;
+    }
+
+    case BAOAB:
+    {
+      const double vscale = exp(-dt*bat->friction);
+      const double nscale = sqrt(kT*(1.0-vscale*vscale));
+
+      // the last kick of a step and the first one of the next step use the same forces : they are merged
+      for(int s=0; s<numSteps; s++)
+      {
+        noise_batch(bat,bat->gauss);
+        kernels.baoab_update(ns,bat->mass,(s==0) ? 0.5*dt : dt,0.5*dt,vscale,nscale,
+                             bat->fx,bat->fy,bat->fz,
+                             bat->gauss,bat->gauss+ns,bat->gauss+2*(size_t)ns,
+                             bat->vx,bat->vy,bat->vz,
+                             bat->x,bat->y,bat->z);
+        forces_batch(bat);
+        bat->time += dt;
+      }
+      // on-step velocities at the end
+      if(numSteps > 0)
+        kernels.kick_update(ns,bat->mass,0.5*dt,bat->fx,bat->fy,bat->fz,bat->vx,bat->vy,bat->vz);
+      break;
+    }
+
+    case BROWNIAN:
+    {
+      for(int s=0; s<numSteps; s++)
+      {
+        noise_batch(bat,bat->gauss);
+        kernels.brownian_update(ns,bat->mass,dt,bat->friction,kT,
+                                bat->fx,bat->fy,bat->fz,
+                                bat->gauss,bat->gauss+ns,bat->gauss+2*(size_t)ns,
+                                bat->vx,bat->vy,bat->vz,
+                                bat->x,bat->y,bat->z);
+        forces_batch(bat);
+        bat->time += dt;
+      }
+      break;
+    }
+
+    case BROWNIAN_LM:
+    {
+      for(int s=0; s<numSteps; s++)
+      {
+        noise_batch(bat,bat->gauss);
+        kernels.brownian_lm_update(ns,bat->mass,dt,bat->friction,kT,
+                                   bat->fx,bat->fy,bat->fz,
+                                   bat->gauss,bat->gauss+ns,bat->gauss+2*(size_t)ns,
+                                   bat->gprev,bat->gprev+ns,bat->gprev+2*(size_t)ns,
+                                   bat->vx,bat->vy,bat->vz,
+                                   bat->x,bat->y,bat->z);
+        // the noise of this step is the previous one of the next step
+        double* const g = bat->gauss;
+        bat->gauss = bat->gprev;
+        bat->gprev = g;
+        forces_batch(bat);
+        bat->time += dt;
+      }
+      break;
+    }
+
+    default:
+      LOG_PRINT(LOG_ERROR,"Error : invalid integrator type %d\n",bat->integrator);
+      exit(-1);
+      break;
+  }
+}
+
+/* --------------------------------------------------------------------------
+ *                COPY THE STATE OF ONE REPLICA TO AN ATOM LIST
+ * -------------------------------------------------------------------------- */
+/**
+ * @brief Time, energies and positions of one replica
+ *
+ * @param bat Batch data
+ * @param r The replica, from 0 to nrep-1
+ * @param wantEnergy 0 for the positions only
+ * @param timeInPs The time, the same for all the replicas
+ * @param energies Energies of the replica in kJ/mol
+ * @param atoms Positions of the replica in angstroems
+ */
+void getState_batch(MyBatchData* bat, uint32_t r, int wantEnergy,
+                    double* timeInPs, ENERGIES* energies, ATOM atoms[])
+{
+  const uint32_t st = bat->stride;
+
+  *timeInPs = bat->time;
+
+  for(uint32_t i=0; i<bat->natom; i++)
+  {
+    atoms[i].x = 10.0*bat->x[(size_t)i*st+r];
+    atoms[i].y = 10.0*bat->y[(size_t)i*st+r];
+    atoms[i].z = 10.0*bat->z[(size_t)i*st+r];
+  }
+
+  if (wantEnergy)
+  {
+    double ekin = 0.0;
+    for(uint32_t i=0; i<bat->natom; i++)
+    {
+      const size_t k = (size_t)i*st+r;
+      ekin += bat->amass[i]*(X2(bat->vx[k]) + X2(bat->vy[k]) + X2(bat->vz[k]));
+    }
+
+    energies->epot = bat->epot[r];
+    energies->ekin = 0.5*ekin;
+    energies->etot = energies->epot + energies->ekin;
+  }
+}
+
+// -----------------------------------------------------------------------------
+//                     LOCAL ENERGY MINIMISATION
+// -----------------------------------------------------------------------------
+/// one replica copied to contiguous arrays for the minimisers of minimiser.c
+typedef struct
+{
+  const MyBatchData* bat;
+  double *x,*y,*z,*fx,*fy,*fz;
+} BATCH_MINIM;
+
+/// forces of the current positions of one replica, single threaded as the replicas are minimised in parallel
+static double minim_forces_batch(void* ctx)
+{
+  BATCH_MINIM* bm = (BATCH_MINIM*)ctx;
+  return lj_forces_allpairs_tiled(bm->bat->natom,bm->x,bm->y,bm->z,bm->bat->type,bm->bat->sp,&(bm->bat->cuts),
+                                  bm->fx,bm->fy,bm->fz,NULL,1);
+}
+
+/**
+ * @brief Local energy minimisation of each replica with FIRE or L-BFGS, one replica per thread ; velocities are not modified
+ *
+ * @param bat Batch data
+ * @param tolerance root mean square of the force components for convergence, in kJ/mol/nm
+ * @param maxSteps maximum number of iterations, 0 means until convergence
+ */
+void minimise_batch(MyBatchData* bat, double tolerance, int maxSteps)
+{
+  const uint32_t n  = bat->natom;
+  const uint32_t st = bat->stride;
+
+  if(bat->mbuf == NULL)
+    bat->mbuf = malloc(6*(size_t)n*bat->nrep*sizeof(double));
+
+  uint64_t iter = 0, nforces = 0;
+  uint32_t nconv = 0;
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(bat->nthreads) schedule(dynamic,1) reduction(+:iter,nforces,nconv) if(bat->nthreads > 1)
+#endif
+  for(uint32_t r=0; r<bat->nrep; r++)
+  {
+    double* b = bat->mbuf + 6*(size_t)n*r;
+    BATCH_MINIM bm = { bat, b, b+n, b+2*n, b+3*n, b+4*n, b+5*n };
+
+    for(uint32_t i=0; i<n; i++)
+    {
+      bm.x[i] = bat->x[(size_t)i*st+r];
+      bm.y[i] = bat->y[(size_t)i*st+r];
+      bm.z[i] = bat->z[(size_t)i*st+r];
+    }
+
+    MINIM_SYS sys = { n, bm.x, bm.y, bm.z, bm.fx, bm.fy, bm.fz, bat->amass, &minim_forces_batch, &bm };
+    MINIM_STATS stats;
+    minim_run(&sys,bat->minimiser,tolerance,(uint32_t)maxSteps,bat->minimHistory,&stats);
+
+    for(uint32_t i=0; i<n; i++)
+    {
+      bat->x[(size_t)i*st+r] = bm.x[i];
+      bat->y[(size_t)i*st+r] = bm.y[i];
+      bat->z[(size_t)i*st+r] = bm.z[i];
+    }
+
+    iter += stats.iter;
+    nforces += stats.nforces;
+    nconv += stats.converged ? 1 : 0;
+  }
+
+  // forces and energies consistent with the minimised positions
+  forces_batch(bat);
+
+  LOG_PRINT(LOG_DEBUG,"Batch %s minimisation of %d replicas : %.1lf iterations and %.1lf force evaluations per replica, %d converged\n",
+            minimisersName[bat->minimiser],bat->nrep,(double)iter/bat->nrep,(double)nforces/bat->nrep,nconv);
+}
+
+// -----------------------------------------------------------------------------
+//             print some information about the batched engine
+// -----------------------------------------------------------------------------
+void infos_batch(const MyBatchData* bat)
+{
+  LOG_PRINT(LOG_INFO,"Native engine running %d replicas of %d atoms in lockstep with %d threads\n",bat->nrep,bat->natom,bat->nthreads);
+  LOG_PRINT(LOG_INFO," Replicas interleaved by groups of %d (%d padding lanes), one per SIMD lane of the pair kernel (%s)\n",
+            LJ_BATCH_LANES,bat->stride-bat->nrep,lj_simd_isa());
+  LOG_PRINT(LOG_INFO," Integrator : %s | T = %lf K | friction = %lf ps^-1 | timestep = %lf ps\n",
+            integratorsName[bat->integrator],bat->T,bat->friction,bat->timestep);
+  LOG_PRINT(LOG_INFO," Switching function : %s | cuton = %lf nm | cutoff = %lf nm\n",
+            bat->cuts.useSwitch ? "yes" : "no",bat->cuts.cuton,bat->cuts.cutoff);
+  LOG_PRINT(LOG_INFO," Integrator and random numbers kernels : %s variant, one random numbers generator per replica\n",kernels.name);
+}
+
+// -----------------------------------------------------------------------------
+//                     DEALLOCATE BATCH OBJECTS
+// -----------------------------------------------------------------------------
+void terminate_batch(MyBatchData* bat)
+{
+  free(bat->x);  free(bat->y);  free(bat->z);
+  free(bat->vx); free(bat->vy); free(bat->vz);
+  free(bat->fx); free(bat->fy); free(bat->fz);
+  free(bat->mass);
+  free(bat->amass);
+  free(bat->type);
+  free(bat->gauss);
+  free(bat->gprev);
+  free(bat->graw);
+  free(bat->epot);
+  free(bat->mbuf);
+  for(uint32_t r=0; r<bat->nrep; r++)
+    free(bat->rdat[r].rn);
+  free(bat->rdat);
+  free(bat);
+}
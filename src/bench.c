@@ -0,0 +1,1969 @@
+/**
+ * \file bench.c
+ *
+ * \brief Benchmarks of the native engine, run with : langevin_LJ -bench [name|all] -bench_nmax [max number of atoms]
+ *
+ * \details Results are printed to stdout as plain text tables. Systems are argon clusters built on a
+ *          jittered simple cubic lattice at about the liquid density, so that no pair is too close.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "global.h"
+#include "bench.h"
+#include "rand.h"
+#include "logger.h"
+#include "ljForces.h"
+#include "ljTable.h"
+#include "neighList.h"
+#include "octree.h"
+#include "cpuDispatch.h"
+#include "tools.h"
+#include "engine.h"
+#include "batchInterface.h"
+#include "minimiser.h"
+#include "spaceCurve.h"
+
+/// a benchmark : a name used on the command line, and the function running it
+typedef struct
+{
+  const char* name;
+  const char* descr;
+  void (*run)(DATA *dat, uint32_t nmax);
+} BENCH;
+
+/// a test system for the benchmarks, structure of arrays in nm
+typedef struct
+{
+  uint32_t n;
+  double *x,*y,*z;
+  double *fx,*fy,*fz;
+  uint32_t *type;
+  SPECIES sp;
+} BENCH_SYS;
+
+/**
+ * @brief Allocates an argon cluster of n atoms : a cube of a simple cubic lattice of step 0.38 nm (close to the LJ minimum)
+ *  with a random jitter of +/- 0.02 nm
+ */
+static BENCH_SYS* bench_sys_alloc(DATA *dat, uint32_t n)
+{
+  BENCH_SYS* s = malloc(sizeof(BENCH_SYS));
+  s->n = n;
+  s->x  = malloc(n*sizeof(double));
+  s->y  = malloc(n*sizeof(double));
+  s->z  = malloc(n*sizeof(double));
+  s->fx = malloc(n*sizeof(double));
+  s->fy = malloc(n*sizeof(double));
+  s->fz = malloc(n*sizeof(double));
+  s->type = calloc(n,sizeof(uint32_t));
+
+  // a single species : argon
+  s->sp.n = 1;
+  s->sp.pars  = malloc(sizeof(PARAMS));
+  s->sp.sigij = NULL;
+  s->sp.epsij = NULL;
+  snprintf(s->sp.pars[0].sym,sizeof(s->sp.pars[0].sym),"AR");
+  s->sp.pars[0].mass   = 39.948;
+  s->sp.pars[0].charge = 0.0;
+  s->sp.pars[0].sig    = 0.3380;
+  s->sp.pars[0].eps    = 0.997680;
+  species_mix(&(s->sp));
+
+  const uint32_t side = (uint32_t) ceil(cbrt((double)n));
+  const double a = 0.38;
+
+  for(uint32_t i=0; i<n; i++)
+  {
+    s->x[i] = a*(i%side)        + 0.04*(get_next(dat)-0.5);
+    s->y[i] = a*((i/side)%side) + 0.04*(get_next(dat)-0.5);
+    s->z[i] = a*(i/(side*side)) + 0.04*(get_next(dat)-0.5);
+  }
+
+  return s;
+}
+
+static void bench_sys_free(BENCH_SYS* s)
+{
+  free(s->x);  free(s->y);  free(s->z);
+  free(s->fx); free(s->fy); free(s->fz);
+  free(s->type);
+  species_free(&(s->sp));
+  free(s);
+}
+
+/// every timing runs for at least BENCH_TMIN seconds and BENCH_NMIN calls, see bench_time (and bench_octree_time, whose setup is not timed)
+#define BENCH_TMIN 0.3
+#define BENCH_NMIN 3
+
+/**
+ * @brief Wall time of one call of fn, the same method for all the benchmarks : fn(ctx) is called until
+ *  at least BENCH_TMIN seconds have elapsed and BENCH_NMIN calls were made
+ *
+ * @param fn The function timed
+ * @param ctx Its argument
+ * @return The mean time of a call in seconds
+ */
+static double bench_time(void (*fn)(void* ctx), void* ctx)
+{
+  uint32_t neval = 0;
+  const double t0 = get_wtime();
+  double t1 = t0;
+  do
+  {
+    fn(ctx);
+    neval++;
+    t1 = get_wtime();
+  } while(t1-t0 < BENCH_TMIN || neval < BENCH_NMIN);
+
+  return (t1-t0)/neval;
+}
+
+/// forces of the system s on the neighbour list nl with the per thread buffers tbuf, timed by bench_time
+typedef struct
+{
+  BENCH_SYS* s;
+  NEIGHLIST* nl;
+  const LJ_CUTS* cuts;
+  const LJ_TABLE* tab;
+  double* tbuf;
+  uint32_t nthreads;
+  double e;         ///< energy of the last evaluation
+} BENCH_NEIGHLIST;
+
+static void bench_neighlist_forces(void* ctx)
+{
+  BENCH_NEIGHLIST* b = (BENCH_NEIGHLIST*)ctx;
+  BENCH_SYS* s = b->s;
+  b->e = lj_forces_neighlist_omp(b->nl,s->n,s->x,s->y,s->z,s->type,&(s->sp),b->cuts,b->tab,s->fx,s->fy,s->fz,b->tbuf,b->nthreads);
+}
+
+static void bench_neighlist_build(void* ctx)
+{
+  BENCH_NEIGHLIST* b = (BENCH_NEIGHLIST*)ctx;
+  neighlist_build(b->nl,b->s->x,b->s->y,b->s->z);
+}
+
+// -----------------------------------------------------------------------------
+//      STRONG SCALING OF THE MULTITHREADED NEIGHBOUR LIST FORCE EVALUATION
+// -----------------------------------------------------------------------------
+static void bench_scaling(DATA *dat, uint32_t nmax)
+{
+  LJ_CUTS cuts;
+  lj_init_cuts(&cuts,1.2,1.4);
+
+  fprintf(stdout,"\n# Strong scaling of the native force evaluation (neighbour lists, cuton 1.2 nm, cutoff 1.4 nm, SIMD %s)\n",lj_simd_isa());
+  fprintf(stdout,"# %10s %8s %14s %10s %10s\n","natom","threads","ms/evaluation","speedup","efficiency");
+
+  for(uint32_t n=1000; n<=nmax && n<=1000000; n*=10)
+  {
+    BENCH_SYS* s = bench_sys_alloc(dat,n);
+    NEIGHLIST* nl = neighlist_alloc(n,cuts.cutoff,0.1);
+    neighlist_build(nl,s->x,s->y,s->z);
+
+    double* tbuf = (dat->nthreads > 1) ? malloc((size_t)(dat->nthreads-1)*3*n*sizeof(double)) : NULL;
+    double tref = 0.0;
+
+    // 1, 2, 4, ... threads and finally all of them
+    for(uint32_t nt=1; ; nt*=2)
+    {
+      nt = (nt < dat->nthreads) ? nt : dat->nthreads;
+
+      BENCH_NEIGHLIST b = {s, nl, &cuts, NULL, tbuf, nt, 0.0};
+      const double t = bench_time(&bench_neighlist_forces,&b);
+      if(nt == 1)
+        tref = t;
+
+      fprintf(stdout,"  %10d %8d %14.4lf %10.2lf %10.2lf\n",n,nt,1.0e3*t,tref/t,tref/t/nt);
+
+      if(nt == dat->nthreads)
+        break;
+    }
+
+    free(tbuf);
+    neighlist_free(nl);
+    bench_sys_free(s);
+  }
+}
+
+// -----------------------------------------------------------------------------
+//      COMPARISON OF THE SSE2 / AVX2 / AVX-512 VARIANTS OF THE HOT KERNELS
+// -----------------------------------------------------------------------------
+
+/// the hot kernels of the selected variant on the system s, timed by bench_time
+typedef struct
+{
+  DATA* dat;
+  BENCH_SYS* s;
+  NEIGHLIST* nl;
+  const LJ_CUTS* cuts;
+  double *mass,*v,*g;
+} BENCH_ISA;
+
+static void bench_isa_forces(void* ctx)
+{
+  BENCH_ISA* b = (BENCH_ISA*)ctx;
+  BENCH_SYS* s = b->s;
+  lj_forces_neighlist_simd(b->nl,s->n,s->x,s->y,s->z,s->type,&(s->sp),b->cuts,s->fx,s->fy,s->fz);
+}
+
+static void bench_isa_langevin(void* ctx)
+{
+  BENCH_ISA* b = (BENCH_ISA*)ctx;
+  BENCH_SYS* s = b->s;
+  const uint32_t n = s->n;
+  // zero noise and tiny timestep : the system is not modified between two calls
+  kernels.langevin_update(n,b->mass,1.0e-12,1.0,0.0,0.0,s->fx,s->fy,s->fz,b->g,b->g+n,b->g+2*n,
+                          b->v,b->v+n,b->v+2*n,s->x,s->y,s->z);
+}
+
+static void bench_isa_gauss(void* ctx)
+{
+  BENCH_ISA* b = (BENCH_ISA*)ctx;
+  get_BoxMuller_array(b->dat,b->g,3*b->s->n);
+}
+
+static void bench_isa(DATA *dat, uint32_t nmax)
+{
+  static const char* const isas[] = {"sse2","avx2","avx512"};
+
+  const uint32_t n = (nmax < 100000) ? nmax : 100000;
+
+  LJ_CUTS cuts;
+  lj_init_cuts(&cuts,1.2,1.4);
+
+  BENCH_SYS* s = bench_sys_alloc(dat,n);
+  NEIGHLIST* nl = neighlist_alloc(n,cuts.cutoff,0.1);
+  neighlist_build(nl,s->x,s->y,s->z);
+
+  double *mass = malloc(n*sizeof(double));
+  double *v    = calloc(3*n,sizeof(double));
+  double *g    = malloc(3*n*sizeof(double));
+  for(uint32_t i=0; i<n; i++)
+    mass[i] = 39.948;
+
+  // reference : the scalar kernel, pair by pair with lj_pair
+  double *fref = malloc(3*(size_t)n*sizeof(double));
+  const double eref = lj_forces_neighlist(nl,n,s->x,s->y,s->z,s->type,&(s->sp),&cuts,fref,fref+n,fref+2*n);
+
+  const KERNELS best = kernels;
+
+  fprintf(stdout,"\n# Variants of the hot kernels, %d atoms (single thread) ; errors of the pair kernel against the scalar one\n",n);
+  fprintf(stdout,"# (lj_forces_neighlist, lj_pair) : relative on the energy, largest relative error on the force of an atom\n");
+  fprintf(stdout,"# %8s %10s %16s %16s %16s | %10s %10s\n","variant","pair isa","forces (ms)","langevin (us)","gauss 3N (us)",
+          "dE/E","max dF/F");
+
+  for(uint32_t k=0; k<sizeof(isas)/sizeof(isas[0]); k++)
+  {
+    if(kernels_select(isas[k]))
+    {
+      fprintf(stdout,"  %8s %10s\n",isas[k],"not available on this cpu");
+      continue;
+    }
+
+    const double e = lj_forces_neighlist_simd(nl,n,s->x,s->y,s->z,s->type,&(s->sp),&cuts,s->fx,s->fy,s->fz);
+    double dfmax = 0.0;
+    for(uint32_t i=0; i<n; i++)
+    {
+      const double d2 = X2(s->fx[i]-fref[i]) + X2(s->fy[i]-fref[n+i]) + X2(s->fz[i]-fref[2*n+i]);
+      const double f2 = X2(fref[i]) + X2(fref[n+i]) + X2(fref[2*n+i]);
+      dfmax = fmax(dfmax,sqrt(d2/f2));
+    }
+
+    BENCH_ISA b = {dat, s, nl, &cuts, mass, v, g};
+    const double t[3] = {bench_time(&bench_isa_forces,&b), bench_time(&bench_isa_langevin,&b), bench_time(&bench_isa_gauss,&b)};
+
+    fprintf(stdout,"  %8s %10s %16.4lf %16.2lf %16.2lf | %10.2le %10.2le\n",kernels.name,kernels.lj_kernel_isa(),
+            1.0e3*t[0],1.0e6*t[1],1.0e6*t[2],fabs(e-eref)/fabs(eref),dfmax);
+  }
+
+  kernels = best;
+
+  free(fref);
+  free(mass);
+  free(v);
+  free(g);
+  neighlist_free(nl);
+  bench_sys_free(s);
+}
+
+// -----------------------------------------------------------------------------
+//      MIXED AGAINST DOUBLE PRECISION FORCES, FOR EACH VARIANT OF THE KERNELS
+// -----------------------------------------------------------------------------
+typedef struct
+{
+  BENCH_SYS* s;
+  NEIGHLIST* nl;
+  const LJ_CUTS* cuts;
+  float *xyzt,*f4;
+  double e;
+} BENCH_PRECISION;
+
+static void bench_precision_double(void* ctx)
+{
+  BENCH_PRECISION* b = (BENCH_PRECISION*)ctx;
+  BENCH_SYS* s = b->s;
+  b->e = lj_forces_neighlist_simd(b->nl,s->n,s->x,s->y,s->z,s->type,&(s->sp),b->cuts,s->fx,s->fy,s->fz);
+}
+
+static void bench_precision_mixed(void* ctx)
+{
+  BENCH_PRECISION* b = (BENCH_PRECISION*)ctx;
+  BENCH_SYS* s = b->s;
+  // packing is part of the cost of a mixed precision force evaluation
+  lj_pack_mixed(s->n,s->x,s->y,s->z,s->type,b->xyzt);
+  b->e = lj_forces_neighlist_mixed(b->nl,s->n,b->xyzt,&(s->sp),b->cuts,b->f4,s->fx,s->fy,s->fz,1);
+}
+
+static void bench_precision(DATA *dat, uint32_t nmax)
+{
+  static const char* const isas[] = {"sse2","avx2","avx512"};
+
+  const uint32_t n = (nmax < 100000) ? nmax : 100000;
+
+  LJ_CUTS cuts;
+  lj_init_cuts(&cuts,1.2,1.4);
+
+  BENCH_SYS* s = bench_sys_alloc(dat,n);
+  NEIGHLIST* nl = neighlist_alloc(n,cuts.cutoff,0.1);
+  neighlist_build(nl,s->x,s->y,s->z);
+
+  float  *xyzt = malloc(4*(size_t)n*sizeof(float));
+  float  *f4   = malloc(4*(size_t)n*sizeof(float));
+  double *fref = malloc(3*(size_t)n*sizeof(double));
+
+  const KERNELS best = kernels;
+
+  fprintf(stdout,"\n# Mixed precision (single precision pair terms, double precision sums) against double precision forces, %d atoms (single thread)\n",n);
+  fprintf(stdout,"# errors : relative on the energy, rms and max on the forces relative to the rms force\n");
+  fprintf(stdout,"# %8s %14s %14s %9s %12s %12s %12s\n","variant","double (ms)","mixed (ms)","speedup","dE/E","rms dF","max dF");
+
+  for(uint32_t k=0; k<sizeof(isas)/sizeof(isas[0]); k++)
+  {
+    if(kernels_select(isas[k]))
+    {
+      fprintf(stdout,"  %8s %14s\n",isas[k],"not available on this cpu");
+      continue;
+    }
+
+    BENCH_PRECISION bp = {s, nl, &cuts, xyzt, f4, 0.0};
+    double t[2], e[2];
+
+    t[0] = bench_time(&bench_precision_double,&bp);
+    e[0] = bp.e;
+    memcpy(fref,s->fx,n*sizeof(double));
+    memcpy(fref+n,s->fy,n*sizeof(double));
+    memcpy(fref+2*n,s->fz,n*sizeof(double));
+
+    t[1] = bench_time(&bench_precision_mixed,&bp);
+    e[1] = bp.e;
+
+    double f2 = 0.0, df2 = 0.0, dfmax = 0.0;
+    for(uint32_t i=0; i<n; i++)
+    {
+      const double d2 = X2(s->fx[i]-fref[i]) + X2(s->fy[i]-fref[n+i]) + X2(s->fz[i]-fref[2*n+i]);
+      f2  += X2(fref[i]) + X2(fref[n+i]) + X2(fref[2*n+i]);
+      df2 += d2;
+      dfmax = (d2 > dfmax) ? d2 : dfmax;
+    }
+
+    fprintf(stdout,"  %8s %14.4lf %14.4lf %9.2lf %12.3e %12.3e %12.3e\n",kernels.name,1.0e3*t[0],1.0e3*t[1],t[0]/t[1],
+            fabs(e[1]-e[0])/fabs(e[0]),sqrt(df2/f2),sqrt(dfmax/(f2/n)));
+  }
+
+  kernels = best;
+
+  free(xyzt);
+  free(f4);
+  free(fref);
+  neighlist_free(nl);
+  bench_sys_free(s);
+}
+
+// -----------------------------------------------------------------------------
+//      TABULATED PAIR POTENTIALS AGAINST THE ANALYTIC KERNEL : SPEED AND ACCURACY
+// -----------------------------------------------------------------------------
+typedef struct
+{
+  BENCH_SYS* s;
+  NEIGHLIST* nl;
+  const LJ_CUTS* cuts;
+  const LJ_TABLE* tab;
+  double e;
+} BENCH_TABLE;
+
+static void bench_table_analytic(void* ctx)
+{
+  BENCH_TABLE* b = (BENCH_TABLE*)ctx;
+  BENCH_SYS* s = b->s;
+  b->e = lj_forces_neighlist_simd(b->nl,s->n,s->x,s->y,s->z,s->type,&(s->sp),b->cuts,s->fx,s->fy,s->fz);
+}
+
+static void bench_table_tabulated(void* ctx)
+{
+  BENCH_TABLE* b = (BENCH_TABLE*)ctx;
+  BENCH_SYS* s = b->s;
+  b->e = lj_forces_neighlist_table(b->nl,s->n,s->x,s->y,s->z,s->type,b->tab,s->fx,s->fy,s->fz);
+}
+
+static void bench_table(DATA *dat, uint32_t nmax)
+{
+  static const uint32_t nbins[] = {256, 1024, 4096, 16384, 65536};
+
+  // the rare gases of input_file.inp, randomly mixed, so that all the tables of the couples are used
+  static const PARAMS gases[] =
+  {
+    {"NE",  20.1797, 0.0, 0.2790, 0.304958},
+    {"AR",  39.9480, 0.0, 0.3380, 0.997680},
+    {"KR",  83.7980, 0.0, 0.3600, 1.421694},
+    {"XE", 131.2930, 0.0, 0.4100, 1.837394}
+  };
+  const uint32_t nsp = sizeof(gases)/sizeof(PARAMS);
+
+  const uint32_t n = (nmax < 100000) ? nmax : 100000;
+  const double cuton = 1.2, cutoff = 1.4;
+
+  LJ_CUTS cuts;
+  lj_init_cuts(&cuts,cuton,cutoff);
+
+  BENCH_SYS* s = bench_sys_alloc(dat,n);
+  s->sp.n = nsp;
+  s->sp.pars = realloc(s->sp.pars,nsp*sizeof(PARAMS));
+  memcpy(s->sp.pars,gases,sizeof(gases));
+  species_mix(&(s->sp));
+  for(uint32_t i=0; i<n; i++)
+    s->type[i] = (uint32_t)(nsp*get_next(dat)) % nsp;
+
+  NEIGHLIST* nl = neighlist_alloc(n,cuts.cutoff,0.1);
+  neighlist_build(nl,s->x,s->y,s->z);
+
+  // reference : the analytic kernel
+  double *fref = malloc(3*n*sizeof(double));
+  BENCH_TABLE bt = {s, nl, &cuts, NULL, 0.0};
+  const double tref = bench_time(&bench_table_analytic,&bt);
+  const double eref = bt.e;
+  memcpy(fref,s->fx,n*sizeof(double));
+  memcpy(fref+n,s->fy,n*sizeof(double));
+  memcpy(fref+2*n,s->fz,n*sizeof(double));
+
+  double f2ref = 0.0;
+  for(uint32_t i=0; i<3*n; i++)
+    f2ref += fref[i]*fref[i];
+
+  fprintf(stdout,"\n# Tabulated pair potentials, %d atoms of %d species, cutoff %.2lf nm, kernels %s (single thread)\n",n,nsp,cutoff,kernels.name);
+  fprintf(stdout,"# analytic kernel : %.4lf ms per force evaluation, epot %.6lf kJ/mol\n",1.0e3*tref,eref);
+  fprintf(stdout,"# errors of the system : relative on the energy, rms and max on the forces relative to the rms force\n");
+  fprintf(stdout,"# errors of the pairs  : max over all couples of species for sigma_ij*0.85 < r < cutoff, energy relative to epsilon_ij, F/r relative to its value at sigma_ij\n");
+  fprintf(stdout,"# %8s %10s %10s %12s %9s %12s %12s %12s %12s %12s\n","bins","size (kB)","build (ms)","forces (ms)","speedup",
+          "sys dE/E","sys rms dF","sys max dF","pair dE","pair dF/r");
+
+  for(uint32_t b=0; b<sizeof(nbins)/sizeof(nbins[0]); b++)
+  {
+    const double t0 = get_wtime();
+    LJ_TABLE* tab = lj_table_build(&(s->sp),cuton,cutoff,nbins[b]);
+    const double tbuild = get_wtime()-t0;
+
+    bt.tab = tab;
+    const double ttab = bench_time(&bench_table_tabulated,&bt);
+    const double epot = bt.e;
+
+    double df2 = 0.0, dfmax = 0.0;
+    for(uint32_t i=0; i<n; i++)
+    {
+      const double d2 = X2(s->fx[i]-fref[i]) + X2(s->fy[i]-fref[n+i]) + X2(s->fz[i]-fref[2*n+i]);
+      df2 += d2;
+      dfmax = (d2 > dfmax) ? d2 : dfmax;
+    }
+    const double frms = sqrt(f2ref/n);
+
+    // dense scan of the distances of each couple of species, not only the ones of the lattice
+    double pde = 0.0, pdf = 0.0;
+    for(uint32_t p=0; p<nsp*nsp; p++)
+    {
+      const double sig = s->sp.sigij[p], eps = s->sp.epsij[p];
+      double e0 = 0.0;
+      const double fr0 = fabs(lj_pair(sig*sig,sig,eps,&cuts,&e0));
+      for(uint32_t k=0; k<=100000; k++)
+      {
+        const double r = 0.85*sig + (cutoff-0.85*sig)*k/100001.0;
+        double ea = 0.0, et = 0.0;
+        const double fa = lj_pair(r*r,sig,eps,&cuts,&ea);
+        const double ft = lj_table_pair(tab,p,r*r,&et);
+        pde = (fabs(et-ea)/eps > pde) ? fabs(et-ea)/eps : pde;
+        pdf = (fabs(ft-fa)/fr0 > pdf) ? fabs(ft-fa)/fr0 : pdf;
+      }
+    }
+
+    fprintf(stdout,"  %8d %10.1lf %10.3lf %12.4lf %9.2lf %12.3e %12.3e %12.3e %12.3e %12.3e\n",
+            nbins[b],(double)nsp*nsp*nbins[b]*LJ_TABLE_NCOEF*sizeof(double)/1024.0,1.0e3*tbuild,1.0e3*ttab,tref/ttab,
+            fabs(epot-eref)/fabs(eref),sqrt(df2/n)/frms,sqrt(dfmax)/frms,pde,pdf);
+
+    lj_table_free(tab);
+  }
+
+  free(fref);
+  neighlist_free(nl);
+  bench_sys_free(s);
+}
+
+// -----------------------------------------------------------------------------
+//      TILED ALL-PAIRS KERNEL AGAINST NEIGHBOUR LISTS FOR SMALL SYSTEMS
+// -----------------------------------------------------------------------------
+
+/// one force evaluation with the given method : 0 scalar all pairs, 1 tiled, 2 neighbour list, 3 list build
+typedef struct
+{
+  BENCH_SYS* s;
+  NEIGHLIST* nl;
+  const LJ_CUTS* cuts;
+  uint32_t method;
+} BENCH_ALLPAIRS;
+
+static void bench_allpairs_forces(void* ctx)
+{
+  BENCH_ALLPAIRS* b = (BENCH_ALLPAIRS*)ctx;
+  BENCH_SYS* s = b->s;
+  switch(b->method)
+  {
+    case 0:
+      lj_forces_allpairs(s->n,s->x,s->y,s->z,s->type,&(s->sp),b->cuts,s->fx,s->fy,s->fz);
+      break;
+    case 1:
+      lj_forces_allpairs_tiled(s->n,s->x,s->y,s->z,s->type,&(s->sp),b->cuts,s->fx,s->fy,s->fz,NULL,1);
+      break;
+    case 2:
+      lj_forces_neighlist_simd(b->nl,s->n,s->x,s->y,s->z,s->type,&(s->sp),b->cuts,s->fx,s->fy,s->fz);
+      break;
+    default:
+      neighlist_build(b->nl,s->x,s->y,s->z);
+      break;
+  }
+}
+
+/// average time in seconds of one force evaluation with the given method, see BENCH_ALLPAIRS
+static double bench_allpairs_time(BENCH_SYS* s, NEIGHLIST* nl, const LJ_CUTS* cuts, uint32_t method)
+{
+  BENCH_ALLPAIRS b = {s, nl, cuts, method};
+  return bench_time(&bench_allpairs_forces,&b);
+}
+
+static void bench_allpairs(DATA *dat, uint32_t nmax)
+{
+  LJ_CUTS cuts, nocut;
+  lj_init_cuts(&cuts,1.2,1.4);
+  lj_init_cuts(&nocut,INFINITY,INFINITY);
+
+  fprintf(stdout,"\n# Tiled all-pairs kernel (blocks of %d atoms, SIMD %s) against neighbour lists (skin 0.1 nm), single thread\n",
+          LJ_ALLPAIRS_TILE,lj_simd_isa());
+  fprintf(stdout,"# times in us per evaluation ; 'rebuild' is the cost of one list build, amortised over the steps between two builds\n");
+  fprintf(stdout,"# %8s | %12s %12s %12s %12s | %12s %12s %10s\n","natom",
+          "scalar","tiled","nlist","rebuild","scalar NOCUT","tiled NOCUT","max |dF|");
+
+  for(uint32_t n=32; n<=nmax && n<=16384; n*=2)
+  {
+    BENCH_SYS* s = bench_sys_alloc(dat,n);
+    NEIGHLIST* nl = neighlist_alloc(n,cuts.cutoff,0.1);
+    neighlist_build(nl,s->x,s->y,s->z);
+
+    // agreement between the scalar and the tiled kernels without cutoff
+    double *fref = malloc(3*n*sizeof(double));
+    lj_forces_allpairs(n,s->x,s->y,s->z,s->type,&(s->sp),&nocut,fref,fref+n,fref+2*n);
+    lj_forces_allpairs_tiled(n,s->x,s->y,s->z,s->type,&(s->sp),&nocut,s->fx,s->fy,s->fz,NULL,1);
+    double dfmax = 0.0;
+    for(uint32_t i=0; i<n; i++)
+    {
+      dfmax = fmax(dfmax,fabs(s->fx[i]-fref[i]));
+      dfmax = fmax(dfmax,fabs(s->fy[i]-fref[n+i]));
+      dfmax = fmax(dfmax,fabs(s->fz[i]-fref[2*n+i]));
+    }
+
+    double t[6];
+    for(uint32_t m=0; m<4; m++)
+      t[m] = bench_allpairs_time(s,nl,&cuts,m);
+    t[4] = bench_allpairs_time(s,nl,&nocut,0);
+    t[5] = bench_allpairs_time(s,nl,&nocut,1);
+
+    fprintf(stdout,"  %8d | %12.2lf %12.2lf %12.2lf %12.2lf | %12.2lf %12.2lf %10.2e\n",n,
+            1.0e6*t[0],1.0e6*t[1],1.0e6*t[2],1.0e6*t[3],1.0e6*t[4],1.0e6*t[5],dfmax);
+
+    free(fref);
+    neighlist_free(nl);
+    bench_sys_free(s);
+  }
+}
+
+// -----------------------------------------------------------------------------
+//      ENERGY ONLY EVALUATIONS AGAINST FORCES AND ENERGY
+// -----------------------------------------------------------------------------
+
+/// one call of the engine : 0 getState with energy, 1 getEnergy of the current positions, 2 getEnergy of trial positions
+typedef struct
+{
+  ENGINE* eng;
+  ATOM* at;
+  DATA* dat;
+  uint32_t what;
+  uint32_t ncall;
+} BENCH_ENERGY_ENGINE;
+
+static void bench_energy_engine_call(void* ctx)
+{
+  BENCH_ENERGY_ENGINE* b = (BENCH_ENERGY_ENGINE*)ctx;
+  ENGINE* eng = b->eng;
+  double time, temp;
+  ENERGIES ener;
+
+  switch(b->what)
+  {
+    case 0:
+      eng->getState(eng->data,1,&time,&ener,&temp,b->at,b->dat);
+      break;
+    case 1:
+      eng->getEnergy(eng->data,NULL);
+      break;
+    default:
+      // Monte Carlo like trial move of one atom, by 0.05 angstroem
+      b->at[b->ncall%b->dat->natom].x += (b->ncall%2) ? -0.05 : 0.05;
+      eng->getEnergy(eng->data,b->at);
+      break;
+  }
+  b->ncall++;
+}
+
+/// average time in seconds of one call of the engine, see BENCH_ENERGY_ENGINE
+static double bench_energy_engine_time(ENGINE* eng, ATOM at[], DATA* dat, uint32_t what)
+{
+  // the first call builds the neighbour list (or the second OpenMM Context) of the trial positions
+  if(what == 2)
+    eng->getEnergy(eng->data,at);
+
+  BENCH_ENERGY_ENGINE b = {eng, at, dat, what, 0};
+  return bench_time(&bench_energy_engine_call,&b);
+}
+
+/// one evaluation : 0 neighbour list forces, 1 neighbour list energy, 2 tiled forces, 3 tiled energy
+typedef struct
+{
+  BENCH_SYS* s;
+  NEIGHLIST* nl;
+  const LJ_CUTS* cuts;
+  double* tbuf;
+  uint32_t nthreads;
+  uint32_t kernel;
+  double e;
+} BENCH_ENERGY;
+
+static void bench_energy_eval(void* ctx)
+{
+  BENCH_ENERGY* b = (BENCH_ENERGY*)ctx;
+  BENCH_SYS* s = b->s;
+  const uint32_t n = s->n;
+  switch(b->kernel)
+  {
+    case 0:
+      b->e = lj_forces_neighlist_omp(b->nl,n,s->x,s->y,s->z,s->type,&(s->sp),b->cuts,NULL,s->fx,s->fy,s->fz,b->tbuf,b->nthreads);
+      break;
+    case 1:
+      b->e = lj_energy_neighlist(b->nl,n,s->x,s->y,s->z,s->type,&(s->sp),b->cuts,b->nthreads);
+      break;
+    case 2:
+      b->e = lj_forces_allpairs_tiled(n,s->x,s->y,s->z,s->type,&(s->sp),b->cuts,s->fx,s->fy,s->fz,b->tbuf,b->nthreads);
+      break;
+    default:
+      b->e = lj_energy_allpairs_tiled(n,s->x,s->y,s->z,s->type,&(s->sp),b->cuts,b->nthreads);
+      break;
+  }
+}
+
+static void bench_energy(DATA *dat, uint32_t nmax)
+{
+  LJ_CUTS cuts;
+  lj_init_cuts(&cuts,1.2,1.4);
+
+  fprintf(stdout,"\n# Energy only kernels against forces and energy (cuton 1.2 nm, cutoff 1.4 nm, SIMD %s, %d threads), us per evaluation\n",
+          lj_simd_isa(),dat->nthreads);
+  fprintf(stdout,"# %8s | %12s %12s %8s | %12s %12s %8s\n","natom","nlist F+E","nlist E","ratio","tiled F+E","tiled E","ratio");
+
+  for(uint32_t n=100; n<=nmax && n<=1000000; n*=10)
+  {
+    BENCH_SYS* s = bench_sys_alloc(dat,n);
+    NEIGHLIST* nl = neighlist_alloc(n,cuts.cutoff,0.1);
+    neighlist_build(nl,s->x,s->y,s->z);
+    double* tbuf = (dat->nthreads > 1) ? malloc((size_t)(dat->nthreads-1)*3*n*sizeof(double)) : NULL;
+
+    // the all-pairs kernels only up to 10^4 atoms
+    const uint32_t nk = (n <= 10000) ? 4 : 2;
+    double t[4] = {0.0,0.0,0.0,0.0};
+    double e[4] = {0.0,0.0,0.0,0.0};
+    for(uint32_t k=0; k<nk; k++)
+    {
+      BENCH_ENERGY b = {s, nl, &cuts, tbuf, dat->nthreads, k, 0.0};
+      t[k] = bench_time(&bench_energy_eval,&b);
+      e[k] = b.e;
+    }
+
+    if(fabs(e[1]-e[0]) > 1.0e-9*fabs(e[0]) || fabs(e[3]-e[2]) > 1.0e-9*fabs(e[2]))
+      fprintf(stdout,"  [Warning] energies differ : %.10lf %.10lf | %.10lf %.10lf\n",e[0],e[1],e[2],e[3]);
+
+    if(nk == 4)
+      fprintf(stdout,"  %8d | %12.2lf %12.2lf %8.2lf | %12.2lf %12.2lf %8.2lf\n",n,
+              1.0e6*t[0],1.0e6*t[1],t[0]/t[1],1.0e6*t[2],1.0e6*t[3],t[2]/t[3]);
+    else
+      fprintf(stdout,"  %8d | %12.2lf %12.2lf %8.2lf | %12s %12s %8s\n",n,
+              1.0e6*t[0],1.0e6*t[1],t[0]/t[1],"-","-","-");
+
+    free(tbuf);
+    neighlist_free(nl);
+    bench_sys_free(s);
+  }
+
+  // the same through the ENGINE interface, for each backend built
+#ifdef USE_OMM
+  static const int8_t platforms[] = {NATIVE, AUTO};
+#else
+  static const int8_t platforms[] = {NATIVE};
+#endif
+
+  fprintf(stdout,"\n# ENGINE interface : getState with energy (positions, velocities and energy copied back) against getEnergy, us per call\n");
+  fprintf(stdout,"# %8s %10s | %14s %14s %14s\n","natom","platform","getState","getEnergy","getEnergy trial");
+
+  for(uint32_t p=0; p<sizeof(platforms)/sizeof(platforms[0]); p++)
+  {
+    for(uint32_t n=100; n<=nmax && n<=100000; n*=10)
+    {
+      BENCH_SYS* s = bench_sys_alloc(dat,n);
+
+      ATOM* at = malloc(n*sizeof(ATOM));
+      for(uint32_t i=0; i<n; i++)
+      {
+        at[i].x = 10.0*s->x[i];
+        at[i].y = 10.0*s->y[i];
+        at[i].z = 10.0*s->z[i];
+        at[i].type = 0;
+      }
+
+      // a copy of the common data describing this system
+      DATA d = *dat;
+      d.natom      = n;
+      d.platform   = platforms[p];
+      d.integrator = LANGEVIN;
+      d.T          = 100.0;
+      d.friction   = 1.0;
+      d.timestep   = 0.001;
+      d.cuton      = cuts.cuton;
+      d.cutoff     = cuts.cutoff;
+      d.skin       = 0.1;
+      d.tableBins  = 0;
+      d.domains    = 0;
+      d.octree     = 0;
+      d.replicas   = 1;
+      d.respaSteps = 0;
+      d.adaptDisp  = 0.0;
+      d.reorder    = NO_REORDER;
+      d.precision  = PREC_DEFAULT;
+      d.species    = s->sp;
+
+      ENGINE* eng = init_engine(at,&d);
+
+      double t[3];
+      for(uint32_t w=0; w<3; w++)
+        t[w] = bench_energy_engine_time(eng,at,&d,w);
+
+      fprintf(stdout,"  %8d %10s | %14.2lf %14.2lf %14.2lf\n",n,eng->platformName,1.0e6*t[0],1.0e6*t[1],1.0e6*t[2]);
+
+      terminate_engine(eng);
+      free(at);
+      bench_sys_free(s);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+//      CONFIGURATIONAL SAMPLING OF THE LANGEVIN AND BAOAB INTEGRATORS VERSUS THE TIMESTEP
+// -----------------------------------------------------------------------------
+
+/// a native engine without cutoff for the argon cluster at, on a copy of the common data
+static ENGINE* bench_baoab_engine(DATA *dat, DATA *d, ATOM at[], const SPECIES* sp, uint32_t n,
+                                  INTEGRATORS integ, double T, double dt)
+{
+  *d = *dat;
+  d->natom      = n;
+  d->platform   = NATIVE;
+  d->integrator = integ;
+  d->T          = T;
+  d->friction   = 5.0;
+  d->timestep   = dt;
+  d->cuton      = INFINITY;
+  d->cutoff     = INFINITY;
+  d->skin       = 0.0;
+  d->tableBins  = 0;
+  d->domains    = 0;
+  d->octree     = 0;
+  d->replicas   = 1;
+  d->respaSteps = 0;
+  d->adaptDisp  = 0.0;
+  d->reorder    = NO_REORDER;
+  d->precision  = PREC_DEFAULT;
+  d->minimiser  = FIRE;
+  d->species    = *sp;
+
+  return init_engine(at,d);
+}
+
+/// the random numbers generator of the copy d of the common data goes back to dat
+static void bench_baoab_release(ENGINE* eng, DATA *dat, const DATA *d)
+{
+  terminate_engine(eng);
+  dat->nrn = d->nrn;
+#ifndef STDRAND
+  dat->dsfmt = d->dsfmt;
+#endif
+}
+
+/**
+ * @brief Runs the native engine from the positions at0 and averages the potential energy over 10 blocks of tsim/10 ps,
+ *  after an equilibration of tsim/10 ps
+ *
+ * @return The wall time of the production in seconds ; the mean and its standard error in *mean and *err
+ */
+static double bench_baoab_run(DATA *dat, const ATOM at0[], const SPECIES* sp, uint32_t n,
+                              INTEGRATORS integ, double T, double dt, double tsim,
+                              double* mean, double* err)
+{
+  ATOM* at = malloc(n*sizeof(ATOM));
+  memcpy(at,at0,n*sizeof(ATOM));
+
+  DATA d;
+  ENGINE* eng = bench_baoab_engine(dat,&d,at,sp,n,integ,T,dt);
+
+  const int sample = 10;
+  const int block  = sample*(int)ceil(0.1*tsim/dt/sample);
+
+  eng->doNsteps(eng->data,block);
+
+  double sum = 0.0, sum2 = 0.0;
+  const double t0 = get_wtime();
+  for(int b=0; b<10; b++)
+  {
+    double be = 0.0;
+    for(int k=0; k<block; k+=sample)
+    {
+      eng->doNsteps(eng->data,sample);
+      be += eng->getEnergy(eng->data,NULL);
+    }
+    be /= (double)(block/sample);
+    sum  += be;
+    sum2 += be*be;
+  }
+  const double wall = get_wtime()-t0;
+
+  *mean = sum/10.0;
+  *err  = sqrt(fmax(sum2/10.0 - (*mean)*(*mean),0.0)/9.0);
+
+  bench_baoab_release(eng,dat,&d);
+  free(at);
+
+  return wall;
+}
+
+/**
+ * @brief The argon cluster s of 13 atoms as an icosahedron, the global minimum of LJ13, from which it does not escape
+ *  at the low temperatures of the sampling benchmarks (it melts around 35 K)
+ *
+ * @return The positions of the minimum (in angstroems) and its potential energy in *emin
+ */
+static ATOM* bench_baoab_minimum(DATA *dat, BENCH_SYS* s, double* emin)
+{
+  const uint32_t n = 13;
+  const double phi = 0.5*(1.0+sqrt(5.0));
+  // centre to vertex distance close to the LJ minimum, 2^(1/6) sigma
+  const double r = 0.379/sqrt(1.0+phi*phi);
+
+  ATOM* at = calloc(n,sizeof(ATOM));
+  // vertices are the cyclic permutations of (0,+-1,+-phi)
+  for(uint32_t k=0; k<12; k++)
+  {
+    const double u = (k&1) ? -1.0 : 1.0;
+    const double w = (k&2) ? -phi : phi;
+    double* c = &(at[k+1].x);
+    c[k/4]       = 0.0;
+    c[(k/4+1)%3] = 10.0*r*u;
+    c[(k/4+2)%3] = 10.0*r*w;
+  }
+
+  double time, temp;
+  ENERGIES ener;
+  DATA d;
+  ENGINE* eng = bench_baoab_engine(dat,&d,at,&(s->sp),n,BAOAB,1.0,0.005);
+  eng->minimise(eng->data,1.0e-6,0);
+  eng->getState(eng->data,0,&time,&ener,&temp,at,&d);
+  *emin = eng->getEnergy(eng->data,NULL);
+  bench_baoab_release(eng,dat,&d);
+
+  return at;
+}
+
+static void bench_baoab(DATA *dat, uint32_t nmax)
+{
+  static const double dts[] = {0.002, 0.010, 0.020, 0.030, 0.040, 0.050};
+
+  // the size of the cluster is fixed
+  (void) nmax;
+  const uint32_t n = 13;
+  const double T = 5.0;
+  const double tsim = 2000.0;
+
+  BENCH_SYS* s = bench_sys_alloc(dat,n);
+
+  // all the runs start from the same minimum
+  double emin;
+  ATOM* at = bench_baoab_minimum(dat,s,&emin);
+
+  // harmonic approximation : <Epot-Emin> = (3N-6) kT/2, for which BAOAB has no bias on the positions
+  const double eharm = 0.5*(3.0*n-6.0)*BOLTZ*T;
+
+  fprintf(stdout,"\n# Configurational sampling versus the timestep : icosahedral argon cluster of %d atoms at %.0lf K,\n",n,T);
+  fprintf(stdout,"# friction 5 ps^-1, no cutoff, %.0lf ps per run ; ratio = <Epot-Emin>/((3N-6)kT/2), 1 for exact harmonic sampling\n",tsim);
+  fprintf(stdout,"# (standard error of 10 blocks) ; s/ns is the wall time per ns of simulation\n");
+  fprintf(stdout,"# %8s | %10s %10s %10s | %10s %10s %10s\n","dt (ps)","LANGEVIN","+/-","s/ns","BAOAB","+/-","s/ns");
+
+  for(uint32_t k=0; k<sizeof(dts)/sizeof(dts[0]); k++)
+  {
+    double el, errl, eb, errb;
+    const double wl = bench_baoab_run(dat,at,&(s->sp),n,LANGEVIN,T,dts[k],tsim,&el,&errl);
+    const double wb = bench_baoab_run(dat,at,&(s->sp),n,BAOAB,T,dts[k],tsim,&eb,&errb);
+
+    fprintf(stdout,"  %8.3lf | %10.4lf %10.4lf %10.3lf | %10.4lf %10.4lf %10.3lf\n",dts[k],
+            (el-emin)/eharm,errl/eharm,wl*1.0e3/tsim,(eb-emin)/eharm,errb/eharm,wb*1.0e3/tsim);
+  }
+
+  free(at);
+  bench_sys_free(s);
+}
+
+// -----------------------------------------------------------------------------
+//      OVERDAMPED INTEGRATORS : CONFIGURATIONAL SAMPLING VERSUS THE TIMESTEP AND COST OF THE NOISE
+// -----------------------------------------------------------------------------
+/// m normal random numbers in g
+typedef struct
+{
+  DATA* dat;
+  double* g;
+  uint32_t m;
+} BENCH_GAUSS;
+
+static void bench_gauss_scalar(void* ctx)
+{
+  BENCH_GAUSS* b = (BENCH_GAUSS*)ctx;
+  for(uint32_t i=0; i<b->m; i++)
+    b->g[i] = get_BoxMuller(b->dat);
+}
+
+static void bench_gauss_batched(void* ctx)
+{
+  BENCH_GAUSS* b = (BENCH_GAUSS*)ctx;
+  get_BoxMuller_array(b->dat,b->g,b->m);
+}
+
+static void bench_brownian(DATA *dat, uint32_t nmax)
+{
+  static const double dts[] = {0.005, 0.010, 0.020, 0.040, 0.060};
+
+  // the size of the cluster is fixed
+  (void) nmax;
+  const uint32_t n = 13;
+  const double T = 5.0;
+  const double tsim = 2000.0;
+
+  BENCH_SYS* s = bench_sys_alloc(dat,n);
+
+  double emin;
+  ATOM* at = bench_baoab_minimum(dat,s,&emin);
+
+  const double eharm = 0.5*(3.0*n-6.0)*BOLTZ*T;
+
+  fprintf(stdout,"\n# Configurational sampling versus the timestep : icosahedral argon cluster of %d atoms at %.0lf K,\n",n,T);
+  fprintf(stdout,"# friction 5 ps^-1, no cutoff, %.0lf ps per run ; ratio = <Epot-Emin>/((3N-6)kT/2), 1 for exact harmonic sampling\n",tsim);
+  fprintf(stdout,"# (standard error of 10 blocks) ; s/ns is the wall time per ns of simulation\n");
+  fprintf(stdout,"# %8s | %10s %10s %10s | %10s %10s %10s\n","dt (ps)","BROWNIAN","+/-","s/ns","BROWNIAN_LM","+/-","s/ns");
+
+  for(uint32_t k=0; k<sizeof(dts)/sizeof(dts[0]); k++)
+  {
+    double eb, errb, el, errl;
+    const double wb = bench_baoab_run(dat,at,&(s->sp),n,BROWNIAN,T,dts[k],tsim,&eb,&errb);
+    const double wl = bench_baoab_run(dat,at,&(s->sp),n,BROWNIAN_LM,T,dts[k],tsim,&el,&errl);
+
+    fprintf(stdout,"  %8.3lf | %10.4lf %10.4lf %10.3lf | %10.4lf %10.4lf %10.3lf\n",dts[k],
+            (eb-emin)/eharm,errb/eharm,wb*1.0e3/tsim,(el-emin)/eharm,errl/eharm,wl*1.0e3/tsim);
+  }
+
+  free(at);
+  bench_sys_free(s);
+
+  // the noise of one step : one call per number against the batched transformation, for 10^4 atoms
+  const uint32_t m = 30000;
+  double* g = malloc(m*sizeof(double));
+  BENCH_GAUSS bg = {dat, g, m};
+  const double t[2] = {bench_time(&bench_gauss_scalar,&bg), bench_time(&bench_gauss_batched,&bg)};
+  free(g);
+
+  fprintf(stdout,"\n# Normal random numbers of one step of 10^4 atoms (%d numbers), %s kernels\n",m,kernels.name);
+  fprintf(stdout,"# %16s %16s %10s\n","scalar (us)","batched (us)","speedup");
+  fprintf(stdout,"  %16.2lf %16.2lf %10.2lf\n",1.0e6*t[0],1.0e6*t[1],t[0]/t[1]);
+}
+
+// -----------------------------------------------------------------------------
+//      QUENCH THROUGHPUT OF THE FIRE AND L-BFGS MINIMISERS
+// -----------------------------------------------------------------------------
+
+/// the in-tree all-pairs evaluator of a cluster without cutoff, for the minimisers
+typedef struct
+{
+  BENCH_SYS* s;
+  LJ_CUTS cuts;
+} BENCH_QUENCH;
+
+static double bench_quench_forces(void* ctx)
+{
+  BENCH_QUENCH* q = (BENCH_QUENCH*)ctx;
+  BENCH_SYS* s = q->s;
+  return lj_forces_allpairs_tiled(s->n,s->x,s->y,s->z,s->type,&(s->sp),&(q->cuts),s->fx,s->fy,s->fz,NULL,1);
+}
+
+static void bench_quench(DATA *dat, uint32_t nmax)
+{
+  static const uint32_t sizes[] = {13, 38, 75, 150};
+  const uint32_t nstart = 200;
+  const double tol = 1.0e-6;
+
+  fprintf(stdout,"\n# Quenches of argon clusters without cutoff to a rms force of %.0le kJ/mol/nm (single thread, tiled all-pairs forces),\n",tol);
+  fprintf(stdout,"# from %d basin hopping moves (all atoms displaced by up to 0.05 nm) of one minimum ; eval : mean force evaluations per quench,\n",nstart);
+  fprintf(stdout,"# conv : converged fraction, distinct : number of different minima found\n");
+  fprintf(stdout,"# %6s %8s | %12s %10s %8s %8s\n","natoms","method","minima/s","eval","conv","distinct");
+
+  for(uint32_t k=0; k<sizeof(sizes)/sizeof(sizes[0]) && sizes[k]<=nmax; k++)
+  {
+    const uint32_t n = sizes[k];
+    BENCH_QUENCH q;
+    q.s = bench_sys_alloc(dat,n);
+    lj_init_cuts(&(q.cuts),INFINITY,INFINITY);
+    BENCH_SYS* s = q.s;
+
+    double* mass = malloc(n*sizeof(double));
+    for(uint32_t i=0; i<n; i++)
+      mass[i] = s->sp.pars[0].mass;
+
+    MINIM_SYS sys = { n, s->x, s->y, s->z, s->fx, s->fy, s->fz, mass, &bench_quench_forces, &q };
+    MINIM_STATS st;
+
+    // the reference minimum, and the starting points around it
+    minim_run(&sys,LBFGS,tol,0,8,&st);
+    double* starts = malloc((size_t)nstart*3*n*sizeof(double));
+    for(uint32_t j=0; j<nstart; j++)
+      for(uint32_t i=0; i<n; i++)
+      {
+        starts[(size_t)j*3*n+i]     = s->x[i] + 0.1*(get_next(dat)-0.5);
+        starts[(size_t)j*3*n+n+i]   = s->y[i] + 0.1*(get_next(dat)-0.5);
+        starts[(size_t)j*3*n+2*n+i] = s->z[i] + 0.1*(get_next(dat)-0.5);
+      }
+
+    static const MINIMISERS algos[] = {FIRE, LBFGS};
+    double* emins = malloc(nstart*sizeof(double));
+    for(uint32_t a=0; a<2; a++)
+    {
+      uint64_t nforces = 0;
+      uint32_t nconv = 0;
+      const double t0 = get_wtime();
+      for(uint32_t j=0; j<nstart; j++)
+      {
+        memcpy(s->x,starts+(size_t)j*3*n,    n*sizeof(double));
+        memcpy(s->y,starts+(size_t)j*3*n+n,  n*sizeof(double));
+        memcpy(s->z,starts+(size_t)j*3*n+2*n,n*sizeof(double));
+        minim_run(&sys,algos[a],tol,100000,8,&st);
+        nforces += st.nforces;
+        nconv   += st.converged;
+        emins[j] = st.epot;
+      }
+      const double wall = get_wtime()-t0;
+
+      // minima are told apart by their energy
+      uint32_t ndist = 0;
+      for(uint32_t j=0; j<nstart; j++)
+      {
+        uint32_t l = 0;
+        while(l<j && fabs(emins[l]-emins[j]) > 1.0e-6*fabs(emins[j]))
+          l++;
+        ndist += (l == j);
+      }
+
+      fprintf(stdout,"  %6d %8s | %12.1lf %10.1lf %8.2lf %8d\n",n,minimisersName[algos[a]],
+              nstart/wall,(double)nforces/nstart,(double)nconv/nstart,ndist);
+    }
+
+    free(emins);
+    free(starts);
+    free(mass);
+    bench_sys_free(s);
+  }
+}
+
+// -----------------------------------------------------------------------------
+//      r-RESPA AGAINST THE SINGLE TIMESTEP BAOAB INTEGRATOR : ENERGY DRIFT AND SPEED
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Runs a constant energy trajectory (BAOAB without friction) of the native engine from the positions at0,
+ *  with cutoff and neighbour lists, and with r-RESPA if k > 1
+ *
+ * @return The wall time per ps in seconds ; the drift of the total energy (slope of a least squares fit) in kJ/mol/ns
+ *  per atom in *drift and its root mean square deviation from the fit in kJ/mol per atom in *fluct
+ */
+static double bench_respa_run(DATA *dat, const ATOM at0[], const SPECIES* sp, uint32_t n,
+                              double T, double dt, uint32_t k, double split, double tsim,
+                              double* drift, double* fluct)
+{
+  ATOM* at = malloc(n*sizeof(ATOM));
+  memcpy(at,at0,n*sizeof(ATOM));
+
+  DATA d;
+  bench_baoab_engine(dat,&d,at,sp,n,BAOAB,T,dt);
+  d.friction   = 0.0;
+  d.cuton      = 1.2;
+  d.cutoff     = 1.4;
+  d.skin       = 0.1;
+  d.respaSteps = k;
+  d.respaSplit = split;
+  d.respaHeal  = 0.1;
+  ENGINE* eng = init_engine(at,&d);
+
+  // total energy every 0.1 ps
+  const int sample = (int)lround(0.1/dt);
+  const uint32_t ns = (uint32_t)lround(tsim/0.1);
+  double* et = malloc(ns*sizeof(double));
+
+  double time, temp;
+  ENERGIES ener;
+  const double t0 = get_wtime();
+  for(uint32_t j=0; j<ns; j++)
+  {
+    eng->doNsteps(eng->data,sample);
+    eng->getState(eng->data,1,&time,&ener,&temp,at,&d);
+    et[j] = ener.etot;
+  }
+  const double wall = get_wtime()-t0;
+
+  double st=0.0, se=0.0, stt=0.0, ste=0.0;
+  for(uint32_t j=0; j<ns; j++)
+  {
+    const double t = 0.1*(j+1);
+    st += t;  se += et[j];  stt += t*t;  ste += t*et[j];
+  }
+  const double slope = (ns*ste-st*se)/(ns*stt-st*st);
+  const double icpt  = (se-slope*st)/ns;
+  double sr2 = 0.0;
+  for(uint32_t j=0; j<ns; j++)
+    sr2 += X2(et[j]-icpt-slope*0.1*(j+1));
+
+  *drift = 1.0e3*slope/n;
+  *fluct = sqrt(sr2/ns)/n;
+
+  free(et);
+  bench_baoab_release(eng,dat,&d);
+  free(at);
+
+  return wall/tsim;
+}
+
+static void bench_respa(DATA *dat, uint32_t nmax)
+{
+  const uint32_t n = (nmax < 512) ? nmax : 512;
+  const double T = 30.0;
+  const double tsim = 50.0;
+  const double split = 0.7;
+
+  BENCH_SYS* s = bench_sys_alloc(dat,n);
+
+  ATOM* at = malloc(n*sizeof(ATOM));
+  for(uint32_t i=0; i<n; i++)
+  {
+    at[i].x = 10.0*s->x[i];
+    at[i].y = 10.0*s->y[i];
+    at[i].z = 10.0*s->z[i];
+    at[i].type = 0;
+  }
+
+  // equilibration with friction, the constant energy runs then start from the same positions
+  {
+    double time, temp;
+    ENERGIES ener;
+    DATA d;
+    ENGINE* eng = bench_baoab_engine(dat,&d,at,&(s->sp),n,BAOAB,T,0.005);
+    eng->doNsteps(eng->data,4000);
+    eng->getState(eng->data,0,&time,&ener,&temp,at,&d);
+    bench_baoab_release(eng,dat,&d);
+  }
+
+  static const struct {double dt; uint32_t k;} runs[] =
+  {
+    {0.005, 1}, {0.010, 1}, {0.020, 1}, {0.005, 2}, {0.005, 4}
+  };
+
+  fprintf(stdout,"\n# Constant energy dynamics (BAOAB without friction) of an argon cluster of %d atoms equilibrated at %.0lf K,\n",n,T);
+  fprintf(stdout,"# cuton 1.2 nm, cutoff 1.4 nm, neighbour lists ; r-RESPA splits the interaction at %.2lf nm (heal 0.1 nm),\n",split);
+  fprintf(stdout,"# outer forces every k steps of dt ; drift of the total energy over %.0lf ps and rms deviation from it, per atom\n",tsim);
+  fprintf(stdout,"# %8s %4s %10s | %16s %16s %10s\n","dt (ps)","k","outer (ps)","drift (kJ/mol/ns)","fluct (kJ/mol)","s/ps");
+
+  for(uint32_t r=0; r<sizeof(runs)/sizeof(runs[0]); r++)
+  {
+    double drift, fluct;
+    const double w = bench_respa_run(dat,at,&(s->sp),n,T,runs[r].dt,runs[r].k,split,tsim,&drift,&fluct);
+    fprintf(stdout,"  %8.3lf %4d %10.3lf | %16.3le %16.3le %10.4lf\n",runs[r].dt,runs[r].k,runs[r].dt*runs[r].k,drift,fluct,w);
+  }
+
+  free(at);
+  bench_sys_free(s);
+}
+
+// -----------------------------------------------------------------------------
+//      FORCES OF ATOMS SCATTERED IN MEMORY AGAINST ATOMS SORTED ALONG A SPACE FILLING CURVE
+// -----------------------------------------------------------------------------
+
+/// positions of s in the order given (a random permutation, or the order along a curve)
+static void bench_reorder_apply(BENCH_SYS* s, const uint32_t order[], const double x0[])
+{
+  const uint32_t n = s->n;
+  for(uint32_t k=0; k<n; k++)
+  {
+    s->x[k] = x0[order[k]];
+    s->y[k] = x0[n+order[k]];
+    s->z[k] = x0[2*n+order[k]];
+  }
+}
+
+static void bench_reorder(DATA *dat, uint32_t nmax)
+{
+  LJ_CUTS cuts;
+  lj_init_cuts(&cuts,1.2,1.4);
+
+  fprintf(stdout,"\n# Argon clusters whose atoms were shuffled in memory (as after a long diffusion), then sorted along a space filling curve ;\n");
+  fprintf(stdout,"# ms for one neighbour list build and one force evaluation (cuton 1.2 nm, cutoff 1.4 nm, %d threads, SIMD %s),\n",
+          dat->nthreads,lj_simd_isa());
+  fprintf(stdout,"# and for computing the order along the curve\n");
+  fprintf(stdout,"# %10s %10s | %10s %10s %8s | %10s\n","natom","order","build (ms)","force (ms)","speedup","sort (ms)");
+
+  for(uint32_t n=10000; n<=nmax && n<=1000000; n*=10)
+  {
+    BENCH_SYS* s = bench_sys_alloc(dat,n);
+    double* tbuf = (dat->nthreads > 1) ? malloc((size_t)(dat->nthreads-1)*3*n*sizeof(double)) : NULL;
+
+    // random permutation of the lattice (Fisher-Yates)
+    uint32_t* order = malloc(n*sizeof(uint32_t));
+    double* x0 = malloc(3*(size_t)n*sizeof(double));
+    for(uint32_t i=0; i<n; i++)
+      order[i] = i;
+    for(uint32_t i=n-1; i>0; i--)
+    {
+      const uint32_t j = (uint32_t)(get_next(dat)*(i+1)) % (i+1);
+      const uint32_t t = order[i];  order[i] = order[j];  order[j] = t;
+    }
+    memcpy(x0,s->x,n*sizeof(double));
+    memcpy(x0+n,s->y,n*sizeof(double));
+    memcpy(x0+2*n,s->z,n*sizeof(double));
+    bench_reorder_apply(s,order,x0);
+    memcpy(x0,s->x,n*sizeof(double));
+    memcpy(x0+n,s->y,n*sizeof(double));
+    memcpy(x0+2*n,s->z,n*sizeof(double));
+
+    double tref = 0.0;
+    for(int32_t c=NO_REORDER; c<=HILBERT; c++)
+    {
+      double tsort = 0.0;
+      if(c != NO_REORDER)
+      {
+        const double t0 = get_wtime();
+        sfc_order(n,x0,x0+n,x0+2*n,(REORDERS)c,order);
+        tsort = get_wtime()-t0;
+        bench_reorder_apply(s,order,x0);
+      }
+
+      NEIGHLIST* nl = neighlist_alloc(n,cuts.cutoff,0.1);
+      BENCH_NEIGHLIST b = {s, nl, &cuts, NULL, tbuf, dat->nthreads, 0.0};
+      const double tb = bench_time(&bench_neighlist_build,&b);
+      const double tf = bench_time(&bench_neighlist_forces,&b);
+      if(c == NO_REORDER)
+        tref = tf;
+
+      fprintf(stdout,"  %10d %10s | %10.3lf %10.3lf %8.2lf | %10.3lf\n",n,(c == NO_REORDER) ? "shuffled" : reordersName[c],
+              1.0e3*tb,1.0e3*tf,tref/tf,1.0e3*tsort);
+
+      neighlist_free(nl);
+    }
+
+    free(x0);
+    free(order);
+    free(tbuf);
+    bench_sys_free(s);
+  }
+}
+
+// -----------------------------------------------------------------------------
+//      KERNELS SPECIALISED FOR A SINGLE SPECIES AGAINST THE GENERIC ONES
+// -----------------------------------------------------------------------------
+
+/// one force evaluation with the tiled all-pairs kernel and the species table sp
+typedef struct
+{
+  BENCH_SYS* s;
+  const SPECIES* sp;
+  const LJ_CUTS* cuts;
+  double* tbuf;
+  uint32_t nthreads;
+  double e;
+} BENCH_SPECIES;
+
+static void bench_species_forces(void* ctx)
+{
+  BENCH_SPECIES* b = (BENCH_SPECIES*)ctx;
+  BENCH_SYS* s = b->s;
+  b->e = lj_forces_allpairs_tiled(s->n,s->x,s->y,s->z,s->type,b->sp,b->cuts,s->fx,s->fy,s->fz,b->tbuf,b->nthreads);
+}
+
+/// wall time of one force evaluation with the tiled all-pairs kernel, see bench_time
+static double bench_species_time(BENCH_SYS* s, const SPECIES* sp, const LJ_CUTS* cuts,
+                                 double* tbuf, uint32_t nthreads, double* epot)
+{
+  BENCH_SPECIES b = {s, sp, cuts, tbuf, nthreads, 0.0};
+  const double t = bench_time(&bench_species_forces,&b);
+  *epot = b.e;
+  return t;
+}
+
+static void bench_species(DATA *dat, uint32_t nmax)
+{
+  static const uint32_t sizes[] = {75, 192, 1000, 4000};
+
+  LJ_CUTS cuts;
+  lj_init_cuts(&cuts,1.2,1.4);
+
+  fprintf(stdout,"\n# Argon clusters, %d threads, SIMD %s : tiled all-pairs kernel specialised for a single species (mixed parameters\n",
+          dat->nthreads,lj_simd_isa());
+  fprintf(stdout,"# as constants) against the generic one (the same atoms with a table of two identical species, parameters looked up\n");
+  fprintf(stdout,"# per pair), cuton 1.2 nm, cutoff 1.4 nm ; best of 10 alternated rounds ; dE : difference of the energies\n");
+  fprintf(stdout,"# (the neighbour list kernels are not specialised : no measurable gain)\n");
+  fprintf(stdout,"# %10s | %14s %14s %8s | %10s\n","natom","generic (ms)","single (ms)","speedup","dE");
+
+  for(uint32_t a=0; a<sizeof(sizes)/sizeof(uint32_t) && sizes[a]<=nmax; a++)
+  {
+    const uint32_t n = sizes[a];
+    BENCH_SYS* s = bench_sys_alloc(dat,n);
+    double* tbuf = (dat->nthreads > 1) ? malloc((size_t)(dat->nthreads-1)*3*n*sizeof(double)) : NULL;
+
+    // the generic kernels are used as soon as the table has two species
+    SPECIES sp2;
+    sp2.n = 2;
+    sp2.pars  = malloc(2*sizeof(PARAMS));
+    sp2.sigij = NULL;
+    sp2.epsij = NULL;
+    sp2.pars[0] = sp2.pars[1] = s->sp.pars[0];
+    species_mix(&sp2);
+
+    // rounds alternating the two kernels, keeping the best time of each : less sensitive to the other loads of the node
+    double e[2];
+    double tg = INFINITY, t1 = INFINITY;
+    for(uint32_t r=0; r<10; r++)
+    {
+      tg = fmin(tg,bench_species_time(s,&sp2,&cuts,tbuf,dat->nthreads,&e[0]));
+      t1 = fmin(t1,bench_species_time(s,&(s->sp),&cuts,tbuf,dat->nthreads,&e[1]));
+    }
+
+    fprintf(stdout,"  %10d | %14.4lf %14.4lf %8.2lf | %10.2le\n",n,1.0e3*tg,1.0e3*t1,tg/t1,fabs(e[1]-e[0]));
+
+    species_free(&sp2);
+    free(tbuf);
+    bench_sys_free(s);
+  }
+}
+
+// -----------------------------------------------------------------------------
+//      HALF LISTS SPLIT IN DOMAINS AGAINST PER THREAD BUFFERS AND FULL LISTS
+// -----------------------------------------------------------------------------
+/// forces of the system s on the half list split in the domains nd, or on the full list fl with nthreads threads
+typedef struct
+{
+  BENCH_SYS* s;
+  NEIGHDOMAINS* nd;
+  NEIGHLIST* fl;
+  const LJ_CUTS* cuts;
+  uint32_t nthreads;
+} BENCH_HALFLIST;
+
+static void bench_halflist_domains(void* ctx)
+{
+  BENCH_HALFLIST* b = (BENCH_HALFLIST*)ctx;
+  BENCH_SYS* s = b->s;
+  lj_forces_neighdomains(b->nd,s->n,s->x,s->y,s->z,&(s->sp),b->cuts,NULL,s->fx,s->fy,s->fz);
+}
+
+static void bench_halflist_full(void* ctx)
+{
+  BENCH_HALFLIST* b = (BENCH_HALFLIST*)ctx;
+  BENCH_SYS* s = b->s;
+  lj_forces_neighlist_full(b->fl,s->n,s->x,s->y,s->z,s->type,&(s->sp),b->cuts,s->fx,s->fy,s->fz,b->nthreads);
+}
+
+/// largest difference of the forces of s with the reference f
+static double bench_halflist_df(const BENCH_SYS* s, const double f[])
+{
+  const uint32_t n = s->n;
+  double df = 0.0;
+  for(uint32_t i=0; i<n; i++)
+    df = fmax(df,fmax(fabs(s->fx[i]-f[i]),fmax(fabs(s->fy[i]-f[n+i]),fabs(s->fz[i]-f[2*n+i]))));
+  return df;
+}
+
+static void bench_halflist(DATA *dat, uint32_t nmax)
+{
+  static const uint32_t threads[] = {1, 8, 32};
+
+  LJ_CUTS cuts;
+  lj_init_cuts(&cuts,1.2,1.4);
+
+  fprintf(stdout,"\n# Force evaluation of argon clusters sorted along the Hilbert curve (cuton 1.2 nm, cutoff 1.4 nm), SIMD %s :\n",
+          lj_simd_isa());
+  fprintf(stdout,"# each pair evaluated once on the half list, the reaction forces accumulated in full size buffers per thread (buffers)\n");
+  fprintf(stdout,"# or in the halos of one domain per thread (domains), against each pair evaluated twice on the full list (full) ;\n");
+#ifdef _OPENMP
+  const int ncores = omp_get_num_procs();
+#else
+  const int ncores = 1;
+#endif
+  fprintf(stdout,"# ms per evaluation, %d cores available : the rows with more threads than cores only measure overheads and say nothing\n",
+          ncores);
+  fprintf(stdout,"# about the scaling of the domains against the buffers ; halo : atoms copied per atom ;\n");
+  fprintf(stdout,"# dF : largest difference of the domains and full list forces with the buffers ones\n");
+  fprintf(stdout,"# %10s %8s | %12s %12s %12s | %8s %10s\n","natom","threads","buffers (ms)","domains (ms)","full (ms)","halo","dF");
+
+  for(uint32_t n=10000; n<=nmax && n<=1000000; n*=100)
+  {
+    BENCH_SYS* s = bench_sys_alloc(dat,n);
+    NEIGHLIST* nl = neighlist_alloc(n,cuts.cutoff,0.1);
+    NEIGHLIST* fl = neighlist_alloc_full(n,cuts.cutoff,0.1);
+    double* x0 = malloc(3*(size_t)n*sizeof(double));
+    double* fref = malloc(3*(size_t)n*sizeof(double));
+
+    // atoms sorted along the Hilbert curve as with REORDER : consecutive rows are compact in space
+    uint32_t* order = malloc(n*sizeof(uint32_t));
+    sfc_order(n,s->x,s->y,s->z,HILBERT,order);
+    for(uint32_t i=0; i<n; i++)
+    {
+      x0[i]     = s->x[order[i]];
+      x0[n+i]   = s->y[order[i]];
+      x0[2*n+i] = s->z[order[i]];
+    }
+    free(order);
+    memcpy(s->x,x0,n*sizeof(double));
+    memcpy(s->y,x0+n,n*sizeof(double));
+    memcpy(s->z,x0+2*n,n*sizeof(double));
+    neighlist_update(nl,s->x,s->y,s->z);
+    neighlist_update(fl,s->x,s->y,s->z);
+
+    for(uint32_t a=0; a<sizeof(threads)/sizeof(uint32_t); a++)
+    {
+      const uint32_t nt = threads[a];
+      double* tbuf = (nt > 1) ? malloc((size_t)(nt-1)*3*n*sizeof(double)) : NULL;
+      NEIGHDOMAINS* nd = neighdomains_alloc(n,nt);
+      neighdomains_update(nd,nl,s->type);
+      const double halo = (double) nd->nhalo / n;
+
+      BENCH_NEIGHLIST bb = {s, nl, &cuts, NULL, tbuf, nt, 0.0};
+      BENCH_HALFLIST  bh = {s, nd, fl, &cuts, nt};
+
+      double t[3];
+      t[0] = bench_time(&bench_neighlist_forces,&bb);
+      memcpy(fref,s->fx,n*sizeof(double));
+      memcpy(fref+n,s->fy,n*sizeof(double));
+      memcpy(fref+2*n,s->fz,n*sizeof(double));
+      t[1] = bench_time(&bench_halflist_domains,&bh);
+      double df = bench_halflist_df(s,fref);
+      t[2] = bench_time(&bench_halflist_full,&bh);
+      df = fmax(df,bench_halflist_df(s,fref));
+
+      fprintf(stdout,"  %10d %8d | %12.4lf %12.4lf %12.4lf | %8.3lf %10.2le\n",n,nt,1.0e3*t[0],1.0e3*t[1],1.0e3*t[2],halo,df);
+
+      neighdomains_free(nd);
+      free(tbuf);
+    }
+
+    free(fref);
+    free(x0);
+    neighlist_free(fl);
+    neighlist_free(nl);
+    bench_sys_free(s);
+  }
+}
+
+// -----------------------------------------------------------------------------
+//      REPLICAS OF SMALL CLUSTERS IN LOCKSTEP, ONE PER SIMD LANE, AGAINST ONE ENGINE PER REPLICA
+// -----------------------------------------------------------------------------
+
+/// a copy d of the common data for nrep replicas of the argon cluster s, Langevin dynamics without cutoff
+static void bench_replicas_data(DATA *dat, DATA *d, const BENCH_SYS* s, uint32_t nrep, uint32_t nthreads)
+{
+  *d = *dat;
+  d->natom      = s->n;
+  d->platform   = NATIVE;
+  d->integrator = LANGEVIN;
+  d->T          = 20.0;
+  d->friction   = 1.0;
+  d->timestep   = 0.002;
+  d->cuton      = INFINITY;
+  d->cutoff     = INFINITY;
+  d->skin       = 0.0;
+  d->tableBins  = 0;
+  d->domains    = 0;
+  d->octree     = 0;
+  d->replicas   = nrep;
+  d->nthreads   = nthreads;
+  d->respaSteps = 0;
+  d->adaptDisp  = 0.0;
+  d->reorder    = NO_REORDER;
+  d->precision  = PREC_DEFAULT;
+  d->minimiser  = FIRE;
+  d->species    = s->sp;
+}
+
+static void bench_replicas(DATA *dat, uint32_t nmax)
+{
+  static const uint32_t sizes[] = {13, 38, 75};
+  const uint32_t nrep   = 64;
+  const int      nsteps = 1000;
+  const uint32_t nthreads = (dat->nthreads > 0) ? dat->nthreads : 1;
+
+  fprintf(stdout,"\n# %d replicas of argon clusters without cutoff, %d LANGEVIN steps at 20 K from the same minimum ;\n",nrep,nsteps);
+  fprintf(stdout,"# throughput in replica steps per second : one native engine per replica one after the other (single thread),\n");
+  fprintf(stdout,"# against the replicas in lockstep (REPLICAS) on 1 and %d threads ; dE : largest difference between the energy\n",nthreads);
+  fprintf(stdout,"# of a replica and the one of its positions evaluated by the tiled all-pairs kernel, kJ/mol\n");
+  fprintf(stdout,"# %6s %6s | %14s %14s %14s | %8s %10s\n","natoms","reps","separate","batch 1 thr","batch all thr","gain","dE");
+
+  for(uint32_t k=0; k<sizeof(sizes)/sizeof(sizes[0]) && sizes[k]<=nmax; k++)
+  {
+    const uint32_t n = sizes[k];
+    BENCH_SYS* s = bench_sys_alloc(dat,n);
+    ATOM* at = calloc(n,sizeof(ATOM));
+    for(uint32_t i=0; i<n; i++)
+    {
+      at[i].x = 10.0*s->x[i];
+      at[i].y = 10.0*s->y[i];
+      at[i].z = 10.0*s->z[i];
+    }
+
+    DATA d;
+    double time, temp;
+    ENERGIES ener;
+
+    // a minimum as the common starting point
+    bench_replicas_data(dat,&d,s,1,1);
+    ENGINE* eng = init_engine(at,&d);
+    eng->minimise(eng->data,1.0e-3,0);
+    eng->getState(eng->data,0,&time,&ener,&temp,at,&d);
+    terminate_engine(eng);
+
+    // one engine per replica
+    double t0 = get_wtime();
+    for(uint32_t r=0; r<nrep; r++)
+    {
+      eng = init_engine(at,&d);
+      eng->doNsteps(eng->data,nsteps);
+      terminate_engine(eng);
+    }
+    double t[3];
+    t[0] = get_wtime()-t0;
+
+    // in lockstep, on 1 then on all the threads
+    double de = 0.0;
+    for(uint32_t w=1; w<3; w++)
+    {
+      bench_replicas_data(dat,&d,s,nrep,(w==1) ? 1 : nthreads);
+      t0 = get_wtime();
+      MyBatchData* bat = init_batch(at,&d);
+      doNsteps_batch(bat,nsteps);
+      t[w] = get_wtime()-t0;
+
+      ATOM* rat = malloc(n*sizeof(ATOM));
+      for(uint32_t r=0; r<nrep; r++)
+      {
+        getState_batch(bat,r,1,&time,&ener,rat);
+        for(uint32_t i=0; i<n; i++)
+        {
+          s->x[i] = 0.1*rat[i].x;
+          s->y[i] = 0.1*rat[i].y;
+          s->z[i] = 0.1*rat[i].z;
+        }
+        const double e = lj_energy_allpairs_tiled(n,s->x,s->y,s->z,s->type,&(s->sp),&(bat->cuts),1);
+        de = fmax(de,fabs(e-ener.epot));
+      }
+      free(rat);
+      terminate_batch(bat);
+    }
+
+    // the random numbers generator of the copies goes back to dat
+    dat->nrn = d.nrn;
+#ifndef STDRAND
+    dat->dsfmt = d.dsfmt;
+#endif
+
+    const double steps = (double)nrep*nsteps;
+    fprintf(stdout,"  %6d %6d | %14.4le %14.4le %14.4le | %8.2lf %10.2le\n",n,nrep,
+            steps/t[0],steps/t[1],steps/t[2],t[0]/t[1],de);
+
+    free(at);
+    bench_sys_free(s);
+  }
+}
+
+// -----------------------------------------------------------------------------
+//      PERIODIC BOX : MINIMUM IMAGE NEIGHBOUR LISTS AGAINST ALL THE IMAGES PAIRS
+// -----------------------------------------------------------------------------
+
+/// reference forces and energy in the periodic box L : all the pairs with the minimum image, scalar
+static double bench_pbc_reference(const BENCH_SYS* s, const double L[3], const LJ_CUTS* cuts,
+                                  double fx[], double fy[], double fz[])
+{
+  const uint32_t n = s->n;
+  const double sig = s->sp.pars[0].sig;
+  const double eps = s->sp.pars[0].eps;
+  double epot = 0.0;
+
+  memset(fx,0,n*sizeof(double));
+  memset(fy,0,n*sizeof(double));
+  memset(fz,0,n*sizeof(double));
+
+  for(uint32_t i=0; i<n; i++)
+    for(uint32_t j=i+1; j<n; j++)
+    {
+      const double dx = cellgrid_image(s->x[i]-s->x[j],L[0],1.0/L[0]);
+      const double dy = cellgrid_image(s->y[i]-s->y[j],L[1],1.0/L[1]);
+      const double dz = cellgrid_image(s->z[i]-s->z[j],L[2],1.0/L[2]);
+      const double fr = lj_pair(dx*dx+dy*dy+dz*dz,sig,eps,cuts,&epot);
+      fx[i] += fr*dx;   fx[j] -= fr*dx;
+      fy[i] += fr*dy;   fy[j] -= fr*dy;
+      fz[i] += fr*dz;   fz[j] -= fr*dz;
+    }
+
+  return epot;
+}
+
+/// wall time of one list build and of one force evaluation
+static void bench_pbc_time(BENCH_SYS* s, NEIGHLIST* nl, const LJ_CUTS* cuts, double* tbuf, uint32_t nthreads,
+                           double* tbuild, double* tforces, double* epot)
+{
+  BENCH_NEIGHLIST b = {s, nl, cuts, NULL, tbuf, nthreads, 0.0};
+  *tbuild  = bench_time(&bench_neighlist_build,&b);
+  *tforces = bench_time(&bench_neighlist_forces,&b);
+  *epot = b.e;
+}
+
+static void bench_pbc(DATA *dat, uint32_t nmax)
+{
+  LJ_CUTS cuts;
+  lj_init_cuts(&cuts,1.2,1.4);
+
+  fprintf(stdout,"\n# Argon lattices (cuton 1.2 nm, cutoff 1.4 nm, skin 0.1 nm), %d threads, SIMD %s : isolated cube against the same\n",
+          dat->nthreads,lj_simd_isa());
+  fprintf(stdout,"# atoms in a periodic box of the size of the lattice (minimum image lists, all the images cells wrapped) ;\n");
+  fprintf(stdout,"# dF, dE : largest force and energy differences with all the pairs at the minimum image (up to 10^4 atoms) ;\n");
+  fprintf(stdout,"# dE shift : energy change when the atoms are translated by a random vector plus several box edges, not wrapped\n");
+  fprintf(stdout,"# %10s %8s | %12s %12s | %12s %12s | %10s %10s %10s\n","natom","box (nm)","build (ms)","forces (ms)",
+          "pbc build","pbc forces","dF","dE","dE shift");
+
+  for(uint32_t n=1000; n<=nmax && n<=1000000; n*=10)
+  {
+    BENCH_SYS* s = bench_sys_alloc(dat,n);
+    double* tbuf = (dat->nthreads > 1) ? malloc((size_t)(dat->nthreads-1)*3*n*sizeof(double)) : NULL;
+
+    // the lattice of bench_sys_alloc tiles the space with the period side*0.38 nm
+    const uint32_t side = (uint32_t) ceil(cbrt((double)n));
+    const double L[3] = {0.38*side, 0.38*side, 0.38*side};
+
+    NEIGHLIST* nl = neighlist_alloc(n,cuts.cutoff,0.1);
+    NEIGHLIST* pl = neighlist_alloc(n,cuts.cutoff,0.1);
+    neighlist_set_box(pl,L);
+
+    double tb, tf, tpb, tpf, e, ep;
+    bench_pbc_time(s,nl,&cuts,tbuf,dat->nthreads,&tb,&tf,&e);
+    bench_pbc_time(s,pl,&cuts,tbuf,dat->nthreads,&tpb,&tpf,&ep);
+
+    char dF[16] = "-", dE[16] = "-";
+    if(n <= 10000)
+    {
+      double* rf = malloc(3*(size_t)n*sizeof(double));
+      const double eref = bench_pbc_reference(s,L,&cuts,rf,rf+n,rf+2*n);
+      double dfmax = 0.0;
+      for(uint32_t i=0; i<n; i++)
+      {
+        dfmax = fmax(dfmax,fabs(s->fx[i]-rf[i]));
+        dfmax = fmax(dfmax,fabs(s->fy[i]-rf[n+i]));
+        dfmax = fmax(dfmax,fabs(s->fz[i]-rf[2*n+i]));
+      }
+      snprintf(dF,sizeof(dF),"%.2le",dfmax);
+      snprintf(dE,sizeof(dE),"%.2le",fabs(ep-eref));
+      free(rf);
+    }
+
+    // rigid translation of the unwrapped coordinates : same energy up to the rounding of the larger coordinates
+    const double sh[3] = {L[0]*(3.0+get_next(dat)), -L[1]*(2.0+get_next(dat)), L[2]*(5.0+get_next(dat))};
+    for(uint32_t i=0; i<n; i++)
+    {
+      s->x[i] += sh[0];
+      s->y[i] += sh[1];
+      s->z[i] += sh[2];
+    }
+    neighlist_build(pl,s->x,s->y,s->z);
+    const double eshift = lj_forces_neighlist_omp(pl,n,s->x,s->y,s->z,s->type,&(s->sp),&cuts,NULL,s->fx,s->fy,s->fz,
+                                                  tbuf,dat->nthreads);
+
+    fprintf(stdout,"  %10d %8.2lf | %12.4lf %12.4lf | %12.4lf %12.4lf | %10s %10s %10.2le\n",n,L[0],
+            1.0e3*tb,1.0e3*tf,1.0e3*tpb,1.0e3*tpf,dF,dE,fabs(eshift-ep));
+
+    neighlist_free(pl);
+    neighlist_free(nl);
+    free(tbuf);
+    bench_sys_free(s);
+  }
+}
+
+// -----------------------------------------------------------------------------
+//      ADAPTIVE OCTREE AGAINST THE CELL GRID FOR AN EVAPORATING DROPLET
+// -----------------------------------------------------------------------------
+/// the atoms moved by +/- 0.01 nm around their reference positions x0 (3 blocks), so that they do not drift
+static void bench_octree_move(DATA *dat, BENCH_SYS* s, const double x0[])
+{
+  const uint32_t n = s->n;
+  for(uint32_t i=0; i<n; i++)
+  {
+    s->x[i] = x0[i]     + 0.02*(get_next(dat)-0.5);
+    s->y[i] = x0[n+i]   + 0.02*(get_next(dat)-0.5);
+    s->z[i] = x0[2*n+i] + 0.02*(get_next(dat)-0.5);
+  }
+}
+
+/// wall time of one build of nl, the atoms being moved (not timed) before each build
+static double bench_octree_time(DATA *dat, BENCH_SYS* s, const double x0[], NEIGHLIST* nl)
+{
+  uint32_t neval = 0;
+  double t = 0.0, tw = 0.0;
+  const double tw0 = get_wtime();
+  do
+  {
+    bench_octree_move(dat,s,x0);
+    const double t0 = get_wtime();
+    neighlist_build(nl,s->x,s->y,s->z);
+    t += get_wtime()-t0;
+    neval++;
+    tw = get_wtime()-tw0;
+  } while(tw < BENCH_TMIN || neval < BENCH_NMIN);
+
+  return t/neval;
+}
+
+/// wall time of the octree alone, from scratch or updated, the atoms being moved (not timed) before each call
+static double bench_octree_tree_time(DATA *dat, BENCH_SYS* s, const double x0[], OCTREE* t, uint8_t scratch)
+{
+  uint32_t neval = 0;
+  double tt = 0.0, tw = 0.0;
+  const double tw0 = get_wtime();
+  do
+  {
+    bench_octree_move(dat,s,x0);
+    const double t0 = get_wtime();
+    if(scratch)
+      octree_build(t,s->n,s->x,s->y,s->z);
+    else
+      octree_update(t,s->n,s->x,s->y,s->z);
+    tt += get_wtime()-t0;
+    neval++;
+    tw = get_wtime()-tw0;
+  } while(tw < BENCH_TMIN || neval < BENCH_NMIN);
+
+  return tt/neval;
+}
+
+static void bench_octree(DATA *dat, uint32_t nmax)
+{
+  LJ_CUTS cuts;
+  lj_init_cuts(&cuts,1.2,1.4);
+  const double rlist = cuts.cutoff+0.1;
+
+  fprintf(stdout,"\n# Argon droplet (cuton 1.2 nm, cutoff 1.4 nm, skin 0.1 nm) of which a fraction of the atoms evaporated in a cloud\n");
+  fprintf(stdout,"# 100 times larger than the droplet : neighbour list builds with the hashed cell grid and with the adaptive octree\n");
+  fprintf(stdout,"# (leaves of at least %.2lf nm split above %d atoms) updated incrementally, the atoms moving by +/- 0.01 nm\n",
+          0.5*rlist,OCTREE_LEAF_MAX);
+  fprintf(stdout,"# between two builds ; the octree alone built from scratch or updated, with the atoms changing of leaf per update ;\n");
+  fprintf(stdout,"# memory of the hashed grid, of a uniform grid of cells of %.1lf nm over the bounding box (one index per cell,\n",rlist);
+  fprintf(stdout,"# not allocated), and of the octree ; dF : largest force difference of the two lists\n");
+  fprintf(stdout,"# %10s %6s %9s | %10s %10s | %10s %10s %8s | %10s %12s %10s %6s | %8s\n","natom","evap","box (nm)",
+          "grid (ms)","octree (ms)","build (ms)","update (ms)","moved","grid (kB)","uniform (MB)","tree (kB)","depth","dF");
+
+  const double fractions[3] = {0.0, 0.01, 0.1};
+
+  for(uint32_t n=10000; n<=nmax && n<=1000000; n*=10)
+  {
+    for(uint32_t f=0; f<3; f++)
+    {
+      BENCH_SYS* s = bench_sys_alloc(dat,n);
+      double* tbuf = (dat->nthreads > 1) ? malloc((size_t)(dat->nthreads-1)*3*n*sizeof(double)) : NULL;
+
+      // every (1/fraction)-th atom of the lattice evaporated somewhere in the cloud around the droplet
+      const double side = 0.38*ceil(cbrt((double)n));
+      const double cloud = 100.0*side;
+      if(fractions[f] > 0.0)
+      {
+        const uint32_t every = (uint32_t) floor(1.0/fractions[f]+0.5);
+        for(uint32_t i=0; i<n; i+=every)
+        {
+          s->x[i] = 0.5*side + cloud*(get_next(dat)-0.5);
+          s->y[i] = 0.5*side + cloud*(get_next(dat)-0.5);
+          s->z[i] = 0.5*side + cloud*(get_next(dat)-0.5);
+        }
+      }
+
+      double lo[3] = {s->x[0], s->y[0], s->z[0]};
+      double hi[3] = {s->x[0], s->y[0], s->z[0]};
+      for(uint32_t i=1; i<n; i++)
+      {
+        lo[0] = fmin(lo[0],s->x[i]);  hi[0] = fmax(hi[0],s->x[i]);
+        lo[1] = fmin(lo[1],s->y[i]);  hi[1] = fmax(hi[1],s->y[i]);
+        lo[2] = fmin(lo[2],s->z[i]);  hi[2] = fmax(hi[2],s->z[i]);
+      }
+      double ncells = 1.0;
+      for(uint32_t d=0; d<3; d++)
+        ncells *= ceil((hi[d]-lo[d])/rlist);
+
+      double* x0 = malloc(3*(size_t)n*sizeof(double));
+      memcpy(x0,s->x,n*sizeof(double));
+      memcpy(x0+n,s->y,n*sizeof(double));
+      memcpy(x0+2*n,s->z,n*sizeof(double));
+
+      NEIGHLIST* gl = neighlist_alloc(n,cuts.cutoff,0.1);
+      NEIGHLIST* tl = neighlist_alloc(n,cuts.cutoff,0.1);
+      neighlist_set_octree(tl);
+
+      const double tg = bench_octree_time(dat,s,x0,gl);
+      const double tl0 = bench_octree_time(dat,s,x0,tl);
+
+      OCTREE* t = octree_alloc(n,0.5*rlist,OCTREE_LEAF_MAX);
+      const double tb = bench_octree_tree_time(dat,s,x0,t,1);
+      const double tu = bench_octree_tree_time(dat,s,x0,t,0);
+      const double moved = (double)t->nmoved/(double)t->nupdate;
+      octree_free(t);
+
+      // same pairs : same forces up to the order of the sums
+      neighlist_build(gl,s->x,s->y,s->z);
+      neighlist_build(tl,s->x,s->y,s->z);
+      double* rf = malloc(3*(size_t)n*sizeof(double));
+      lj_forces_neighlist_omp(gl,n,s->x,s->y,s->z,s->type,&(s->sp),&cuts,NULL,rf,rf+n,rf+2*n,tbuf,dat->nthreads);
+      lj_forces_neighlist_omp(tl,n,s->x,s->y,s->z,s->type,&(s->sp),&cuts,NULL,s->fx,s->fy,s->fz,tbuf,dat->nthreads);
+      double dfmax = 0.0;
+      for(uint32_t i=0; i<n; i++)
+      {
+        dfmax = fmax(dfmax,fabs(s->fx[i]-rf[i]));
+        dfmax = fmax(dfmax,fabs(s->fy[i]-rf[n+i]));
+        dfmax = fmax(dfmax,fabs(s->fz[i]-rf[2*n+i]));
+      }
+      free(rf);
+
+      const CELLGRID* g = gl->grid;
+      const double gridMem = (double)g->nbuckets*sizeof(int32_t) + 4.0*g->natom*sizeof(int32_t);
+
+      fprintf(stdout,"  %10d %5.1lf%% %9.1lf | %10.4lf %10.4lf | %10.4lf %10.4lf %8.1lf | %10.1lf %12.1lf %10.1lf %6d | %8.2le\n",
+              n,100.0*fractions[f],fmax(fmax(hi[0]-lo[0],hi[1]-lo[1]),hi[2]-lo[2]),
+              1.0e3*tg,1.0e3*tl0,1.0e3*tb,1.0e3*tu,moved,
+              gridMem/1024.0,ncells*sizeof(int32_t)/1048576.0,octree_memory(tl->tree)/1024.0,octree_depth(tl->tree),dfmax);
+
+      neighlist_free(tl);
+      neighlist_free(gl);
+      free(x0);
+      free(tbuf);
+      bench_sys_free(s);
+    }
+  }
+}
+
+/// the list of the available benchmarks
+static const BENCH benchs[] =
+{
+  {"scaling", "strong scaling of the multithreaded native force evaluation, 10^3 to 10^6 atoms", &bench_scaling},
+  {"isa",     "SSE2, AVX2 and AVX-512 variants of the forces, integrator and random numbers kernels", &bench_isa},
+  {"precision","mixed against double precision forces, for each variant of the kernels", &bench_precision},
+  {"table",   "tabulated pair potentials against the analytic kernel : speed and accuracy versus the number of bins", &bench_table},
+  {"allpairs","tiled all-pairs kernel against neighbour lists for small systems, with and without cutoff", &bench_allpairs},
+  {"energy",  "energy only evaluations (kernels and ENGINE::getEnergy) against forces and energy", &bench_energy},
+  {"baoab",   "configurational sampling bias of the LANGEVIN and BAOAB integrators versus the timestep", &bench_baoab},
+  {"brownian","configurational sampling bias of the BROWNIAN and BROWNIAN_LM integrators, cost of the batched noise", &bench_brownian},
+  {"quench",  "quench throughput (minima/s) of the FIRE and L-BFGS minimisers at tight tolerance", &bench_quench},
+  {"respa",   "energy drift and speed of r-RESPA against the single timestep integrator (constant energy)", &bench_respa},
+  {"reorder", "forces of atoms shuffled in memory against atoms sorted along the Morton and Hilbert curves, 10^4 to 10^6 atoms", &bench_reorder},
+  {"species", "all-pairs kernel specialised for a single species against the generic one, 75 to 4000 atoms", &bench_species},
+  {"halflist","half lists split in one domain per thread against per thread buffers and full lists, 1 to 32 threads", &bench_halflist},
+  {"replicas","replicas of LJ13, LJ38 and LJ75 in lockstep, one per SIMD lane, against one native engine per replica", &bench_replicas},
+  {"pbc",     "minimum image neighbour lists in a periodic box against an isolated cube, checked against all the pairs", &bench_pbc},
+  {"octree",  "adaptive octree against the hashed cell grid for the lists of an evaporating droplet : time and memory", &bench_octree}
+};
+
+static const uint32_t nbenchs = sizeof(benchs)/sizeof(BENCH);
+
+/**
+ * @brief Prints the list of the available benchmarks
+ */
+void list_bench()
+{
+  fprintf(stdout,"Available benchmarks (-bench name) :\n");
+  fprintf(stdout,"  %-12s %s\n","all","run all the benchmarks");
+  for(uint32_t b=0; b<nbenchs; b++)
+    fprintf(stdout,"  %-12s %s\n",benchs[b].name,benchs[b].descr);
+}
+
+/**
+ * @brief Runs one or all of the benchmarks
+ *
+ * @param dat Common data : random numbers generator and number of threads
+ * @param name Name of the benchmark, or "all"
+ * @param nmax Maximum number of atoms of the systems
+ */
+void run_bench(DATA *dat, const char name[], uint32_t nmax)
+{
+  uint32_t found = 0;
+
+  for(uint32_t b=0; b<nbenchs; b++)
+  {
+    if(!strcasecmp(name,"all") || !strcasecmp(name,benchs[b].name))
+    {
+      LOG_PRINT(LOG_INFO,"Running benchmark %s\n",benchs[b].name);
+      benchs[b].run(dat,nmax);
+      found = 1;
+    }
+  }
+
+  if(!found)
+  {
+    fprintf(stdout,"[Error] Unknown benchmark '%s'.\n",name);
+    list_bench();
+  }
+}
@@ -0,0 +1,147 @@
+/**
+ * \file cellGrid.c
+ *
+ * \brief Hashed linked-cell grid : O(N) search of the pairs closer than the cell size, for unbounded clusters
+ *
+ * \details The cluster has no box and may spread as atoms evaporate, so the cell coordinates are not bounded :
+ *          instead of an array of cells spanning the bounding box, cells are hashed into a table of size proportional to the number of atoms.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cellGrid.h"
+
+const int32_t cellgrid_half_shell[13][3] =
+{
+  { 1, 0, 0},
+  {-1, 1, 0}, { 0, 1, 0}, { 1, 1, 0},
+  {-1,-1, 1}, { 0,-1, 1}, { 1,-1, 1},
+  {-1, 0, 1}, { 0, 0, 1}, { 1, 0, 1},
+  {-1, 1, 1}, { 0, 1, 1}, { 1, 1, 1}
+};
+
+/**
+ * @brief Allocates an empty grid
+ *
+ * @param natom Maximum number of atoms stored
+ * @param cellSize Edge of the cells, usually the cutoff
+ * @return The grid, to be freed with cellgrid_free
+ */
+CELLGRID* cellgrid_alloc(uint32_t natom, double cellSize)
+{
+  CELLGRID* g = malloc(sizeof(CELLGRID));
+
+  g->cellSize    = cellSize;
+  g->invCellSize = 1.0/cellSize;
+  g->natom       = natom;
+
+  // about 2 buckets per atom limits the number of collisions
+  g->nbuckets = 64;
+  while(g->nbuckets < 2*natom)
+    g->nbuckets <<= 1;
+  g->mask = g->nbuckets-1;
+
+  g->head = malloc(g->nbuckets*sizeof(int32_t));
+  g->next = malloc(natom*sizeof(int32_t));
+  g->cx   = malloc(natom*sizeof(int32_t));
+  g->cy   = malloc(natom*sizeof(int32_t));
+  g->cz   = malloc(natom*sizeof(int32_t));
+
+  g->periodic = 0;
+  g->nc[0] = g->nc[1] = g->nc[2] = 0;
+  g->invc[0] = g->invc[1] = g->invc[2] = 0.0;
+
+  cellgrid_clear(g);
+
+  return g;
+}
+
+/**
+ * @brief Frees the grid
+ *
+ * @param g The grid
+ */
+void cellgrid_free(CELLGRID* g)
+{
+  free(g->head);
+  free(g->next);
+  free(g->cx);
+  free(g->cy);
+  free(g->cz);
+  free(g);
+}
+
+/**
+ * @brief Makes the grid periodic : each edge of the orthorhombic box is split in as many cells of at least cellSize as
+ *  possible (at least one), and the atoms are stored in the cell of their image in the box
+ *
+ * @param g The grid, empty
+ * @param box Edges of the box, in the unit of cellSize
+ */
+void cellgrid_set_box(CELLGRID* g, const double box[3])
+{
+  g->periodic = 1;
+  for(uint32_t d=0; d<3; d++)
+  {
+    g->nc[d] = (int32_t) floor(box[d]*g->invCellSize);
+    g->nc[d] = (g->nc[d] > 0) ? g->nc[d] : 1;
+    g->invc[d] = g->nc[d]/box[d];
+  }
+}
+
+/**
+ * @brief Removes all atoms from the grid
+ *
+ * @param g The grid
+ */
+void cellgrid_clear(CELLGRID* g)
+{
+  memset(g->head,0xff,g->nbuckets*sizeof(int32_t));
+}
+
+/**
+ * @brief Adds atom i at position (x,y,z) ; used when placing atoms one by one
+ *
+ * @param g The grid
+ * @param i Atom index, lower than the capacity of the grid
+ * @param x,y,z Position of the atom
+ */
+void cellgrid_insert(CELLGRID* g, uint32_t i, double x, double y, double z)
+{
+  const int32_t cx = g->periodic ? cellgrid_pcoord(g,x,0) : cellgrid_coord(g,x);
+  const int32_t cy = g->periodic ? cellgrid_pcoord(g,y,1) : cellgrid_coord(g,y);
+  const int32_t cz = g->periodic ? cellgrid_pcoord(g,z,2) : cellgrid_coord(g,z);
+  const uint32_t b = cellgrid_hash(g,cx,cy,cz);
+
+  g->cx[i] = cx;
+  g->cy[i] = cy;
+  g->cz[i] = cz;
+  g->next[i] = g->head[b];
+  g->head[b] = (int32_t) i;
+}
+
+/**
+ * @brief Rebuilds the grid from scratch with atoms 0 to n-1
+ *
+ * @param g The grid
+ * @param n Number of atoms
+ * @param x,y,z Coordinates
+ */
+void cellgrid_build(CELLGRID* g, uint32_t n, const double x[], const double y[], const double z[])
+{
+  cellgrid_clear(g);
+
+  // inserting in reverse order keeps atoms of a bucket sorted by increasing index
+  for(uint32_t i=n; i-- > 0; )
+    cellgrid_insert(g,i,x[i],y[i],z[i]);
+}
@@ -0,0 +1,115 @@
+/**
+ * \file cpuDispatch.c
+ *
+ * \brief Selection at run time of the variants of the hot kernels : the pair forces (ljKernelSimd.c),
+ *        the integrators updates, the centre of mass and the normal random numbers (vecKernels.c)
+ *
+ * \details Those kernels are compiled once per instruction set (kernelsSse2.c, kernelsAvx2.c, kernelsAvx512.c)
+ *          and the best one supported by the cpu is selected at startup with cpuid, so that the same binary
+ *          runs at full speed on all the nodes of a cluster instead of being built with -march=native on each of them.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "global.h"
+#include "cpuDispatch.h"
+#include "logger.h"
+
+/// initialiser of a KERNELS structure with the variants compiled for the instruction set isa
+#define KERNELS_VARIANT(isa)                  \
+  {                                           \
+    #isa,                                     \
+    &KERNEL_NAME(lj_kernel_isa,isa),          \
+    &KERNEL_NAME(lj_rows_neighlist,isa),      \
+    &KERNEL_NAME(lj_rows_neighlist_full,isa), \
+    &KERNEL_NAME(lj_tile_allpairs,isa),       \
+    &KERNEL_NAME(lj_energy_rows_neighlist,isa),\
+    &KERNEL_NAME(lj_energy_tile_allpairs,isa),\
+    &KERNEL_NAME(lj_rows_neighlist_mixed,isa),\
+    &KERNEL_NAME(lj_rows_neighlist_table,isa),\
+    &KERNEL_NAME(lj_batch_allpairs,isa),      \
+    &KERNEL_NAME(langevin_update,isa),        \
+    &KERNEL_NAME(brownian_update,isa),        \
+    &KERNEL_NAME(brownian_lm_update,isa),     \
+    &KERNEL_NAME(baoab_update,isa),           \
+    &KERNEL_NAME(kick_update,isa),            \
+    &KERNEL_NAME(gauss_transform,isa),        \
+    &KERNEL_NAME(sum_xyz,isa),                \
+    &KERNEL_NAME(shift_xyz,isa)               \
+  }
+
+/// the variants built, the best first
+static const KERNELS variants[] =
+{
+#ifdef HAVE_KERNELS_AVX512
+  KERNELS_VARIANT(avx512),
+#endif
+#ifdef HAVE_KERNELS_AVX2
+  KERNELS_VARIANT(avx2),
+#endif
+  KERNELS_VARIANT(sse2)
+};
+
+static const uint32_t nvariants = sizeof(variants)/sizeof(KERNELS);
+
+KERNELS kernels = KERNELS_VARIANT(sse2);
+
+/**
+ * @brief Checks with cpuid if the cpu supports an instruction set
+ *
+ * @param name One of sse2, avx2 or avx512
+ * @return 1 if the instruction set is supported by the cpu (and by the OS for the wide registers), 0 otherwise
+ */
+int32_t kernels_supported(const char name[])
+{
+  // the sse2 variant is compiled with the default flags so it always runs
+  if(!strcasecmp(name,"sse2"))
+    return 1;
+
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+
+  if(!strcasecmp(name,"avx2"))
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+  if(!strcasecmp(name,"avx512"))
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+
+  return 0;
+}
+
+/**
+ * @brief Selects the variant of the hot kernels used from now on
+ *
+ * @param name One of sse2, avx2 or avx512 ; NULL or "auto" for the best one supported by the cpu
+ * @return 0 on success, -1 if this variant was not built or is not supported by the cpu (the previous one is kept)
+ */
+int32_t kernels_select(const char name[])
+{
+  const uint32_t best = (name == NULL || !strcasecmp(name,"auto"));
+
+  for(uint32_t v=0; v<nvariants; v++)
+  {
+    if((best || !strcasecmp(name,variants[v].name)) && kernels_supported(variants[v].name))
+    {
+      kernels = variants[v];
+      LOG_PRINT(LOG_INFO,"Using the %s variant of the hot kernels (pair kernel : %s)\n",kernels.name,kernels.lj_kernel_isa());
+      return 0;
+    }
+  }
+
+  LOG_PRINT(LOG_WARNING,"Warning : kernels variant '%s' not built or not supported by this cpu, keeping %s\n",name,kernels.name);
+  return -1;
+}
@@ -0,0 +1,203 @@
+/**
+ * \file engine.c
+ *
+ * \brief Selection of the backend (OpenMM or native) used for energies, forces and integration
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "global.h"
+#include "logger.h"
+#include "engine.h"
+#include "nativeInterface.h"
+#include "ljForces.h"
+
+#ifdef USE_OMM
+#include "ommInterface.h"
+#endif
+
+const char* ommPlatformName[4] = { "Reference\0", "CPU\0", "CUDA\0", "OpenCL\0" };
+const char* minimisersName[3] = { "FIRE\0", "LOCAL\0", "LBFGS\0" };
+const char* integratorsName[4] = { "LANGEVIN\0", "BROWNIAN\0", "BAOAB\0", "BROWNIAN_LM\0" };
+// same strings than the values of the Precision property of the OpenMM platforms
+const char* precisionsName[3]  = { "single\0", "mixed\0", "double\0" };
+const char* reordersName[3]    = { "none\0", "Morton\0", "Hilbert\0" };
+
+/*
+ * Thin wrappers converting the opaque pointer of the ENGINE to the backend specific type
+ */
+
+static void eng_doNsteps_native(void* data, int numSteps)
+{
+  doNsteps_native((MyNativeData*)data,numSteps);
+}
+
+static void eng_getState_native(void* data, int wantEnergy,
+                                double* timeInPs, ENERGIES* energies, double* currentTemperature,
+                                ATOM atoms[], DATA* dat)
+{
+  getState_native((MyNativeData*)data,wantEnergy,timeInPs,energies,currentTemperature,atoms,dat);
+}
+
+static double eng_getEnergy_native(void* data, const ATOM atoms[])
+{
+  return getEnergy_native((MyNativeData*)data,atoms);
+}
+
+static void eng_minimise_native(void* data, double tolerance, int maxSteps)
+{
+  minimise_native((MyNativeData*)data,tolerance,maxSteps);
+}
+
+static void eng_evaporate_native(void* data, const uint8_t evap[])
+{
+  evaporate_native((MyNativeData*)data,evap);
+}
+
+static void eng_infos_native(const void* data)
+{
+  infos_native((const MyNativeData*)data);
+}
+
+static void eng_terminate_native(void* data)
+{
+  terminate_native((MyNativeData*)data);
+}
+
+#ifdef USE_OMM
+static void eng_doNsteps_omm(void* data, int numSteps)
+{
+  doNsteps_omm((MyOpenMMData*)data,numSteps);
+}
+
+static void eng_getState_omm(void* data, int wantEnergy,
+                             double* timeInPs, ENERGIES* energies, double* currentTemperature,
+                             ATOM atoms[], DATA* dat)
+{
+  getState_omm((MyOpenMMData*)data,wantEnergy,timeInPs,energies,currentTemperature,atoms,dat);
+}
+
+static double eng_getEnergy_omm(void* data, const ATOM atoms[])
+{
+  return getEnergy_omm((MyOpenMMData*)data,atoms);
+}
+
+static void eng_minimise_omm(void* data, double tolerance, int maxSteps)
+{
+  minimise_omm((MyOpenMMData*)data,tolerance,maxSteps);
+}
+
+static void eng_infos_omm(const void* data)
+{
+  infos_omm((const MyOpenMMData*)data);
+}
+
+static void eng_terminate_omm(void* data)
+{
+  terminate_omm((MyOpenMMData*)data);
+}
+
+/// exits with an error for the options only implemented by the native engine
+static void check_omm_options(const DATA* dat)
+{
+  const char* unsupported = NULL;
+
+  if(dat->integrator == BAOAB || dat->integrator == BROWNIAN_LM)
+    unsupported = (dat->integrator == BAOAB) ? "METHOD BAOAB" : "METHOD BROWNIAN_LM";
+  else if(dat->adaptDisp > 0.0)
+    unsupported = "ADAPTIVE";
+  else if(dat->evapCheck)
+    unsupported = "EVAPORATION";
+
+  if(unsupported != NULL)
+  {
+    LOG_PRINT(LOG_ERROR,"Error : %s is only available with PLATFORM NATIVE, not with the OpenMM platform %s\n",
+              unsupported,(dat->platform == AUTO) ? "AUTO" : ommPlatformName[dat->platform]);
+    exit(-1);
+  }
+}
+#endif
+
+/**
+ * @brief Initialises the backend requested by the PLATFORM keyword.
+ *
+ * If the code was built without OpenMM (cmake -DUSE_OMM=OFF) any OpenMM platform falls back to NATIVE.
+ * With PLATFORM AUTO, systems small enough for the tiled all-pairs kernel (see ljForces.h) are run by the NATIVE
+ * platform, for which the cost of a step is a few microseconds instead of the overhead of an OpenMM Context.
+ * The options only implemented by the native engine are errors with the OpenMM platforms, see check_omm_options.
+ *
+ * @param atoms The atom list, coordinates in angstroems
+ * @param dat Common data ; platform is set to NATIVE whenever the native engine is the one initialised
+ * @return The initialised ENGINE, to be freed with terminate_engine
+ */
+ENGINE* init_engine(ATOM atoms[], DATA* dat)
+{
+  ENGINE* eng = (ENGINE*)malloc(sizeof(ENGINE));
+
+#ifndef USE_OMM
+  if(dat->platform != NATIVE)
+  {
+    LOG_PRINT(LOG_WARNING,"Code built without OpenMM support : platform %d replaced by the NATIVE platform.\n",dat->platform);
+    dat->platform = NATIVE;
+  }
+#else
+  if(dat->platform == AUTO && dat->natom <= LJ_ALLPAIRS_NMAX)
+  {
+    LOG_PRINT(LOG_INFO,"Platform AUTO : %d atoms, using the NATIVE platform (all-pairs kernel)\n",dat->natom);
+    dat->platform = NATIVE;
+  }
+#endif
+
+  if(dat->platform == NATIVE)
+  {
+    MyNativeData* nat = init_native(atoms,dat);
+    eng->data         = nat;
+    eng->platformName = "Native";
+    eng->doNsteps     = &eng_doNsteps_native;
+    eng->getState     = &eng_getState_native;
+    eng->getEnergy    = &eng_getEnergy_native;
+    eng->minimise     = &eng_minimise_native;
+    eng->evaporate    = &eng_evaporate_native;
+    eng->infos        = &eng_infos_native;
+    eng->terminate    = &eng_terminate_native;
+  }
+#ifdef USE_OMM
+  else
+  {
+    check_omm_options(dat);
+    MyOpenMMData* omm = init_omm(atoms,dat);
+    eng->data         = omm;
+    eng->platformName = omm->platformName;
+    eng->doNsteps     = &eng_doNsteps_omm;
+    eng->getState     = &eng_getState_omm;
+    eng->getEnergy    = &eng_getEnergy_omm;
+    eng->minimise     = &eng_minimise_omm;
+    eng->evaporate    = NULL;
+    eng->infos        = &eng_infos_omm;
+    eng->terminate    = &eng_terminate_omm;
+  }
+#endif
+
+  return eng;
+}
+
+/**
+ * @brief Frees the backend specific data and the ENGINE itself
+ *
+ * @param eng The ENGINE to free
+ */
+void terminate_engine(ENGINE* eng)
+{
+  eng->terminate(eng->data);
+  free(eng);
+}
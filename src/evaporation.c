@@ -0,0 +1,196 @@
+/**
+ * \file evaporation.c
+ *
+ * \brief Detection of the atoms evaporated from the cluster : after each block of TRSAVE steps the atoms are connected
+ *  when closer than a radius (the cutoff by default), and the atoms out of the largest connected group are evaporated.
+ *
+ * \details An evaporated atom, or a small fragment, does not interact with the cluster any more and drifts away forever,
+ *          still costing pair searches and moving the centre of mass. They are dropped from the engine (see the
+ *          evaporate function of ENGINE), keep the position at which they were detected, and are not taken into account
+ *          by getCM. An atom with no neighbour within the radius is the most common case, but dimers and larger
+ *          fragments leaving together are detected as well.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "global.h"
+#include "logger.h"
+#include "cellGrid.h"
+#include "evaporation.h"
+
+/**
+ * @brief Checks the EVAPORATION keyword against the other ones and allocates the flags of the evaporated atoms
+ *
+ * @param dat Common data ; evapCheck is reset if the detection does not apply
+ */
+void evaporation_init(DATA* dat)
+{
+  if(!dat->evapCheck)
+    return;
+
+  if(dat->pbc)
+  {
+    LOG_PRINT(LOG_WARNING,"Warning : EVAPORATION ignored in a periodic box, where no atom can leave\n");
+    dat->evapCheck = 0;
+    return;
+  }
+
+  if(!(dat->evapRadius > 0.0))
+  {
+    if(!isfinite(dat->cutoff))
+    {
+      LOG_PRINT(LOG_ERROR,"Error : EVAPORATION without cutoff (NOCUT) requires a RADIUS\n");
+      exit(-1);
+    }
+    dat->evapRadius = dat->cutoff;
+  }
+
+  dat->evap  = calloc(dat->natom,sizeof(uint8_t));
+  dat->nevap = 0;
+
+  LOG_PRINT(LOG_INFO,"Evaporation : atoms out of the largest group connected within %lf nm dropped after each block%s\n",
+            dat->evapRadius,(dat->evapStop > 0.0) ? "" : ", never stopping the run");
+  if(dat->evapStop > 0.0)
+    LOG_PRINT(LOG_INFO,"Evaporation : the run stops once more than %.2lf %% of the atoms evaporated\n",100.0*dat->evapStop);
+}
+
+/// root of the group of k, halving the paths on the way
+static inline uint32_t evaporation_root(uint32_t parent[], uint32_t k)
+{
+  while(parent[k] != k)
+  {
+    parent[k] = parent[parent[k]];
+    k = parent[k];
+  }
+  return k;
+}
+
+/**
+ * @brief Connects the atoms not evaporated yet within the radius and flags those out of the largest connected group :
+ *  linear cost, from a hashed cell grid with cells of the size of the radius and a union-find of the pairs
+ *
+ * @param at Atom list, coordinates in angstroems
+ * @param dat Common data, whose evap flags and nevap count are updated
+ * @return The number of atoms evaporated since the previous call
+ */
+uint32_t evaporation_update(const ATOM at[], DATA* dat)
+{
+  const uint32_t ntot = dat->natom;
+  const double r  = 10.0*dat->evapRadius;
+  const double r2 = r*r;
+
+  // the atoms still in the cluster, renumbered from 0
+  uint32_t* idx = malloc(ntot*sizeof(uint32_t));
+  uint32_t n = 0;
+  for(uint32_t i=0; i<ntot; i++)
+    if(!dat->evap[i])
+      idx[n++] = i;
+
+  CELLGRID* grid = cellgrid_alloc(n,r);
+  for(uint32_t k=0; k<n; k++)
+    cellgrid_insert(grid,k,at[idx[k]].x,at[idx[k]].y,at[idx[k]].z);
+
+  uint32_t* parent = malloc(2*(size_t)n*sizeof(uint32_t));
+  uint32_t* size = parent + n;
+  for(uint32_t k=0; k<n; k++)
+  {
+    parent[k] = k;
+    size[k] = 1;
+  }
+
+  for(uint32_t k=0; k<n; k++)
+  {
+    const ATOM* ak = &(at[idx[k]]);
+
+    // the cell of k (l>k only) then the 13 cells of the half shell
+    for(int32_t c=-1; c<13; c++)
+    {
+      const int32_t ncx = grid->cx[k] + ((c<0) ? 0 : cellgrid_half_shell[c][0]);
+      const int32_t ncy = grid->cy[k] + ((c<0) ? 0 : cellgrid_half_shell[c][1]);
+      const int32_t ncz = grid->cz[k] + ((c<0) ? 0 : cellgrid_half_shell[c][2]);
+
+      for(int32_t l=grid->head[cellgrid_hash(grid,ncx,ncy,ncz)]; l>=0; l=grid->next[l])
+      {
+        if(grid->cx[l]!=ncx || grid->cy[l]!=ncy || grid->cz[l]!=ncz)
+          continue;
+        if(c<0 && (uint32_t)l<=k)
+          continue;
+
+        const ATOM* al = &(at[idx[l]]);
+        if(X2(ak->x-al->x) + X2(ak->y-al->y) + X2(ak->z-al->z) >= r2)
+          continue;
+
+        uint32_t a = evaporation_root(parent,k);
+        uint32_t b = evaporation_root(parent,(uint32_t)l);
+        if(a == b)
+          continue;
+        // union by size
+        if(size[a] < size[b])
+        {
+          const uint32_t t = a;
+          a = b;
+          b = t;
+        }
+        parent[b] = a;
+        size[a] += size[b];
+      }
+    }
+  }
+
+  // the largest group is the cluster, the first one found in case of a tie
+  uint32_t big = 0, bigSize = 0;
+  for(uint32_t k=0; k<n; k++)
+    if(parent[k] == k && size[k] > bigSize)
+    {
+      big = k;
+      bigSize = size[k];
+    }
+
+  uint32_t nnew = 0;
+  for(uint32_t k=0; k<n; k++)
+    if(evaporation_root(parent,k) != big)
+    {
+      dat->evap[idx[k]] = 1;
+      nnew++;
+    }
+  dat->nevap += nnew;
+
+  free(parent);
+  cellgrid_free(grid);
+  free(idx);
+
+  return nnew;
+}
+
+/**
+ * @brief Whether the run has to stop, more than the STOP fraction of the atoms having evaporated
+ *
+ * @param dat Common data
+ * @return 1 if the run has to stop, 0 otherwise
+ */
+int32_t evaporation_stop(const DATA* dat)
+{
+  return dat->evapCheck && (dat->evapStop > 0.0) && (dat->nevap > dat->evapStop*dat->natom);
+}
+
+/**
+ * @brief Frees the flags of the evaporated atoms
+ *
+ * @param dat Common data
+ */
+void evaporation_free(DATA* dat)
+{
+  free(dat->evap);
+  dat->evap  = NULL;
+  dat->nevap = 0;
+}
@@ -17,9 +17,11 @@
 #include <stdio.h>
 #include <time.h>
 #include <string.h>
+#include <strings.h>
 
 #include "global.h"
 #include "io.h"
+#include "logger.h"
 #include "tools.h"
 
 /// header has to be written only once at the beginning of the dcd
@@ -35,12 +37,15 @@ static uint32_t dcd_header_empty=1;
  */
 void write_xyz(ATOM at[], DATA *dat, uint64_t when, FILE *outf)
 {
-    recentre(at,dat);
+    if (dat->pbc)
+        wrap_box(at,dat);
+    else
+        recentre(at,dat);
 
     uint32_t i=0;
     fprintf(outf,"%d\n#step %"PRIu64"\ttime %lf (ps)\n",dat->natom,when,when*dat->timestep);
     for (i=0; i<(dat->natom); i++)
-        fprintf(outf,"%s\t%10.5lf\t%10.5lf\t%10.5lf\n",at[i].sym,at[i].x,at[i].y,at[i].z);
+        fprintf(outf,"%s\t%10.5lf\t%10.5lf\t%10.5lf\n",dat->species.pars[at[i].type].sym,at[i].x,at[i].y,at[i].z);
 }
 
 /**
@@ -65,31 +70,48 @@ void read_xyz(ATOM at[], DATA *dat, FILE *inpf)
         exit(-1);
     }
 
+    // the species are given by the ATOM keywords, symbols of the file are only compared to them
+    char sym[64]="";
     for (i=0; i<nat; i++)
-        fscanf(inpf,"%s %lf %lf %lf\n",at[i].sym,&(at[i].x),&(at[i].y),&(at[i].z));
+    {
+        fscanf(inpf,"%63s %lf %lf %lf\n",sym,&(at[i].x),&(at[i].y),&(at[i].z));
+        if (strcasecmp(sym,dat->species.pars[at[i].type].sym))
+            LOG_PRINT(LOG_INFO,"Atom %d is %s in the xyz file but %s in the input file : keeping %s\n",
+                      i,sym,dat->species.pars[at[i].type].sym,dat->species.pars[at[i].type].sym);
+    }
 
 }
 
 /**
- * Writes a CHARMM like dcd
+ * Writes a frame of a CHARMM like dcd to a given file, preceded by the header for the first frame
  * @param at ATOM array where to store coordinates
  * @param dat common simulation data
- * @param when At which step function was called ; unused here but kept for compatibility with write_xyz
+ * @param f The dcd file
+ * @param header_empty 1 if the header of f has not been written yet, set to 0 once written
  */
-void write_dcd(ATOM at[], DATA *dat, uint64_t when)
+void write_dcd_to(ATOM at[], DATA *dat, FILE *f, uint32_t *header_empty)
 {
-    recentre(at,dat);
+    if (dat->pbc)
+        wrap_box(at,dat);
+    else
+        recentre(at,dat);
 
     uint32_t i=0;
     uint32_t sizeB = 0;
 
-    if (dcd_header_empty)
+    if (*header_empty)
     {
         char corp[4]= {'C','O','R','D'};
 
         uint32_t  ICNTRL[20]= {0};
         ICNTRL[0]=ICNTRL[3] = (uint32_t) dat->nsteps/io.trsave;
         ICNTRL[1]=ICNTRL[2]=1;
+        // DELTA : time between two frames as a float in AKMA units, frame k (from 1) being at k*DELTA ;
+        //  with ADAPTIVE the blocks of steps still last trsave timesteps of METHOD
+        const float delta = (float)(io.trsave*dat->timestep/AKMA_TIME_PS);
+        memcpy(&ICNTRL[9],&delta,sizeof(float));
+        // a unit cell record precedes the coordinates of each frame in a periodic box
+        ICNTRL[10] = dat->pbc ? 1 : 0;
         ICNTRL[19]=39;	//charmm version : not important, we just put a not too old charmm version number
 
         uint32_t NTITLE=3;
@@ -117,58 +139,98 @@ void write_dcd(ATOM at[], DATA *dat, uint64_t when)
         uint32_t NATOM=dat->natom;
 
         sizeB = sizeof(corp) + sizeof(ICNTRL);
-        fwrite(&sizeB,sizeof(uint32_t),1,traj);
+        fwrite(&sizeB,sizeof(uint32_t),1,f);
         {
-            fwrite(corp,sizeof(char),4,traj);
-            fwrite(ICNTRL,sizeof(uint32_t),20,traj);
+            fwrite(corp,sizeof(char),4,f);
+            fwrite(ICNTRL,sizeof(uint32_t),20,f);
         }
-        fwrite(&sizeB,sizeof(uint32_t),1,traj);
+        fwrite(&sizeB,sizeof(uint32_t),1,f);
 
         sizeB = sizeof(NTITLE) + NTITLE*80*sizeof(char);
-        fwrite(&sizeB,sizeof(uint32_t),1,traj);
+        fwrite(&sizeB,sizeof(uint32_t),1,f);
         {
-            fwrite(&NTITLE,sizeof(uint32_t),1,traj);
+            fwrite(&NTITLE,sizeof(uint32_t),1,f);
             for (i=0; i<NTITLE; i++)
-                fwrite(TITLE[i],sizeof(char),80,traj);
+                fwrite(TITLE[i],sizeof(char),80,f);
         }
-        fwrite(&sizeB,sizeof(uint32_t),1,traj);
+        fwrite(&sizeB,sizeof(uint32_t),1,f);
 
         sizeB = sizeof(NATOM);
-        fwrite(&sizeB,sizeof(uint32_t),1,traj);
-        fwrite(&NATOM,sizeof(uint32_t),1,traj);
-        fwrite(&sizeB,sizeof(uint32_t),1,traj);
+        fwrite(&sizeB,sizeof(uint32_t),1,f);
+        fwrite(&NATOM,sizeof(uint32_t),1,f);
+        fwrite(&sizeB,sizeof(uint32_t),1,f);
+
+        *header_empty=0;
+    }
 
-        dcd_header_empty=0;
+    if (dat->pbc)
+    {
+        // CHARMM order : A, gamma, B, beta, alpha, C ; edges in angstroems and angles in degrees
+        const double cell[6] = {10.0*dat->box[0],90.0,10.0*dat->box[1],90.0,90.0,10.0*dat->box[2]};
+        sizeB=(uint32_t)sizeof(cell);
+        fwrite(&sizeB,sizeof(uint32_t),1,f);
+        fwrite(cell,sizeof(double),6,f);
+        fwrite(&sizeB,sizeof(uint32_t),1,f);
     }
 
     float x=0.f,y=0.f,z=0.f;
     sizeB=(uint32_t)sizeof(float)*dat->natom;
 
-    fwrite(&sizeB,sizeof(uint32_t),1,traj);
+    fwrite(&sizeB,sizeof(uint32_t),1,f);
     for(i=0; i<dat->natom; i++)
     {
         x=(float)at[i].x;
-        fwrite(&x,sizeof(float),1,traj);
+        fwrite(&x,sizeof(float),1,f);
     }
-    fwrite(&sizeB,sizeof(uint32_t),1,traj);
+    fwrite(&sizeB,sizeof(uint32_t),1,f);
 
-    fwrite(&sizeB,sizeof(uint32_t),1,traj);
+    fwrite(&sizeB,sizeof(uint32_t),1,f);
     for(i=0; i<dat->natom; i++)
     {
         y=(float)at[i].y;
-        fwrite(&y,sizeof(float),1,traj);
+        fwrite(&y,sizeof(float),1,f);
     }
-    fwrite(&sizeB,sizeof(uint32_t),1,traj);
+    fwrite(&sizeB,sizeof(uint32_t),1,f);
 
-    fwrite(&sizeB,sizeof(uint32_t),1,traj);
+    fwrite(&sizeB,sizeof(uint32_t),1,f);
     for(i=0; i<dat->natom; i++)
     {
         z=(float)at[i].z;
-        fwrite(&z,sizeof(float),1,traj);
+        fwrite(&z,sizeof(float),1,f);
     }
-    fwrite(&sizeB,sizeof(uint32_t),1,traj);
+    fwrite(&sizeB,sizeof(uint32_t),1,f);
 
 }
+
+/**
+ * Writes a CHARMM like dcd
+ * @param at ATOM array where to store coordinates
+ * @param dat common simulation data
+ * @param when At which step function was called ; unused here but kept for compatibility with write_xyz
+ */
+void write_dcd(ATOM at[], DATA *dat, uint64_t when)
+{
+    write_dcd_to(at,dat,traj,&dcd_header_empty);
+}
+
+/**
+ * Sets the number of frames of the dcd header (NFILE and NSTEP) once the run stopped before NSTEPS (EVAPORATION STOP),
+ * so that readers do not expect the frames announced at startup ; the file is left positioned at its end
+ * @param nframes Number of frames actually written
+ */
+void write_dcd_nframes(uint32_t nframes)
+{
+    if (dcd_header_empty)
+        return;
+
+    // record length then 'CORD' : ICNTRL[0] at byte 8, ICNTRL[3] at byte 20
+    fseek(traj,8,SEEK_SET);
+    fwrite(&nframes,sizeof(uint32_t),1,traj);
+    fseek(traj,20,SEEK_SET);
+    fwrite(&nframes,sizeof(uint32_t),1,traj);
+    fseek(traj,0,SEEK_END);
+}
+
 /**
  * Writes a restart file : DO NOT USE for the moment there is a bug somewhere !
  * 
@@ -0,0 +1,23 @@
+/**
+ * \file kernelsAvx2.c
+ *
+ * \brief AVX2 variants of the hot kernels : see ljKernelSimd.c, vecKernels.c and cpuDispatch.c
+ *
+ * \details Compiled with -mavx2 -mfma (see CMakeLists.txt), only called if the cpu supports them.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include "cpuDispatch.h"
+
+#define KNAME(f) KERNEL_NAME(f,avx2)
+
+#include "ljKernelSimd.c"
+#include "vecKernels.c"
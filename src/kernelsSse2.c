@@ -0,0 +1,24 @@
+/**
+ * \file kernelsSse2.c
+ *
+ * \brief SSE2 variants of the hot kernels : see ljKernelSimd.c, vecKernels.c and cpuDispatch.c
+ *
+ * \details Compiled with the default flags of the project : this is the variant used on any x86-64 cpu,
+ *          and the scalar fallback on other architectures.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include "cpuDispatch.h"
+
+#define KNAME(f) KERNEL_NAME(f,sse2)
+
+#include "ljKernelSimd.c"
+#include "vecKernels.c"
@@ -0,0 +1,894 @@
+/**
+ * \file ljForces.c
+ *
+ * \brief Lennard-Jones energy and forces evaluation for the native engine
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "global.h"
+#include "ljForces.h"
+#include "cpuDispatch.h"
+
+/**
+ * @brief Initialises the cuton/cutoff structure in the same way than init_omm configures OpenMM :
+ *  the switching function is used only if both values are finite and cuton < cutoff.
+ *
+ * @param cuts The structure to fill
+ * @param cuton Switching distance in nm
+ * @param cutoff Cutoff distance in nm, INFINITY for no cutoff
+ */
+void lj_init_cuts(LJ_CUTS* cuts, double cuton, double cutoff)
+{
+  cuts->cuton  = cuton;
+  cuts->cutoff = cutoff;
+  cuts->cutoff2 = isfinite(cutoff) ? cutoff*cutoff : INFINITY;
+  cuts->cuton2  = isfinite(cuton)  ? cuton*cuton   : INFINITY;
+
+  cuts->useSwitch = (isfinite(cuton) && isfinite(cutoff) && (cuton < cutoff)) ? 1 : 0;
+  cuts->swInv = cuts->useSwitch ? 1.0/(cutoff-cuton) : 0.0;
+}
+
+/**
+ * @brief Computes the total LJ energy and the forces by looping over all the pairs i<j.
+ *  Parameters of the pairs are read from the species table, mixed with the Lorentz-Berthelot rules as in OpenMM's NonbondedForce.
+ *
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten
+ * @return The potential energy in kJ/mol
+ */
+double lj_forces_allpairs(uint32_t n,
+                          const double x[], const double y[], const double z[],
+                          const uint32_t type[], const SPECIES* sp,
+                          const LJ_CUTS* cuts,
+                          double fx[], double fy[], double fz[])
+{
+  double epot = 0.0;
+
+  memset(fx,0,n*sizeof(double));
+  memset(fy,0,n*sizeof(double));
+  memset(fz,0,n*sizeof(double));
+
+  for(uint32_t i=0; i<n; i++)
+  {
+    const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+    const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+    double fxi=0.0, fyi=0.0, fzi=0.0;
+
+    for(uint32_t j=i+1; j<n; j++)
+    {
+      const double dx = x[i]-x[j];
+      const double dy = y[i]-y[j];
+      const double dz = z[i]-z[j];
+      const double r2 = dx*dx + dy*dy + dz*dz;
+
+      const double fr = lj_pair(r2, sigi[type[j]], epsi[type[j]], cuts, &epot);
+
+      fxi += fr*dx;   fx[j] -= fr*dx;
+      fyi += fr*dy;   fy[j] -= fr*dy;
+      fzi += fr*dz;   fz[j] -= fr*dz;
+    }
+
+    fx[i] += fxi;
+    fy[i] += fyi;
+    fz[i] += fzi;
+  }
+
+  return epot;
+}
+
+/// pairs of the atoms ibeg to iend-1 with the atoms of their own cell (j>i) and of the 13 cells of the half shell :
+///  energy and forces accumulated, reaction forces included
+static double lj_rows_cellgrid(const CELLGRID* grid, uint32_t ibeg, uint32_t iend,
+                               const double x[], const double y[], const double z[],
+                               const uint32_t type[], const SPECIES* sp,
+                               const LJ_CUTS* cuts,
+                               double fx[], double fy[], double fz[])
+{
+  double epot = 0.0;
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const int32_t cx = grid->cx[i];
+    const int32_t cy = grid->cy[i];
+    const int32_t cz = grid->cz[i];
+    const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+    const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+    double fxi=0.0, fyi=0.0, fzi=0.0;
+
+    // the cell of i (only j>i) then the 13 cells of the half shell (all j)
+    for(int32_t c=-1; c<13; c++)
+    {
+      const int32_t ncx = (c<0) ? cx : cx+cellgrid_half_shell[c][0];
+      const int32_t ncy = (c<0) ? cy : cy+cellgrid_half_shell[c][1];
+      const int32_t ncz = (c<0) ? cz : cz+cellgrid_half_shell[c][2];
+
+      for(int32_t j=grid->head[cellgrid_hash(grid,ncx,ncy,ncz)]; j>=0; j=grid->next[j])
+      {
+        if(grid->cx[j]!=ncx || grid->cy[j]!=ncy || grid->cz[j]!=ncz || (c<0 && (uint32_t)j<=i))
+          continue;
+
+        const double dx = x[i]-x[j];
+        const double dy = y[i]-y[j];
+        const double dz = z[i]-z[j];
+        const double r2 = dx*dx + dy*dy + dz*dz;
+
+        const double fr = lj_pair(r2, sigi[type[j]], epsi[type[j]], cuts, &epot);
+
+        fxi += fr*dx;   fx[j] -= fr*dx;
+        fyi += fr*dy;   fy[j] -= fr*dy;
+        fzi += fr*dz;   fz[j] -= fr*dz;
+      }
+    }
+
+    fx[i] += fxi;
+    fy[i] += fyi;
+    fz[i] += fzi;
+  }
+
+  return epot;
+}
+
+/**
+ * @brief Same as lj_forces_allpairs but only the pairs in the same or in neighbouring cells of the grid are visited,
+ *  i.e. O(N) instead of O(N^2). The grid must have been built with the current coordinates and with cells not smaller than the cutoff.
+ *
+ * @param grid Hashed cell grid built from x,y,z
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten
+ * @return The potential energy in kJ/mol
+ */
+double lj_forces_cellgrid(const CELLGRID* grid, uint32_t n,
+                          const double x[], const double y[], const double z[],
+                          const uint32_t type[], const SPECIES* sp,
+                          const LJ_CUTS* cuts,
+                          double fx[], double fy[], double fz[])
+{
+  memset(fx,0,n*sizeof(double));
+  memset(fy,0,n*sizeof(double));
+  memset(fz,0,n*sizeof(double));
+
+  return lj_rows_cellgrid(grid,0,n,x,y,z,type,sp,cuts,fx,fy,fz);
+}
+
+/**
+ * @brief Multithreaded version of \b #lj_forces_cellgrid (SKIN 0, no neighbour list), as \b #lj_forces_neighlist_omp :
+ *  the atoms are distributed dynamically over the threads by chunks, each thread accumulating forces (including
+ *  reaction forces) in its own buffer, and the buffers are then summed in parallel over the atoms.
+ *
+ * @param grid Hashed cell grid built from x,y,z
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten ; also used as the buffer of the first thread
+ * @param tbuf Force buffers of the other threads, of size (nthreads-1)*3*n
+ * @param nthreads Number of threads ; if 1 or without OpenMP the sequential kernel is used
+ * @return The potential energy in kJ/mol
+ */
+double lj_forces_cellgrid_omp(const CELLGRID* grid, uint32_t n,
+                              const double x[], const double y[], const double z[],
+                              const uint32_t type[], const SPECIES* sp,
+                              const LJ_CUTS* cuts,
+                              double fx[], double fy[], double fz[],
+                              double tbuf[], uint32_t nthreads)
+{
+#ifdef _OPENMP
+  if(nthreads > 1)
+  {
+    const uint32_t chunk   = 64;
+    const uint32_t nchunks = (n+chunk-1)/chunk;
+    double epot = 0.0;
+
+    #pragma omp parallel num_threads(nthreads) reduction(+:epot)
+    {
+      const uint32_t t  = (uint32_t) omp_get_thread_num();
+      const uint32_t nt = (uint32_t) omp_get_num_threads();
+
+      double *tfx = (t==0) ? fx : tbuf + (size_t)(t-1)*3*n;
+      double *tfy = (t==0) ? fy : tfx + n;
+      double *tfz = (t==0) ? fz : tfx + 2*n;
+
+      memset(tfx,0,n*sizeof(double));
+      memset(tfy,0,n*sizeof(double));
+      memset(tfz,0,n*sizeof(double));
+
+      #pragma omp for schedule(dynamic,1)
+      for(uint32_t c=0; c<nchunks; c++)
+      {
+        const uint32_t iend = (c+1)*chunk < n ? (c+1)*chunk : n;
+        epot += lj_rows_cellgrid(grid,c*chunk,iend,x,y,z,type,sp,cuts,tfx,tfy,tfz);
+      }
+
+      // implicit barrier above : all buffers are complete, reduce them in parallel over the atoms
+      #pragma omp for schedule(static)
+      for(uint32_t j=0; j<n; j++)
+      {
+        for(uint32_t b=1; b<nt; b++)
+        {
+          const double* bf = tbuf + (size_t)(b-1)*3*n;
+          fx[j] += bf[j];
+          fy[j] += bf[n+j];
+          fz[j] += bf[2*n+j];
+        }
+      }
+    }
+
+    return epot;
+  }
+#else
+  (void) tbuf;
+  (void) nthreads;
+#endif
+
+  return lj_forces_cellgrid(grid,n,x,y,z,type,sp,cuts,fx,fy,fz);
+}
+
+/**
+ * @brief Same as lj_forces_allpairs but only the pairs of the (half) Verlet neighbour list are visited.
+ *  The list must be up to date, see neighlist_update.
+ *
+ * @param nl Neighbour list built with a list radius not smaller than the cutoff ; periodic lists use the minimum image
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten
+ * @return The potential energy in kJ/mol
+ */
+double lj_forces_neighlist(const NEIGHLIST* nl, uint32_t n,
+                           const double x[], const double y[], const double z[],
+                           const uint32_t type[], const SPECIES* sp,
+                           const LJ_CUTS* cuts,
+                           double fx[], double fy[], double fz[])
+{
+  double epot = 0.0;
+
+  memset(fx,0,n*sizeof(double));
+  memset(fy,0,n*sizeof(double));
+  memset(fz,0,n*sizeof(double));
+
+  for(uint32_t i=0; i<n; i++)
+  {
+    const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+    const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+    double fxi=0.0, fyi=0.0, fzi=0.0;
+
+    for(uint32_t k=nl->start[i]; k<nl->start[i+1]; k++)
+    {
+      const uint32_t j = nl->list[k];
+
+      const double dx = nl->periodic ? cellgrid_image(x[i]-x[j],nl->box[0],nl->ibox[0]) : x[i]-x[j];
+      const double dy = nl->periodic ? cellgrid_image(y[i]-y[j],nl->box[1],nl->ibox[1]) : y[i]-y[j];
+      const double dz = nl->periodic ? cellgrid_image(z[i]-z[j],nl->box[2],nl->ibox[2]) : z[i]-z[j];
+      const double r2 = dx*dx + dy*dy + dz*dz;
+
+      const double fr = lj_pair(r2, sigi[type[j]], epsi[type[j]], cuts, &epot);
+
+      fxi += fr*dx;   fx[j] -= fr*dx;
+      fyi += fr*dy;   fy[j] -= fr*dy;
+      fzi += fr*dz;   fz[j] -= fr*dz;
+    }
+
+    fx[i] += fxi;
+    fy[i] += fyi;
+    fz[i] += fzi;
+  }
+
+  return epot;
+}
+
+/**
+ * @brief Returns the instruction set of the variant of the SIMD kernel selected at run time (see cpuDispatch.c)
+ */
+const char* lj_simd_isa()
+{
+  return kernels.lj_kernel_isa();
+}
+
+/**
+ * @brief Vectorised LJ interactions of the atoms ibeg to iend-1 with their neighbours, energy and forces being accumulated :
+ *  calls the variant of the kernel of ljKernelSimd.c selected at run time
+ *
+ * @param nl Neighbour list built with a list radius not smaller than the cutoff
+ * @param ibeg,iend Range of atoms (rows of the list) to process
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param fx,fy,fz Forces in kJ/mol/nm, accumulated
+ * @return The potential energy of the pairs processed, in kJ/mol
+ */
+double lj_rows_neighlist_simd(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                              const double x[], const double y[], const double z[],
+                              const uint32_t type[], const SPECIES* sp,
+                              const LJ_CUTS* cuts,
+                              double fx[], double fy[], double fz[])
+{
+  return kernels.lj_rows_neighlist(nl,ibeg,iend,x,y,z,type,sp,cuts,fx,fy,fz);
+}
+
+/**
+ * @brief Vectorised equivalent of \b #lj_forces_neighlist
+ *
+ * @param nl Neighbour list built with a list radius not smaller than the cutoff
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten
+ * @return The potential energy in kJ/mol
+ */
+double lj_forces_neighlist_simd(const NEIGHLIST* nl, uint32_t n,
+                                const double x[], const double y[], const double z[],
+                                const uint32_t type[], const SPECIES* sp,
+                                const LJ_CUTS* cuts,
+                                double fx[], double fy[], double fz[])
+{
+  memset(fx,0,n*sizeof(double));
+  memset(fy,0,n*sizeof(double));
+  memset(fz,0,n*sizeof(double));
+
+  return kernels.lj_rows_neighlist(nl,0,n,x,y,z,type,sp,cuts,fx,fy,fz);
+}
+
+/**
+ * @brief Packs the coordinates and the species in single precision for the mixed precision kernel :
+ *  4 floats per atom (x,y,z,species) so that all the data of a neighbour is in the same cache line
+ *
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param type Species of the atoms
+ * @param xyzt Output, size 4*n
+ */
+void lj_pack_mixed(uint32_t n, const double x[], const double y[], const double z[], const uint32_t type[], float xyzt[])
+{
+  for(uint32_t i=0; i<n; i++)
+  {
+    xyzt[4*i]   = (float) x[i];
+    xyzt[4*i+1] = (float) y[i];
+    xyzt[4*i+2] = (float) z[i];
+    xyzt[4*i+3] = (float) type[i];
+  }
+}
+
+/**
+ * @brief Mixed precision forces (see lj_rows_neighlist_mixed in ljKernelSimd.c), multithreaded as \b #lj_forces_neighlist_omp :
+ *  each thread accumulates in its own packed single precision buffer, the buffers being summed in double precision.
+ *
+ * @param nl Neighbour list built with a list radius not smaller than the cutoff
+ * @param n Number of atoms
+ * @param xyzt Single precision copy of the coordinates in nm and of the species, packed by atom, see \b #lj_pack_mixed
+ * @param sp Species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param f4buf Packed single precision force buffers of the threads, of size nthreads*4*n
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten
+ * @param nthreads Number of threads ; 1 without OpenMP
+ * @return The potential energy in kJ/mol
+ */
+double lj_forces_neighlist_mixed(const NEIGHLIST* nl, uint32_t n, const float xyzt[],
+                                 const SPECIES* sp, const LJ_CUTS* cuts,
+                                 float f4buf[], double fx[], double fy[], double fz[],
+                                 uint32_t nthreads)
+{
+  const uint32_t chunk   = 64;
+  const uint32_t nchunks = (n+chunk-1)/chunk;
+  double epot = 0.0;
+
+#ifdef _OPENMP
+  #pragma omp parallel num_threads(nthreads) reduction(+:epot)
+#else
+  (void) nthreads;
+#endif
+  {
+#ifdef _OPENMP
+    const uint32_t t  = (uint32_t) omp_get_thread_num();
+    const uint32_t nt = (uint32_t) omp_get_num_threads();
+#else
+    const uint32_t t  = 0;
+    const uint32_t nt = 1;
+#endif
+
+    float *tf4 = f4buf + (size_t)t*4*n;
+    memset(tf4,0,4*(size_t)n*sizeof(float));
+
+#ifdef _OPENMP
+    #pragma omp for schedule(dynamic,1)
+#endif
+    for(uint32_t c=0; c<nchunks; c++)
+    {
+      const uint32_t iend = (c+1)*chunk < n ? (c+1)*chunk : n;
+      epot += kernels.lj_rows_neighlist_mixed(nl,c*chunk,iend,xyzt,sp,cuts,tf4);
+    }
+
+#ifdef _OPENMP
+    #pragma omp for schedule(static)
+#endif
+    for(uint32_t j=0; j<n; j++)
+    {
+      double sx=0.0, sy=0.0, sz=0.0;
+      for(uint32_t b=0; b<nt; b++)
+      {
+        const float* bf = f4buf + (size_t)b*4*n + 4*(size_t)j;
+        sx += (double) bf[0];
+        sy += (double) bf[1];
+        sz += (double) bf[2];
+      }
+      fx[j] = sx;
+      fy[j] = sy;
+      fz[j] = sz;
+    }
+  }
+
+  return epot;
+}
+
+/**
+ * @brief Same as \b #lj_forces_neighlist_simd, the pair interactions being interpolated in tables (see ljTable.c)
+ *
+ * @param nl Neighbour list built with a list radius not smaller than the cutoff
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param type Species of the atoms
+ * @param tab Tables of the pair potentials of all the couples of species
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten
+ * @return The potential energy in kJ/mol
+ */
+double lj_forces_neighlist_table(const NEIGHLIST* nl, uint32_t n,
+                                 const double x[], const double y[], const double z[],
+                                 const uint32_t type[], const LJ_TABLE* tab,
+                                 double fx[], double fy[], double fz[])
+{
+  memset(fx,0,n*sizeof(double));
+  memset(fy,0,n*sizeof(double));
+  memset(fz,0,n*sizeof(double));
+
+  return kernels.lj_rows_neighlist_table(nl,0,n,x,y,z,type,tab,fx,fy,fz);
+}
+
+/**
+ * @brief Multithreaded version of \b #lj_forces_neighlist_simd : rows of the neighbour list are distributed
+ *  dynamically over the threads, each thread accumulating forces (including reaction forces) in its own buffer,
+ *  and the buffers are then summed in parallel over the atoms. No atomic operation is needed.
+ *
+ * @param nl Neighbour list built with a list radius not smaller than the cutoff
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param tab Tables of the pair potentials (see ljTable.c), or NULL for the analytic potential
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten ; also used as the buffer of the first thread
+ * @param tbuf Force buffers of the other threads, of size (nthreads-1)*3*n
+ * @param nthreads Number of threads ; if 1 or without OpenMP the sequential kernel is used
+ * @return The potential energy in kJ/mol
+ */
+double lj_forces_neighlist_omp(const NEIGHLIST* nl, uint32_t n,
+                               const double x[], const double y[], const double z[],
+                               const uint32_t type[], const SPECIES* sp,
+                               const LJ_CUTS* cuts, const LJ_TABLE* tab,
+                               double fx[], double fy[], double fz[],
+                               double tbuf[], uint32_t nthreads)
+{
+#ifdef _OPENMP
+  if(nthreads > 1)
+  {
+    // rows are processed by chunks : small enough for load balancing, large enough for limiting scheduling overhead
+    const uint32_t chunk   = 64;
+    const uint32_t nchunks = (n+chunk-1)/chunk;
+    double epot = 0.0;
+
+    #pragma omp parallel num_threads(nthreads) reduction(+:epot)
+    {
+      const uint32_t t  = (uint32_t) omp_get_thread_num();
+      const uint32_t nt = (uint32_t) omp_get_num_threads();
+
+      double *tfx = (t==0) ? fx : tbuf + (size_t)(t-1)*3*n;
+      double *tfy = (t==0) ? fy : tfx + n;
+      double *tfz = (t==0) ? fz : tfx + 2*n;
+
+      memset(tfx,0,n*sizeof(double));
+      memset(tfy,0,n*sizeof(double));
+      memset(tfz,0,n*sizeof(double));
+
+      #pragma omp for schedule(dynamic,1)
+      for(uint32_t c=0; c<nchunks; c++)
+      {
+        const uint32_t iend = (c+1)*chunk < n ? (c+1)*chunk : n;
+        if(tab != NULL)
+          epot += kernels.lj_rows_neighlist_table(nl,c*chunk,iend,x,y,z,type,tab,tfx,tfy,tfz);
+        else
+          epot += lj_rows_neighlist_simd(nl,c*chunk,iend,x,y,z,type,sp,cuts,tfx,tfy,tfz);
+      }
+
+      // implicit barrier above : all buffers are complete, reduce them in parallel over the atoms
+      #pragma omp for schedule(static)
+      for(uint32_t j=0; j<n; j++)
+      {
+        for(uint32_t b=1; b<nt; b++)
+        {
+          const double* bf = tbuf + (size_t)(b-1)*3*n;
+          fx[j] += bf[j];
+          fy[j] += bf[n+j];
+          fz[j] += bf[2*n+j];
+        }
+      }
+    }
+
+    return epot;
+  }
+#else
+  (void) tbuf;
+  (void) nthreads;
+#endif
+
+  if(tab != NULL)
+    return lj_forces_neighlist_table(nl,n,x,y,z,type,tab,fx,fy,fz);
+
+  return lj_forces_neighlist_simd(nl,n,x,y,z,type,sp,cuts,fx,fy,fz);
+}
+
+/**
+ * @brief Multithreaded forces on a half neighbour list split in domains (see neighDomains.c), each pair being evaluated
+ *  once : in a first phase each thread gathers the positions of its atoms and of its halo, and accumulates all the
+ *  forces of its rows in its local arrays ; in a second phase each thread sums the forces of its own atoms, adding the
+ *  ones left in the halos of the other threads. Every array is written by a single thread, so that no atomic operation
+ *  is needed, and the memory traffic grows with the halos instead of nthreads*n as in \b #lj_forces_neighlist_omp .
+ *
+ * @param nd Domains of the neighbour list, up to date (see neighdomains_update), one per thread
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param sp Species table with the mixed LJ parameters ; the species of the atoms are copied in the domains
+ * @param cuts cuton/cutoff parameters
+ * @param tab Tables of the pair potentials (see ljTable.c), or NULL for the analytic potential
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten
+ * @return The potential energy in kJ/mol
+ */
+double lj_forces_neighdomains(const NEIGHDOMAINS* nd, uint32_t n,
+                              const double x[], const double y[], const double z[],
+                              const SPECIES* sp, const LJ_CUTS* cuts, const LJ_TABLE* tab,
+                              double fx[], double fy[], double fz[])
+{
+  const uint32_t ndom = nd->ndom;
+  double epot = 0.0;
+
+  (void) n;
+
+#ifdef _OPENMP
+  #pragma omp parallel num_threads(ndom) reduction(+:epot)
+#endif
+  {
+    // one domain per thread, the loops only guarding against a team smaller than requested
+#ifdef _OPENMP
+    #pragma omp for schedule(static,1)
+#endif
+    for(uint32_t d=0; d<ndom; d++)
+    {
+      NEIGHDOMAIN* dm = &(nd->dom[d]);
+      const uint32_t nown = dm->nown;
+      const uint32_t nloc = dm->nown + dm->nhalo;
+
+      memcpy(dm->x,x+dm->ibeg,nown*sizeof(double));
+      memcpy(dm->y,y+dm->ibeg,nown*sizeof(double));
+      memcpy(dm->z,z+dm->ibeg,nown*sizeof(double));
+      for(uint32_t k=0; k<dm->nhalo; k++)
+      {
+        const uint32_t j = dm->halo[k];
+        dm->x[nown+k] = x[j];
+        dm->y[nown+k] = y[j];
+        dm->z[nown+k] = z[j];
+      }
+
+      memset(dm->fx,0,nloc*sizeof(double));
+      memset(dm->fy,0,nloc*sizeof(double));
+      memset(dm->fz,0,nloc*sizeof(double));
+
+      if(tab != NULL)
+        epot += kernels.lj_rows_neighlist_table(&(dm->rows),0,nown,dm->x,dm->y,dm->z,dm->type,tab,dm->fx,dm->fy,dm->fz);
+      else
+        epot += lj_rows_neighlist_simd(&(dm->rows),0,nown,dm->x,dm->y,dm->z,dm->type,sp,cuts,dm->fx,dm->fy,dm->fz);
+    }
+
+    // implicit barrier above : each domain collects its forces, from its own arrays then from the halos of the others
+#ifdef _OPENMP
+    #pragma omp for schedule(static,1)
+#endif
+    for(uint32_t u=0; u<ndom; u++)
+    {
+      const NEIGHDOMAIN* du = &(nd->dom[u]);
+      memcpy(fx+du->ibeg,du->fx,du->nown*sizeof(double));
+      memcpy(fy+du->ibeg,du->fy,du->nown*sizeof(double));
+      memcpy(fz+du->ibeg,du->fz,du->nown*sizeof(double));
+
+      for(uint32_t d=0; d<ndom; d++)
+      {
+        const NEIGHDOMAIN* dm = &(nd->dom[d]);
+        for(uint32_t k=dm->hstart[u]; k<dm->hstart[u+1]; k++)
+        {
+          const uint32_t j = dm->halo[k];
+          fx[j] += dm->fx[dm->nown+k];
+          fy[j] += dm->fy[dm->nown+k];
+          fz[j] += dm->fz[dm->nown+k];
+        }
+      }
+    }
+  }
+
+  return epot;
+}
+
+/**
+ * @brief Multithreaded LJ energy and forces on a full neighbour list : every pair is evaluated in the rows of both
+ *  atoms, so the rows are independent and the threads share them without force buffers nor reduction,
+ *  at the price of twice as many pair evaluations as \b #lj_forces_neighlist_omp.
+ *
+ * @param nl Full neighbour list (see neighlist_alloc_full) built with a list radius not smaller than the cutoff
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten
+ * @param nthreads Number of threads
+ * @return The potential energy in kJ/mol
+ */
+double lj_forces_neighlist_full(const NEIGHLIST* nl, uint32_t n,
+                                const double x[], const double y[], const double z[],
+                                const uint32_t type[], const SPECIES* sp,
+                                const LJ_CUTS* cuts,
+                                double fx[], double fy[], double fz[],
+                                uint32_t nthreads)
+{
+#ifdef _OPENMP
+  if(nthreads > 1)
+  {
+    const uint32_t chunk   = 64;
+    const uint32_t nchunks = (n+chunk-1)/chunk;
+    double epot = 0.0;
+
+    #pragma omp parallel for num_threads(nthreads) schedule(dynamic,1) reduction(+:epot)
+    for(uint32_t c=0; c<nchunks; c++)
+    {
+      const uint32_t iend = (c+1)*chunk < n ? (c+1)*chunk : n;
+      epot += kernels.lj_rows_neighlist_full(nl,c*chunk,iend,x,y,z,type,sp,cuts,fx,fy,fz);
+    }
+    return epot;
+  }
+#else
+  (void) nthreads;
+#endif
+
+  return kernels.lj_rows_neighlist_full(nl,0,n,x,y,z,type,sp,cuts,fx,fy,fz);
+}
+
+/**
+ * @brief All-pairs LJ energy and forces without any list, for small systems or without cutoff (NOCUT) :
+ *  the atoms are split in blocks of LJ_ALLPAIRS_TILE consecutive atoms and each couple of blocks (a,b), b >= a,
+ *  is processed by the vectorised kernel lj_tile_allpairs (see ljKernelSimd.c). The two blocks fit in the L1 cache,
+ *  and each pair i<j is evaluated once, the reaction force being applied to j.
+ *
+ * With several threads the couples of blocks are distributed dynamically, with per-thread force buffers
+ * as in \b #lj_forces_neighlist_omp.
+ *
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters, the cutoff may be infinite
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten ; also used as the buffer of the first thread
+ * @param tbuf Force buffers of the other threads, of size (nthreads-1)*3*n
+ * @param nthreads Number of threads
+ * @return The potential energy in kJ/mol
+ */
+double lj_forces_allpairs_tiled(uint32_t n,
+                                const double x[], const double y[], const double z[],
+                                const uint32_t type[], const SPECIES* sp,
+                                const LJ_CUTS* cuts,
+                                double fx[], double fy[], double fz[],
+                                double tbuf[], uint32_t nthreads)
+{
+  const uint32_t tile   = LJ_ALLPAIRS_TILE;
+  const uint32_t ntiles = (n+tile-1)/tile;
+  const uint32_t npairs = ntiles*(ntiles+1)/2;
+
+#ifdef _OPENMP
+  if(nthreads > 1 && npairs > 1)
+  {
+    double epot = 0.0;
+
+    #pragma omp parallel num_threads(nthreads) reduction(+:epot)
+    {
+      const uint32_t t  = (uint32_t) omp_get_thread_num();
+      const uint32_t nt = (uint32_t) omp_get_num_threads();
+
+      double *tfx = (t==0) ? fx : tbuf + (size_t)(t-1)*3*n;
+      double *tfy = (t==0) ? fy : tfx + n;
+      double *tfz = (t==0) ? fz : tfx + 2*n;
+
+      memset(tfx,0,n*sizeof(double));
+      memset(tfy,0,n*sizeof(double));
+      memset(tfz,0,n*sizeof(double));
+
+      #pragma omp for schedule(dynamic,1)
+      for(uint32_t p=0; p<npairs; p++)
+      {
+        // couple of blocks number p, in the order (0,0),(0,1),...,(0,ntiles-1),(1,1),...
+        uint32_t a = 0, q = p;
+        while(q >= ntiles-a)
+        {
+          q -= ntiles-a;
+          a++;
+        }
+        const uint32_t b = a+q;
+
+        const uint32_t iend = (a+1)*tile < n ? (a+1)*tile : n;
+        const uint32_t jend = (b+1)*tile < n ? (b+1)*tile : n;
+        epot += kernels.lj_tile_allpairs(a*tile,iend,b*tile,jend,x,y,z,type,sp,cuts,tfx,tfy,tfz);
+      }
+
+      #pragma omp for schedule(static)
+      for(uint32_t j=0; j<n; j++)
+      {
+        for(uint32_t b=1; b<nt; b++)
+        {
+          const double* bf = tbuf + (size_t)(b-1)*3*n;
+          fx[j] += bf[j];
+          fy[j] += bf[n+j];
+          fz[j] += bf[2*n+j];
+        }
+      }
+    }
+
+    return epot;
+  }
+#else
+  (void) tbuf;
+  (void) nthreads;
+  (void) npairs;
+#endif
+
+  double epot = 0.0;
+
+  memset(fx,0,n*sizeof(double));
+  memset(fy,0,n*sizeof(double));
+  memset(fz,0,n*sizeof(double));
+
+  for(uint32_t a=0; a<ntiles; a++)
+  {
+    const uint32_t iend = (a+1)*tile < n ? (a+1)*tile : n;
+    for(uint32_t b=a; b<ntiles; b++)
+    {
+      const uint32_t jend = (b+1)*tile < n ? (b+1)*tile : n;
+      epot += kernels.lj_tile_allpairs(a*tile,iend,b*tile,jend,x,y,z,type,sp,cuts,fx,fy,fz);
+    }
+  }
+
+  return epot;
+}
+
+/**
+ * @brief Potential energy only, with a neighbour list : nothing is written, so that the rows are simply
+ *  distributed over the threads without any force buffer.
+ *
+ * @param nl Neighbour list built with a list radius not smaller than the cutoff
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param nthreads Number of threads
+ * @return The potential energy in kJ/mol
+ */
+double lj_energy_neighlist(const NEIGHLIST* nl, uint32_t n,
+                           const double x[], const double y[], const double z[],
+                           const uint32_t type[], const SPECIES* sp,
+                           const LJ_CUTS* cuts, uint32_t nthreads)
+{
+  const uint32_t chunk   = 64;
+  const uint32_t nchunks = (n+chunk-1)/chunk;
+  double epot = 0.0;
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(nthreads) schedule(dynamic,1) reduction(+:epot) if(nthreads > 1)
+#else
+  (void) nthreads;
+#endif
+  for(uint32_t c=0; c<nchunks; c++)
+  {
+    const uint32_t iend = (c+1)*chunk < n ? (c+1)*chunk : n;
+    epot += kernels.lj_energy_rows_neighlist(nl,c*chunk,iend,x,y,z,type,sp,cuts);
+  }
+
+  return epot;
+}
+
+/**
+ * @brief Forces and energies of a batch of replicas of the same cluster, stored interleaved (see lj_batch_allpairs
+ *  in ljKernelSimd.c) : the groups of LJ_BATCH_LANES replicas are independent, and shared by the threads
+ *
+ * @param n Number of atoms of each replica
+ * @param stride Number of replicas in the arrays, a multiple of LJ_BATCH_LANES
+ * @param x,y,z Coordinates in nm, of atom i of replica r at [i*stride+r]
+ * @param type,sp Species of the n atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters, the cutoff may be infinite
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten, same layout as the coordinates
+ * @param epot Potential energy of each replica in kJ/mol, size stride
+ * @param nthreads Number of threads
+ */
+void lj_forces_batch(uint32_t n, uint32_t stride,
+                     const double x[], const double y[], const double z[],
+                     const uint32_t type[], const SPECIES* sp,
+                     const LJ_CUTS* cuts,
+                     double fx[], double fy[], double fz[], double epot[],
+                     uint32_t nthreads)
+{
+  const uint32_t ngroups = stride/LJ_BATCH_LANES;
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(nthreads) schedule(static) if(nthreads > 1 && ngroups > 1)
+#else
+  (void) nthreads;
+#endif
+  for(uint32_t g=0; g<ngroups; g++)
+    kernels.lj_batch_allpairs(n,stride,g*LJ_BATCH_LANES,(g+1)*LJ_BATCH_LANES,x,y,z,type,sp,cuts,fx,fy,fz,epot);
+}
+
+/**
+ * @brief Potential energy only, visiting all the pairs by blocks as \b #lj_forces_allpairs_tiled
+ *
+ * @param n Number of atoms
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters, the cutoff may be infinite
+ * @param nthreads Number of threads
+ * @return The potential energy in kJ/mol
+ */
+double lj_energy_allpairs_tiled(uint32_t n,
+                                const double x[], const double y[], const double z[],
+                                const uint32_t type[], const SPECIES* sp,
+                                const LJ_CUTS* cuts, uint32_t nthreads)
+{
+  const uint32_t tile   = LJ_ALLPAIRS_TILE;
+  const uint32_t ntiles = (n+tile-1)/tile;
+  const uint32_t npairs = ntiles*(ntiles+1)/2;
+  double epot = 0.0;
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(nthreads) schedule(dynamic,1) reduction(+:epot) if(nthreads > 1 && npairs > 1)
+#else
+  (void) nthreads;
+#endif
+  for(uint32_t p=0; p<npairs; p++)
+  {
+    // couple of blocks number p, in the order (0,0),(0,1),...,(0,ntiles-1),(1,1),...
+    uint32_t a = 0, q = p;
+    while(q >= ntiles-a)
+    {
+      q -= ntiles-a;
+      a++;
+    }
+    const uint32_t b = a+q;
+
+    const uint32_t iend = (a+1)*tile < n ? (a+1)*tile : n;
+    const uint32_t jend = (b+1)*tile < n ? (b+1)*tile : n;
+    epot += kernels.lj_energy_tile_allpairs(a*tile,iend,b*tile,jend,x,y,z,type,sp,cuts);
+  }
+
+  return epot;
+}
@@ -0,0 +1,1567 @@
+/**
+ * \file ljKernelSimd.c
+ *
+ * \brief SIMD Lennard-Jones kernel over the Verlet neighbour lists : 2 (SSE2), 4 (AVX2) or 8 (AVX-512) neighbours of an atom at once
+ *
+ * \details Neighbours are gathered from the structure of arrays, the cutoff and the switching function
+ *          are applied with masks instead of branches, so that the result is the one of \b #lj_pair
+ *          (i.e. of OpenMM's NonbondedForce with setUseSwitchingFunction) up to rounding.
+ *          If the compiler does not target SSE2, AVX2 or AVX-512 a scalar loop is used instead.
+ *          A mixed precision variant works on single precision vectors (twice the lanes) and accumulates in double precision.
+ *
+ *          This file is not compiled on its own : it is included by kernelsSse2.c, kernelsAvx2.c and kernelsAvx512.c,
+ *          each one compiled with its own instruction set flags, and the variant used is selected at run time (see cpuDispatch.c).
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef KNAME
+#error "ljKernelSimd.c is a template : compile kernelsSse2.c, kernelsAvx2.c or kernelsAvx512.c instead"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "global.h"
+#include "ljForces.h"
+#include "ljTable.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * A minimal abstraction of the vector operations, so that the kernel is written only once.
+ * The neighbours are gathered with scalar loads and the reaction forces scattered with scalar stores :
+ * on the cpus we tested the AVX2/AVX-512 gather and scatter instructions were slower for 64 bits elements.
+ */
+#if defined(__AVX512F__)
+
+#define SIMD_ISA    "AVX-512"
+#define SIMD_W      8
+typedef __m512d     vd;
+typedef __mmask8    vmask;
+
+#define VSET1(a)        _mm512_set1_pd(a)
+#define VZERO()         _mm512_setzero_pd()
+#define VADD(a,b)       _mm512_add_pd(a,b)
+#define VSUB(a,b)       _mm512_sub_pd(a,b)
+#define VMUL(a,b)       _mm512_mul_pd(a,b)
+#define VDIV(a,b)       _mm512_div_pd(a,b)
+#define VSQRT(a)        _mm512_sqrt_pd(a)
+#define VROUND(a)       _mm512_roundscale_pd(a,_MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC)
+#define VLT(a,b)        _mm512_cmp_pd_mask(a,b,_CMP_LT_OQ)
+#define VGT(a,b)        _mm512_cmp_pd_mask(a,b,_CMP_GT_OQ)
+#define VAND(m1,m2)     ((vmask)((m1)&(m2)))
+#define VSEL(m,a,b)     _mm512_mask_blend_pd(m,b,a)
+#define VHSUM(a)        _mm512_reduce_add_pd(a)
+#define VLANES(cnt)     ((vmask)((1u<<(cnt))-1u))
+
+#define VGATHER(b,idx)  _mm512_set_pd((b)[(idx)[7]],(b)[(idx)[6]],(b)[(idx)[5]],(b)[(idx)[4]],(b)[(idx)[3]],(b)[(idx)[2]],(b)[(idx)[1]],(b)[(idx)[0]])
+#define VSTORE(p,a)     _mm512_storeu_pd(p,a)
+#define VLOAD(p)        _mm512_loadu_pd(p)
+
+// single precision : twice as many lanes, for the mixed precision kernel
+#define SIMD_WF     16
+typedef __m512      vf;
+typedef __mmask16   vfmask;
+
+#define FSET1(a)        _mm512_set1_ps(a)
+#define FZERO()         _mm512_setzero_ps()
+#define FADD(a,b)       _mm512_add_ps(a,b)
+#define FSUB(a,b)       _mm512_sub_ps(a,b)
+#define FMUL(a,b)       _mm512_mul_ps(a,b)
+#define FDIV(a,b)       _mm512_div_ps(a,b)
+#define FSQRT(a)        _mm512_sqrt_ps(a)
+#define FLT(a,b)        _mm512_cmp_ps_mask(a,b,_CMP_LT_OQ)
+#define FGT(a,b)        _mm512_cmp_ps_mask(a,b,_CMP_GT_OQ)
+#define FAND(m1,m2)     ((vfmask)((m1)&(m2)))
+#define FSEL(m,a,b)     _mm512_mask_blend_ps(m,b,a)
+#define FHSUM(a)        ((double)_mm512_reduce_add_ps(a))
+#define FLANES(cnt)     ((vfmask)((1u<<(cnt))-1u))
+
+#define FGATHER(b,idx)  _mm512_set_ps((float)(b)[(idx)[15]],(float)(b)[(idx)[14]],(float)(b)[(idx)[13]],(float)(b)[(idx)[12]], \
+                                      (float)(b)[(idx)[11]],(float)(b)[(idx)[10]],(float)(b)[(idx)[9]], (float)(b)[(idx)[8]],  \
+                                      (float)(b)[(idx)[7]], (float)(b)[(idx)[6]], (float)(b)[(idx)[5]], (float)(b)[(idx)[4]],  \
+                                      (float)(b)[(idx)[3]], (float)(b)[(idx)[2]], (float)(b)[(idx)[1]], (float)(b)[(idx)[0]])
+#define FSTORE(p,a)     _mm512_storeu_ps(p,a)
+#define FLOADU(p)       _mm512_loadu_ps(p)
+// in-register lookup of a table of up to 16 floats, indexed by the species stored as floats
+#define FPERMUTE(row,t) _mm512_permutexvar_ps(_mm512_cvttps_epi32(t),row)
+
+/// loads the packed (x,y,z,species) of 16 neighbours and transposes them : one load per neighbour instead of four
+static inline void FLOAD_XYZT(const float* p, const int32_t* j4, vf* x, vf* y, vf* z, vf* t)
+{
+  __m512 a = _mm512_castps128_ps512(_mm_loadu_ps(p+j4[0]));
+  __m512 b = _mm512_castps128_ps512(_mm_loadu_ps(p+j4[1]));
+  __m512 c = _mm512_castps128_ps512(_mm_loadu_ps(p+j4[2]));
+  __m512 d = _mm512_castps128_ps512(_mm_loadu_ps(p+j4[3]));
+  for(int q=1; q<4; q++)
+  {
+    a = _mm512_insertf32x4(a,_mm_loadu_ps(p+j4[4*q]),q);
+    b = _mm512_insertf32x4(b,_mm_loadu_ps(p+j4[4*q+1]),q);
+    c = _mm512_insertf32x4(c,_mm_loadu_ps(p+j4[4*q+2]),q);
+    d = _mm512_insertf32x4(d,_mm_loadu_ps(p+j4[4*q+3]),q);
+  }
+  const __m512d t0 = _mm512_castps_pd(_mm512_unpacklo_ps(a,b));
+  const __m512d t1 = _mm512_castps_pd(_mm512_unpackhi_ps(a,b));
+  const __m512d t2 = _mm512_castps_pd(_mm512_unpacklo_ps(c,d));
+  const __m512d t3 = _mm512_castps_pd(_mm512_unpackhi_ps(c,d));
+  *x = _mm512_castpd_ps(_mm512_unpacklo_pd(t0,t2));
+  *y = _mm512_castpd_ps(_mm512_unpackhi_pd(t0,t2));
+  *z = _mm512_castpd_ps(_mm512_unpacklo_pd(t1,t3));
+  *t = _mm512_castpd_ps(_mm512_unpackhi_pd(t1,t3));
+}
+
+/// subtracts the forces (x,y,z) of the cnt first lanes from the packed force buffer p : inverse of FLOAD_XYZT
+static inline void FSCATTER_SUB_XYZ(float* p, const int32_t* j4, uint32_t cnt, vf x, vf y, vf z)
+{
+  float tmp[4][SIMD_WF];
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512 t0 = _mm512_unpacklo_ps(x,y);
+  const __m512 t1 = _mm512_unpackhi_ps(x,y);
+  const __m512 t2 = _mm512_unpacklo_ps(z,zero);
+  const __m512 t3 = _mm512_unpackhi_ps(z,zero);
+  _mm512_storeu_ps(tmp[0],_mm512_shuffle_ps(t0,t2,_MM_SHUFFLE(1,0,1,0)));
+  _mm512_storeu_ps(tmp[1],_mm512_shuffle_ps(t0,t2,_MM_SHUFFLE(3,2,3,2)));
+  _mm512_storeu_ps(tmp[2],_mm512_shuffle_ps(t1,t3,_MM_SHUFFLE(1,0,1,0)));
+  _mm512_storeu_ps(tmp[3],_mm512_shuffle_ps(t1,t3,_MM_SHUFFLE(3,2,3,2)));
+  for(uint32_t l=0; l<cnt; l++)
+    _mm_storeu_ps(p+j4[l],_mm_sub_ps(_mm_loadu_ps(p+j4[l]),_mm_loadu_ps(&(tmp[l%4][4*(l/4)]))));
+}
+
+#elif defined(__AVX2__)
+
+#define SIMD_ISA    "AVX2"
+#define SIMD_W      4
+typedef __m256d     vd;
+typedef __m256d     vmask;
+
+#define VSET1(a)        _mm256_set1_pd(a)
+#define VZERO()         _mm256_setzero_pd()
+#define VADD(a,b)       _mm256_add_pd(a,b)
+#define VSUB(a,b)       _mm256_sub_pd(a,b)
+#define VMUL(a,b)       _mm256_mul_pd(a,b)
+#define VDIV(a,b)       _mm256_div_pd(a,b)
+#define VSQRT(a)        _mm256_sqrt_pd(a)
+#define VROUND(a)       _mm256_round_pd(a,_MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC)
+#define VLT(a,b)        _mm256_cmp_pd(a,b,_CMP_LT_OQ)
+#define VGT(a,b)        _mm256_cmp_pd(a,b,_CMP_GT_OQ)
+#define VAND(m1,m2)     _mm256_and_pd(m1,m2)
+#define VSEL(m,a,b)     _mm256_blendv_pd(b,a,m)
+#define VLANES(cnt)     _mm256_cmp_pd(_mm256_set_pd(3.,2.,1.,0.),_mm256_set1_pd((double)(cnt)),_CMP_LT_OQ)
+
+static inline double VHSUM(__m256d a)
+{
+  __m128d lo = _mm256_castpd256_pd128(a);
+  __m128d hi = _mm256_extractf128_pd(a,1);
+  lo = _mm_add_pd(lo,hi);
+  return _mm_cvtsd_f64(_mm_add_sd(lo,_mm_unpackhi_pd(lo,lo)));
+}
+
+#define VGATHER(b,idx)  _mm256_set_pd((b)[(idx)[3]],(b)[(idx)[2]],(b)[(idx)[1]],(b)[(idx)[0]])
+#define VSTORE(p,a)     _mm256_storeu_pd(p,a)
+#define VLOAD(p)        _mm256_loadu_pd(p)
+
+// single precision : twice as many lanes, for the mixed precision kernel
+#define SIMD_WF     8
+typedef __m256      vf;
+typedef __m256      vfmask;
+
+#define FSET1(a)        _mm256_set1_ps(a)
+#define FZERO()         _mm256_setzero_ps()
+#define FADD(a,b)       _mm256_add_ps(a,b)
+#define FSUB(a,b)       _mm256_sub_ps(a,b)
+#define FMUL(a,b)       _mm256_mul_ps(a,b)
+#define FDIV(a,b)       _mm256_div_ps(a,b)
+#define FSQRT(a)        _mm256_sqrt_ps(a)
+#define FLT(a,b)        _mm256_cmp_ps(a,b,_CMP_LT_OQ)
+#define FGT(a,b)        _mm256_cmp_ps(a,b,_CMP_GT_OQ)
+#define FAND(m1,m2)     _mm256_and_ps(m1,m2)
+#define FSEL(m,a,b)     _mm256_blendv_ps(b,a,m)
+#define FLANES(cnt)     _mm256_cmp_ps(_mm256_set_ps(7.f,6.f,5.f,4.f,3.f,2.f,1.f,0.f),_mm256_set1_ps((float)(cnt)),_CMP_LT_OQ)
+
+static inline double FHSUM(__m256 a)
+{
+  __m128 lo = _mm_add_ps(_mm256_castps256_ps128(a),_mm256_extractf128_ps(a,1));
+  lo = _mm_add_ps(lo,_mm_movehl_ps(lo,lo));
+  return (double)_mm_cvtss_f32(_mm_add_ss(lo,_mm_shuffle_ps(lo,lo,1)));
+}
+
+#define FGATHER(b,idx)  _mm256_set_ps((float)(b)[(idx)[7]],(float)(b)[(idx)[6]],(float)(b)[(idx)[5]],(float)(b)[(idx)[4]], \
+                                      (float)(b)[(idx)[3]],(float)(b)[(idx)[2]],(float)(b)[(idx)[1]],(float)(b)[(idx)[0]])
+#define FSTORE(p,a)     _mm256_storeu_ps(p,a)
+#define FLOADU(p)       _mm256_loadu_ps(p)
+// in-register lookup of a table of up to 8 floats, indexed by the species stored as floats
+#define FPERMUTE(row,t) _mm256_permutevar8x32_ps(row,_mm256_cvttps_epi32(t))
+
+/// loads the packed (x,y,z,species) of 8 neighbours and transposes them : one load per neighbour instead of four
+static inline void FLOAD_XYZT(const float* p, const int32_t* j4, vf* x, vf* y, vf* z, vf* t)
+{
+  const __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p+j4[0])),_mm_loadu_ps(p+j4[4]),1);
+  const __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p+j4[1])),_mm_loadu_ps(p+j4[5]),1);
+  const __m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p+j4[2])),_mm_loadu_ps(p+j4[6]),1);
+  const __m256 d = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p+j4[3])),_mm_loadu_ps(p+j4[7]),1);
+  const __m256d t0 = _mm256_castps_pd(_mm256_unpacklo_ps(a,b));
+  const __m256d t1 = _mm256_castps_pd(_mm256_unpackhi_ps(a,b));
+  const __m256d t2 = _mm256_castps_pd(_mm256_unpacklo_ps(c,d));
+  const __m256d t3 = _mm256_castps_pd(_mm256_unpackhi_ps(c,d));
+  *x = _mm256_castpd_ps(_mm256_unpacklo_pd(t0,t2));
+  *y = _mm256_castpd_ps(_mm256_unpackhi_pd(t0,t2));
+  *z = _mm256_castpd_ps(_mm256_unpacklo_pd(t1,t3));
+  *t = _mm256_castpd_ps(_mm256_unpackhi_pd(t1,t3));
+}
+
+/// subtracts the forces (x,y,z) of the cnt first lanes from the packed force buffer p : inverse of FLOAD_XYZT
+static inline void FSCATTER_SUB_XYZ(float* p, const int32_t* j4, uint32_t cnt, vf x, vf y, vf z)
+{
+  float tmp[4][SIMD_WF];
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 t0 = _mm256_unpacklo_ps(x,y);
+  const __m256 t1 = _mm256_unpackhi_ps(x,y);
+  const __m256 t2 = _mm256_unpacklo_ps(z,zero);
+  const __m256 t3 = _mm256_unpackhi_ps(z,zero);
+  _mm256_storeu_ps(tmp[0],_mm256_shuffle_ps(t0,t2,_MM_SHUFFLE(1,0,1,0)));
+  _mm256_storeu_ps(tmp[1],_mm256_shuffle_ps(t0,t2,_MM_SHUFFLE(3,2,3,2)));
+  _mm256_storeu_ps(tmp[2],_mm256_shuffle_ps(t1,t3,_MM_SHUFFLE(1,0,1,0)));
+  _mm256_storeu_ps(tmp[3],_mm256_shuffle_ps(t1,t3,_MM_SHUFFLE(3,2,3,2)));
+  for(uint32_t l=0; l<cnt; l++)
+    _mm_storeu_ps(p+j4[l],_mm_sub_ps(_mm_loadu_ps(p+j4[l]),_mm_loadu_ps(&(tmp[l%4][4*(l/4)]))));
+}
+
+#elif defined(__SSE2__)
+
+#define SIMD_ISA    "SSE2"
+#define SIMD_W      2
+typedef __m128d     vd;
+typedef __m128d     vmask;
+
+#define VSET1(a)        _mm_set1_pd(a)
+#define VZERO()         _mm_setzero_pd()
+#define VADD(a,b)       _mm_add_pd(a,b)
+#define VSUB(a,b)       _mm_sub_pd(a,b)
+#define VMUL(a,b)       _mm_mul_pd(a,b)
+#define VDIV(a,b)       _mm_div_pd(a,b)
+#define VSQRT(a)        _mm_sqrt_pd(a)
+// no rounding instruction before SSE4.1 : through 32 bits integers, enough for coordinates within 2^31 boxes
+#define VROUND(a)       _mm_cvtepi32_pd(_mm_cvtpd_epi32(a))
+#define VLT(a,b)        _mm_cmplt_pd(a,b)
+#define VGT(a,b)        _mm_cmpgt_pd(a,b)
+#define VAND(m1,m2)     _mm_and_pd(m1,m2)
+#define VSEL(m,a,b)     _mm_or_pd(_mm_and_pd(m,a),_mm_andnot_pd(m,b))
+#define VLANES(cnt)     _mm_cmplt_pd(_mm_set_pd(1.,0.),_mm_set1_pd((double)(cnt)))
+
+static inline double VHSUM(__m128d a)
+{
+  return _mm_cvtsd_f64(_mm_add_sd(a,_mm_unpackhi_pd(a,a)));
+}
+
+#define VGATHER(b,idx)  _mm_set_pd((b)[(idx)[1]],(b)[(idx)[0]])
+#define VSTORE(p,a)     _mm_storeu_pd(p,a)
+#define VLOAD(p)        _mm_loadu_pd(p)
+
+// single precision : twice as many lanes, for the mixed precision kernel
+#define SIMD_WF     4
+typedef __m128      vf;
+typedef __m128      vfmask;
+
+#define FSET1(a)        _mm_set1_ps(a)
+#define FZERO()         _mm_setzero_ps()
+#define FADD(a,b)       _mm_add_ps(a,b)
+#define FSUB(a,b)       _mm_sub_ps(a,b)
+#define FMUL(a,b)       _mm_mul_ps(a,b)
+#define FDIV(a,b)       _mm_div_ps(a,b)
+#define FSQRT(a)        _mm_sqrt_ps(a)
+#define FLT(a,b)        _mm_cmplt_ps(a,b)
+#define FGT(a,b)        _mm_cmpgt_ps(a,b)
+#define FAND(m1,m2)     _mm_and_ps(m1,m2)
+#define FSEL(m,a,b)     _mm_or_ps(_mm_and_ps(m,a),_mm_andnot_ps(m,b))
+#define FLANES(cnt)     _mm_cmplt_ps(_mm_set_ps(3.f,2.f,1.f,0.f),_mm_set1_ps((float)(cnt)))
+
+static inline double FHSUM(__m128 a)
+{
+  a = _mm_add_ps(a,_mm_movehl_ps(a,a));
+  return (double)_mm_cvtss_f32(_mm_add_ss(a,_mm_shuffle_ps(a,a,1)));
+}
+
+#define FGATHER(b,idx)  _mm_set_ps((float)(b)[(idx)[3]],(float)(b)[(idx)[2]],(float)(b)[(idx)[1]],(float)(b)[(idx)[0]])
+#define FSTORE(p,a)     _mm_storeu_ps(p,a)
+#define FLOADU(p)       _mm_loadu_ps(p)
+
+/// loads the packed (x,y,z,species) of 4 neighbours and transposes them : one load per neighbour instead of four
+static inline void FLOAD_XYZT(const float* p, const int32_t* j4, vf* x, vf* y, vf* z, vf* t)
+{
+  const __m128 a = _mm_loadu_ps(p+j4[0]);
+  const __m128 b = _mm_loadu_ps(p+j4[1]);
+  const __m128 c = _mm_loadu_ps(p+j4[2]);
+  const __m128 d = _mm_loadu_ps(p+j4[3]);
+  const __m128d t0 = _mm_castps_pd(_mm_unpacklo_ps(a,b));
+  const __m128d t1 = _mm_castps_pd(_mm_unpackhi_ps(a,b));
+  const __m128d t2 = _mm_castps_pd(_mm_unpacklo_ps(c,d));
+  const __m128d t3 = _mm_castps_pd(_mm_unpackhi_ps(c,d));
+  *x = _mm_castpd_ps(_mm_unpacklo_pd(t0,t2));
+  *y = _mm_castpd_ps(_mm_unpackhi_pd(t0,t2));
+  *z = _mm_castpd_ps(_mm_unpacklo_pd(t1,t3));
+  *t = _mm_castpd_ps(_mm_unpackhi_pd(t1,t3));
+}
+
+/// subtracts the forces (x,y,z) of the cnt first lanes from the packed force buffer p : inverse of FLOAD_XYZT
+static inline void FSCATTER_SUB_XYZ(float* p, const int32_t* j4, uint32_t cnt, vf x, vf y, vf z)
+{
+  __m128 v[4];
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 t0 = _mm_unpacklo_ps(x,y);
+  const __m128 t1 = _mm_unpackhi_ps(x,y);
+  const __m128 t2 = _mm_unpacklo_ps(z,zero);
+  const __m128 t3 = _mm_unpackhi_ps(z,zero);
+  v[0] = _mm_movelh_ps(t0,t2);
+  v[1] = _mm_movehl_ps(t2,t0);
+  v[2] = _mm_movelh_ps(t1,t3);
+  v[3] = _mm_movehl_ps(t3,t1);
+  for(uint32_t l=0; l<cnt; l++)
+    _mm_storeu_ps(p+j4[l],_mm_sub_ps(_mm_loadu_ps(p+j4[l]),v[l]));
+}
+
+#endif
+
+#ifdef SIMD_W
+
+/**
+ * @brief Returns the instruction set this variant of the kernel was compiled for
+ */
+const char* KNAME(lj_kernel_isa)()
+{
+  return SIMD_ISA;
+}
+
+/**
+ * @brief LJ energies and F/r of SIMD_W pairs with the switching function, as \b #lj_pair ; the cutoff is not applied
+ *
+ * @param r2 squared distances
+ * @param s2,e4 sigma_ij^2 and 4 epsilon_ij of the pairs
+ * @param cuts cuton/cutoff parameters
+ * @param e output : the energies
+ * @return F/r
+ */
+static inline vd lj_pair_vec(vd r2, vd s2, vd e4, const LJ_CUTS* cuts, vd* e)
+{
+  const vd one     = VSET1(1.0);
+  const vd twelve  = VSET1(12.0);
+  const vd c6      = VSET1(6.0);
+
+  const vd ir2 = VDIV(one,r2);
+  const vd sr2 = VMUL(s2,ir2);
+  const vd s6  = VMUL(VMUL(sr2,sr2),sr2);
+  *e = VMUL(e4,VSUB(VMUL(s6,s6),s6));
+  // 24 eps (2 s12 - s6) / r2 = 4 eps (12 s12 - 6 s6) / r2
+  vd fr  = VMUL(VMUL(e4,VSUB(VMUL(twelve,VMUL(s6,s6)),VMUL(c6,s6))),ir2);
+
+  if(cuts->useSwitch)
+  {
+    const vd c10 = VSET1(10.0);
+    const vd c15 = VSET1(15.0);
+    const vd c30 = VSET1(30.0);
+    const vd c60 = VSET1(60.0);
+
+    const vmask swm = VGT(r2,VSET1(cuts->cuton2));
+    const vd r   = VSQRT(r2);
+    const vd t   = VMUL(VSUB(r,VSET1(cuts->cuton)),VSET1(cuts->swInv));
+    const vd t2  = VMUL(t,t);
+    // 1 + t^3 (-10 + t (15 - 6 t))
+    const vd sw  = VADD(one,VMUL(VMUL(t2,t),VSUB(VMUL(t,VSUB(c15,VMUL(c6,t))),c10)));
+    // t^2 (-30 + t (60 - 30 t)) / (cutoff-cuton)
+    const vd dsw = VMUL(VMUL(t2,VSUB(VMUL(t,VSUB(c60,VMUL(c30,t))),c30)),VSET1(cuts->swInv));
+
+    fr = VSEL(swm,VSUB(VMUL(sw,fr),VDIV(VMUL(*e,dsw),r)),fr);
+    *e = VSEL(swm,VMUL(sw,*e),*e);
+  }
+
+  return fr;
+}
+
+/**
+ * @brief Energy only version of lj_pair_vec, with the same operations so that the energies are the same
+ *
+ * @param r2 squared distances
+ * @param s2,e4 sigma_ij^2 and 4 epsilon_ij of the pairs
+ * @param cuts cuton/cutoff parameters
+ * @return the energies
+ */
+static inline vd lj_energy_vec(vd r2, vd s2, vd e4, const LJ_CUTS* cuts)
+{
+  const vd one     = VSET1(1.0);
+
+  const vd ir2 = VDIV(one,r2);
+  const vd sr2 = VMUL(s2,ir2);
+  const vd s6  = VMUL(VMUL(sr2,sr2),sr2);
+  vd e = VMUL(e4,VSUB(VMUL(s6,s6),s6));
+
+  if(cuts->useSwitch)
+  {
+    const vd c6  = VSET1(6.0);
+    const vd c10 = VSET1(10.0);
+    const vd c15 = VSET1(15.0);
+
+    const vmask swm = VGT(r2,VSET1(cuts->cuton2));
+    const vd r   = VSQRT(r2);
+    const vd t   = VMUL(VSUB(r,VSET1(cuts->cuton)),VSET1(cuts->swInv));
+    const vd t2  = VMUL(t,t);
+    const vd sw  = VADD(one,VMUL(VMUL(t2,t),VSUB(VMUL(t,VSUB(c15,VMUL(c6,t))),c10)));
+
+    e = VSEL(swm,VMUL(sw,e),e);
+  }
+
+  return e;
+}
+
+/*
+ * Single species specialisation : most clusters have one ATOM line, for which looking up the species of every
+ * neighbour and its mixed parameters is wasted work. The all-pairs kernels are written once as bodies always inlined
+ * with a constant flag one : the instance with one = 1 uses sigma^2 and 4 epsilon of the only couple as loop
+ * invariant constants, without reading the species at all ; the one with one = 0 is the generic kernel.
+ * The entry points select the instance from the species table, see LJ_SPECIALISE.
+ * The neighbour list kernels are not specialised : their cost is in the gathers of the coordinates and the scattered
+ * reaction forces, and the lookup in the small parameter matrices, in L1, made no measurable difference (-bench species).
+ */
+#if defined(__GNUC__)
+#define LJ_INLINE static inline __attribute__((always_inline))
+#else
+#define LJ_INLINE static inline
+#endif
+
+/// edges of the periodic box of the list nl and their inverses, unused if the list is not periodic
+#define LJ_BOX_CONSTS(nl,pbc,bx,by,bz,ibx,iby,ibz) \
+  const int pbc = (nl)->periodic;                    \
+  const vd bx  = VSET1((nl)->box[0]);                \
+  const vd by  = VSET1((nl)->box[1]);                \
+  const vd bz  = VSET1((nl)->box[2]);                \
+  const vd ibx = VSET1((nl)->ibox[0]);               \
+  const vd iby = VSET1((nl)->ibox[1]);               \
+  const vd ibz = VSET1((nl)->ibox[2])
+
+/// minimum image of the separation d in a periodic box of edge b, ib = 1/b
+#define VIMAGE(d,b,ib)  VSUB(d,VMUL(b,VROUND(VMUL(d,ib))))
+
+/// calls the body f with the flag one set to 1 for a single species, 0 otherwise
+#define LJ_SPECIALISE(f,sp,...)  (((sp)->n == 1) ? f(__VA_ARGS__,1) : f(__VA_ARGS__,0))
+
+/// mixed parameters of the only couple of species, as constants for the single species instances
+#define LJ_CONST_PARAMS(sp,one,s2c,e4c) \
+  const vd s2c = VSET1((one) ? (sp)->sigij[0]*(sp)->sigij[0] : 0.0); \
+  const vd e4c = VSET1((one) ? 4.0*(sp)->epsij[0] : 0.0)
+
+/// sigma_ij^2 and 4 epsilon_ij of SIMD_W pairs of species tdx, looked up in the row of i
+#define LJ_GATHER_PARAMS(sigi,epsi,tdx,s2,e4)                      \
+  const vd sij_ = VGATHER(sigi,tdx);                                 \
+  const vd s2 = VMUL(sij_,sij_);                                     \
+  const vd e4 = VMUL(VSET1(4.0),VGATHER(epsi,tdx))
+
+/// sigma_ij^2 and 4 epsilon_ij of SIMD_W pairs : constants with a single species, looked up in the row of i otherwise
+#define LJ_PAIR_PARAMS(one,s2c,e4c,sigi,epsi,tdx,s2,e4)             \
+  vd s2, e4;                                                         \
+  if(one)                                                            \
+  {                                                                  \
+    s2 = s2c;                                                        \
+    e4 = e4c;                                                        \
+  }                                                                  \
+  else                                                               \
+  {                                                                  \
+    LJ_GATHER_PARAMS(sigi,epsi,tdx,s2g_,e4g_);                       \
+    s2 = s2g_;                                                       \
+    e4 = e4g_;                                                       \
+  }
+
+/**
+ * @brief Vectorised LJ interactions of the atoms ibeg to iend-1 with their neighbours :
+ *  energy and forces are accumulated (not overwritten), including the reaction forces on the neighbours,
+ *  so that several threads can process different rows with their own force buffers.
+ *
+ * @param nl Neighbour list built with a list radius not smaller than the cutoff ; periodic lists use the minimum image
+ * @param ibeg,iend Range of atoms (rows of the list) to process
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param fx,fy,fz Forces in kJ/mol/nm, accumulated
+ * @return The potential energy of the pairs processed, in kJ/mol
+ */
+double KNAME(lj_rows_neighlist)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                const double x[], const double y[], const double z[],
+                                const uint32_t type[], const SPECIES* sp,
+                                const LJ_CUTS* cuts,
+                                double fx[], double fy[], double fz[])
+{
+  const vd vcut2   = VSET1(cuts->cutoff2);
+  const vd zero    = VZERO();
+  LJ_BOX_CONSTS(nl,pbc,bx,by,bz,ibx,iby,ibz);
+
+  vd vepot = VZERO();
+
+  int32_t jdx[SIMD_W], tdx[SIMD_W];
+  double  tx[SIMD_W], ty[SIMD_W], tz[SIMD_W];
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const vd xi = VSET1(x[i]);
+    const vd yi = VSET1(y[i]);
+    const vd zi = VSET1(z[i]);
+    // row of the species of i in the matrices of the mixed parameters
+    const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+    const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+
+    vd fxi = VZERO(), fyi = VZERO(), fzi = VZERO();
+
+    const uint32_t kend = nl->start[i+1];
+    for(uint32_t k=nl->start[i]; k<kend; k+=SIMD_W)
+    {
+      const uint32_t cnt = (kend-k < SIMD_W) ? kend-k : SIMD_W;
+
+      // the last chunk is padded with a real neighbour, masked out later
+      for(uint32_t l=0; l<SIMD_W; l++)
+      {
+        jdx[l] = (int32_t) nl->list[k + ((l<cnt) ? l : 0)];
+        tdx[l] = (int32_t) type[jdx[l]];
+      }
+
+      vd dx = VSUB(xi,VGATHER(x,jdx));
+      vd dy = VSUB(yi,VGATHER(y,jdx));
+      vd dz = VSUB(zi,VGATHER(z,jdx));
+      if(pbc)
+      {
+        dx = VIMAGE(dx,bx,ibx);
+        dy = VIMAGE(dy,by,iby);
+        dz = VIMAGE(dz,bz,ibz);
+      }
+      const vd r2 = VADD(VADD(VMUL(dx,dx),VMUL(dy,dy)),VMUL(dz,dz));
+
+      const vmask valid = VAND(VLANES(cnt),VLT(r2,vcut2));
+
+      // parameters of the pairs, already mixed
+      LJ_GATHER_PARAMS(sigi,epsi,tdx,s2,e4);
+
+      vd e;
+      vd fr = lj_pair_vec(r2,s2,e4,cuts,&e);
+
+      fr = VSEL(valid,fr,zero);
+      e  = VSEL(valid,e,zero);
+
+      vepot = VADD(vepot,e);
+
+      const vd fxj = VMUL(fr,dx);
+      const vd fyj = VMUL(fr,dy);
+      const vd fzj = VMUL(fr,dz);
+      fxi = VADD(fxi,fxj);
+      fyi = VADD(fyi,fyj);
+      fzi = VADD(fzi,fzj);
+
+      // reaction forces : no conflict within a chunk as the neighbours of i are all different
+      VSTORE(tx,fxj);
+      VSTORE(ty,fyj);
+      VSTORE(tz,fzj);
+      for(uint32_t l=0; l<cnt; l++)
+      {
+        fx[jdx[l]] -= tx[l];
+        fy[jdx[l]] -= ty[l];
+        fz[jdx[l]] -= tz[l];
+      }
+    }
+
+    fx[i] += VHSUM(fxi);
+    fy[i] += VHSUM(fyi);
+    fz[i] += VHSUM(fzi);
+  }
+
+  return VHSUM(vepot);
+}
+
+/**
+ * @brief Same as lj_rows_neighlist on the rows ibeg to iend-1 of a full neighbour list : each pair being stored
+ *  in the rows of both atoms, the forces of an atom are complete at the end of its row and no reaction force is
+ *  written, so that several threads can share the rows without force buffers.
+ *
+ * @param nl Full neighbour list (see neighlist_alloc_full) built with a list radius not smaller than the cutoff
+ * @param ibeg,iend Range of atoms (rows of the list) to process
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param fx,fy,fz Forces in kJ/mol/nm, overwritten for the atoms ibeg to iend-1 only
+ * @return The potential energy of the pairs processed, each one counted for half in each of its rows, in kJ/mol
+ */
+double KNAME(lj_rows_neighlist_full)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                     const double x[], const double y[], const double z[],
+                                     const uint32_t type[], const SPECIES* sp,
+                                     const LJ_CUTS* cuts,
+                                     double fx[], double fy[], double fz[])
+{
+  const vd vcut2   = VSET1(cuts->cutoff2);
+  const vd zero    = VZERO();
+  LJ_BOX_CONSTS(nl,pbc,bx,by,bz,ibx,iby,ibz);
+
+  vd vepot = VZERO();
+
+  int32_t jdx[SIMD_W], tdx[SIMD_W];
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const vd xi = VSET1(x[i]);
+    const vd yi = VSET1(y[i]);
+    const vd zi = VSET1(z[i]);
+    const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+    const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+
+    vd fxi = VZERO(), fyi = VZERO(), fzi = VZERO();
+
+    const uint32_t kend = nl->start[i+1];
+    for(uint32_t k=nl->start[i]; k<kend; k+=SIMD_W)
+    {
+      const uint32_t cnt = (kend-k < SIMD_W) ? kend-k : SIMD_W;
+
+      for(uint32_t l=0; l<SIMD_W; l++)
+      {
+        jdx[l] = (int32_t) nl->list[k + ((l<cnt) ? l : 0)];
+        tdx[l] = (int32_t) type[jdx[l]];
+      }
+
+      vd dx = VSUB(xi,VGATHER(x,jdx));
+      vd dy = VSUB(yi,VGATHER(y,jdx));
+      vd dz = VSUB(zi,VGATHER(z,jdx));
+      if(pbc)
+      {
+        dx = VIMAGE(dx,bx,ibx);
+        dy = VIMAGE(dy,by,iby);
+        dz = VIMAGE(dz,bz,ibz);
+      }
+      const vd r2 = VADD(VADD(VMUL(dx,dx),VMUL(dy,dy)),VMUL(dz,dz));
+
+      const vmask valid = VAND(VLANES(cnt),VLT(r2,vcut2));
+
+      LJ_GATHER_PARAMS(sigi,epsi,tdx,s2,e4);
+
+      vd e;
+      vd fr = lj_pair_vec(r2,s2,e4,cuts,&e);
+
+      fr = VSEL(valid,fr,zero);
+      e  = VSEL(valid,e,zero);
+
+      vepot = VADD(vepot,e);
+
+      fxi = VADD(fxi,VMUL(fr,dx));
+      fyi = VADD(fyi,VMUL(fr,dy));
+      fzi = VADD(fzi,VMUL(fr,dz));
+    }
+
+    fx[i] = VHSUM(fxi);
+    fy[i] = VHSUM(fyi);
+    fz[i] = VHSUM(fzi);
+  }
+
+  return 0.5*VHSUM(vepot);
+}
+
+LJ_INLINE double lj_tile_allpairs_body(uint32_t ibeg, uint32_t iend, uint32_t jbeg, uint32_t jend,
+                                       const double x[], const double y[], const double z[],
+                                       const uint32_t type[], const SPECIES* sp,
+                                       const LJ_CUTS* cuts,
+                                       double fx[], double fy[], double fz[], const int one)
+{
+  const vd vcut2 = VSET1(cuts->cutoff2);
+  const vd zero  = VZERO();
+  LJ_CONST_PARAMS(sp,one,s2c,e4c);
+
+  vd vepot = VZERO();
+  double epot = 0.0;
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const vd xi = VSET1(x[i]);
+    const vd yi = VSET1(y[i]);
+    const vd zi = VSET1(z[i]);
+    const double* sigi = sp->sigij + (one ? 0 : (size_t)type[i]*sp->n);
+    const double* epsi = sp->epsij + (one ? 0 : (size_t)type[i]*sp->n);
+
+    vd fxi = VZERO(), fyi = VZERO(), fzi = VZERO();
+
+    uint32_t j = (jbeg > i) ? jbeg : i+1;
+    for(; j+SIMD_W<=jend; j+=SIMD_W)
+    {
+      const vd dx = VSUB(xi,VLOAD(x+j));
+      const vd dy = VSUB(yi,VLOAD(y+j));
+      const vd dz = VSUB(zi,VLOAD(z+j));
+      const vd r2 = VADD(VADD(VMUL(dx,dx),VMUL(dy,dy)),VMUL(dz,dz));
+
+      LJ_PAIR_PARAMS(one,s2c,e4c,sigi,epsi,type+j,s2,e4);
+
+      vd e;
+      vd fr = lj_pair_vec(r2,s2,e4,cuts,&e);
+
+      const vmask valid = VLT(r2,vcut2);
+      fr = VSEL(valid,fr,zero);
+      e  = VSEL(valid,e,zero);
+
+      vepot = VADD(vepot,e);
+
+      const vd fxj = VMUL(fr,dx);
+      const vd fyj = VMUL(fr,dy);
+      const vd fzj = VMUL(fr,dz);
+      fxi = VADD(fxi,fxj);
+      fyi = VADD(fyi,fyj);
+      fzi = VADD(fzi,fzj);
+
+      VSTORE(fx+j,VSUB(VLOAD(fx+j),fxj));
+      VSTORE(fy+j,VSUB(VLOAD(fy+j),fyj));
+      VSTORE(fz+j,VSUB(VLOAD(fz+j),fzj));
+    }
+
+    // remainder of the block
+    double sfx=0.0, sfy=0.0, sfz=0.0;
+    for(; j<jend; j++)
+    {
+      const double dx = x[i]-x[j];
+      const double dy = y[i]-y[j];
+      const double dz = z[i]-z[j];
+      const double r2 = dx*dx + dy*dy + dz*dz;
+
+      const uint32_t tj = one ? 0 : type[j];
+      const double fr = lj_pair(r2, sigi[tj], epsi[tj], cuts, &epot);
+
+      sfx += fr*dx;   fx[j] -= fr*dx;
+      sfy += fr*dy;   fy[j] -= fr*dy;
+      sfz += fr*dz;   fz[j] -= fr*dz;
+    }
+
+    fx[i] += VHSUM(fxi) + sfx;
+    fy[i] += VHSUM(fyi) + sfy;
+    fz[i] += VHSUM(fzi) + sfz;
+  }
+
+  return VHSUM(vepot) + epot;
+}
+
+/**
+ * @brief Vectorised LJ interactions between two blocks of consecutive atoms, for the tiled all-pairs kernel :
+ *  the pairs (i,j) with ibeg <= i < iend, jbeg <= j < jend and j > i. Energy and forces are accumulated.
+ *  The atoms j being consecutive they are read, and their reaction forces written, with vector loads and stores.
+ *
+ * @param ibeg,iend Range of the first block
+ * @param jbeg,jend Range of the second block, jbeg >= ibeg
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters, the cutoff may be infinite
+ * @param fx,fy,fz Forces in kJ/mol/nm, accumulated
+ * @return The potential energy of the pairs processed, in kJ/mol
+ */
+double KNAME(lj_tile_allpairs)(uint32_t ibeg, uint32_t iend, uint32_t jbeg, uint32_t jend,
+                               const double x[], const double y[], const double z[],
+                               const uint32_t type[], const SPECIES* sp,
+                               const LJ_CUTS* cuts,
+                               double fx[], double fy[], double fz[])
+{
+  return LJ_SPECIALISE(lj_tile_allpairs_body,sp,ibeg,iend,jbeg,jend,x,y,z,type,sp,cuts,fx,fy,fz);
+}
+
+/**
+ * @brief Energy only version of lj_rows_neighlist : no force is computed nor written
+ *
+ * @param nl Neighbour list built with a list radius not smaller than the cutoff ; periodic lists use the minimum image
+ * @param ibeg,iend Range of atoms whose rows are processed
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @return The potential energy of the pairs processed, in kJ/mol
+ */
+double KNAME(lj_energy_rows_neighlist)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                       const double x[], const double y[], const double z[],
+                                       const uint32_t type[], const SPECIES* sp,
+                                       const LJ_CUTS* cuts)
+{
+  const vd vcut2   = VSET1(cuts->cutoff2);
+  const vd zero    = VZERO();
+  LJ_BOX_CONSTS(nl,pbc,bx,by,bz,ibx,iby,ibz);
+
+  vd vepot = VZERO();
+
+  int32_t jdx[SIMD_W], tdx[SIMD_W];
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const vd xi = VSET1(x[i]);
+    const vd yi = VSET1(y[i]);
+    const vd zi = VSET1(z[i]);
+    const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+    const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+
+    const uint32_t kend = nl->start[i+1];
+    for(uint32_t k=nl->start[i]; k<kend; k+=SIMD_W)
+    {
+      const uint32_t cnt = (kend-k < SIMD_W) ? kend-k : SIMD_W;
+
+      for(uint32_t l=0; l<SIMD_W; l++)
+      {
+        jdx[l] = (int32_t) nl->list[k + ((l<cnt) ? l : 0)];
+        tdx[l] = (int32_t) type[jdx[l]];
+      }
+
+      vd dx = VSUB(xi,VGATHER(x,jdx));
+      vd dy = VSUB(yi,VGATHER(y,jdx));
+      vd dz = VSUB(zi,VGATHER(z,jdx));
+      if(pbc)
+      {
+        dx = VIMAGE(dx,bx,ibx);
+        dy = VIMAGE(dy,by,iby);
+        dz = VIMAGE(dz,bz,ibz);
+      }
+      const vd r2 = VADD(VADD(VMUL(dx,dx),VMUL(dy,dy)),VMUL(dz,dz));
+
+      const vmask valid = VAND(VLANES(cnt),VLT(r2,vcut2));
+
+      LJ_GATHER_PARAMS(sigi,epsi,tdx,s2,e4);
+
+      const vd e = lj_energy_vec(r2,s2,e4,cuts);
+      vepot = VADD(vepot,VSEL(valid,e,zero));
+    }
+  }
+
+  return VHSUM(vepot);
+}
+
+LJ_INLINE double lj_energy_tile_allpairs_body(uint32_t ibeg, uint32_t iend, uint32_t jbeg, uint32_t jend,
+                                              const double x[], const double y[], const double z[],
+                                              const uint32_t type[], const SPECIES* sp,
+                                              const LJ_CUTS* cuts, const int one)
+{
+  const vd vcut2 = VSET1(cuts->cutoff2);
+  const vd zero  = VZERO();
+  LJ_CONST_PARAMS(sp,one,s2c,e4c);
+
+  vd vepot = VZERO();
+  double epot = 0.0;
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const vd xi = VSET1(x[i]);
+    const vd yi = VSET1(y[i]);
+    const vd zi = VSET1(z[i]);
+    const double* sigi = sp->sigij + (one ? 0 : (size_t)type[i]*sp->n);
+    const double* epsi = sp->epsij + (one ? 0 : (size_t)type[i]*sp->n);
+
+    uint32_t j = (jbeg > i) ? jbeg : i+1;
+    for(; j+SIMD_W<=jend; j+=SIMD_W)
+    {
+      const vd dx = VSUB(xi,VLOAD(x+j));
+      const vd dy = VSUB(yi,VLOAD(y+j));
+      const vd dz = VSUB(zi,VLOAD(z+j));
+      const vd r2 = VADD(VADD(VMUL(dx,dx),VMUL(dy,dy)),VMUL(dz,dz));
+
+      LJ_PAIR_PARAMS(one,s2c,e4c,sigi,epsi,type+j,s2,e4);
+
+      const vd e = lj_energy_vec(r2,s2,e4,cuts);
+      vepot = VADD(vepot,VSEL(VLT(r2,vcut2),e,zero));
+    }
+
+    for(; j<jend; j++)
+    {
+      const double dx = x[i]-x[j];
+      const double dy = y[i]-y[j];
+      const double dz = z[i]-z[j];
+      const uint32_t tj = one ? 0 : type[j];
+      epot += lj_pair_energy(dx*dx + dy*dy + dz*dz, sigi[tj], epsi[tj], cuts);
+    }
+  }
+
+  return VHSUM(vepot) + epot;
+}
+
+/**
+ * @brief Energy only version of lj_tile_allpairs : no force is computed nor written
+ *
+ * @param ibeg,iend Range of the first block
+ * @param jbeg,jend Range of the second block, jbeg >= ibeg
+ * @param x,y,z Coordinates in nm
+ * @param type,sp Species of the atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters, the cutoff may be infinite
+ * @return The potential energy of the pairs processed, in kJ/mol
+ */
+double KNAME(lj_energy_tile_allpairs)(uint32_t ibeg, uint32_t iend, uint32_t jbeg, uint32_t jend,
+                                      const double x[], const double y[], const double z[],
+                                      const uint32_t type[], const SPECIES* sp,
+                                      const LJ_CUTS* cuts)
+{
+  return LJ_SPECIALISE(lj_energy_tile_allpairs_body,sp,ibeg,iend,jbeg,jend,x,y,z,type,sp,cuts);
+}
+
+/**
+ * @brief Mixed precision version of lj_rows_neighlist : distances, pair energies and forces are computed in single precision
+ *  with twice as many lanes, the energy being accumulated in double precision. Coordinates, species and forces
+ *  are packed by atom so that each neighbour costs one load and one read-modify-write of 4 floats.
+ *
+ * @param nl Neighbour list built with a list radius not smaller than the cutoff
+ * @param ibeg,iend Range of atoms (rows of the list) to process
+ * @param xyzt Single precision copy of the coordinates in nm and of the species, packed by atom (x,y,z,species),
+ *  so that a neighbour is read from a single cache line
+ * @param sp Species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters
+ * @param f4 Forces in kJ/mol/nm packed by atom (x,y,z,unused) in single precision, accumulated
+ * @return The potential energy of the pairs processed, in kJ/mol
+ */
+double KNAME(lj_rows_neighlist_mixed)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                      const float xyzt[], const SPECIES* sp,
+                                      const LJ_CUTS* cuts, float f4[])
+{
+  const vf vcut2   = FSET1((float)cuts->cutoff2);
+  const vf vcuton2 = FSET1((float)cuts->cuton2);
+  const vf vcuton  = FSET1((float)cuts->cuton);
+  const vf vswinv  = FSET1((float)cuts->swInv);
+  const vf one     = FSET1(1.f);
+  const vf four    = FSET1(4.f);
+  const vf twelve  = FSET1(12.f);
+  const vf c6      = FSET1(6.f);
+  const vf c10     = FSET1(10.f);
+  const vf c15     = FSET1(15.f);
+  const vf c30     = FSET1(30.f);
+  const vf c60     = FSET1(60.f);
+  const vf zero    = FZERO();
+
+  double epot = 0.0;
+
+  int32_t j4[SIMD_WF], tdx[SIMD_WF];
+  float   tx[SIMD_WF];
+
+#ifdef FPERMUTE
+  // with few species the parameters of a row are kept in a register and looked up with a permutation
+  const uint32_t permute = (sp->n <= SIMD_WF);
+  float ty[SIMD_WF];
+#endif
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const vf xi = FSET1(xyzt[4*i]);
+    const vf yi = FSET1(xyzt[4*i+1]);
+    const vf zi = FSET1(xyzt[4*i+2]);
+    const double* sigi = sp->sigij + (size_t)xyzt[4*i+3]*sp->n;
+    const double* epsi = sp->epsij + (size_t)xyzt[4*i+3]*sp->n;
+
+#ifdef FPERMUTE
+    vf sigrow = zero, epsrow = zero;
+    if(permute)
+    {
+      for(uint32_t l=0; l<SIMD_WF; l++)
+      {
+        tx[l] = (l<sp->n) ? (float) sigi[l] : 0.f;
+        ty[l] = (l<sp->n) ? (float) epsi[l] : 0.f;
+      }
+      sigrow = FLOADU(tx);
+      epsrow = FLOADU(ty);
+    }
+#endif
+
+    vf fxi = FZERO(), fyi = FZERO(), fzi = FZERO(), ei = FZERO();
+
+    const uint32_t kend = nl->start[i+1];
+    for(uint32_t k=nl->start[i]; k<kend; k+=SIMD_WF)
+    {
+      const uint32_t cnt = (kend-k < SIMD_WF) ? kend-k : SIMD_WF;
+
+      for(uint32_t l=0; l<SIMD_WF; l++)
+      {
+        j4[l] = 4*(int32_t) nl->list[k + ((l<cnt) ? l : 0)];
+      }
+
+      vf xj, yj, zj, tj;
+      FLOAD_XYZT(xyzt,j4,&xj,&yj,&zj,&tj);
+
+      const vf dx = FSUB(xi,xj);
+      const vf dy = FSUB(yi,yj);
+      const vf dz = FSUB(zi,zj);
+      const vf r2 = FADD(FADD(FMUL(dx,dx),FMUL(dy,dy)),FMUL(dz,dz));
+
+      const vfmask valid = FAND(FLANES(cnt),FLT(r2,vcut2));
+
+      vf sij, eij;
+#ifdef FPERMUTE
+      if(permute)
+      {
+        sij = FPERMUTE(sigrow,tj);
+        eij = FPERMUTE(epsrow,tj);
+      }
+      else
+#endif
+      {
+        FSTORE(tx,tj);
+        for(uint32_t l=0; l<SIMD_WF; l++)
+          tdx[l] = (int32_t) tx[l];
+        sij = FGATHER(sigi,tdx);
+        eij = FGATHER(epsi,tdx);
+      }
+
+      const vf ir2 = FDIV(one,r2);
+      const vf s2  = FMUL(FMUL(sij,sij),ir2);
+      const vf s6  = FMUL(FMUL(s2,s2),s2);
+      const vf e4  = FMUL(four,eij);
+      vf e   = FMUL(e4,FSUB(FMUL(s6,s6),s6));
+      vf fr  = FMUL(FMUL(e4,FSUB(FMUL(twelve,FMUL(s6,s6)),FMUL(c6,s6))),ir2);
+
+      if(cuts->useSwitch)
+      {
+        const vfmask swm = FGT(r2,vcuton2);
+        const vf r   = FSQRT(r2);
+        const vf t   = FMUL(FSUB(r,vcuton),vswinv);
+        const vf t2  = FMUL(t,t);
+        const vf sw  = FADD(one,FMUL(FMUL(t2,t),FSUB(FMUL(t,FSUB(c15,FMUL(c6,t))),c10)));
+        const vf dsw = FMUL(FMUL(t2,FSUB(FMUL(t,FSUB(c60,FMUL(c30,t))),c30)),vswinv);
+
+        fr = FSEL(swm,FSUB(FMUL(sw,fr),FDIV(FMUL(e,dsw),r)),fr);
+        e  = FSEL(swm,FMUL(sw,e),e);
+      }
+
+      fr = FSEL(valid,fr,zero);
+      e  = FSEL(valid,e,zero);
+
+      ei = FADD(ei,e);
+
+      const vf fxj = FMUL(fr,dx);
+      const vf fyj = FMUL(fr,dy);
+      const vf fzj = FMUL(fr,dz);
+      fxi = FADD(fxi,fxj);
+      fyi = FADD(fyi,fyj);
+      fzi = FADD(fzi,fzj);
+
+      // reaction forces : one read-modify-write of 4 floats per neighbour
+      FSCATTER_SUB_XYZ(f4,j4,cnt,fxj,fyj,fzj);
+    }
+
+    f4[4*i]   += (float) FHSUM(fxi);
+    f4[4*i+1] += (float) FHSUM(fyi);
+    f4[4*i+2] += (float) FHSUM(fzi);
+    // the energy of each row is small : the total is accumulated in double precision
+    epot += FHSUM(ei);
+  }
+
+  return epot;
+}
+
+/**
+ * @brief Same as lj_rows_neighlist, the pair interactions being interpolated in the tables of ljTable.c
+ *  instead of computed analytically : no division nor square root, but eight gathered coefficients per pair.
+ *  The rare pairs closer than the first node of the tables are evaluated with the potential of the couple.
+ *
+ * @param nl Neighbour list built with a list radius not smaller than the cutoff
+ * @param ibeg,iend Range of atoms (rows of the list) to process
+ * @param x,y,z Coordinates in nm
+ * @param type Species of the atoms
+ * @param tab Tables of all the couples of species, up to the cutoff
+ * @param fx,fy,fz Forces in kJ/mol/nm, accumulated
+ * @return The potential energy of the pairs processed, in kJ/mol
+ */
+double KNAME(lj_rows_neighlist_table)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                      const double x[], const double y[], const double z[],
+                                      const uint32_t type[], const LJ_TABLE* tab,
+                                      double fx[], double fy[], double fz[])
+{
+  const vd vcut2 = VSET1(tab->s1);
+  const vd vs0   = VSET1(tab->s0);
+  const vd vinvh = VSET1(tab->invh);
+  const vd zero  = VZERO();
+  const double* coef = tab->coef;
+  const int32_t kmax = (int32_t) tab->nbins - 1;
+
+  vd vepot = VZERO();
+
+  int32_t jdx[SIMD_W], cdx[SIMD_W];
+  double  tx[SIMD_W], ty[SIMD_W], tz[SIMD_W];
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const vd xi = VSET1(x[i]);
+    const vd yi = VSET1(y[i]);
+    const vd zi = VSET1(z[i]);
+    // first table of the row of the species of i
+    const int32_t rowi = (int32_t)(type[i]*tab->ntypes);
+
+    vd fxi = VZERO(), fyi = VZERO(), fzi = VZERO();
+
+    const uint32_t kend = nl->start[i+1];
+    for(uint32_t k=nl->start[i]; k<kend; k+=SIMD_W)
+    {
+      const uint32_t cnt = (kend-k < SIMD_W) ? kend-k : SIMD_W;
+
+      // the last chunk is padded with a real neighbour, masked out later
+      for(uint32_t l=0; l<SIMD_W; l++)
+        jdx[l] = (int32_t) nl->list[k + ((l<cnt) ? l : 0)];
+
+      const vd dx = VSUB(xi,VGATHER(x,jdx));
+      const vd dy = VSUB(yi,VGATHER(y,jdx));
+      const vd dz = VSUB(zi,VGATHER(z,jdx));
+      const vd r2 = VADD(VADD(VMUL(dx,dx),VMUL(dy,dy)),VMUL(dz,dz));
+
+      const vmask valid = VAND(VLANES(cnt),VLT(r2,vcut2));
+
+      // bin of each pair, clamped so that pairs beyond the cutoff or below s0 still read inside the table
+      uint32_t below = 0;
+      VSTORE(tx,VMUL(VSUB(r2,vs0),vinvh));
+      for(uint32_t l=0; l<SIMD_W; l++)
+      {
+        below |= (l<cnt && tx[l] < 0.0);
+        int32_t b = (tx[l] > 0.0) ? (int32_t) tx[l] : 0;
+        b = (b < kmax) ? b : kmax;
+        tx[l] -= (double) b;
+        tx[l] = (tx[l] > 0.0) ? ((tx[l] < 1.0) ? tx[l] : 1.0) : 0.0;
+        cdx[l] = ((rowi + (int32_t) type[jdx[l]])*(int32_t) tab->nbins + b)*LJ_TABLE_NCOEF;
+      }
+      const vd t = VLOAD(tx);
+
+      vd e  = VGATHER(coef+3,cdx);
+      e  = VADD(VGATHER(coef+2,cdx),VMUL(t,e));
+      e  = VADD(VGATHER(coef+1,cdx),VMUL(t,e));
+      e  = VADD(VGATHER(coef+0,cdx),VMUL(t,e));
+      vd fr = VGATHER(coef+7,cdx);
+      fr = VADD(VGATHER(coef+6,cdx),VMUL(t,fr));
+      fr = VADD(VGATHER(coef+5,cdx),VMUL(t,fr));
+      fr = VADD(VGATHER(coef+4,cdx),VMUL(t,fr));
+
+      fr = VSEL(valid,fr,zero);
+      e  = VSEL(valid,e,zero);
+
+      // pairs closer than the first node : the cubics are not extrapolated
+      if(below)
+      {
+        VSTORE(tx,e);
+        VSTORE(ty,fr);
+        VSTORE(tz,r2);
+        for(uint32_t l=0; l<cnt; l++)
+        {
+          if(tz[l] < tab->s0)
+          {
+            const uint32_t p = (uint32_t) cdx[l]/(tab->nbins*LJ_TABLE_NCOEF);
+            tx[l] = 0.0;
+            ty[l] = (tab->pot[p] != NULL) ? tab->pot[p](tz[l],tab->par[p],tx+l) : 0.0;
+          }
+        }
+        e  = VLOAD(tx);
+        fr = VLOAD(ty);
+      }
+
+      vepot = VADD(vepot,e);
+
+      const vd fxj = VMUL(fr,dx);
+      const vd fyj = VMUL(fr,dy);
+      const vd fzj = VMUL(fr,dz);
+      fxi = VADD(fxi,fxj);
+      fyi = VADD(fyi,fyj);
+      fzi = VADD(fzi,fzj);
+
+      VSTORE(tx,fxj);
+      VSTORE(ty,fyj);
+      VSTORE(tz,fzj);
+      for(uint32_t l=0; l<cnt; l++)
+      {
+        fx[jdx[l]] -= tx[l];
+        fy[jdx[l]] -= ty[l];
+        fz[jdx[l]] -= tz[l];
+      }
+    }
+
+    fx[i] += VHSUM(fxi);
+    fy[i] += VHSUM(fyi);
+    fz[i] += VHSUM(fzi);
+  }
+
+  return VHSUM(vepot);
+}
+
+/**
+ * @brief Forces and energies of independent replicas of the same small cluster, one replica per SIMD lane :
+ *  the coordinates are interleaved, coordinate of atom i of replica r at [i*stride+r], so that atom i of SIMD_W
+ *  consecutive replicas is loaded with one vector load, without any gather. All the pairs i<j are visited,
+ *  the mixed parameters of a pair being the same in all the replicas.
+ *
+ * @param n Number of atoms of each replica
+ * @param stride Distance between two atoms of the same replica in the arrays, a multiple of SIMD_W
+ * @param rbeg,rend Range of replicas (lanes) to process, multiples of SIMD_W
+ * @param x,y,z Interleaved coordinates in nm
+ * @param type,sp Species of the n atoms, and species table with the mixed LJ parameters
+ * @param cuts cuton/cutoff parameters, the cutoff may be infinite
+ * @param fx,fy,fz Interleaved forces in kJ/mol/nm, overwritten for the replicas processed
+ * @param epot Potential energy of each replica in kJ/mol, overwritten for the replicas processed
+ */
+void KNAME(lj_batch_allpairs)(uint32_t n, uint32_t stride, uint32_t rbeg, uint32_t rend,
+                              const double x[], const double y[], const double z[],
+                              const uint32_t type[], const SPECIES* sp, const LJ_CUTS* cuts,
+                              double fx[], double fy[], double fz[], double epot[])
+{
+  const vd vcut2 = VSET1(cuts->cutoff2);
+  const vd zero  = VZERO();
+
+  for(uint32_t r=rbeg; r<rend; r+=SIMD_W)
+  {
+    for(uint32_t i=0; i<n; i++)
+    {
+      VSTORE(fx+(size_t)i*stride+r,zero);
+      VSTORE(fy+(size_t)i*stride+r,zero);
+      VSTORE(fz+(size_t)i*stride+r,zero);
+    }
+
+    vd vepot = VZERO();
+
+    for(uint32_t i=0; i<n; i++)
+    {
+      const size_t ii = (size_t)i*stride+r;
+      const vd xi = VLOAD(x+ii);
+      const vd yi = VLOAD(y+ii);
+      const vd zi = VLOAD(z+ii);
+      const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+      const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+
+      vd fxi = VZERO(), fyi = VZERO(), fzi = VZERO();
+
+      for(uint32_t j=i+1; j<n; j++)
+      {
+        const size_t jj = (size_t)j*stride+r;
+        const vd dx = VSUB(xi,VLOAD(x+jj));
+        const vd dy = VSUB(yi,VLOAD(y+jj));
+        const vd dz = VSUB(zi,VLOAD(z+jj));
+        const vd r2 = VADD(VADD(VMUL(dx,dx),VMUL(dy,dy)),VMUL(dz,dz));
+
+        // the same couple of species in all the lanes : parameters broadcast
+        const double sij = sigi[type[j]];
+        const vd s2 = VSET1(sij*sij);
+        const vd e4 = VSET1(4.0*epsi[type[j]]);
+
+        vd e;
+        vd fr = lj_pair_vec(r2,s2,e4,cuts,&e);
+        const vmask valid = VLT(r2,vcut2);
+        fr = VSEL(valid,fr,zero);
+        vepot = VADD(vepot,VSEL(valid,e,zero));
+
+        const vd fxj = VMUL(fr,dx);
+        const vd fyj = VMUL(fr,dy);
+        const vd fzj = VMUL(fr,dz);
+        fxi = VADD(fxi,fxj);
+        fyi = VADD(fyi,fyj);
+        fzi = VADD(fzi,fzj);
+        VSTORE(fx+jj,VSUB(VLOAD(fx+jj),fxj));
+        VSTORE(fy+jj,VSUB(VLOAD(fy+jj),fyj));
+        VSTORE(fz+jj,VSUB(VLOAD(fz+jj),fzj));
+      }
+
+      VSTORE(fx+ii,VADD(VLOAD(fx+ii),fxi));
+      VSTORE(fy+ii,VADD(VLOAD(fy+ii),fyi));
+      VSTORE(fz+ii,VADD(VLOAD(fz+ii),fzi));
+    }
+
+    VSTORE(epot+r,vepot);
+  }
+}
+
+#else // no SIMD instruction set available at compile time
+
+const char* KNAME(lj_kernel_isa)()
+{
+  return "none (scalar)";
+}
+
+double KNAME(lj_rows_neighlist)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                const double x[], const double y[], const double z[],
+                                const uint32_t type[], const SPECIES* sp,
+                                const LJ_CUTS* cuts,
+                                double fx[], double fy[], double fz[])
+{
+  double epot = 0.0;
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+    const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+    double fxi=0.0, fyi=0.0, fzi=0.0;
+
+    for(uint32_t k=nl->start[i]; k<nl->start[i+1]; k++)
+    {
+      const uint32_t j = nl->list[k];
+
+      const double dx = nl->periodic ? cellgrid_image(x[i]-x[j],nl->box[0],nl->ibox[0]) : x[i]-x[j];
+      const double dy = nl->periodic ? cellgrid_image(y[i]-y[j],nl->box[1],nl->ibox[1]) : y[i]-y[j];
+      const double dz = nl->periodic ? cellgrid_image(z[i]-z[j],nl->box[2],nl->ibox[2]) : z[i]-z[j];
+      const double r2 = dx*dx + dy*dy + dz*dz;
+
+      const double fr = lj_pair(r2, sigi[type[j]], epsi[type[j]], cuts, &epot);
+
+      fxi += fr*dx;   fx[j] -= fr*dx;
+      fyi += fr*dy;   fy[j] -= fr*dy;
+      fzi += fr*dz;   fz[j] -= fr*dz;
+    }
+
+    fx[i] += fxi;
+    fy[i] += fyi;
+    fz[i] += fzi;
+  }
+
+  return epot;
+}
+
+double KNAME(lj_rows_neighlist_full)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                     const double x[], const double y[], const double z[],
+                                     const uint32_t type[], const SPECIES* sp,
+                                     const LJ_CUTS* cuts,
+                                     double fx[], double fy[], double fz[])
+{
+  double epot = 0.0;
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+    const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+    double fxi=0.0, fyi=0.0, fzi=0.0;
+
+    for(uint32_t k=nl->start[i]; k<nl->start[i+1]; k++)
+    {
+      const uint32_t j = nl->list[k];
+
+      const double dx = nl->periodic ? cellgrid_image(x[i]-x[j],nl->box[0],nl->ibox[0]) : x[i]-x[j];
+      const double dy = nl->periodic ? cellgrid_image(y[i]-y[j],nl->box[1],nl->ibox[1]) : y[i]-y[j];
+      const double dz = nl->periodic ? cellgrid_image(z[i]-z[j],nl->box[2],nl->ibox[2]) : z[i]-z[j];
+      const double r2 = dx*dx + dy*dy + dz*dz;
+
+      const double fr = lj_pair(r2, sigi[type[j]], epsi[type[j]], cuts, &epot);
+
+      fxi += fr*dx;
+      fyi += fr*dy;
+      fzi += fr*dz;
+    }
+
+    fx[i] = fxi;
+    fy[i] = fyi;
+    fz[i] = fzi;
+  }
+
+  return 0.5*epot;
+}
+
+double KNAME(lj_tile_allpairs)(uint32_t ibeg, uint32_t iend, uint32_t jbeg, uint32_t jend,
+                               const double x[], const double y[], const double z[],
+                               const uint32_t type[], const SPECIES* sp,
+                               const LJ_CUTS* cuts,
+                               double fx[], double fy[], double fz[])
+{
+  double epot = 0.0;
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+    const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+    double fxi=0.0, fyi=0.0, fzi=0.0;
+
+    for(uint32_t j=((jbeg > i) ? jbeg : i+1); j<jend; j++)
+    {
+      const double dx = x[i]-x[j];
+      const double dy = y[i]-y[j];
+      const double dz = z[i]-z[j];
+      const double r2 = dx*dx + dy*dy + dz*dz;
+
+      const double fr = lj_pair(r2, sigi[type[j]], epsi[type[j]], cuts, &epot);
+
+      fxi += fr*dx;   fx[j] -= fr*dx;
+      fyi += fr*dy;   fy[j] -= fr*dy;
+      fzi += fr*dz;   fz[j] -= fr*dz;
+    }
+
+    fx[i] += fxi;
+    fy[i] += fyi;
+    fz[i] += fzi;
+  }
+
+  return epot;
+}
+
+double KNAME(lj_energy_rows_neighlist)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                       const double x[], const double y[], const double z[],
+                                       const uint32_t type[], const SPECIES* sp,
+                                       const LJ_CUTS* cuts)
+{
+  double epot = 0.0;
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+    const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+
+    for(uint32_t k=nl->start[i]; k<nl->start[i+1]; k++)
+    {
+      const uint32_t j = nl->list[k];
+
+      const double dx = nl->periodic ? cellgrid_image(x[i]-x[j],nl->box[0],nl->ibox[0]) : x[i]-x[j];
+      const double dy = nl->periodic ? cellgrid_image(y[i]-y[j],nl->box[1],nl->ibox[1]) : y[i]-y[j];
+      const double dz = nl->periodic ? cellgrid_image(z[i]-z[j],nl->box[2],nl->ibox[2]) : z[i]-z[j];
+      epot += lj_pair_energy(dx*dx + dy*dy + dz*dz, sigi[type[j]], epsi[type[j]], cuts);
+    }
+  }
+
+  return epot;
+}
+
+double KNAME(lj_energy_tile_allpairs)(uint32_t ibeg, uint32_t iend, uint32_t jbeg, uint32_t jend,
+                                      const double x[], const double y[], const double z[],
+                                      const uint32_t type[], const SPECIES* sp,
+                                      const LJ_CUTS* cuts)
+{
+  double epot = 0.0;
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+    const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+
+    for(uint32_t j=((jbeg > i) ? jbeg : i+1); j<jend; j++)
+    {
+      const double dx = x[i]-x[j];
+      const double dy = y[i]-y[j];
+      const double dz = z[i]-z[j];
+      epot += lj_pair_energy(dx*dx + dy*dy + dz*dz, sigi[type[j]], epsi[type[j]], cuts);
+    }
+  }
+
+  return epot;
+}
+
+double KNAME(lj_rows_neighlist_mixed)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                      const float xyzt[], const SPECIES* sp,
+                                      const LJ_CUTS* cuts, float f4[])
+{
+  const float cut2   = (float) cuts->cutoff2;
+  const float cuton2 = (float) cuts->cuton2;
+  const float cuton  = (float) cuts->cuton;
+  const float swinv  = (float) cuts->swInv;
+
+  double epot = 0.0;
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const double* sigi = sp->sigij + (size_t)xyzt[4*i+3]*sp->n;
+    const double* epsi = sp->epsij + (size_t)xyzt[4*i+3]*sp->n;
+    float fxi=0.f, fyi=0.f, fzi=0.f, ei=0.f;
+
+    for(uint32_t k=nl->start[i]; k<nl->start[i+1]; k++)
+    {
+      const uint32_t j = nl->list[k];
+
+      const float dx = xyzt[4*i]-xyzt[4*j];
+      const float dy = xyzt[4*i+1]-xyzt[4*j+1];
+      const float dz = xyzt[4*i+2]-xyzt[4*j+2];
+      const float r2 = dx*dx + dy*dy + dz*dz;
+
+      if (r2 >= cut2)
+        continue;
+
+      const uint32_t tj = (uint32_t) xyzt[4*j+3];
+      const float sig = (float) sigi[tj];
+      const float eps = (float) epsi[tj];
+      const float s2  = sig*sig/r2;
+      const float s6  = s2*s2*s2;
+      float e   = 4.f*eps*(s6*s6-s6);
+      float fr  = 24.f*eps*(2.f*s6*s6-s6)/r2;
+
+      if (cuts->useSwitch && r2 > cuton2)
+      {
+        const float r  = sqrtf(r2);
+        const float t  = (r-cuton)*swinv;
+        const float sw = 1.f + t*t*t*(-10.f + t*(15.f - t*6.f));
+        const float dsw= t*t*(-30.f + t*(60.f - t*30.f))*swinv;
+        fr = sw*fr - e*dsw/r;
+        e *= sw;
+      }
+
+      ei += e;
+      fxi += fr*dx;   f4[4*j]   -= fr*dx;
+      fyi += fr*dy;   f4[4*j+1] -= fr*dy;
+      fzi += fr*dz;   f4[4*j+2] -= fr*dz;
+    }
+
+    f4[4*i]   += fxi;
+    f4[4*i+1] += fyi;
+    f4[4*i+2] += fzi;
+    epot += (double) ei;
+  }
+
+  return epot;
+}
+
+double KNAME(lj_rows_neighlist_table)(const NEIGHLIST* nl, uint32_t ibeg, uint32_t iend,
+                                      const double x[], const double y[], const double z[],
+                                      const uint32_t type[], const LJ_TABLE* tab,
+                                      double fx[], double fy[], double fz[])
+{
+  double epot = 0.0;
+
+  for(uint32_t i=ibeg; i<iend; i++)
+  {
+    const uint32_t rowi = type[i]*tab->ntypes;
+    double fxi=0.0, fyi=0.0, fzi=0.0;
+
+    for(uint32_t k=nl->start[i]; k<nl->start[i+1]; k++)
+    {
+      const uint32_t j = nl->list[k];
+
+      const double dx = x[i]-x[j];
+      const double dy = y[i]-y[j];
+      const double dz = z[i]-z[j];
+      const double r2 = dx*dx + dy*dy + dz*dz;
+
+      const double fr = lj_table_pair(tab, rowi+type[j], r2, &epot);
+
+      fxi += fr*dx;   fx[j] -= fr*dx;
+      fyi += fr*dy;   fy[j] -= fr*dy;
+      fzi += fr*dz;   fz[j] -= fr*dz;
+    }
+
+    fx[i] += fxi;
+    fy[i] += fyi;
+    fz[i] += fzi;
+  }
+
+  return epot;
+}
+
+void KNAME(lj_batch_allpairs)(uint32_t n, uint32_t stride, uint32_t rbeg, uint32_t rend,
+                              const double x[], const double y[], const double z[],
+                              const uint32_t type[], const SPECIES* sp, const LJ_CUTS* cuts,
+                              double fx[], double fy[], double fz[], double epot[])
+{
+  for(uint32_t r=rbeg; r<rend; r++)
+  {
+    for(uint32_t i=0; i<n; i++)
+      fx[(size_t)i*stride+r] = fy[(size_t)i*stride+r] = fz[(size_t)i*stride+r] = 0.0;
+
+    double e = 0.0;
+    for(uint32_t i=0; i<n; i++)
+    {
+      const size_t ii = (size_t)i*stride+r;
+      const double* sigi = sp->sigij + (size_t)type[i]*sp->n;
+      const double* epsi = sp->epsij + (size_t)type[i]*sp->n;
+
+      for(uint32_t j=i+1; j<n; j++)
+      {
+        const size_t jj = (size_t)j*stride+r;
+        const double dx = x[ii]-x[jj];
+        const double dy = y[ii]-y[jj];
+        const double dz = z[ii]-z[jj];
+        const double r2 = dx*dx + dy*dy + dz*dz;
+
+        const double fr = lj_pair(r2, sigi[type[j]], epsi[type[j]], cuts, &e);
+
+        fx[ii] += fr*dx;   fx[jj] -= fr*dx;
+        fy[ii] += fr*dy;   fy[jj] -= fr*dy;
+        fz[ii] += fr*dz;   fz[jj] -= fr*dz;
+      }
+    }
+    epot[r] = e;
+  }
+}
+
+#endif
@@ -0,0 +1,195 @@
+/**
+ * \file ljTable.c
+ *
+ * \brief Tabulated pair potentials : cubic splines of the energy and of F/r on r^2, one table per couple of species
+ *
+ * \details The tables are built at startup from the PARAMS section (Lorentz-Berthelot parameters and switching function,
+ *          i.e. the same potential than \b #lj_pair), with a number of bins given by the TABLE option of NONBOND.
+ *          Any other pair potential can be tabulated with \b #lj_table_set_pair, the cost of the kernel being the same.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "global.h"
+#include "ljTable.h"
+#include "ljForces.h"
+#include "logger.h"
+
+/**
+ * @brief Allocates empty tables for all the couples of species
+ *
+ * @param ntypes Number of species
+ * @param nbins Number of bins of each table
+ * @param rmin Smallest distance tabulated, in nm
+ * @param cutoff Cutoff in nm, has to be finite
+ * @return The tables, to be filled with lj_table_set_pair and freed with lj_table_free
+ */
+LJ_TABLE* lj_table_alloc(uint32_t ntypes, uint32_t nbins, double rmin, double cutoff)
+{
+  // the kernels index the coefficients with 32 bits integers
+  if(!isfinite(cutoff) || nbins < 1 || !(rmin < cutoff) || (double)ntypes*ntypes*nbins*LJ_TABLE_NCOEF > INT32_MAX)
+  {
+    LOG_PRINT(LOG_ERROR,"Error : cannot tabulate the pair potentials with %d bins between %lf and %lf nm\n",nbins,rmin,cutoff);
+    exit(-1);
+  }
+
+  LJ_TABLE* tab = malloc(sizeof(LJ_TABLE));
+
+  tab->ntypes = ntypes;
+  tab->nbins  = nbins;
+  tab->s0     = rmin*rmin;
+  tab->s1     = cutoff*cutoff;
+  tab->invh   = (double) nbins/(tab->s1 - tab->s0);
+  tab->coef   = calloc((size_t)ntypes*ntypes*nbins*LJ_TABLE_NCOEF,sizeof(double));
+  tab->pot    = calloc((size_t)ntypes*ntypes,sizeof(PAIR_POTENTIAL));
+  tab->par    = calloc((size_t)ntypes*ntypes,sizeof(void*));
+  tab->owned  = NULL;
+
+  return tab;
+}
+
+/**
+ * @brief Frees the tables
+ *
+ * @param tab The tables
+ */
+void lj_table_free(LJ_TABLE* tab)
+{
+  free(tab->coef);
+  free(tab->pot);
+  free(tab->par);
+  free(tab->owned);
+  free(tab);
+}
+
+/**
+ * @brief Tabulates a pair potential for the couples of species (a,b) and (b,a).
+ *
+ * The derivative of the energy with respect to r^2 is -(F/r)/2 ; the one of F/r is obtained by central differences.
+ *
+ * @param tab The tables
+ * @param a,b The two species
+ * @param pot The potential, evaluated at the ends of the bins, and by the kernels for the pairs closer than rmin
+ * @param par Parameters passed to pot, kept by the tables : they have to live as long as them
+ */
+void lj_table_set_pair(LJ_TABLE* tab, uint32_t a, uint32_t b, PAIR_POTENTIAL pot, const void* par)
+{
+  const uint32_t nb = tab->nbins;
+  const double h = 1.0/tab->invh;
+
+  // values and derivatives (with respect to r^2) at the nb+1 nodes
+  double *e  = malloc((nb+1)*sizeof(double));
+  double *de = malloc((nb+1)*sizeof(double));
+  double *f  = malloc((nb+1)*sizeof(double));
+  double *df = malloc((nb+1)*sizeof(double));
+
+  for(uint32_t k=0; k<=nb; k++)
+  {
+    const double s = (k<nb) ? tab->s0 + k*h : tab->s1;
+    double tmp = 0.0;
+
+    e[k] = 0.0;
+    f[k] = pot(s,par,&(e[k]));
+    de[k] = -0.5*f[k];
+
+    // central differences inside, backward at the cutoff
+    const double ds = 1.0e-6*s;
+    const double fm = pot(s-ds,par,&tmp);
+    const double fp = (k<nb) ? pot(s+ds,par,&tmp) : f[k];
+    df[k] = (k<nb) ? (fp-fm)/(2.0*ds) : (fp-fm)/ds;
+  }
+
+  tab->pot[a*tab->ntypes+b] = tab->pot[b*tab->ntypes+a] = pot;
+  tab->par[a*tab->ntypes+b] = tab->par[b*tab->ntypes+a] = par;
+
+  double* ab = tab->coef + (size_t)(a*tab->ntypes+b)*nb*LJ_TABLE_NCOEF;
+  double* ba = tab->coef + (size_t)(b*tab->ntypes+a)*nb*LJ_TABLE_NCOEF;
+
+  // cubic Hermite interpolation on each bin, in the variable t in [0,1]
+  for(uint32_t k=0; k<nb; k++)
+  {
+    double* c = ab + (size_t)k*LJ_TABLE_NCOEF;
+
+    c[0] = e[k];
+    c[1] = h*de[k];
+    c[2] = 3.0*(e[k+1]-e[k]) - h*(2.0*de[k]+de[k+1]);
+    c[3] = 2.0*(e[k]-e[k+1]) + h*(de[k]+de[k+1]);
+
+    c[4] = f[k];
+    c[5] = h*df[k];
+    c[6] = 3.0*(f[k+1]-f[k]) - h*(2.0*df[k]+df[k+1]);
+    c[7] = 2.0*(f[k]-f[k+1]) + h*(df[k]+df[k+1]);
+
+    if(ba != ab)
+      for(uint32_t l=0; l<LJ_TABLE_NCOEF; l++)
+        ba[(size_t)k*LJ_TABLE_NCOEF+l] = c[l];
+  }
+
+  free(e);
+  free(de);
+  free(f);
+  free(df);
+}
+
+/// parameters of the LJ potential of one couple of species, for lj_table_set_pair
+typedef struct
+{
+  double sig, eps;
+  LJ_CUTS cuts;
+} LJ_TABLE_PAR;
+
+/// the LJ potential with switching function of \b #lj_pair as a PAIR_POTENTIAL
+static double lj_table_potential(double r2, const void* par, double* ener)
+{
+  const LJ_TABLE_PAR* p = (const LJ_TABLE_PAR*) par;
+  return lj_pair(r2,p->sig,p->eps,&(p->cuts),ener);
+}
+
+/**
+ * @brief Tabulates the Lennard-Jones potentials of all the couples of species
+ *
+ * @param sp Species table with the mixed parameters
+ * @param cuton Switching distance in nm
+ * @param cutoff Cutoff in nm, has to be finite
+ * @param nbins Number of bins of each table
+ * @return The tables, down to half of the smallest sigma_ij
+ */
+LJ_TABLE* lj_table_build(const SPECIES* sp, double cuton, double cutoff, uint32_t nbins)
+{
+  const uint32_t n = sp->n;
+
+  double sigmin = INFINITY;
+  for(uint32_t p=0; p<n*n; p++)
+    sigmin = (sp->sigij[p] < sigmin) ? sp->sigij[p] : sigmin;
+
+  LJ_TABLE* tab = lj_table_alloc(n,nbins,0.5*sigmin,cutoff);
+
+  LJ_TABLE_PAR* par = malloc((size_t)n*n*sizeof(LJ_TABLE_PAR));
+  tab->owned = par;
+
+  for(uint32_t a=0; a<n; a++)
+  {
+    for(uint32_t b=a; b<n; b++)
+    {
+      LJ_TABLE_PAR* p = par + a*n+b;
+      p->sig = sp->sigij[a*n+b];
+      p->eps = sp->epsij[a*n+b];
+      lj_init_cuts(&(p->cuts),cuton,cutoff);
+      // the nodes at the cutoff itself are evaluated
+      p->cuts.cutoff2 = INFINITY;
+      lj_table_set_pair(tab,a,b,&lj_table_potential,p);
+    }
+  }
+
+  return tab;
+}
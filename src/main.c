@@ -20,13 +20,21 @@
 #include <time.h>
 #include <math.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "global.h"
 #include "tools.h"
 #include "rand.h"
 #include "io.h"
 #include "parsing.h"
 #include "logger.h"
-#include "ommInterface.h"
+#include "engine.h"
+#include "evaporation.h"
+#include "batchInterface.h"
+#include "bench.h"
+#include "cpuDispatch.h"
 
 // -----------------------------------------------------------------------------------------
 
@@ -45,6 +53,9 @@ FILE *traj=NULL;
 FILE *crdfile=NULL;
 FILE *efile=NULL;
 
+// pointer to the function used for saving the trajectory
+void (*write_traj)(ATOM at[], DATA *dat, uint64_t when) = NULL;
+
 /*
  * boolean like values
  * is the stdout redirected ?
@@ -67,6 +78,7 @@ LOG_LEVELS LOG_SEVERITY = LOG_WARNING;
 
 //prototypes of functions written in this main.c
 void run_md(DATA *dat, ATOM at[]);
+void run_md_replicas(DATA *dat, ATOM at[]);
 void help(char **argv);
 
 // -----------------------------------------------------------------------------------------
@@ -93,6 +105,9 @@ int main(int argc, char** argv)
     uint32_t i;
     char seed[128] = "";
     char inpf[FILENAME_MAX] = "";
+    char bench[128] = "";
+    uint32_t bench_nmax = 1000000;
+    char isa[16] = "auto";
 
     DATA dat ;
 
@@ -114,6 +129,21 @@ int main(int argc, char** argv)
         {
             sprintf(seed,"%s",argv[++i]);
         }
+        // run a benchmark instead of a simulation
+        else if (!strcasecmp(argv[i],"-bench"))
+        {
+            sprintf(bench,"%s",argv[++i]);
+        }
+        // largest system used by the benchmarks
+        else if (!strcasecmp(argv[i],"-bench_nmax"))
+        {
+            bench_nmax = (uint32_t) atoi(argv[++i]);
+        }
+        // force a variant of the hot kernels instead of the best one for this cpu
+        else if (!strcasecmp(argv[i],"-isa"))
+        {
+            snprintf(isa,sizeof(isa),"%s",argv[++i]);
+        }
         // reopen stdout to user specified file
         else if (!strcasecmp(argv[i],"-o"))
         {
@@ -164,6 +194,13 @@ int main(int argc, char** argv)
     //prepare log files if necessary
     init_logfiles();
 
+    // select the variant of the hot kernels for this cpu (cpuDispatch.c)
+    if (kernels_select(isa))
+    {
+        fprintf(stdout,"[Warning] Variant '%s' of the kernels not available on this cpu : using the best one available.\n\n",isa);
+        kernels_select(NULL);
+    }
+
     // Print date and some env. variables
     fprintf(stdout,"Welcome to %s ! Command line arguments succesfully parsed, now intialising parameters...\n\n",argv[0]);
     fprintf(stdout,"Logging level is : %s : see the documentation to see which .log files are generated, and what they contain.\n\n",get_loglevel_string());
@@ -172,6 +209,7 @@ int main(int argc, char** argv)
     fprintf(stdout,"HOSTNAME : %s\n",getenv("HOSTNAME"));
     fprintf(stdout,"USER : %s\n",getenv("USER"));
     fprintf(stdout,"PWD : %s\n",getenv("PWD"));
+    fprintf(stdout,"KERNELS : %s (SIMD pair kernel : %s)\n",kernels.name,kernels.lj_kernel_isa());
 
     /*
      * Random numbers can be generated by using the standard functions from the C library (no guarantee on the quality)
@@ -207,15 +245,43 @@ int main(int argc, char** argv)
     }
 #endif
     
+    // benchmarks do not need an input file : run them and exit
+    if (strlen(bench))
+    {
+        dat.nthreads = get_ncpus_affinity();
+#ifdef _OPENMP
+        omp_set_num_threads((int)dat.nthreads);
+#else
+        dat.nthreads = 1;
+#endif
+        fprintf(stdout,"\nRunning benchmark(s) '%s' with up to %d threads and %d atoms\n",bench,dat.nthreads,bench_nmax);
+        run_bench(&dat,bench,bench_nmax);
+
+        free(dat.rn);
+#ifndef STDRAND
+        free(dat.seeds);
+#endif
+        close_logfiles();
+        return EXIT_SUCCESS;
+    }
+
     // parse input file, initialise atom list
     parse_from_file(inpf,&dat,&at);
 
     // summary of parameters to output file
+#ifdef _OPENMP
+    omp_set_num_threads((int)dat.nthreads);
+    fprintf(stdout,"\nStarting program with %d threads\n\n",dat.nthreads);
+#else
+    dat.nthreads = 1;
     fprintf(stdout,"\nStarting program in sequential mode\n\n");
+#endif
 
     fprintf(stdout,"Seed   = %s \n\n",seed);
 
-    fprintf(stdout,"Using OpenMM toolkit for energy and integration\n");
+    // for a single system the engine is only known once initialised (PLATFORM AUTO), see run_md
+    if(dat.replicas > 1)
+      fprintf(stdout,"Using the native Lennard-Jones engine for %d replicas integrated in lockstep\n",dat.replicas);
 
     fprintf(stdout,"Energy      saved each %d  steps in file %s\n",io.esave,io.etitle);
     fprintf(stdout,"Trajectory  saved each %d  steps in file %s\n",io.trsave,io.trajtitle);
@@ -230,9 +296,14 @@ int main(int argc, char** argv)
     fprintf(stdout,"friction     = %lf\n",dat.friction);
     fprintf(stdout,"tstep        = %lf\n",dat.timestep);
     fprintf(stdout,"nb cuton     = %lf\n",dat.cuton);
-    fprintf(stdout,"nb cutoff    = %lf\n\n",dat.cutoff);
+    fprintf(stdout,"nb cutoff    = %lf\n",dat.cutoff);
+    fprintf(stdout,"minimiser    = %s\n",(dat.minimiser == NO_MINIM) ? "none" : minimisersName[dat.minimiser]);
+    fprintf(stdout,"precision    = %s\n\n",(dat.precision == PREC_DEFAULT) ? "default" : precisionsName[dat.precision]);
     
-    run_md(&dat,at);
+    if(dat.replicas > 1)
+      run_md_replicas(&dat,at);
+    else
+      run_md(&dat,at);
 
     fprintf(stdout,"End of program\n");
 
@@ -242,6 +313,7 @@ int main(int argc, char** argv)
     free(dat.seeds);
 #endif
     free(at);
+    species_free(&(dat.species));
 
     // closing log files is the last thing to do as errors may occur at the end
     close_logfiles();
@@ -264,20 +336,19 @@ void help(char **argv)
   fprintf(stdout,"Need at least one argument : %s -i an_input_file\n",argv[0]);
   fprintf(stdout,"optional args : -seed [a_rnd_seed] -o [output_file] -log [logging level, one of { no | err | warn | info | dbg }] \n");
   fprintf(stdout,"Example : \n %s -i input_file -seed 1330445520 -o out.txt -log info \n\n",argv[0]);
+  fprintf(stdout,"The variant of the kernels is chosen for the current cpu, for forcing one : -isa [one of { auto | sse2 | avx2 | avx512 }] \n");
+  fprintf(stdout,"For running benchmarks of the native engine instead of a simulation : %s -bench [name|all] -bench_nmax [max number of atoms]\n",argv[0]);
+  list_bench();
+  fprintf(stdout,"\n");
   fprintf(stdout,"The default logging level is 'warn' \n");
 }
 
 // -----------------------------------------------------------------------------------------
-// OPEN MM data structures and code only included after this point : more modularity
-// -----------------------------------------------------------------------------------------
-
-#include "ommInterface.h"
-
 /**
- * \brief   This function starts a Langevin or Brownian MD simulation using OpenMM
+ * \brief   This function starts a Langevin or Brownian MD simulation using OpenMM or the native engine
  *
  * \details This function is first in charge of opening all the output (coordinates, trajectory and energy) files.\n
- *          Then it runs the MD using openMM code.\n
+ *          Then it runs the MD using the ENGINE selected by the PLATFORM keyword (see engine.h).\n
  *          In the end it prints results, close the files and goes back to the function \b #main.
  *
  * \param   dat is a structure containing control parameters common to all simulations.
@@ -288,23 +359,23 @@ void run_md(DATA *dat, ATOM at[])
   
   LOG_PRINT(LOG_INFO,"Forcing energy save frequency to be the same than trajectory save frequency.\n");
   io.esave = (io.esave == io.trsave) ? io.esave : io.trsave;
+
+  // initialise the backend : OpenMM (fastest platform (usually cuda) selected automatically) or native
+  ENGINE* eng = init_engine(at,dat);
+
+  // init_engine sets the platform actually used : PLATFORM AUTO runs small systems natively
+  if(dat->platform == NATIVE)
+    fprintf(stdout,"Using the native Lennard-Jones engine for energy and integration\n");
+  else
+    fprintf(stdout,"Using OpenMM toolkit for energy and integration\n");
+
+  // atoms leaving the cluster are detected after each block and dropped from the engine
+  evaporation_init(dat);
   
-//   if(!strcasecmp(dat->method,"LANGEVIN"))
-//   {
-//     dat->integrator = LANGEVIN;
-//   }
-//   else if(!strcasecmp(dat->method,"BROWNIAN"))
-//   {
-//     dat->integrator = BROWNIAN;
-//   }
-
-  // initialise openMM code : fastest platform (usually cuda) will be selected automatically
-  MyOpenMMData* omm = init_omm(at,dat);
-  
-  fprintf(stdout,"OpenMM initialised with platform : %s\n\n",omm->platformName);
+  fprintf(stdout,"Engine initialised with platform : %s\n\n",eng->platformName);
   
   // print to info log file more infos concerning platform selected
-  infos_omm(omm);
+  eng->infos(eng->data);
   
   //open required output files
   crdfile=fopen(io.crdtitle_first,"wt");
@@ -315,8 +386,6 @@ void run_md(DATA *dat, ATOM at[])
   write_xyz(at,dat,0,crdfile);
   fclose(crdfile);
   
-  // TODO : code calling openMM for performing MD
-  
   // current simulation time
   double time = 0.;
   // current Temperature (should not vary)
@@ -324,19 +393,26 @@ void run_md(DATA *dat, ATOM at[])
   
   // energies stored in a data structure
   ENERGIES eners;
-  
-  const double minimTol = 10;
-  const int minimSteps = 0;
+
+  // number and wall time of the minimisations, for the quench throughput
+  uint32_t nminim = 0;
+  double tminim = 0.0;
   
   //write at beginning of energy file the number of steps
   uint64_t saved = dat->nsteps/io.trsave + 1 ;
   fwrite(&(saved),sizeof(uint64_t),1,efile);
   
   // do minimisation
-  OpenMM_LocalEnergyMinimizer_minimize(omm->context,minimTol,minimSteps);
+  if(dat->minimiser != NO_MINIM)
+  {
+    const double t0 = get_wtime();
+    eng->minimise(eng->data,dat->minimTol,(int)dat->minimMaxIter);
+    tminim += get_wtime()-t0;
+    nminim++;
+  }
   
   // get initial energy
-  getState_omm(omm,1,&time,&eners,&currentT,at,dat);
+  eng->getState(eng->data,1,&time,&eners,&currentT,at,dat);
   fprintf(stdout,"time (ps) \t %lf \t epot (kJ/mol) \t %lf \t ekin (kJ/mol) \t %lf \t etot (kJ/mol) \t %lf\n",time,eners.epot,eners.ekin,eners.etot);
   
   //write time and the 3 energy terms
@@ -347,16 +423,35 @@ void run_md(DATA *dat, ATOM at[])
   do
   {
     // do some steps
-    doNsteps_omm(omm,io.trsave);
+    eng->doNsteps(eng->data,io.trsave);
     
     // do minimisation
-    OpenMM_LocalEnergyMinimizer_minimize(omm->context,minimTol,minimSteps);
+    if(dat->minimiser != NO_MINIM && dat->minimBlocks)
+    {
+      const double t0 = get_wtime();
+      eng->minimise(eng->data,dat->minimTol,(int)dat->minimMaxIter);
+      tminim += get_wtime()-t0;
+      nminim++;
+    }
     
     //get time energy and coordinates
-    getState_omm(omm,1,&time,&eners,&currentT,at,dat);
+    eng->getState(eng->data,1,&time,&eners,&currentT,at,dat);
     fprintf(stdout,"time (ps) \t %lf \t epot (kJ/mol) \t %lf \t ekin (kJ/mol) \t %lf \t etot (kJ/mol) \t %lf\n",time,eners.epot,eners.ekin,eners.etot);
     steps += io.trsave;
     
+    // atoms out of the cluster
+    if(dat->evapCheck)
+    {
+      const uint32_t nnew = evaporation_update(at,dat);
+      LOG_PRINT(LOG_INFO,"Evaporation at %lf ps : %d new atoms, %d in total (%.2lf %%)\n",
+                time,nnew,dat->nevap,100.0*dat->nevap/dat->natom);
+      if(nnew > 0)
+      {
+        fprintf(stdout,"Evaporation : %d atoms left the cluster, %d of %d in total\n",nnew,dat->nevap,dat->natom);
+        eng->evaporate(eng->data,dat->evap);
+      }
+    }
+    
     //write trajectory
     write_traj(at,dat,steps);
     
@@ -364,11 +459,25 @@ void run_md(DATA *dat, ATOM at[])
     fwrite(&time,sizeof(double),1,efile);
     fwrite(&(eners.ene[0]),sizeof(double),3,efile);
     
+    // too many atoms evaporated : the headers announce the frames actually written
+    if(evaporation_stop(dat))
+    {
+      fprintf(stdout,"Evaporation : more than %.2lf %% of the atoms left the cluster, run stopped after %"PRIu64" steps\n",
+              100.0*dat->evapStop,steps);
+      saved = steps/io.trsave + 1;
+      fseek(efile,0,SEEK_SET);
+      fwrite(&(saved),sizeof(uint64_t),1,efile);
+      write_dcd_nframes((uint32_t)(steps/io.trsave));
+      break;
+    }
+    
   }while(steps < dat->nsteps);
-  
-  // END TODO
 
-  terminate_omm(omm);
+  if(nminim > 0)
+    fprintf(stdout,"Minimisations (%s) : %d quenches in %lf s, %lf minima/s\n",
+            minimisersName[dat->minimiser],nminim,tminim,nminim/tminim);
+
+  terminate_engine(eng);
   
   crdfile=fopen(io.crdtitle_last,"wt");
   //write last coordinates
@@ -376,4 +485,195 @@ void run_md(DATA *dat, ATOM at[])
   
   fclose(crdfile);
   fclose(efile);
+
+  evaporation_free(dat);
+}
+
+// -----------------------------------------------------------------------------------------
+/**
+ * \brief   Name of the output file of one replica : _rNNNN inserted before the extension, NULLFILE unchanged
+ *
+ * \param   out The name of the file of the replica
+ * \param   in The name given in the input file
+ * \param   r The replica
+ */
+static void replica_name(char out[FILENAME_MAX], const char in[], uint32_t r)
+{
+  if(!strcmp(in,NULLFILE))
+  {
+    snprintf(out,FILENAME_MAX,"%s",in);
+    return;
+  }
+
+  const char* slash = strrchr(in,'/');
+  const char* dot = strrchr(in,'.');
+  if(dot == NULL || (slash != NULL && dot < slash))
+    dot = in + strlen(in);
+
+  snprintf(out,FILENAME_MAX,"%.*s_r%04d%s",(int)(dot-in),in,r,dot);
+}
+
+// -----------------------------------------------------------------------------------------
+/**
+ * \brief   Appends the current frame of each replica to its energy and trajectory files, and averages the energies
+ *
+ * \param   bat The batched engine
+ * \param   dat Common data
+ * \param   rat Scratch atom list receiving the coordinates of each replica
+ * \param   dcd_empty For each replica, 1 until the header of its dcd has been written
+ * \param   withTraj 0 for the energies only
+ * \param   time Current time
+ * \param   mean Energies averaged over the replicas
+ */
+static void replicas_frame(MyBatchData* bat, DATA *dat, ATOM rat[], uint32_t dcd_empty[], int withTraj,
+                           double* time, ENERGIES* mean)
+{
+  char fname[FILENAME_MAX];
+  ENERGIES eners;
+
+  mean->epot = mean->ekin = mean->etot = 0.0;
+
+  for(uint32_t r=0; r<bat->nrep; r++)
+  {
+    getState_batch(bat,r,1,time,&eners,rat);
+    for(uint32_t k=0; k<3; k++)
+      mean->ene[k] += eners.ene[k]/bat->nrep;
+
+    // reopened at each frame : thousands of replicas would exceed the limit of open files
+    if(strcmp(io.etitle,NULLFILE))
+    {
+      replica_name(fname,io.etitle,r);
+      FILE* f = fopen(fname,"ab");
+      fwrite(time,sizeof(double),1,f);
+      fwrite(&(eners.ene[0]),sizeof(double),3,f);
+      fclose(f);
+    }
+
+    if(withTraj && strcmp(io.trajtitle,NULLFILE))
+    {
+      replica_name(fname,io.trajtitle,r);
+      FILE* f = fopen(fname,"ab");
+      write_dcd_to(rat,dat,f,&(dcd_empty[r]));
+      fclose(f);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------------------
+/**
+ * \brief   Same as \b #run_md for REPLICAS independent copies of the system, integrated in lockstep by the
+ *          batched native engine (see batchInterface.c)
+ *
+ * \details Each replica has its own energy and trajectory files and final coordinates, named after the ones of the
+ *          input file with _rNNNN inserted before the extension (the replicas all start from the initial coordinates,
+ *          saved once) ; energies averaged over the replicas are printed.
+ *
+ * \param   dat is a structure containing control parameters common to all simulations.
+ * \param   at[] is an array of structures ATOM containing coordinates and other variables.
+ */
+void run_md_replicas(DATA *dat, ATOM at[])
+{
+  LOG_PRINT(LOG_INFO,"Forcing energy save frequency to be the same than trajectory save frequency.\n");
+  io.esave = (io.esave == io.trsave) ? io.esave : io.trsave;
+
+  MyBatchData* bat = init_batch(at,dat);
+  const uint32_t nrep = bat->nrep;
+
+  fprintf(stdout,"Engine initialised with platform : Native (%d replicas)\n\n",nrep);
+
+  infos_batch(bat);
+
+  //write initial coordinates at step 0, the same for all the replicas
+  crdfile=fopen(io.crdtitle_first,"wt");
+  write_xyz(at,dat,0,crdfile);
+  fclose(crdfile);
+
+  char fname[FILENAME_MAX];
+  ATOM* rat = malloc(dat->natom*sizeof(ATOM));
+  memcpy(rat,at,dat->natom*sizeof(ATOM));
+  uint32_t* dcd_empty = malloc(nrep*sizeof(uint32_t));
+
+  //write at beginning of each energy file the number of steps, and empty the trajectories
+  uint64_t saved = dat->nsteps/io.trsave + 1 ;
+  for(uint32_t r=0; r<nrep; r++)
+  {
+    dcd_empty[r] = 1;
+    if(strcmp(io.etitle,NULLFILE))
+    {
+      replica_name(fname,io.etitle,r);
+      efile=fopen(fname,"wb");
+      fwrite(&(saved),sizeof(uint64_t),1,efile);
+      fclose(efile);
+    }
+    if(strcmp(io.trajtitle,NULLFILE))
+    {
+      replica_name(fname,io.trajtitle,r);
+      traj=fopen(fname,"wb");
+      fclose(traj);
+    }
+  }
+
+  double time = 0.;
+  ENERGIES eners;
+
+  uint32_t nminim = 0;
+  double tminim = 0.0;
+
+  // do minimisation
+  if(dat->minimiser != NO_MINIM)
+  {
+    const double t0 = get_wtime();
+    minimise_batch(bat,dat->minimTol,(int)dat->minimMaxIter);
+    tminim += get_wtime()-t0;
+    nminim++;
+  }
+
+  // initial energies
+  replicas_frame(bat,dat,rat,dcd_empty,0,&time,&eners);
+  fprintf(stdout,"time (ps) \t %lf \t <epot> (kJ/mol) \t %lf \t <ekin> (kJ/mol) \t %lf \t <etot> (kJ/mol) \t %lf\n",time,eners.epot,eners.ekin,eners.etot);
+
+  uint64_t steps = 0;
+  const double t0 = get_wtime();
+  do
+  {
+    // do some steps
+    doNsteps_batch(bat,io.trsave);
+
+    // do minimisation
+    if(dat->minimiser != NO_MINIM && dat->minimBlocks)
+    {
+      const double t1 = get_wtime();
+      minimise_batch(bat,dat->minimTol,(int)dat->minimMaxIter);
+      tminim += get_wtime()-t1;
+      nminim++;
+    }
+
+    steps += io.trsave;
+
+    //write trajectories and energies
+    replicas_frame(bat,dat,rat,dcd_empty,1,&time,&eners);
+    fprintf(stdout,"time (ps) \t %lf \t <epot> (kJ/mol) \t %lf \t <ekin> (kJ/mol) \t %lf \t <etot> (kJ/mol) \t %lf\n",time,eners.epot,eners.ekin,eners.etot);
+
+  }while(steps < dat->nsteps);
+
+  const double twall = get_wtime()-t0;
+  fprintf(stdout,"Replicas : %d x %"PRIu64" steps in %lf s, %le replica steps/s\n",nrep,steps,twall,nrep*(double)steps/twall);
+
+  if(nminim > 0)
+    fprintf(stdout,"Minimisations (%s) : %d quenches of %d replicas in %lf s, %lf minima/s\n",
+            minimisersName[bat->minimiser],nminim,nrep,tminim,nminim*(double)nrep/tminim);
+
+  //write last coordinates of each replica
+  for(uint32_t r=0; r<nrep; r++)
+  {
+    getState_batch(bat,r,0,&time,NULL,rat);
+    replica_name(fname,io.crdtitle_last,r);
+    crdfile=fopen(fname,"wt");
+    write_xyz(rat,dat,steps,crdfile);
+    fclose(crdfile);
+  }
+
+  terminate_batch(bat);
+  free(rat);
+  free(dcd_empty);
 }
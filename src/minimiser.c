@@ -0,0 +1,642 @@
+/**
+ * \file minimiser.c
+ *
+ * \brief Local energy minimisers shared by the engines : they only see the positions, the forces and
+ *  a function evaluating the forces (see MINIM_SYS), so that they run on the forces of the native engine
+ *  as well as on the ones of an OpenMM context.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "global.h"
+#include "minimiser.h"
+
+/**
+ * @brief Root mean square of the 3n force components, the convergence criterion of all the minimisers
+ *  (same as OpenMM_LocalEnergyMinimizer)
+ */
+double minim_force_rms(const MINIM_SYS* sys)
+{
+  double s = 0.0;
+  for(uint32_t i=0; i<sys->n; i++)
+    s += X2(sys->fx[i]) + X2(sys->fy[i]) + X2(sys->fz[i]);
+
+  return sqrt(s/(3.0*sys->n));
+}
+
+/**
+ * @brief Default parameters of FIRE, the ones of Guénolé et al. (Comput. Mater. Sci. 175, 109584, 2020)
+ *  with a timestep suited to rare gas clusters in nm, ps and amu
+ *
+ * @param p The parameters to initialise
+ * @param tolerance Root mean square force for convergence, in kJ/mol/nm
+ * @param maxIter Maximum number of iterations, 0 means until convergence
+ */
+void fire_default_params(FIRE_PARAMS* p, double tolerance, uint32_t maxIter)
+{
+  p->tolerance = tolerance;
+  p->maxIter   = maxIter;
+  p->dt0       = 0.005;
+  p->dtmax     = 0.05;
+  p->dtmin     = 1.0e-4;
+  p->maxmove   = 0.01;
+  p->ndelay    = 20;
+  p->nnegmax   = 2000;
+  p->finc      = 1.1;
+  p->fdec      = 0.5;
+  p->alpha0    = 0.25;
+  p->falpha    = 0.99;
+}
+
+/**
+ * @brief FIRE minimisation (Fast Inertial Relaxation Engine, Bitzek et al. PRL 97, 170201, 2006), in the 2.0 version :
+ *  semi-implicit Euler integration, velocities mixed with the force direction, and half a step back
+ *  when the power F.v becomes negative.
+ *
+ * Only the positions are modified : the forces of the final positions are in sys->fx,fy,fz when returning.
+ *
+ * @param sys The system to minimise
+ * @param p Parameters, see fire_default_params
+ * @param stats Number of iterations, final energy and rms force
+ */
+void fire_minimise(MINIM_SYS* sys, const FIRE_PARAMS* p, MINIM_STATS* stats)
+{
+  const uint32_t n = sys->n;
+  double *x = sys->x, *y = sys->y, *z = sys->z;
+  const double *fx = sys->fx, *fy = sys->fy, *fz = sys->fz;
+
+  double *vx = calloc(3*(size_t)n,sizeof(double));
+  double *vy = vx+n;
+  double *vz = vx+2*n;
+
+  double epot = sys->forces(sys->ctx);
+  double frms = minim_force_rms(sys);
+  uint32_t nforces = 1;
+
+  double dt = p->dt0;
+  double alpha = p->alpha0;
+  // length of the last move of the positions, h = dt unless limited by maxmove
+  double hlast = 0.0;
+  uint32_t npos = 0, nneg = 0, iter = 0;
+
+  while(frms >= p->tolerance && !(p->maxIter > 0 && iter >= p->maxIter))
+  {
+    double power = 0.0;
+    for(uint32_t i=0; i<n; i++)
+      power += fx[i]*vx[i] + fy[i]*vy[i] + fz[i]*vz[i];
+
+    if(power > 0.0)
+    {
+      npos++;
+      nneg = 0;
+      if(npos > p->ndelay)
+      {
+        dt = fmin(dt*p->finc,p->dtmax);
+        alpha *= p->falpha;
+      }
+    }
+    else
+    {
+      npos = 0;
+      nneg++;
+      if(nneg > p->nnegmax)
+        break;
+      if(iter >= p->ndelay)
+      {
+        dt = fmax(dt*p->fdec,p->dtmin);
+        alpha = p->alpha0;
+      }
+      // back to the middle of the last step, which went uphill, and restart from rest
+      for(uint32_t i=0; i<n; i++)
+      {
+        x[i] -= 0.5*hlast*vx[i];
+        y[i] -= 0.5*hlast*vy[i];
+        z[i] -= 0.5*hlast*vz[i];
+        vx[i] = vy[i] = vz[i] = 0.0;
+      }
+    }
+
+    // semi-implicit Euler, then the velocities are turned towards the forces
+    double v2 = 0.0, f2 = 0.0;
+    for(uint32_t i=0; i<n; i++)
+    {
+      const double im = dt/sys->mass[i];
+      vx[i] += im*fx[i];
+      vy[i] += im*fy[i];
+      vz[i] += im*fz[i];
+      v2 += X2(vx[i]) + X2(vy[i]) + X2(vz[i]);
+      f2 += X2(fx[i]) + X2(fy[i]) + X2(fz[i]);
+    }
+
+    const double mix = (f2 > 0.0) ? alpha*sqrt(v2/f2) : 0.0;
+    double d2max = 0.0;
+    for(uint32_t i=0; i<n; i++)
+    {
+      vx[i] = (1.0-alpha)*vx[i] + mix*fx[i];
+      vy[i] = (1.0-alpha)*vy[i] + mix*fy[i];
+      vz[i] = (1.0-alpha)*vz[i] + mix*fz[i];
+      const double d2 = X2(vx[i]) + X2(vy[i]) + X2(vz[i]);
+      d2max = (d2 > d2max) ? d2 : d2max;
+    }
+
+    // no atom moves by more than maxmove, which keeps the first iterations safe from overlapping atoms
+    const double dmax = dt*sqrt(d2max);
+    const double h = (dmax > p->maxmove) ? dt*p->maxmove/dmax : dt;
+    for(uint32_t i=0; i<n; i++)
+    {
+      x[i] += h*vx[i];
+      y[i] += h*vy[i];
+      z[i] += h*vz[i];
+    }
+    hlast = h;
+
+    epot = sys->forces(sys->ctx);
+    frms = minim_force_rms(sys);
+    nforces++;
+    iter++;
+  }
+
+  stats->iter      = iter;
+  stats->nforces   = nforces;
+  stats->epot      = epot;
+  stats->frms      = frms;
+  stats->converged = (frms < p->tolerance);
+
+  free(vx);
+}
+
+/**
+ * @brief Default parameters of L-BFGS : the usual line search parameters for quasi-Newton methods (Nocedal and Wright)
+ *
+ * @param p The parameters to initialise
+ * @param tolerance Root mean square force for convergence, in kJ/mol/nm
+ * @param maxIter Maximum number of iterations, 0 means until convergence
+ * @param history Number of corrections kept, 0 for the default of 8
+ */
+void lbfgs_default_params(LBFGS_PARAMS* p, double tolerance, uint32_t maxIter, uint32_t history)
+{
+  p->tolerance = tolerance;
+  p->maxIter   = maxIter;
+  p->history   = (history > 0) ? history : 8;
+  p->ftol      = 1.0e-4;
+  p->gtol      = 0.9;
+  p->xtol      = 1.0e-16;
+  p->epsf      = 1.0e-10;
+  p->maxfev    = 20;
+  p->maxmove   = 0.01;
+  p->maxstep   = 0.1;
+}
+
+/// positions of sys copied to the flat array v of size 3n
+static void minim_get_pos(const MINIM_SYS* sys, double v[])
+{
+  const uint32_t n = sys->n;
+  memcpy(v,    sys->x,n*sizeof(double));
+  memcpy(v+n,  sys->y,n*sizeof(double));
+  memcpy(v+2*n,sys->z,n*sizeof(double));
+}
+
+/// positions of sys set to x0+stp*d, flat arrays of size 3n
+static void minim_set_pos(MINIM_SYS* sys, const double x0[], double stp, const double d[])
+{
+  const uint32_t n = sys->n;
+  for(uint32_t i=0; i<n; i++)
+  {
+    sys->x[i] = x0[i]     + stp*d[i];
+    sys->y[i] = x0[i+n]   + stp*d[i+n];
+    sys->z[i] = x0[i+2*n] + stp*d[i+2*n];
+  }
+}
+
+/// gradient (minus the forces) of sys copied to the flat array g of size 3n
+static void minim_get_grad(const MINIM_SYS* sys, double g[])
+{
+  const uint32_t n = sys->n;
+  for(uint32_t i=0; i<n; i++)
+  {
+    g[i]     = -sys->fx[i];
+    g[i+n]   = -sys->fy[i];
+    g[i+2*n] = -sys->fz[i];
+  }
+}
+
+static double minim_dot(uint32_t m, const double a[], const double b[])
+{
+  double s = 0.0;
+  for(uint32_t i=0; i<m; i++)
+    s += a[i]*b[i];
+  return s;
+}
+
+/// largest displacement of an atom along the flat direction d of size 3n
+static double minim_max_atom(uint32_t n, const double d[])
+{
+  double d2max = 0.0;
+  for(uint32_t i=0; i<n; i++)
+  {
+    const double d2 = X2(d[i]) + X2(d[i+n]) + X2(d[i+2*n]);
+    d2max = (d2 > d2max) ? d2 : d2max;
+  }
+  return sqrt(d2max);
+}
+
+/**
+ * @brief Safeguarded step of the More-Thuente line search (dcstep of MINPACK-2) : computes a new trial step
+ *  from a cubic or quadratic interpolation, and updates the interval [stx,sty] which contains a step
+ *  satisfying the strong Wolfe conditions once brackt is set.
+ *
+ * stx,fx,dx : best step so far, its function value and derivative ; sty,fy,dy : other end of the interval ;
+ * stp,fp,dp : current step ; the new trial step is returned in *stp
+ */
+static void mt_step(double* stx, double* fx, double* dx,
+                    double* sty, double* fy, double* dy,
+                    double* stp, double fp, double dp,
+                    uint8_t* brackt, double stpmin, double stpmax)
+{
+  const double sgnd = dp*((*dx > 0.0) ? 1.0 : -1.0);
+  double stpf;
+
+  if(fp > *fx)
+  {
+    // higher function value : the minimum is bracketed, closest of the cubic and quadratic steps
+    const double theta = 3.0*(*fx-fp)/(*stp-*stx) + *dx + dp;
+    const double s = fmax(fabs(theta),fmax(fabs(*dx),fabs(dp)));
+    double gamma = s*sqrt(X2(theta/s) - (*dx/s)*(dp/s));
+    if(*stp < *stx)
+      gamma = -gamma;
+    const double p = (gamma - *dx) + theta;
+    const double q = ((gamma - *dx) + gamma) + dp;
+    const double stpc = *stx + (p/q)*(*stp-*stx);
+    const double stpq = *stx + ((*dx/((*fx-fp)/(*stp-*stx) + *dx))/2.0)*(*stp-*stx);
+    if(fabs(stpc-*stx) < fabs(stpq-*stx))
+      stpf = stpc;
+    else
+      stpf = stpc + (stpq-stpc)/2.0;
+    *brackt = 1;
+  }
+  else if(sgnd < 0.0)
+  {
+    // lower value and derivatives of opposite signs : bracketed, farthest of the cubic and secant steps
+    const double theta = 3.0*(*fx-fp)/(*stp-*stx) + *dx + dp;
+    const double s = fmax(fabs(theta),fmax(fabs(*dx),fabs(dp)));
+    double gamma = s*sqrt(X2(theta/s) - (*dx/s)*(dp/s));
+    if(*stp > *stx)
+      gamma = -gamma;
+    const double p = (gamma - dp) + theta;
+    const double q = ((gamma - dp) + gamma) + *dx;
+    const double stpc = *stp + (p/q)*(*stx-*stp);
+    const double stpq = *stp + (dp/(dp-*dx))*(*stx-*stp);
+    stpf = (fabs(stpc-*stp) > fabs(stpq-*stp)) ? stpc : stpq;
+    *brackt = 1;
+  }
+  else if(fabs(dp) < fabs(*dx))
+  {
+    // lower value, same sign and decreasing derivative : the cubic step is used only if it goes in the right direction
+    const double theta = 3.0*(*fx-fp)/(*stp-*stx) + *dx + dp;
+    const double s = fmax(fabs(theta),fmax(fabs(*dx),fabs(dp)));
+    double gamma = s*sqrt(fmax(0.0,X2(theta/s) - (*dx/s)*(dp/s)));
+    if(*stp > *stx)
+      gamma = -gamma;
+    const double p = (gamma - dp) + theta;
+    const double q = (gamma + (*dx-dp)) + gamma;
+    const double r = p/q;
+    double stpc;
+    if(r < 0.0 && gamma != 0.0)
+      stpc = *stp + r*(*stx-*stp);
+    else if(*stp > *stx)
+      stpc = stpmax;
+    else
+      stpc = stpmin;
+    const double stpq = *stp + (dp/(dp-*dx))*(*stx-*stp);
+
+    if(*brackt)
+    {
+      stpf = (fabs(stpc-*stp) < fabs(stpq-*stp)) ? stpc : stpq;
+      if(*stp > *stx)
+        stpf = fmin(*stp + 0.66*(*sty-*stp),stpf);
+      else
+        stpf = fmax(*stp + 0.66*(*sty-*stp),stpf);
+    }
+    else
+    {
+      stpf = (fabs(stpc-*stp) > fabs(stpq-*stp)) ? stpc : stpq;
+      stpf = fmax(stpmin,fmin(stpmax,stpf));
+    }
+  }
+  else
+  {
+    // lower value, same sign and the derivative does not decrease : cubic step towards sty, or to the bounds
+    if(*brackt)
+    {
+      const double theta = 3.0*(fp-*fy)/(*sty-*stp) + *dy + dp;
+      const double s = fmax(fabs(theta),fmax(fabs(*dy),fabs(dp)));
+      double gamma = s*sqrt(X2(theta/s) - (*dy/s)*(dp/s));
+      if(*stp > *sty)
+        gamma = -gamma;
+      const double p = (gamma - dp) + theta;
+      const double q = ((gamma - dp) + gamma) + *dy;
+      stpf = *stp + (p/q)*(*sty-*stp);
+    }
+    else
+      stpf = (*stp > *stx) ? stpmax : stpmin;
+  }
+
+  // update of the interval
+  if(fp > *fx)
+  {
+    *sty = *stp;
+    *fy  = fp;
+    *dy  = dp;
+  }
+  else
+  {
+    if(sgnd < 0.0)
+    {
+      *sty = *stx;
+      *fy  = *fx;
+      *dy  = *dx;
+    }
+    *stx = *stp;
+    *fx  = fp;
+    *dx  = dp;
+  }
+
+  *stp = stpf;
+}
+
+/**
+ * @brief More-Thuente line search (dcsrch of MINPACK-2) along d from the flat positions x0 of energy f0 and gradient g :
+ *  looks for a step satisfying the strong Wolfe conditions.
+ *
+ * @return 1 if the conditions are satisfied, 0 otherwise ; in both cases sys is left at the best step found,
+ *  whose energy and gradient are in *f and g, and the step in *stp
+ */
+static int32_t mt_search(MINIM_SYS* sys, const LBFGS_PARAMS* p,
+                         const double x0[], const double d[], double* f, double g[],
+                         double* stp, double stpmax, uint32_t* nfev)
+{
+  const uint32_t m = 3*sys->n;
+  const double xtrapl = 1.1, xtrapu = 4.0;
+  const double stpmin = 0.0;
+
+  const double finit = *f;
+  const double ginit = minim_dot(m,g,d);
+  const double gtest = p->ftol*ginit;
+
+  uint8_t brackt = 0, stage = 1;
+  double width  = stpmax-stpmin;
+  double width1 = 2.0*width;
+  double stx = 0.0, fx = finit, gx = ginit;
+  double sty = 0.0, fy = finit, gy = ginit;
+  double stmin = 0.0, stmax = *stp + xtrapu*(*stp);
+
+  int32_t ok = 0;
+  double fp = finit;
+
+  for(uint32_t k=0; k<p->maxfev; k++)
+  {
+    minim_set_pos(sys,x0,*stp,d);
+    fp = sys->forces(sys->ctx);
+    minim_get_grad(sys,g);
+    (*nfev)++;
+    const double gp = minim_dot(m,g,d);
+
+    const double ftest = finit + (*stp)*gtest;
+    if(stage == 1 && fp <= ftest && gp >= 0.0)
+      stage = 2;
+
+    // strong Wolfe conditions ; close to the minimum the energy differences are lost in rounding errors
+    //  and the approximate Wolfe conditions of Hager and Zhang, which rely on the derivative only, are used instead
+    if((fp <= ftest && fabs(gp) <= p->gtol*(-ginit))
+       || (fp <= finit + p->epsf*fabs(finit) && gp >= p->gtol*ginit && gp <= (2.0*p->ftol-1.0)*ginit))
+    {
+      ok = 1;
+      break;
+    }
+    // no progress possible : rounding errors, interval too small, or at the bounds of the step
+    if((brackt && (*stp <= stmin || *stp >= stmax)) || (brackt && stmax-stmin <= p->xtol*stmax)
+       || (*stp == stpmax && fp <= ftest && gp <= gtest) || (*stp == stpmin && (fp > ftest || gp >= gtest)))
+      break;
+
+    // in the first stage a modified function is used as long as it is not known that a step satisfies the sufficient decrease
+    if(stage == 1 && fp <= fx && fp > ftest)
+    {
+      double fm  = fp - (*stp)*gtest;
+      double fxm = fx - stx*gtest, fym = fy - sty*gtest;
+      double gm  = gp - gtest;
+      double gxm = gx - gtest, gym = gy - gtest;
+      mt_step(&stx,&fxm,&gxm,&sty,&fym,&gym,stp,fm,gm,&brackt,stmin,stmax);
+      fx = fxm + stx*gtest;
+      fy = fym + sty*gtest;
+      gx = gxm + gtest;
+      gy = gym + gtest;
+    }
+    else
+      mt_step(&stx,&fx,&gx,&sty,&fy,&gy,stp,fp,gp,&brackt,stmin,stmax);
+
+    // bisection if the interval does not shrink enough
+    if(brackt)
+    {
+      if(fabs(sty-stx) >= 0.66*width1)
+        *stp = stx + 0.5*(sty-stx);
+      width1 = width;
+      width  = fabs(sty-stx);
+      stmin  = fmin(stx,sty);
+      stmax  = fmax(stx,sty);
+    }
+    else
+    {
+      stmin = *stp + xtrapl*(*stp-stx);
+      stmax = *stp + xtrapu*(*stp-stx);
+    }
+
+    *stp = fmax(stpmin,fmin(stpmax,*stp));
+    if((brackt && (*stp <= stmin || *stp >= stmax)) || (brackt && stmax-stmin <= p->xtol*stmax))
+      *stp = stx;
+  }
+
+  // back to the best step if the last one was not accepted
+  if(!ok && fp > fx)
+  {
+    *stp = stx;
+    minim_set_pos(sys,x0,*stp,d);
+    fp = sys->forces(sys->ctx);
+    minim_get_grad(sys,g);
+    (*nfev)++;
+  }
+
+  *f = fp;
+  return ok;
+}
+
+/**
+ * @brief L-BFGS minimisation (Nocedal, Math. Comp. 35, 773, 1980) with the More-Thuente line search
+ *  (ACM TOMS 20, 286, 1994) : converges to tight tolerances (1e-6 kJ/mol/nm) in far fewer force evaluations than FIRE.
+ *
+ * The history is cleared when the line search fails, and the minimisation stops if it fails again
+ * along the steepest descent direction.
+ * Only the positions are modified : the forces of the final positions are in sys->fx,fy,fz when returning.
+ *
+ * @param sys The system to minimise
+ * @param p Parameters, see lbfgs_default_params
+ * @param stats Number of iterations, final energy and rms force
+ */
+void lbfgs_minimise(MINIM_SYS* sys, const LBFGS_PARAMS* p, MINIM_STATS* stats)
+{
+  const uint32_t n = sys->n;
+  const uint32_t m = 3*n;
+  const uint32_t hmax = p->history;
+
+  double *work  = malloc((5+2*(size_t)hmax)*m*sizeof(double) + 2*(size_t)hmax*sizeof(double));
+  double *x     = work;
+  double *x0    = x+m;
+  double *g     = x0+m;
+  double *g0    = g+m;
+  double *d     = g0+m;
+  double *s     = d+m;
+  double *y     = s+(size_t)hmax*m;
+  double *rho   = y+(size_t)hmax*m;
+  double *alpha = rho+hmax;
+
+  double f = sys->forces(sys->ctx);
+  minim_get_pos(sys,x);
+  minim_get_grad(sys,g);
+  double frms = minim_force_rms(sys);
+  uint32_t nfev = 1;
+
+  uint32_t iter = 0, nhist = 0, newest = 0;
+  uint8_t restarted = 1;
+
+  // steepest descent scaled for the first step
+  for(uint32_t i=0; i<m; i++)
+    d[i] = -g[i];
+
+  while(frms >= p->tolerance && !(p->maxIter > 0 && iter >= p->maxIter))
+  {
+    memcpy(x0,x,m*sizeof(double));
+    memcpy(g0,g,m*sizeof(double));
+
+    const double dmax = minim_max_atom(n,d);
+    if(!(dmax > 0.0))
+      break;
+    const double stpmax = p->maxstep/dmax;
+    double stp = restarted ? p->maxmove/dmax : fmin(1.0,stpmax);
+
+    const int32_t ok = mt_search(sys,p,x0,d,&f,g,&stp,stpmax,&nfev);
+    minim_get_pos(sys,x);
+    frms = minim_force_rms(sys);
+    iter++;
+
+    if(!ok)
+    {
+      // the history is cleared, and the minimisation stops after a failure along the steepest descent
+      if(restarted)
+        break;
+      nhist = 0;
+      restarted = 1;
+      for(uint32_t i=0; i<m; i++)
+        d[i] = -g[i];
+      continue;
+    }
+
+    // new correction pair, kept only if the curvature is positive
+    double* sk = s+(size_t)newest*m;
+    double* yk = y+(size_t)newest*m;
+    for(uint32_t i=0; i<m; i++)
+    {
+      sk[i] = x[i]-x0[i];
+      yk[i] = g[i]-g0[i];
+    }
+    const double ys = minim_dot(m,yk,sk);
+    const double yy = minim_dot(m,yk,yk);
+    if(ys > 1.0e-10*sqrt(yy*minim_dot(m,sk,sk)))
+    {
+      rho[newest] = 1.0/ys;
+      newest = (newest+1)%hmax;
+      nhist = (nhist < hmax) ? nhist+1 : hmax;
+    }
+
+    if(nhist == 0)
+    {
+      restarted = 1;
+      for(uint32_t i=0; i<m; i++)
+        d[i] = -g[i];
+      continue;
+    }
+    restarted = 0;
+
+    // two-loop recursion : d = -H g, with the initial inverse Hessian scaled by y.s/y.y of the last pair
+    for(uint32_t i=0; i<m; i++)
+      d[i] = -g[i];
+
+    uint32_t k = newest;
+    for(uint32_t h=0; h<nhist; h++)
+    {
+      k = (k+hmax-1)%hmax;
+      alpha[k] = rho[k]*minim_dot(m,s+(size_t)k*m,d);
+      const double* yh = y+(size_t)k*m;
+      for(uint32_t i=0; i<m; i++)
+        d[i] -= alpha[k]*yh[i];
+    }
+
+    const uint32_t last = (newest+hmax-1)%hmax;
+    const double* yl = y+(size_t)last*m;
+    const double gamma = 1.0/(rho[last]*minim_dot(m,yl,yl));
+    for(uint32_t i=0; i<m; i++)
+      d[i] *= gamma;
+
+    for(uint32_t h=0; h<nhist; h++)
+    {
+      const double beta = rho[k]*minim_dot(m,y+(size_t)k*m,d);
+      const double* sh = s+(size_t)k*m;
+      for(uint32_t i=0; i<m; i++)
+        d[i] += sh[i]*(alpha[k]-beta);
+      k = (k+1)%hmax;
+    }
+  }
+
+  stats->iter      = iter;
+  stats->nforces   = nfev;
+  stats->epot      = f;
+  stats->frms      = frms;
+  stats->converged = (frms < p->tolerance);
+
+  free(work);
+}
+
+/**
+ * @brief Minimisation of sys with the FIRE or L-BFGS algorithm, with their default parameters
+ *
+ * @param sys The system to minimise
+ * @param algo FIRE or LBFGS
+ * @param tolerance Root mean square force for convergence, in kJ/mol/nm
+ * @param maxIter Maximum number of iterations, 0 means until convergence
+ * @param history Number of corrections kept by L-BFGS
+ * @param stats Number of iterations, final energy and rms force
+ */
+void minim_run(MINIM_SYS* sys, MINIMISERS algo, double tolerance, uint32_t maxIter, uint32_t history, MINIM_STATS* stats)
+{
+  if(algo == LBFGS)
+  {
+    LBFGS_PARAMS p;
+    lbfgs_default_params(&p,tolerance,maxIter,history);
+    lbfgs_minimise(sys,&p,stats);
+  }
+  else
+  {
+    FIRE_PARAMS p;
+    fire_default_params(&p,tolerance,maxIter);
+    fire_minimise(sys,&p,stats);
+  }
+}
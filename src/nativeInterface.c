@@ -0,0 +1,993 @@
+/**
+ * \file nativeInterface.c
+ *
+ * \brief Built-in Lennard-Jones engine : an alternative to OpenMM for small clusters, selected with PLATFORM NATIVE
+ *
+ * \details The integrators reproduce the ones of OpenMM :
+ *          \li LANGEVIN : leap-frog Langevin integrator, as OpenMM_LangevinIntegrator
+ *          \li BROWNIAN : Euler-Maruyama overdamped Langevin integrator, as OpenMM_BrownianIntegrator
+ *
+ *          and two integrators are only implemented here :
+ *          \li BAOAB : BAOAB splitting of the Langevin dynamics (Leimkuhler and Matthews)
+ *          \li BROWNIAN_LM : Leimkuhler-Matthews overdamped Langevin integrator, averaging the noise of two successive steps
+ *
+ *          With REORDER the atoms are stored in the order of a space filling curve, perm giving their index
+ *          in the ATOM list used by the rest of the code (outputs, energies of other positions).
+ *          With EVAPORATION the evaporated atoms are moved after the natom integrated ones, where they keep the
+ *          position at which they left the cluster.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "global.h"
+#include "logger.h"
+#include "rand.h"
+#include "cpuDispatch.h"
+#include "minimiser.h"
+#include "nativeInterface.h"
+
+// -----------------------------------------------------------------------------
+//              COMPUTE FORCES AND ENERGY FOR THE CURRENT POSITIONS
+// -----------------------------------------------------------------------------
+static void forces_native(MyNativeData* nat)
+{
+  if(nat->nlist != NULL)
+  {
+    neighlist_update(nat->nlist,nat->x,nat->y,nat->z);
+    if(nat->xyzt != NULL)
+    {
+      lj_pack_mixed(nat->natom,nat->x,nat->y,nat->z,nat->type,nat->xyzt);
+      nat->epot = lj_forces_neighlist_mixed(nat->nlist,nat->natom,nat->xyzt,nat->sp,&(nat->cuts),
+                                            nat->f4buf,nat->fx,nat->fy,nat->fz,nat->nthreads);
+    }
+    else if(nat->domains != NULL)
+    {
+      neighdomains_update(nat->domains,nat->nlist,nat->type);
+      nat->epot = lj_forces_neighdomains(nat->domains,nat->natom,nat->x,nat->y,nat->z,
+                                         nat->sp,&(nat->cuts),nat->table,
+                                         nat->fx,nat->fy,nat->fz);
+    }
+    else
+      nat->epot = lj_forces_neighlist_omp(nat->nlist,nat->natom,nat->x,nat->y,nat->z,
+                                          nat->type,nat->sp,&(nat->cuts),nat->table,
+                                          nat->fx,nat->fy,nat->fz,
+                                          nat->tbuf,nat->nthreads);
+  }
+  else if(nat->grid != NULL)
+  {
+    cellgrid_build(nat->grid,nat->natom,nat->x,nat->y,nat->z);
+    nat->epot = lj_forces_cellgrid_omp(nat->grid,nat->natom,nat->x,nat->y,nat->z,
+                                       nat->type,nat->sp,&(nat->cuts),
+                                       nat->fx,nat->fy,nat->fz,
+                                       nat->tbuf,nat->nthreads);
+  }
+  else
+  {
+    nat->epot = lj_forces_allpairs_tiled(nat->natom,nat->x,nat->y,nat->z,
+                                         nat->type,nat->sp,&(nat->cuts),
+                                         nat->fx,nat->fy,nat->fz,
+                                         nat->tbuf,nat->nthreads);
+  }
+}
+
+// -----------------------------------------------------------------------------
+//        SORT THE ATOMS IN MEMORY ALONG A SPACE FILLING CURVE
+// -----------------------------------------------------------------------------
+/// a[k] = a[order[k]] for the arrays of 1 or 3 blocks of n values
+static void reorder_array(uint32_t n, uint32_t nblocks, const uint32_t order[], double a[], double tmp[])
+{
+  for(uint32_t b=0; b<nblocks; b++)
+  {
+    double* ab = a + (size_t)b*n;
+    for(uint32_t k=0; k<n; k++)
+      tmp[k] = ab[order[k]];
+    memcpy(ab,tmp,n*sizeof(double));
+  }
+}
+
+/// all the per atom arrays carried from one step to the next : a[k] = a[order[k]] for the n first atoms, lists invalidated
+static void permute_native(MyNativeData* nat, const uint32_t order[], double tmp[])
+{
+  const uint32_t n = nat->natom;
+
+  reorder_array(n,1,order,nat->x,tmp);
+  reorder_array(n,1,order,nat->y,tmp);
+  reorder_array(n,1,order,nat->z,tmp);
+  reorder_array(n,1,order,nat->vx,tmp);
+  reorder_array(n,1,order,nat->vy,tmp);
+  reorder_array(n,1,order,nat->vz,tmp);
+  reorder_array(n,1,order,nat->fx,tmp);
+  reorder_array(n,1,order,nat->fy,tmp);
+  reorder_array(n,1,order,nat->fz,tmp);
+  reorder_array(n,1,order,nat->mass,tmp);
+  if(nat->gprev != NULL)
+    reorder_array(n,3,order,nat->gprev,tmp);
+
+  uint32_t* itmp = (uint32_t*) tmp;
+  for(uint32_t k=0; k<n; k++)
+    itmp[k] = nat->type[order[k]];
+  memcpy(nat->type,itmp,n*sizeof(uint32_t));
+  for(uint32_t k=0; k<n; k++)
+    itmp[k] = nat->perm[order[k]];
+  memcpy(nat->perm,itmp,n*sizeof(uint32_t));
+
+  if(nat->nlist != NULL)
+    neighlist_invalidate(nat->nlist);
+  if(nat->ilist != NULL)
+    neighlist_invalidate(nat->ilist);
+  if(nat->elist != NULL)
+    neighlist_invalidate(nat->elist);
+}
+
+/*
+ * Atoms close in space end up scattered in memory as they diffuse, so that the neighbours gathered by the pair
+ * kernels are spread over many cache lines and pages : sorting them along a space filling curve restores the locality.
+ * All the per atom arrays carried from one step to the next are permuted, and the lists are rebuilt.
+ */
+static void reorder_native(MyNativeData* nat)
+{
+  const uint32_t n = nat->natom;
+  uint32_t* order = malloc(n*sizeof(uint32_t));
+  double* tmp = malloc(n*sizeof(double));
+
+  sfc_order(n,nat->x,nat->y,nat->z,nat->reorder,order);
+  permute_native(nat,order,tmp);
+
+  nat->sinceReorder = 0;
+  nat->nreorder++;
+
+  free(tmp);
+  free(order);
+}
+
+/* --------------------------------------------------------------------------
+ *                      INITIALIZE NATIVE DATA STRUCTURES
+ * --------------------------------------------------------------------------
+ */
+MyNativeData* init_native(ATOM atoms[], DATA* dat)
+{
+  MyNativeData* nat = (MyNativeData*)malloc(sizeof(MyNativeData));
+
+  const uint32_t n = dat->natom;
+  nat->natom = n;
+
+  nat->x  = calloc(n,sizeof(double));
+  nat->y  = calloc(n,sizeof(double));
+  nat->z  = calloc(n,sizeof(double));
+  nat->vx = calloc(n,sizeof(double));
+  nat->vy = calloc(n,sizeof(double));
+  nat->vz = calloc(n,sizeof(double));
+  nat->fx = calloc(n,sizeof(double));
+  nat->fy = calloc(n,sizeof(double));
+  nat->fz = calloc(n,sizeof(double));
+  nat->mass = calloc(n,sizeof(double));
+  nat->type = calloc(n,sizeof(uint32_t));
+  nat->sp   = &(dat->species);
+  nat->gauss = calloc(3*n,sizeof(double));
+  nat->gprev = NULL;
+
+  nat->integrator = (INTEGRATORS) dat->integrator;
+  nat->T        = dat->T;
+  nat->friction = dat->friction;
+  nat->timestep = dat->timestep;
+  nat->time     = 0.0;
+  nat->minimiser = (MINIMISERS) dat->minimiser;
+  nat->minimHistory = dat->minimHistory;
+  nat->dat      = dat;
+
+  // the first thread accumulates directly in fx,fy,fz
+  nat->nthreads = (dat->nthreads > 0) ? dat->nthreads : 1;
+  nat->tbuf = (nat->nthreads > 1) ? malloc((size_t)(nat->nthreads-1)*3*n*sizeof(double)) : NULL;
+
+  if((nat->integrator == BROWNIAN || nat->integrator == BROWNIAN_LM) && !(nat->friction > 0.0))
+  {
+    LOG_PRINT(LOG_ERROR,"Error : the Brownian integrator requires a strictly positive friction (%lf given)\n",nat->friction);
+    exit(-1);
+  }
+
+  lj_init_cuts(&(nat->cuts),dat->cuton,dat->cutoff);
+  if(nat->cuts.useSwitch)
+    LOG_PRINT(LOG_INFO," User specified cuton = %lf and cutoff = %lf for the native engine.\n",dat->cuton,dat->cutoff);
+
+  /*
+   * with a cutoff the pair search uses Verlet neighbour lists, rebuilt when an atom moved by more than skin/2,
+   * or if the skin is 0 a hashed cell grid rebuilt at each step, cells being of the size of the cutoff.
+   * Without cutoff, or for small systems for which maintaining the lists costs more than visiting all the pairs,
+   * the tiled all-pairs kernel is used (the tables and the mixed precision being only available with the lists).
+   * In a periodic box (NONBOND PBC) the lists are always used, their kernels applying the minimum image convention.
+   */
+  const uint8_t needsList = (dat->tableBins > 0) || (dat->precision == SINGLE) || (dat->precision == MIXED) || dat->pbc;
+  nat->grid  = NULL;
+  nat->nlist = NULL;
+  double skin = dat->skin;
+  if(dat->pbc && !(skin > 0.0))
+  {
+    LOG_PRINT(LOG_WARNING,"Warning : periodic boxes require neighbour lists : SKIN set to 0.1 nm\n");
+    skin = 0.1;
+  }
+  if(isfinite(dat->cutoff) && (n > LJ_ALLPAIRS_NMAX || needsList))
+  {
+    if(skin > 0.0)
+      nat->nlist = neighlist_alloc(n,dat->cutoff,skin);
+    else
+      nat->grid = cellgrid_alloc(n,dat->cutoff);
+  }
+  if(dat->pbc)
+  {
+    neighlist_set_box(nat->nlist,dat->box);
+    LOG_PRINT(LOG_INFO," Periodic box of %lf x %lf x %lf nm for the native engine.\n",dat->box[0],dat->box[1],dat->box[2]);
+  }
+
+  // the tables are interpolated by the neighbour list kernels only, without periodic images
+  nat->table = NULL;
+  if(dat->tableBins > 0)
+  {
+    if(dat->pbc)
+      LOG_PRINT(LOG_WARNING,"Warning : tabulated potentials are not available in a periodic box : using the analytic potential\n");
+    else if(nat->nlist != NULL)
+      nat->table = lj_table_build(nat->sp,dat->cuton,dat->cutoff,dat->tableBins);
+    else
+      LOG_PRINT(LOG_WARNING,"Warning : tabulated potentials require a cutoff and a non zero SKIN : using the analytic potential\n");
+  }
+
+  /*
+   * r-RESPA : the inner part of the interaction, switched off between SPLIT-HEAL and SPLIT with the same switching
+   * function than the cutoff, is integrated with the timestep and the remaining outer part every respaSteps steps
+   */
+  nat->respaSteps = (dat->respaSteps > 1) ? dat->respaSteps : 0;
+  lj_init_cuts(&(nat->icuts),dat->respaSplit-dat->respaHeal,dat->respaSplit);
+  nat->ilist = NULL;
+  nat->fin   = NULL;
+  if(nat->respaSteps)
+  {
+    if(nat->integrator != BAOAB)
+    {
+      LOG_PRINT(LOG_ERROR,"Error : RESPA requires METHOD BAOAB (with FRICTION 0 for constant energy dynamics)\n");
+      exit(-1);
+    }
+    if(isfinite(dat->cuton) && dat->respaSplit > dat->cuton)
+    {
+      LOG_PRINT(LOG_ERROR,"Error : RESPA SPLIT (%lf nm) should not be larger than CUTON (%lf nm)\n",dat->respaSplit,dat->cuton);
+      exit(-1);
+    }
+    nat->ilist = neighlist_alloc(n,dat->respaSplit,(dat->skin > 0.0) ? dat->skin : 0.1);
+    if(dat->pbc)
+      neighlist_set_box(nat->ilist,dat->box);
+    nat->fin   = malloc(6*(size_t)n*sizeof(double));
+  }
+
+  // adaptive timestep, per step : not with the outer steps of r-RESPA
+  adapt_init(&(nat->adapt),dat);
+  if(nat->adapt.maxdisp > 0.0 && nat->respaSteps)
+  {
+    LOG_PRINT(LOG_ERROR,"Error : ADAPTIVE and RESPA cannot be used together\n");
+    exit(-1);
+  }
+
+  // single and mixed precision : pair terms in single precision, everything else (sums, integration) in double precision
+  nat->xyzt  = NULL;
+  nat->f4buf = NULL;
+  if(dat->precision == SINGLE || dat->precision == MIXED)
+  {
+    if(nat->nlist != NULL && nat->table == NULL && !dat->pbc)
+    {
+      nat->xyzt  = malloc(4*(size_t)n*sizeof(float));
+      nat->f4buf = malloc((size_t)nat->nthreads*4*n*sizeof(float));
+    }
+    else
+      LOG_PRINT(LOG_WARNING,"Warning : PRECISION %s requires neighbour lists and the analytic potential without periodic box : "
+                "using double precision\n",
+                precisionsName[dat->precision]);
+  }
+
+  /*
+   * half list split in one domain of consecutive rows per thread : each thread accumulates the forces of its rows in
+   *  local arrays holding its atoms and their neighbours owned by other threads, then sums the forces of its own atoms ;
+   *  no full size buffer per thread, which the atoms sorted in space (REORDER) keep the halos thin
+   */
+  nat->domains = NULL;
+  if(dat->domains)
+  {
+    if(nat->nlist != NULL && nat->xyzt == NULL)
+    {
+      nat->domains = neighdomains_alloc(n,nat->nthreads);
+      // the buffers are still used by the inner forces of r-RESPA
+      if(nat->ilist == NULL)
+      {
+        free(nat->tbuf);
+        nat->tbuf = NULL;
+      }
+    }
+    else
+      LOG_PRINT(LOG_WARNING,"Warning : DOMAINS requires neighbour lists in double precision : using the per thread buffers\n");
+  }
+
+  /*
+   * adaptive octree instead of the hashed cell grid for building the lists : the leaves are split by occupancy, so that
+   *  a dense droplet and the sparse cloud of its evaporated atoms both end up in leaves of a few atoms, and the octree
+   *  is updated incrementally from one build to the next, the atoms moving to another leaf only when leaving their own
+   */
+  if(dat->octree)
+  {
+    if(nat->nlist != NULL && !dat->pbc)
+    {
+      neighlist_set_octree(nat->nlist);
+      if(nat->ilist != NULL)
+        neighlist_set_octree(nat->ilist);
+    }
+    else
+      LOG_PRINT(LOG_WARNING,"Warning : OCTREE requires neighbour lists without periodic box : using the cell grid\n");
+  }
+
+  // energy only evaluations of other positions, allocated at the first call of getEnergy_native
+  nat->epos  = NULL;
+  nat->elist = NULL;
+
+  // coordinates are in angstroems in the ATOM list but the engine works in nm, as OpenMM
+  for(uint32_t i=0; i<n; i++)
+  {
+    nat->x[i] = 0.1*atoms[i].x;
+    nat->y[i] = 0.1*atoms[i].y;
+    nat->z[i] = 0.1*atoms[i].z;
+    nat->type[i] = atoms[i].type;
+    nat->mass[i] = nat->sp->pars[atoms[i].type].mass;
+  }
+
+  // set velocities to initial temperature (Maxwell-Boltzmann), without centre of mass motion
+  double px=0.0, py=0.0, pz=0.0, mtot=0.0;
+  for(uint32_t i=0; i<n; i++)
+  {
+    const double sd = sqrt(BOLTZ*nat->T/nat->mass[i]);
+    nat->vx[i] = sd*get_BoxMuller(dat);
+    nat->vy[i] = sd*get_BoxMuller(dat);
+    nat->vz[i] = sd*get_BoxMuller(dat);
+    px += nat->mass[i]*nat->vx[i];
+    py += nat->mass[i]*nat->vy[i];
+    pz += nat->mass[i]*nat->vz[i];
+    mtot += nat->mass[i];
+  }
+  for(uint32_t i=0; i<n; i++)
+  {
+    nat->vx[i] -= px/mtot;
+    nat->vy[i] -= py/mtot;
+    nat->vz[i] -= pz/mtot;
+  }
+
+  // the Leimkuhler-Matthews scheme needs the noise of the step before the first one
+  if(nat->integrator == BROWNIAN_LM)
+  {
+    nat->gprev = malloc(3*(size_t)n*sizeof(double));
+    get_BoxMuller_array(dat,nat->gprev,3*n);
+  }
+
+  // the input order is usually not a spatial one : first sort before the first forces
+  nat->reorder      = (REORDERS) dat->reorder;
+  nat->reorderEvery = dat->reorderEvery;
+  nat->sinceReorder = 0;
+  nat->nreorder     = 0;
+  nat->perm         = NULL;
+  if(nat->reorder != NO_REORDER)
+  {
+    nat->perm = malloc(n*sizeof(uint32_t));
+    for(uint32_t i=0; i<n; i++)
+      nat->perm[i] = i;
+    reorder_native(nat);
+  }
+
+  forces_native(nat);
+
+  return nat;
+}
+
+// -----------------------------------------------------------------------------
+//          r-RESPA : INNER FORCES EVERY STEP, OUTER FORCES EVERY respaSteps
+// -----------------------------------------------------------------------------
+static double respa_inner_native(MyNativeData* nat, double fi[])
+{
+  const uint32_t n = nat->natom;
+
+  neighlist_update(nat->ilist,nat->x,nat->y,nat->z);
+
+  // SPLIT not being larger than CUTON, the switching of the full interaction does not apply to the inner part
+  return lj_forces_neighlist_omp(nat->ilist,n,nat->x,nat->y,nat->z,nat->type,nat->sp,&(nat->icuts),NULL,
+                                 fi,fi+n,fi+2*n,nat->tbuf,nat->nthreads);
+}
+
+// outer forces, the full forces fx,fy,fz minus the inner ones
+static void respa_outer_native(MyNativeData* nat, const double fi[], double fo[])
+{
+  const uint32_t n = nat->natom;
+
+  for(uint32_t i=0; i<n; i++)
+  {
+    fo[i]     = nat->fx[i] - fi[i];
+    fo[n+i]   = nat->fy[i] - fi[n+i];
+    fo[2*n+i] = nat->fz[i] - fi[2*n+i];
+  }
+}
+
+/*
+ * Each cycle of k steps is an outer half kick of k*dt/2, k BAOAB steps with the inner forces only, then the full
+ * forces and the closing outer half kick (Tuckerman, Berne and Martyna) ; with FRICTION 0 this is the constant
+ * energy r-RESPA scheme, the BAOAB steps being velocity Verlet steps.
+ */
+static void respa_baoab_native(MyNativeData* nat, int numSteps)
+{
+  const uint32_t n  = nat->natom;
+  const double dt   = nat->timestep;
+  const double kT   = BOLTZ*nat->T;
+  const double vscale = exp(-dt*nat->friction);
+  const double nscale = sqrt(kT*(1.0-vscale*vscale));
+
+  double* fi = nat->fin;
+  double* fo = nat->fin + 3*n;
+
+  // the positions may have been changed by a minimisation since the previous call
+  respa_inner_native(nat,fi);
+  respa_outer_native(nat,fi,fo);
+
+  for(int s=0; s<numSteps; )
+  {
+    const int k = ((int)nat->respaSteps < numSteps-s) ? (int)nat->respaSteps : numSteps-s;
+
+    kernels.kick_update(n,nat->mass,0.5*k*dt,fo,fo+n,fo+2*n,nat->vx,nat->vy,nat->vz);
+    for(int j=0; j<k; j++)
+    {
+      get_BoxMuller_array(nat->dat,nat->gauss,3*n);
+      kernels.baoab_update(n,nat->mass,0.5*dt,0.5*dt,vscale,nscale,
+                           fi,fi+n,fi+2*n,
+                           nat->gauss,nat->gauss+n,nat->gauss+2*n,
+                           nat->vx,nat->vy,nat->vz,
+                           nat->x,nat->y,nat->z);
+      respa_inner_native(nat,fi);
+      kernels.kick_update(n,nat->mass,0.5*dt,fi,fi+n,fi+2*n,nat->vx,nat->vy,nat->vz);
+    }
+    forces_native(nat);
+    respa_outer_native(nat,fi,fo);
+    kernels.kick_update(n,nat->mass,0.5*k*dt,fo,fo+n,fo+2*n,nat->vx,nat->vy,nat->vz);
+
+    s += k;
+    nat->time += k*dt;
+  }
+}
+
+// -----------------------------------------------------------------------------
+//                     TAKE MULTIPLE STEPS USING THE NATIVE ENGINE
+// -----------------------------------------------------------------------------
+static void steps_native(MyNativeData* nat, int numSteps, double dt)
+{
+  const uint32_t n  = nat->natom;
+  const double kT   = BOLTZ*nat->T;
+  DATA* dat = nat->dat;
+
+  switch(nat->integrator)
+  {
+    case LANGEVIN:
+    {
+      const double vscale = exp(-dt*nat->friction);
+      const double fscale = (nat->friction > 0.0) ? (1.0-vscale)/nat->friction : dt;
+      const double nscale = sqrt(kT*(1.0-vscale*vscale));
+
+      for(int s=0; s<numSteps; s++)
+      {
+        get_BoxMuller_array(dat,nat->gauss,3*n);
+        kernels.langevin_update(n,nat->mass,dt,vscale,fscale,nscale,
+                                nat->fx,nat->fy,nat->fz,
+                                nat->gauss,nat->gauss+n,nat->gauss+2*n,
+                                nat->vx,nat->vy,nat->vz,
+                                nat->x,nat->y,nat->z);
+        forces_native(nat);
+        nat->time += dt;
+      }
+      break;
+    }
+
+    case BAOAB:
+    {
+      if(nat->respaSteps)
+      {
+        respa_baoab_native(nat,numSteps);
+        break;
+      }
+
+      const double vscale = exp(-dt*nat->friction);
+      const double nscale = sqrt(kT*(1.0-vscale*vscale));
+
+      // the last kick of a step and the first one of the next step use the same forces : they are merged
+      for(int s=0; s<numSteps; s++)
+      {
+        get_BoxMuller_array(dat,nat->gauss,3*n);
+        kernels.baoab_update(n,nat->mass,(s==0) ? 0.5*dt : dt,0.5*dt,vscale,nscale,
+                             nat->fx,nat->fy,nat->fz,
+                             nat->gauss,nat->gauss+n,nat->gauss+2*n,
+                             nat->vx,nat->vy,nat->vz,
+                             nat->x,nat->y,nat->z);
+        forces_native(nat);
+        nat->time += dt;
+      }
+      // on-step velocities at the end
+      if(numSteps > 0)
+        kernels.kick_update(n,nat->mass,0.5*dt,nat->fx,nat->fy,nat->fz,nat->vx,nat->vy,nat->vz);
+      break;
+    }
+
+    case BROWNIAN:
+    {
+      for(int s=0; s<numSteps; s++)
+      {
+        get_BoxMuller_array(dat,nat->gauss,3*n);
+        kernels.brownian_update(n,nat->mass,dt,nat->friction,kT,
+                                nat->fx,nat->fy,nat->fz,
+                                nat->gauss,nat->gauss+n,nat->gauss+2*n,
+                                nat->vx,nat->vy,nat->vz,
+                                nat->x,nat->y,nat->z);
+        forces_native(nat);
+        nat->time += dt;
+      }
+      break;
+    }
+
+    case BROWNIAN_LM:
+    {
+      for(int s=0; s<numSteps; s++)
+      {
+        get_BoxMuller_array(dat,nat->gauss,3*n);
+        kernels.brownian_lm_update(n,nat->mass,dt,nat->friction,kT,
+                                   nat->fx,nat->fy,nat->fz,
+                                   nat->gauss,nat->gauss+n,nat->gauss+2*n,
+                                   nat->gprev,nat->gprev+n,nat->gprev+2*n,
+                                   nat->vx,nat->vy,nat->vz,
+                                   nat->x,nat->y,nat->z);
+        // the noise of this step is the previous one of the next step
+        double* const g = nat->gauss;
+        nat->gauss = nat->gprev;
+        nat->gprev = g;
+        forces_native(nat);
+        nat->time += dt;
+      }
+      break;
+    }
+
+    default:
+      LOG_PRINT(LOG_ERROR,"Error : invalid integrator type %d\n",nat->integrator);
+      exit(-1);
+      break;
+  }
+}
+
+// counts the steps taken, and sorts the atoms again every reorderEvery steps
+static void reorder_count_native(MyNativeData* nat, uint32_t numSteps)
+{
+  if(nat->reorder == NO_REORDER)
+    return;
+
+  nat->sinceReorder += numSteps;
+  if(nat->sinceReorder >= nat->reorderEvery)
+    reorder_native(nat);
+}
+
+// largest squared velocity and acceleration of the atoms, for the adaptive timestep
+static void adapt_maxima_native(const MyNativeData* nat, double* v2max, double* a2max)
+{
+  double v2 = 0.0, a2 = 0.0;
+  for(uint32_t i=0; i<nat->natom; i++)
+  {
+    const double vi = X2(nat->vx[i]) + X2(nat->vy[i]) + X2(nat->vz[i]);
+    const double ai = (X2(nat->fx[i]) + X2(nat->fy[i]) + X2(nat->fz[i]))/X2(nat->mass[i]);
+    v2 = (vi > v2) ? vi : v2;
+    a2 = (ai > a2) ? ai : a2;
+  }
+  *v2max = v2;
+  *a2max = a2;
+}
+
+void doNsteps_native(MyNativeData* nat, int numSteps)
+{
+  const NEIGHLIST* nl = nat->nlist;
+  const uint64_t nbuild  = (nl != NULL) ? nl->nbuild  : 0;
+  const uint64_t nupdate = (nl != NULL) ? nl->nupdate : 0;
+
+  if(nat->adapt.maxdisp > 0.0)
+  {
+    // the block lasts numSteps timesteps of METHOD, in steps of variable length
+    const double duration = numSteps*nat->timestep;
+    const double tend = nat->time + duration;
+    while(tend - nat->time > 1.0e-9*nat->timestep)
+    {
+      double v2max, a2max;
+      adapt_maxima_native(nat,&v2max,&a2max);
+      steps_native(nat,1,adapt_next(&(nat->adapt),v2max,a2max,tend-nat->time));
+      reorder_count_native(nat,1);
+    }
+    nat->time = tend;
+    adapt_report(&(nat->adapt),duration);
+  }
+  else
+  {
+    // the block is cut where the atoms are sorted again
+    for(int s=0; s<numSteps; )
+    {
+      int k = numSteps-s;
+      if(nat->reorder != NO_REORDER && nat->reorderEvery-nat->sinceReorder < (uint32_t)k)
+        k = (int)(nat->reorderEvery-nat->sinceReorder);
+      steps_native(nat,k,nat->timestep);
+      reorder_count_native(nat,(uint32_t)k);
+      s += k;
+    }
+  }
+
+  if(nl != NULL)
+  {
+    const uint64_t b = nl->nbuild  - nbuild;
+    const uint64_t u = nl->nupdate - nupdate;
+    LOG_PRINT(LOG_INFO,"Neighbour list rebuilt %"PRIu64" times in %"PRIu64" force evaluations (rate %.4lf, skin %lf nm)\n",
+              b,u,(u>0)?(double)b/(double)u:0.0,nl->skin);
+  }
+}
+
+/* --------------------------------------------------------------------------
+ *              POTENTIAL ENERGY ONLY, OF THE CURRENT OR OF OTHER POSITIONS
+ * -------------------------------------------------------------------------- */
+/**
+ * @brief Potential energy without any force, and without modifying the state of the engine :
+ *  for Monte Carlo moves, line searches or the analysis of other configurations.
+ *
+ * Other positions have their own neighbour list, rebuilt only when an atom moved by more than skin/2
+ * since its last build, so that successive trial moves close to each other reuse it.
+ * With PRECISION MIXED the energy is computed in double precision ; with TABLE the forces are computed
+ * in a scratch buffer, as the table kernels have no energy only version.
+ *
+ * @param nat Native engine data
+ * @param atoms Positions in angstroems, or NULL for the current positions
+ * @return The potential energy in kJ/mol
+ */
+double getEnergy_native(MyNativeData* nat, const ATOM atoms[])
+{
+  // forces and energy are always consistent with the current positions
+  if(atoms == NULL)
+    return nat->epot;
+
+  const uint32_t n = nat->natom;
+
+  if(nat->epos == NULL)
+    nat->epos = malloc(6*(size_t)n*sizeof(double));
+
+  double *ex = nat->epos;
+  double *ey = ex + n;
+  double *ez = ex + 2*n;
+
+  for(uint32_t i=0; i<n; i++)
+  {
+    const uint32_t a = (nat->perm != NULL) ? nat->perm[i] : i;
+    ex[i] = 0.1*atoms[a].x;
+    ey[i] = 0.1*atoms[a].y;
+    ez[i] = 0.1*atoms[a].z;
+  }
+
+  if(nat->nlist == NULL && nat->grid == NULL)
+    return lj_energy_allpairs_tiled(n,ex,ey,ez,nat->type,nat->sp,&(nat->cuts),nat->nthreads);
+
+  if(nat->elist == NULL)
+  {
+    nat->elist = neighlist_alloc(n,nat->cuts.cutoff,(nat->nlist != NULL) ? nat->nlist->skin : 0.1);
+    if(nat->dat->pbc)
+      neighlist_set_box(nat->elist,nat->dat->box);
+    if(nat->nlist != NULL && nat->nlist->tree != NULL)
+      neighlist_set_octree(nat->elist);
+  }
+  neighlist_update(nat->elist,ex,ey,ez);
+
+  if(nat->table != NULL)
+    return lj_forces_neighlist_table(nat->elist,n,ex,ey,ez,nat->type,nat->table,ex+3*n,ex+4*n,ex+5*n);
+
+  return lj_energy_neighlist(nat->elist,n,ex,ey,ez,nat->type,nat->sp,&(nat->cuts),nat->nthreads);
+}
+
+/* --------------------------------------------------------------------------
+ *                    COPY STATE BACK TO THE ATOM LIST
+ * -------------------------------------------------------------------------- */
+void getState_native(MyNativeData* nat, int wantEnergy,
+                     double* timeInPs, ENERGIES* energies, double* currentTemperature,
+                     ATOM atoms[], DATA* dat)
+{
+  *timeInPs = nat->time;
+
+  // back to the order of the ATOM list
+  for(uint32_t i=0; i<dat->natom; i++)
+  {
+    const uint32_t a = (nat->perm != NULL) ? nat->perm[i] : i;
+    atoms[a].x = 10.0*nat->x[i];
+    atoms[a].y = 10.0*nat->y[i];
+    atoms[a].z = 10.0*nat->z[i];
+  }
+
+  if (wantEnergy)
+  {
+    double ekin = 0.0;
+    for(uint32_t i=0; i<nat->natom; i++)
+      ekin += nat->mass[i]*(X2(nat->vx[i]) + X2(nat->vy[i]) + X2(nat->vz[i]));
+
+    energies->epot = nat->epot;
+    energies->ekin = 0.5*ekin;
+    energies->etot = energies->epot + energies->ekin;
+  }
+
+  *currentTemperature = nat->T;
+}
+
+// -----------------------------------------------------------------------------
+//                     LOCAL ENERGY MINIMISATION
+// -----------------------------------------------------------------------------
+/// forces of the current positions for the minimisers of minimiser.c
+static double minim_forces_native(void* ctx)
+{
+  MyNativeData* nat = (MyNativeData*)ctx;
+  forces_native(nat);
+  return nat->epot;
+}
+
+/**
+ * @brief Steepest descent with an adaptive step, stopping when the root mean square
+ *  of the force components is below tolerance (same criterion than OpenMM_LocalEnergyMinimizer).
+ *
+ * @param nat Native engine data
+ * @param tolerance in kJ/mol/nm
+ * @param maxSteps maximum number of iterations, 0 means until convergence
+ */
+static void steepest_native(MyNativeData* nat, double tolerance, int maxSteps)
+{
+  const uint32_t n = nat->natom;
+
+  double *x0 = malloc(n*sizeof(double));
+  double *y0 = malloc(n*sizeof(double));
+  double *z0 = malloc(n*sizeof(double));
+
+  // initial step of 0.01 nm for the atom with the largest force
+  double h = 0.01;
+  int iter = 0;
+
+  for(;;)
+  {
+    double rms=0.0, fmax=0.0;
+    for(uint32_t i=0; i<n; i++)
+    {
+      const double f2 = X2(nat->fx[i]) + X2(nat->fy[i]) + X2(nat->fz[i]);
+      rms += f2;
+      fmax = (f2 > fmax) ? f2 : fmax;
+    }
+    rms  = sqrt(rms/(3.0*n));
+    fmax = sqrt(fmax);
+
+    // no force at all (a zero tolerance, or no pair within the cutoff) : nothing to follow
+    if(rms < tolerance || fmax == 0.0 || (maxSteps > 0 && iter >= maxSteps) || h < 1.0e-10)
+      break;
+
+    memcpy(x0,nat->x,n*sizeof(double));
+    memcpy(y0,nat->y,n*sizeof(double));
+    memcpy(z0,nat->z,n*sizeof(double));
+    const double e0 = nat->epot;
+
+    for(uint32_t i=0; i<n; i++)
+    {
+      nat->x[i] += h*nat->fx[i]/fmax;
+      nat->y[i] += h*nat->fy[i]/fmax;
+      nat->z[i] += h*nat->fz[i]/fmax;
+    }
+    forces_native(nat);
+
+    if(nat->epot < e0)
+      h *= 1.2;
+    else
+    {
+      memcpy(nat->x,x0,n*sizeof(double));
+      memcpy(nat->y,y0,n*sizeof(double));
+      memcpy(nat->z,z0,n*sizeof(double));
+      forces_native(nat);
+      h *= 0.5;
+    }
+
+    iter++;
+  }
+
+  LOG_PRINT(LOG_DEBUG,"Native minimisation : %d iterations, final epot = %lf kJ/mol\n",iter,nat->epot);
+
+  free(x0);
+  free(y0);
+  free(z0);
+}
+
+/**
+ * @brief Local energy minimisation with the algorithm of the MINIMIZE keyword : FIRE or L-BFGS directly on the arrays
+ *  of the engine, or the steepest descent above for LOCAL ; velocities are not modified
+ *
+ * @param nat Native engine data
+ * @param tolerance root mean square of the force components for convergence, in kJ/mol/nm
+ * @param maxSteps maximum number of iterations, 0 means until convergence
+ */
+void minimise_native(MyNativeData* nat, double tolerance, int maxSteps)
+{
+  if(nat->minimiser == LOCAL)
+  {
+    steepest_native(nat,tolerance,maxSteps);
+    return;
+  }
+
+  MINIM_SYS sys = { nat->natom, nat->x, nat->y, nat->z, nat->fx, nat->fy, nat->fz, nat->mass,
+                    &minim_forces_native, nat };
+  MINIM_STATS st;
+  minim_run(&sys,nat->minimiser,tolerance,(uint32_t)maxSteps,nat->minimHistory,&st);
+
+  LOG_PRINT(LOG_DEBUG,"Native %s minimisation : %d iterations, %d force evaluations, final epot = %lf kJ/mol, rms force = %le kJ/mol/nm%s\n",
+            minimisersName[nat->minimiser],st.iter,st.nforces,st.epot,st.frms,st.converged ? "" : " (not converged)");
+}
+
+// -----------------------------------------------------------------------------
+//                  DROP THE ATOMS EVAPORATED FROM THE CLUSTER
+// -----------------------------------------------------------------------------
+/**
+ * @brief Drops the atoms flagged as evaporated from the engine : they are moved after the atoms still integrated
+ *  (a stable partition, so that the sorting of REORDER is kept), and all the loops, pair searches and random numbers
+ *  stop at the new number of atoms ; their positions are frozen and still reported by getState_native
+ *
+ * @param nat Native engine data
+ * @param evap Flag of each atom of the ATOM list, 1 if evaporated (see evaporation.c)
+ */
+void evaporate_native(MyNativeData* nat, const uint8_t evap[])
+{
+  const uint32_t n = nat->natom;
+  const uint32_t ntot = nat->dat->natom;
+
+  // the engine index in the ATOM list is required to read the flags
+  if(nat->perm == NULL)
+  {
+    nat->perm = malloc(ntot*sizeof(uint32_t));
+    for(uint32_t i=0; i<ntot; i++)
+      nat->perm[i] = i;
+  }
+
+  uint32_t* order = malloc(n*sizeof(uint32_t));
+  double* tmp = malloc(n*sizeof(double));
+
+  uint32_t na = 0;
+  for(uint32_t k=0; k<n; k++)
+    if(!evap[nat->perm[k]])
+      order[na++] = k;
+  if(na == n)
+  {
+    free(tmp);
+    free(order);
+    return;
+  }
+  uint32_t m = na;
+  for(uint32_t k=0; k<n; k++)
+    if(evap[nat->perm[k]])
+      order[m++] = k;
+
+  permute_native(nat,order,tmp);
+
+  // the blocks of the previous noise of BROWNIAN_LM have a stride of natom
+  if(nat->gprev != NULL)
+  {
+    memmove(nat->gprev+na,nat->gprev+n,na*sizeof(double));
+    memmove(nat->gprev+2*na,nat->gprev+2*n,na*sizeof(double));
+  }
+
+  nat->natom = na;
+  if(nat->nlist != NULL)
+    nat->nlist->natom = na;
+  if(nat->ilist != NULL)
+    nat->ilist->natom = na;
+  if(nat->elist != NULL)
+    nat->elist->natom = na;
+  if(nat->domains != NULL)
+    nat->domains->natom = na;
+
+  forces_native(nat);
+
+  LOG_PRINT(LOG_INFO,"Native engine : %d atoms dropped after evaporation, %d atoms integrated\n",n-na,na);
+
+  free(tmp);
+  free(order);
+}
+
+// -----------------------------------------------------------------------------
+//             print some information about the native engine
+// -----------------------------------------------------------------------------
+void infos_native(const MyNativeData* nat)
+{
+  LOG_PRINT(LOG_INFO,"Native engine running with %d atoms and %d threads\n",nat->natom,nat->nthreads);
+  LOG_PRINT(LOG_INFO," Integrator : %s | T = %lf K | friction = %lf ps^-1 | timestep = %lf ps\n",
+            integratorsName[nat->integrator],nat->T,nat->friction,nat->timestep);
+  LOG_PRINT(LOG_INFO," Switching function : %s | cuton = %lf nm | cutoff = %lf nm\n",
+            nat->cuts.useSwitch ? "yes" : "no",nat->cuts.cuton,nat->cuts.cutoff);
+  if(nat->nlist != NULL)
+  {
+    LOG_PRINT(LOG_INFO," Pair search : Verlet neighbour lists with a skin of %lf nm, built with %s\n",nat->nlist->skin,
+              (nat->nlist->tree != NULL) ? "an adaptive octree" : "a hashed cell grid");
+    LOG_PRINT(LOG_INFO," Pair kernel : SIMD instruction set %s, %s precision\n",lj_simd_isa(),(nat->xyzt != NULL) ? "mixed" : "double");
+    if(nat->table != NULL)
+      LOG_PRINT(LOG_INFO," Pair potential : tabulated, cubic splines on r^2 with %d bins from %lf to %lf nm\n",
+                nat->table->nbins,sqrt(nat->table->s0),sqrt(nat->table->s1));
+  }
+  else if(nat->grid != NULL)
+    LOG_PRINT(LOG_INFO," Pair search : hashed cell grid with %d buckets of cells of size %lf nm\n",nat->grid->nbuckets,nat->grid->cellSize);
+  else
+    LOG_PRINT(LOG_INFO," Pair search : all pairs (%s), tiled kernel with SIMD instruction set %s\n",
+              isfinite(nat->cuts.cutoff) ? "small system" : "no cutoff",lj_simd_isa());
+  if(nat->sp->n == 1)
+    LOG_PRINT(LOG_INFO," Pair parameters : single species (%s), all-pairs kernels specialised with constant parameters\n",nat->sp->pars[0].sym);
+  else
+    LOG_PRINT(LOG_INFO," Pair parameters : %d species, looked up for each pair\n",nat->sp->n);
+  if(nat->respaSteps)
+    LOG_PRINT(LOG_INFO," r-RESPA : inner part up to %lf nm (switched off over %lf nm) every step, outer part every %d steps\n",
+              nat->icuts.cutoff,nat->icuts.cutoff-nat->icuts.cuton,nat->respaSteps);
+  if(nat->reorder != NO_REORDER)
+    LOG_PRINT(LOG_INFO," Atoms sorted in memory along the %s curve every %d steps\n",reordersName[nat->reorder],nat->reorderEvery);
+  if(nat->domains != NULL)
+    LOG_PRINT(LOG_INFO," Reaction forces : half neighbour list split in %d domains, one per thread\n",nat->domains->ndom);
+  if(nat->adapt.maxdisp > 0.0)
+    LOG_PRINT(LOG_INFO," Adaptive timestep : atoms move by at most %lf nm per step, timestep from %le to %lf ps, growth %lf\n",
+              nat->adapt.maxdisp,nat->adapt.dtmin,nat->adapt.dtmax,nat->adapt.growth);
+  LOG_PRINT(LOG_INFO," Integrator and random numbers kernels : %s variant\n",kernels.name);
+}
+
+// -----------------------------------------------------------------------------
+//                     DEALLOCATE NATIVE OBJECTS
+// -----------------------------------------------------------------------------
+void terminate_native(MyNativeData* nat)
+{
+  free(nat->x);  free(nat->y);  free(nat->z);
+  free(nat->vx); free(nat->vy); free(nat->vz);
+  free(nat->fx); free(nat->fy); free(nat->fz);
+  free(nat->mass);
+  free(nat->type);
+  free(nat->gauss);
+  free(nat->gprev);
+  free(nat->xyzt);
+  free(nat->f4buf);
+  free(nat->tbuf);
+  free(nat->epos);
+  free(nat->fin);
+  if(nat->reorder != NO_REORDER)
+    LOG_PRINT(LOG_INFO,"Atoms sorted along the %s curve %"PRIu64" times during the whole run\n",reordersName[nat->reorder],nat->nreorder);
+  free(nat->perm);
+  if(nat->domains != NULL)
+  {
+    LOG_PRINT(LOG_INFO,"Neighbour list domains : %.4lf halo atoms per atom after the last split\n",
+              (double)nat->domains->nhalo/(double)nat->natom);
+    neighdomains_free(nat->domains);
+  }
+  if(nat->ilist != NULL)
+    neighlist_free(nat->ilist);
+  if(nat->elist != NULL)
+    neighlist_free(nat->elist);
+  if(nat->table != NULL)
+    lj_table_free(nat->table);
+  if(nat->grid != NULL)
+    cellgrid_free(nat->grid);
+  if(nat->nlist != NULL)
+  {
+    LOG_PRINT(LOG_INFO,"Neighbour list rebuilt %"PRIu64" times in %"PRIu64" force evaluations during the whole run (rate %.4lf)\n",
+              nat->nlist->nbuild,nat->nlist->nupdate,
+              (nat->nlist->nupdate>0)?(double)nat->nlist->nbuild/(double)nat->nlist->nupdate:0.0);
+    const OCTREE* t = nat->nlist->tree;
+    if(t != NULL)
+      LOG_PRINT(LOG_INFO,"Octree : %"PRIu64" builds from scratch, %"PRIu64" incremental updates moving %.2lf atoms each, "
+                "%d levels and %.1lf kB at the end\n",t->nbuild,t->nupdate,(t->nupdate>0)?(double)t->nmoved/(double)t->nupdate:0.0,
+                octree_depth(t),octree_memory(t)/1024.0);
+    neighlist_free(nat->nlist);
+  }
+  free(nat);
+}
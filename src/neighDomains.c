@@ -0,0 +1,228 @@
+/**
+ * \file neighDomains.c
+ *
+ * \brief Half neighbour lists split in one domain of consecutive rows per thread, for accumulating the reaction forces
+ *        of the pairs evaluated once without atomics nor full size buffers per thread.
+ *
+ * \details Each thread owns the atoms of its rows and has a local copy of the positions of the other atoms they interact
+ *          with (its halo), the rows being renumbered accordingly : the unmodified pair kernels then accumulate all the
+ *          forces of the domain in small local arrays (first phase), and each thread adds to its own atoms the forces left
+ *          in the halos of the other threads (second phase, see lj_forces_neighdomains). The halos are the surfaces of
+ *          the domains when the atoms are sorted in space (REORDER), at worst all the atoms.
+ *          The split is done again, in parallel, each time the neighbour list has been rebuilt.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "global.h"
+#include "neighDomains.h"
+
+/**
+ * @brief Allocates the domains ; they are split at the first call of neighdomains_update
+ *
+ * @param natom Number of atoms
+ * @param ndom Number of domains, the number of threads of the force evaluation
+ * @return The domains, to be freed with neighdomains_free
+ */
+NEIGHDOMAINS* neighdomains_alloc(uint32_t natom, uint32_t ndom)
+{
+  NEIGHDOMAINS* nd = malloc(sizeof(NEIGHDOMAINS));
+
+  nd->natom  = natom;
+  nd->ndom   = (ndom > 0) ? ndom : 1;
+  nd->dom    = calloc(nd->ndom,sizeof(NEIGHDOMAIN));
+  nd->nbuild = 0;
+  nd->nhalo  = 0;
+
+  // the arrays of each domain are allocated by its thread when splitting, close to the cores using them
+
+  return nd;
+}
+
+/**
+ * @brief Frees the domains
+ */
+void neighdomains_free(NEIGHDOMAINS* nd)
+{
+  if(nd == NULL)
+    return;
+
+  for(uint32_t d=0; d<nd->ndom; d++)
+  {
+    NEIGHDOMAIN* dm = &(nd->dom[d]);
+    free(dm->halo);
+    free(dm->hstart);
+    free(dm->rows.start);
+    free(dm->rows.list);
+    free(dm->x);
+    free(dm->type);
+    free(dm->mark);
+    free(dm->rank);
+  }
+
+  free(nd->dom);
+  free(nd);
+}
+
+/// renumbering of the rows of the domain d of nd : the ranges of all the domains are already set
+static void neighdomains_split(NEIGHDOMAINS* nd, uint32_t d, const NEIGHLIST* nl, const uint32_t type[])
+{
+  NEIGHDOMAIN* dm = &(nd->dom[d]);
+  const uint32_t n = nd->natom;
+  const uint32_t nwords = (n+63)/64;
+  const uint32_t ibeg = dm->ibeg;
+  const uint32_t nown = dm->iend - dm->ibeg;
+  const uint32_t kbeg = nl->start[ibeg];
+  const uint32_t npairs = nl->start[dm->iend] - kbeg;
+
+  if(dm->mark == NULL)
+  {
+    dm->mark = malloc(nwords*sizeof(uint64_t));
+    dm->rank = malloc(nwords*sizeof(uint32_t));
+    dm->hstart = malloc((nd->ndom+1)*sizeof(uint32_t));
+  }
+
+  // halo : the neighbours owned by other domains, marked once whatever the number of pairs in which they appear
+  memset(dm->mark,0,nwords*sizeof(uint64_t));
+  for(uint32_t k=kbeg; k<kbeg+npairs; k++)
+  {
+    const uint32_t j = nl->list[k];
+    if(j-ibeg >= nown)
+      dm->mark[j>>6] |= 1ULL << (j&63);
+  }
+
+  uint32_t nhalo = 0;
+  for(uint32_t w=0; w<nwords; w++)
+  {
+    dm->rank[w] = nhalo;
+    nhalo += (uint32_t) __builtin_popcountll(dm->mark[w]);
+  }
+
+  dm->nown  = nown;
+  dm->nhalo = nhalo;
+
+  if(nown+nhalo > dm->lcapacity || dm->x == NULL)
+  {
+    // some room for the growth of the halo between two splits
+    dm->lcapacity = nown + nhalo + nhalo/4 + 64;
+    free(dm->halo);
+    free(dm->rows.start);
+    free(dm->x);
+    free(dm->type);
+    dm->halo = malloc(dm->lcapacity*sizeof(uint32_t));
+    dm->rows.start = malloc((dm->lcapacity+1)*sizeof(uint32_t));
+    dm->x = malloc(6*(size_t)dm->lcapacity*sizeof(double));
+    dm->type = malloc(dm->lcapacity*sizeof(uint32_t));
+    dm->y  = dm->x + dm->lcapacity;
+    dm->z  = dm->x + 2*dm->lcapacity;
+    dm->fx = dm->x + 3*dm->lcapacity;
+    dm->fy = dm->x + 4*dm->lcapacity;
+    dm->fz = dm->x + 5*dm->lcapacity;
+  }
+
+  if(npairs > dm->rows.capacity || dm->rows.list == NULL)
+  {
+    dm->rows.capacity = npairs + npairs/4 + 64;
+    free(dm->rows.list);
+    dm->rows.list = malloc(dm->rows.capacity*sizeof(uint32_t));
+  }
+
+  // the halo in increasing order, so that the part owned by each other domain is contiguous
+  uint32_t h = 0;
+  for(uint32_t w=0; w<nwords; w++)
+    for(uint64_t bits=dm->mark[w]; bits!=0; bits&=bits-1)
+      dm->halo[h++] = 64*w + (uint32_t) __builtin_ctzll(bits);
+
+  // the rows with local indices : own atoms first, then the halo in the same order
+  dm->rows.natom = nown + nhalo;
+  dm->rows.full  = 0;
+  // the local copies of the positions are not wrapped either : same minimum image than the list
+  dm->rows.periodic = nl->periodic;
+  memcpy(dm->rows.box,nl->box,3*sizeof(double));
+  memcpy(dm->rows.ibox,nl->ibox,3*sizeof(double));
+  for(uint32_t r=0; r<=nown; r++)
+    dm->rows.start[r] = nl->start[ibeg+r] - kbeg;
+
+  for(uint32_t k=0; k<npairs; k++)
+  {
+    const uint32_t j = nl->list[kbeg+k];
+    if(j-ibeg < nown)
+      dm->rows.list[k] = j-ibeg;
+    else
+    {
+      const uint64_t below = dm->mark[j>>6] & ((1ULL << (j&63)) - 1);
+      dm->rows.list[k] = nown + dm->rank[j>>6] + (uint32_t) __builtin_popcountll(below);
+    }
+  }
+
+  memcpy(dm->type,type+ibeg,nown*sizeof(uint32_t));
+  for(uint32_t k=0; k<nhalo; k++)
+    dm->type[nown+k] = type[dm->halo[k]];
+
+  // part of the halo owned by each domain
+  h = 0;
+  for(uint32_t u=0; u<nd->ndom; u++)
+  {
+    while(h < nhalo && dm->halo[h] < nd->dom[u].ibeg)
+      h++;
+    dm->hstart[u] = h;
+  }
+  dm->hstart[nd->ndom] = nhalo;
+}
+
+/**
+ * @brief Splits the rows of the neighbour list in domains with about the same number of pairs, if the list has been
+ *  rebuilt since the last call ; to be called after neighlist_update and before lj_forces_neighdomains
+ *
+ * @param nd The domains
+ * @param nl Half neighbour list
+ * @param type Species of the atoms, copied in the local arrays
+ */
+void neighdomains_update(NEIGHDOMAINS* nd, const NEIGHLIST* nl, const uint32_t type[])
+{
+  if(nd->nbuild == nl->nbuild)
+    return;
+
+  const uint32_t n = nd->natom;
+  const uint64_t npairs = nl->start[n];
+
+  // consecutive rows : the atoms sorted in space (REORDER) give compact domains and thin halos
+  uint32_t i = 0;
+  for(uint32_t d=0; d<nd->ndom; d++)
+  {
+    const uint64_t target = npairs*d/nd->ndom;
+    while(i < n && nl->start[i] < target)
+      i++;
+    nd->dom[d].ibeg = i;
+    if(d > 0)
+      nd->dom[d-1].iend = i;
+  }
+  nd->dom[nd->ndom-1].iend = n;
+
+  uint64_t nhalo = 0;
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(nd->ndom) schedule(static,1) reduction(+:nhalo)
+#endif
+  for(uint32_t d=0; d<nd->ndom; d++)
+  {
+    neighdomains_split(nd,d,nl,type);
+    nhalo += nd->dom[d].nhalo;
+  }
+
+  nd->nhalo  = nhalo;
+  nd->nbuild = nl->nbuild;
+}
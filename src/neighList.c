@@ -0,0 +1,398 @@
+/**
+ * \file neighList.c
+ *
+ * \brief Verlet neighbour lists : built with a skin on top of the cutoff and rebuilt only when
+ *        the maximum displacement since the last build exceeds half of the skin
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "global.h"
+#include "neighList.h"
+
+/**
+ * @brief Allocates an empty neighbour list ; it has to be built before use
+ *
+ * @param natom Number of atoms
+ * @param cutoff Cutoff of the interactions
+ * @param skin Skin added to the cutoff, same unit
+ * @return The neighbour list, to be freed with neighlist_free
+ */
+NEIGHLIST* neighlist_alloc(uint32_t natom, double cutoff, double skin)
+{
+  NEIGHLIST* nl = malloc(sizeof(NEIGHLIST));
+
+  nl->natom  = natom;
+  nl->cutoff = cutoff;
+  nl->skin   = skin;
+  nl->rlist2 = X2(cutoff+skin);
+  nl->full   = 0;
+  nl->stale  = 0;
+  nl->periodic = 0;
+  for(uint32_t d=0; d<3; d++)
+    nl->box[d] = nl->ibox[d] = 0.0;
+  nl->xw = NULL;
+
+  nl->start = calloc(natom+1,sizeof(uint32_t));
+  // a first guess for a dense cluster, increased later if necessary
+  nl->capacity = 64*natom;
+  nl->list  = malloc(nl->capacity*sizeof(uint32_t));
+
+  nl->x0 = malloc(natom*sizeof(double));
+  nl->y0 = malloc(natom*sizeof(double));
+  nl->z0 = malloc(natom*sizeof(double));
+
+  nl->grid = cellgrid_alloc(natom,cutoff+skin);
+  nl->tree = NULL;
+
+  nl->nbuild  = 0;
+  nl->nupdate = 0;
+
+  return nl;
+}
+
+/**
+ * @brief Allocates a full neighbour list : each pair is stored in the rows of both atoms, so that the forces of an atom
+ *  are complete once its row is processed (see lj_forces_neighlist_full), at the price of twice as many pairs
+ *
+ * @param natom Number of atoms
+ * @param cutoff Cutoff of the interactions
+ * @param skin Skin added to the cutoff
+ * @return The list, built at the first call of neighlist_update
+ */
+NEIGHLIST* neighlist_alloc_full(uint32_t natom, double cutoff, double skin)
+{
+  NEIGHLIST* nl = neighlist_alloc(natom,cutoff,skin);
+
+  nl->full = 1;
+  nl->capacity *= 2;
+  nl->list = realloc(nl->list,nl->capacity*sizeof(uint32_t));
+
+  return nl;
+}
+
+/**
+ * @brief Frees the neighbour list
+ *
+ * @param nl The neighbour list
+ */
+void neighlist_free(NEIGHLIST* nl)
+{
+  free(nl->start);
+  free(nl->list);
+  free(nl->x0);
+  free(nl->y0);
+  free(nl->z0);
+  free(nl->xw);
+  cellgrid_free(nl->grid);
+  if(nl->tree != NULL)
+    octree_free(nl->tree);
+  free(nl);
+}
+
+/**
+ * @brief Makes the list periodic : the pairs are those of the minimum image convention in an orthorhombic box,
+ *  which requires a cutoff not larger than half of the smallest edge
+ *
+ * @param nl The neighbour list
+ * @param box Edges of the box, same unit than the cutoff
+ */
+void neighlist_set_box(NEIGHLIST* nl, const double box[3])
+{
+  nl->periodic = 1;
+  for(uint32_t d=0; d<3; d++)
+  {
+    nl->box[d]  = box[d];
+    nl->ibox[d] = 1.0/box[d];
+  }
+  cellgrid_set_box(nl->grid,box);
+  if(nl->xw == NULL)
+    nl->xw = malloc(3*(size_t)nl->natom*sizeof(double));
+  nl->stale = 1;
+}
+
+/**
+ * @brief Builds the list from an adaptive octree instead of the cell grid, for systems mixing dense and very sparse
+ *  regions (a droplet and its evaporated atoms) : the leaves are at least half of cutoff+skin wide and split above
+ *  OCTREE_LEAF_MAX atoms, and the octree is updated incrementally from one build to the next ; not in a periodic box
+ *
+ * @param nl The neighbour list
+ */
+void neighlist_set_octree(NEIGHLIST* nl)
+{
+  if(nl->tree == NULL)
+    nl->tree = octree_alloc(nl->natom,0.5*(nl->cutoff+nl->skin),OCTREE_LEAF_MAX);
+  nl->stale = 1;
+}
+
+/// coordinates wrapped in [0,L) along the edge of length L (iL = 1/L), the rounding errors at the edges being clamped
+static void neighlist_wrap(uint32_t n, const double v[], double L, double iL, double vw[])
+{
+  for(uint32_t i=0; i<n; i++)
+  {
+    const double w = v[i] - L*floor(v[i]*iL);
+    vw[i] = (w < 0.0) ? 0.0 : ((w < L) ? w : w - L);
+  }
+}
+
+/// minimum image of the separation of two coordinates wrapped in [0,L) : no rounding needed as |d| < L
+static inline double neighlist_image(double d, double L)
+{
+  return (d > 0.5*L) ? d - L : ((d < -0.5*L) ? d + L : d);
+}
+
+/**
+ * @brief Periodic box too small for 3 cells of size cutoff+skin along each edge, so that the 27 neighbouring cells would
+ *  not all be different : builds the list from all the minimum image distances
+ *
+ * @param nl The neighbour list
+ * @param x,y,z The coordinates
+ * @return The number of neighbours stored
+ */
+static uint32_t neighlist_build_allpairs(NEIGHLIST* nl, const double x[], const double y[], const double z[])
+{
+  const uint32_t n = nl->natom;
+  const double* L  = nl->box;
+
+  uint32_t nn = 0;
+
+  for(uint32_t i=0; i<n; i++)
+  {
+    nl->start[i] = nn;
+
+    for(uint32_t j=(nl->full ? 0 : i+1); j<n; j++)
+    {
+      if(j==i)
+        continue;
+
+      const double r2 = X2(neighlist_image(x[i]-x[j],L[0]))
+                      + X2(neighlist_image(y[i]-y[j],L[1]))
+                      + X2(neighlist_image(z[i]-z[j],L[2]));
+      if(r2 >= nl->rlist2)
+        continue;
+
+      if(nn == nl->capacity)
+      {
+        nl->capacity *= 2;
+        nl->list = realloc(nl->list,nl->capacity*sizeof(uint32_t));
+      }
+      nl->list[nn++] = j;
+    }
+  }
+
+  return nn;
+}
+
+/**
+ * @brief Builds the list from the cell grid, wrapping the neighbouring cells and using the minimum image in a periodic box
+ *
+ * @param nl The neighbour list
+ * @param x,y,z The coordinates
+ * @return The number of neighbours stored
+ */
+static uint32_t neighlist_build_cells(NEIGHLIST* nl, const double x[], const double y[], const double z[])
+{
+  const uint32_t n = nl->natom;
+  const CELLGRID* grid = nl->grid;
+  const uint8_t pbc = nl->periodic;
+  const double* L  = nl->box;
+
+  cellgrid_build(nl->grid,n,x,y,z);
+
+  uint32_t nn = 0;
+
+  for(uint32_t i=0; i<n; i++)
+  {
+    nl->start[i] = nn;
+
+    const int32_t cx = grid->cx[i];
+    const int32_t cy = grid->cy[i];
+    const int32_t cz = grid->cz[i];
+
+    // the cell of i (only j>i, or all j but i for a full list) then the 13 cells of the half shell (all j),
+    //  and for a full list the 13 opposite cells
+    const int32_t ncells = nl->full ? 26 : 13;
+    for(int32_t c=-1; c<ncells; c++)
+    {
+      const int32_t sg  = (c<13) ? 1 : -1;
+      const int32_t hc  = (c<13) ? c : c-13;
+      int32_t ncx = (c<0) ? cx : cx+sg*cellgrid_half_shell[hc][0];
+      int32_t ncy = (c<0) ? cy : cy+sg*cellgrid_half_shell[hc][1];
+      int32_t ncz = (c<0) ? cz : cz+sg*cellgrid_half_shell[hc][2];
+      if(pbc)
+      {
+        ncx = cellgrid_pwrap(grid,ncx,0);
+        ncy = cellgrid_pwrap(grid,ncy,1);
+        ncz = cellgrid_pwrap(grid,ncz,2);
+      }
+
+      for(int32_t j=grid->head[cellgrid_hash(grid,ncx,ncy,ncz)]; j>=0; j=grid->next[j])
+      {
+        if(grid->cx[j]!=ncx || grid->cy[j]!=ncy || grid->cz[j]!=ncz)
+          continue;
+        if(c<0 && ((uint32_t)j==i || (!nl->full && (uint32_t)j<i)))
+          continue;
+
+        const double r2 = pbc ? X2(neighlist_image(x[i]-x[j],L[0]))
+                              + X2(neighlist_image(y[i]-y[j],L[1]))
+                              + X2(neighlist_image(z[i]-z[j],L[2]))
+                              : X2(x[i]-x[j]) + X2(y[i]-y[j]) + X2(z[i]-z[j]);
+        if(r2 >= nl->rlist2)
+          continue;
+
+        if(nn == nl->capacity)
+        {
+          nl->capacity *= 2;
+          nl->list = realloc(nl->list,nl->capacity*sizeof(uint32_t));
+        }
+        nl->list[nn++] = (uint32_t) j;
+      }
+    }
+  }
+
+  return nn;
+}
+
+/**
+ * @brief Builds the list from the octree : each atom visits the leaves near its own one, skipping those whose cube is
+ *  further than cutoff+skin from it ; the half list keeps the pairs of two leaves in the rows of the atoms of the first
+ *  one (depth first order), and the pairs i<j of a leaf in the row of i
+ *
+ * @param nl The neighbour list
+ * @param x,y,z The coordinates
+ * @return The number of neighbours stored
+ */
+static uint32_t neighlist_build_octree(NEIGHLIST* nl, const double x[], const double y[], const double z[])
+{
+  const uint32_t n = nl->natom;
+  OCTREE* t = nl->tree;
+
+  // renumbered atoms (REORDER, EVAPORATION) : the leaves of the atoms are not valid any more
+  if(nl->stale)
+    octree_build(t,n,x,y,z);
+  else
+    octree_update(t,n,x,y,z);
+  octree_near_leaves(t,sqrt(nl->rlist2));
+
+  uint32_t nn = 0;
+
+  for(uint32_t i=0; i<n; i++)
+  {
+    nl->start[i] = nn;
+
+    const int32_t s = t->nodes[t->leaf[i]].slot;
+    for(uint32_t l=t->lstart[s]; l<t->lstart[s+1]; l++)
+    {
+      const OCTNODE* nd = &(t->nodes[t->lnear[l]]);
+      if((!nl->full && nd->slot < s) || octree_point_dist2(nd,x[i],y[i],z[i]) >= nl->rlist2)
+        continue;
+
+      const uint8_t same = (nd->slot == s);
+      for(int32_t j=nd->head; j>=0; j=t->next[j])
+      {
+        if(same && ((uint32_t)j==i || (!nl->full && (uint32_t)j<i)))
+          continue;
+
+        const double r2 = X2(x[i]-x[j]) + X2(y[i]-y[j]) + X2(z[i]-z[j]);
+        if(r2 >= nl->rlist2)
+          continue;
+
+        if(nn == nl->capacity)
+        {
+          nl->capacity *= 2;
+          nl->list = realloc(nl->list,nl->capacity*sizeof(uint32_t));
+        }
+        nl->list[nn++] = (uint32_t) j;
+      }
+    }
+  }
+
+  return nn;
+}
+
+/**
+ * @brief Builds the list from scratch using the cell grid, and saves the reference positions
+ *
+ * @param nl The neighbour list
+ * @param x,y,z The coordinates
+ */
+void neighlist_build(NEIGHLIST* nl, const double x[], const double y[], const double z[])
+{
+  const uint32_t n = nl->natom;
+  const CELLGRID* grid = nl->grid;
+
+  uint32_t nn = 0;
+  if(nl->periodic)
+  {
+    // the pairs are searched with the wrapped coordinates, whose minimum image is a comparison with half the edge
+    double *xw = nl->xw, *yw = xw + n, *zw = xw + 2*n;
+    neighlist_wrap(n,x,nl->box[0],nl->ibox[0],xw);
+    neighlist_wrap(n,y,nl->box[1],nl->ibox[1],yw);
+    neighlist_wrap(n,z,nl->box[2],nl->ibox[2],zw);
+    nn = (grid->nc[0] < 3 || grid->nc[1] < 3 || grid->nc[2] < 3) ? neighlist_build_allpairs(nl,xw,yw,zw)
+                                                                 : neighlist_build_cells(nl,xw,yw,zw);
+  }
+  else if(nl->tree != NULL)
+    nn = neighlist_build_octree(nl,x,y,z);
+  else
+    nn = neighlist_build_cells(nl,x,y,z);
+
+  nl->start[n] = nn;
+
+  memcpy(nl->x0,x,n*sizeof(double));
+  memcpy(nl->y0,y,n*sizeof(double));
+  memcpy(nl->z0,z,n*sizeof(double));
+
+  nl->stale = 0;
+  nl->nbuild++;
+}
+
+/**
+ * @brief Rebuilds the list only if an atom moved by more than skin/2 since the last build
+ *
+ * @param nl The neighbour list
+ * @param x,y,z The coordinates
+ * @return 1 if the list was rebuilt, 0 otherwise
+ */
+int32_t neighlist_update(NEIGHLIST* nl, const double x[], const double y[], const double z[])
+{
+  const double lim2 = X2(0.5*nl->skin);
+
+  nl->nupdate++;
+
+  // no early exit so that the loop is vectorised
+  double d2max = 0.0;
+  for(uint32_t i=0; i<nl->natom; i++)
+  {
+    const double d2 = X2(x[i]-nl->x0[i]) + X2(y[i]-nl->y0[i]) + X2(z[i]-nl->z0[i]);
+    d2max = (d2 > d2max) ? d2 : d2max;
+  }
+
+  const int32_t rebuild = (nl->nbuild == 0) || nl->stale || (d2max > lim2);
+
+  if(rebuild)
+    neighlist_build(nl,x,y,z);
+
+  return rebuild;
+}
+
+/**
+ * @brief Forces a rebuild at the next call of neighlist_update, when the atoms were renumbered
+ *
+ * @param nl The neighbour list
+ */
+void neighlist_invalidate(NEIGHLIST* nl)
+{
+  nl->stale = 1;
+}
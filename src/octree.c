@@ -0,0 +1,575 @@
+/**
+ * \file octree.c
+ *
+ * \brief Adaptive octree of the atoms, used instead of the hashed cell grid for building the neighbour lists of very
+ *        inhomogeneous systems : leaves are split by occupancy, and the tree is updated incrementally as atoms move
+ *
+ * \details The edges of the nodes are powers of two and the corners multiples of a power of two not larger than the
+ *          smallest edge, so that all the corners and edges are exact in floating point and an atom is always found
+ *          in the same leaf when going down the tree and when checking the cube of its leaf.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "global.h"
+#include "logger.h"
+#include "octree.h"
+
+/**
+ * @brief Allocates an empty octree ; it has to be built before use
+ *
+ * @param natom Number of atoms
+ * @param minEdge Smallest edge of the leaves, in the unit of the coordinates : with a fraction of the search distance
+ *  the dense regions end up in leaves of a few atoms whose neighbouring leaves cover little more than the search sphere
+ * @param leafMax Largest number of atoms of a leaf larger than 2*minEdge, OCTREE_LEAF_MAX if 0
+ * @return The octree, to be freed with octree_free
+ */
+OCTREE* octree_alloc(uint32_t natom, double minEdge, uint32_t leafMax)
+{
+  OCTREE* t = malloc(sizeof(OCTREE));
+
+  t->natom   = natom;
+  t->nbuilt  = 0;
+  t->leafMax = (leafMax > 0) ? leafMax : OCTREE_LEAF_MAX;
+  t->minEdge = minEdge;
+
+  // a first guess for a dense system with leaves of about leafMax atoms, increased later if necessary
+  t->capacity  = 64 + natom/4;
+  t->nodes     = malloc(t->capacity*sizeof(OCTNODE));
+  t->nnodes    = 0;
+  t->freeGroup = -1;
+
+  t->leaf = malloc(natom*sizeof(int32_t));
+  t->next = malloc(natom*sizeof(int32_t));
+  t->prev = malloc(natom*sizeof(int32_t));
+
+  t->nleaves   = 0;
+  t->leaves    = NULL;
+  t->lstart    = NULL;
+  t->lnear     = NULL;
+  t->lcapacity = 0;
+  t->ncapacity = 0;
+  t->stack     = NULL;
+  t->scapacity = 0;
+
+  t->nbuild  = 0;
+  t->nupdate = 0;
+  t->nmoved  = 0;
+
+  return t;
+}
+
+/**
+ * @brief Frees the octree
+ *
+ * @param t The octree
+ */
+void octree_free(OCTREE* t)
+{
+  free(t->nodes);
+  free(t->leaf);
+  free(t->next);
+  free(t->prev);
+  free(t->leaves);
+  free(t->lstart);
+  free(t->lnear);
+  free(t->stack);
+  free(t);
+}
+
+/// a group of 8 consecutive nodes, from the free groups or at the end of the array : the nodes may move in memory
+static int32_t octree_new_group(OCTREE* t)
+{
+  if(t->freeGroup >= 0)
+  {
+    const int32_t g = t->freeGroup;
+    t->freeGroup = t->nodes[g].child;
+    return g;
+  }
+
+  if(t->nnodes + 8 > t->capacity)
+  {
+    t->capacity = 2*t->capacity + 8;
+    t->nodes = realloc(t->nodes,t->capacity*sizeof(OCTNODE));
+  }
+  const int32_t g = (int32_t) t->nnodes;
+  t->nnodes += 8;
+  return g;
+}
+
+static inline void octree_free_group(OCTREE* t, int32_t g)
+{
+  t->nodes[g].child = t->freeGroup;
+  t->freeGroup = g;
+}
+
+/// the 8 children of the cube (lo,edge) as empty leaves of the parent k, in the group g
+static void octree_init_group(OCTREE* t, int32_t g, int32_t k, const double lo[3], double edge)
+{
+  const double h = 0.5*edge;
+  for(uint32_t c=0; c<8; c++)
+  {
+    OCTNODE* ch = &(t->nodes[g+c]);
+    for(uint32_t d=0; d<3; d++)
+      ch->lo[d] = ((c>>d)&1) ? lo[d]+h : lo[d];
+    ch->edge   = h;
+    ch->child  = -1;
+    ch->parent = k;
+    ch->count  = 0;
+    ch->head   = -1;
+    ch->slot   = -1;
+  }
+}
+
+/// index from 0 to 7 of the child of nd containing the point
+static inline uint32_t octree_octant(const OCTNODE* nd, double x, double y, double z)
+{
+  const double h = 0.5*nd->edge;
+  return (uint32_t)(x >= nd->lo[0]+h) | ((uint32_t)(y >= nd->lo[1]+h) << 1) | ((uint32_t)(z >= nd->lo[2]+h) << 2);
+}
+
+static inline int32_t octree_contains(const OCTNODE* nd, double x, double y, double z)
+{
+  return (x >= nd->lo[0]) && (x < nd->lo[0]+nd->edge)
+      && (y >= nd->lo[1]) && (y < nd->lo[1]+nd->edge)
+      && (z >= nd->lo[2]) && (z < nd->lo[2]+nd->edge);
+}
+
+static inline int32_t octree_too_full(const OCTREE* t, int32_t k)
+{
+  return (t->nodes[k].count > t->leafMax) && (0.5*t->nodes[k].edge >= t->minEdge);
+}
+
+/// adds the atom i to the leaf k, without counting it
+static inline void octree_link(OCTREE* t, int32_t k, uint32_t i)
+{
+  OCTNODE* nd = &(t->nodes[k]);
+  t->next[i] = nd->head;
+  t->prev[i] = -1;
+  if(nd->head >= 0)
+    t->prev[nd->head] = (int32_t) i;
+  nd->head = (int32_t) i;
+  t->leaf[i] = k;
+}
+
+/// removes the atom i from its leaf, without counting it
+static inline void octree_unlink(OCTREE* t, uint32_t i)
+{
+  if(t->prev[i] >= 0)
+    t->next[t->prev[i]] = t->next[i];
+  else
+    t->nodes[t->leaf[i]].head = t->next[i];
+  if(t->next[i] >= 0)
+    t->prev[t->next[i]] = t->prev[i];
+}
+
+/// the node k changed of index : its children, or the atoms of the leaf, follow it
+static void octree_relink(OCTREE* t, int32_t k)
+{
+  if(t->nodes[k].child >= 0)
+  {
+    for(uint32_t c=0; c<8; c++)
+      t->nodes[t->nodes[k].child+c].parent = k;
+  }
+  else
+  {
+    for(int32_t i=t->nodes[k].head; i>=0; i=t->next[i])
+      t->leaf[i] = k;
+  }
+}
+
+/// the too full leaf k gets 8 children, among which its atoms are shared, and which are split in turn if too full
+static void octree_split(OCTREE* t, int32_t k, const double x[], const double y[], const double z[])
+{
+  const int32_t g = octree_new_group(t);
+  octree_init_group(t,g,k,t->nodes[k].lo,t->nodes[k].edge);
+
+  OCTNODE* nd = &(t->nodes[k]);
+  int32_t i = nd->head;
+  nd->head  = -1;
+  nd->child = g;
+  while(i >= 0)
+  {
+    const int32_t inext = t->next[i];
+    const int32_t c = g + (int32_t) octree_octant(nd,x[i],y[i],z[i]);
+    octree_link(t,c,(uint32_t)i);
+    t->nodes[c].count++;
+    i = inext;
+  }
+
+  for(int32_t c=g; c<g+8; c++)
+    if(octree_too_full(t,c))
+      octree_split(t,c,x,y,z);
+}
+
+/// the root doubles until it contains the point, the former root becoming one of its children
+static void octree_grow(OCTREE* t, double x, double y, double z)
+{
+  if(!isfinite(x) || !isfinite(y) || !isfinite(z))
+  {
+    LOG_PRINT(LOG_ERROR,"Error : non finite coordinates (%lf,%lf,%lf) cannot be stored in the octree\n",x,y,z);
+    exit(-1);
+  }
+
+  while(!octree_contains(&(t->nodes[0]),x,y,z))
+  {
+    const int32_t g = octree_new_group(t);
+    OCTNODE* r = &(t->nodes[0]);
+
+    // the former root is the lower or the upper half of the larger cube along each axis, towards the point
+    const double e = 2.0*r->edge;
+    const double p[3] = {x, y, z};
+    double lo[3];
+    uint32_t c = 0;
+    for(uint32_t d=0; d<3; d++)
+    {
+      lo[d] = r->lo[d];
+      if(p[d] < r->lo[d])
+      {
+        lo[d] -= r->edge;
+        c |= 1u << d;
+      }
+    }
+
+    octree_init_group(t,g,0,lo,e);
+    const int32_t k = g + (int32_t) c;
+    t->nodes[k] = *r;
+    t->nodes[k].parent = 0;
+    octree_relink(t,k);
+
+    r->lo[0] = lo[0];
+    r->lo[1] = lo[1];
+    r->lo[2] = lo[2];
+    r->edge  = e;
+    r->child = g;
+    r->head  = -1;
+  }
+}
+
+/// adds the atom i, going down from the root and splitting its leaf if too full
+static void octree_insert(OCTREE* t, uint32_t i, const double x[], const double y[], const double z[])
+{
+  if(!octree_contains(&(t->nodes[0]),x[i],y[i],z[i]))
+    octree_grow(t,x[i],y[i],z[i]);
+
+  int32_t k = 0;
+  for(;;)
+  {
+    t->nodes[k].count++;
+    if(t->nodes[k].child < 0)
+      break;
+    k = t->nodes[k].child + (int32_t) octree_octant(&(t->nodes[k]),x[i],y[i],z[i]);
+  }
+
+  octree_link(t,k,i);
+  if(octree_too_full(t,k))
+    octree_split(t,k,x,y,z);
+}
+
+/// moves all the atoms of the subtree of k to the leaf dst, freeing the groups of children on the way
+static void octree_gather(OCTREE* t, int32_t k, int32_t dst)
+{
+  const int32_t g = t->nodes[k].child;
+  if(g >= 0)
+  {
+    for(int32_t c=g; c<g+8; c++)
+      octree_gather(t,c,dst);
+    octree_free_group(t,g);
+    return;
+  }
+
+  for(int32_t i=t->nodes[k].head; i>=0; )
+  {
+    const int32_t inext = t->next[i];
+    octree_link(t,dst,(uint32_t)i);
+    i = inext;
+  }
+}
+
+/// the subtrees with at most leafMax/2 atoms become single leaves : a margin with the split, against splitting back and forth
+static void octree_merge(OCTREE* t, int32_t k)
+{
+  const int32_t g = t->nodes[k].child;
+  if(g < 0)
+    return;
+
+  if(t->nodes[k].count <= t->leafMax/2)
+  {
+    t->nodes[k].child = -1;
+    t->nodes[k].head  = -1;
+    for(int32_t c=g; c<g+8; c++)
+      octree_gather(t,c,k);
+    octree_free_group(t,g);
+    return;
+  }
+
+  for(int32_t c=g; c<g+8; c++)
+    octree_merge(t,c);
+}
+
+/// while all the atoms are in one child of the root, this child becomes the root (the others are empty leaves after octree_merge)
+static void octree_shrink(OCTREE* t)
+{
+  while(t->nodes[0].child >= 0 && t->nodes[0].count > 0)
+  {
+    const int32_t g = t->nodes[0].child;
+    int32_t k = -1;
+    for(int32_t c=g; c<g+8; c++)
+      if(t->nodes[c].count == t->nodes[0].count)
+        k = c;
+    if(k < 0)
+      break;
+
+    t->nodes[0] = t->nodes[k];
+    t->nodes[0].parent = -1;
+    octree_relink(t,0);
+    octree_free_group(t,g);
+  }
+}
+
+/**
+ * @brief Builds the octree of the n first atoms from scratch : the root is the smallest cube of edge 2^k containing them
+ *
+ * @param t The octree
+ * @param n Number of atoms, not larger than the capacity
+ * @param x,y,z The coordinates
+ */
+void octree_build(OCTREE* t, uint32_t n, const double x[], const double y[], const double z[])
+{
+  double lo[3] = {0.0, 0.0, 0.0};
+  double hi[3] = {0.0, 0.0, 0.0};
+  if(n > 0)
+  {
+    lo[0] = hi[0] = x[0];
+    lo[1] = hi[1] = y[0];
+    lo[2] = hi[2] = z[0];
+  }
+  for(uint32_t i=1; i<n; i++)
+  {
+    lo[0] = fmin(lo[0],x[i]);  hi[0] = fmax(hi[0],x[i]);
+    lo[1] = fmin(lo[1],y[i]);  hi[1] = fmax(hi[1],y[i]);
+    lo[2] = fmin(lo[2],z[i]);  hi[2] = fmax(hi[2],z[i]);
+  }
+
+  const double extent = fmax(fmax(hi[0]-lo[0],hi[1]-lo[1]),fmax(hi[2]-lo[2],t->minEdge));
+  if(!isfinite(extent))
+  {
+    LOG_PRINT(LOG_ERROR,"Error : non finite coordinates cannot be stored in the octree\n");
+    exit(-1);
+  }
+
+  // the corner on a multiple of a power of two not larger than half of minEdge, below the edges of all the nodes
+  const double q = ldexp(1.0,ilogb(0.5*t->minEdge));
+  for(uint32_t d=0; d<3; d++)
+    lo[d] = q*floor(lo[d]/q);
+
+  // a power of two edge, doubled until the cube contains all the atoms
+  double e = ldexp(1.0,ilogb(extent));
+  while(lo[0]+e <= hi[0] || lo[1]+e <= hi[1] || lo[2]+e <= hi[2])
+    e *= 2.0;
+
+  t->nnodes    = 1;
+  t->freeGroup = -1;
+  OCTNODE* r = &(t->nodes[0]);
+  for(uint32_t d=0; d<3; d++)
+    r->lo[d] = lo[d];
+  r->edge   = e;
+  r->child  = -1;
+  r->parent = -1;
+  r->count  = 0;
+  r->head   = -1;
+  r->slot   = -1;
+
+  for(uint32_t i=0; i<n; i++)
+    octree_insert(t,i,x,y,z);
+
+  t->nbuilt = n;
+  t->nbuild++;
+}
+
+/**
+ * @brief Moves the atoms which left the cube of their leaf, then merges the nodes which became too empty : the cost
+ *  follows the number of atoms which changed of leaf since the previous call, plus a pass over the nodes.
+ *  The atoms must not have been renumbered since the previous call (the octree is then built from scratch when
+ *  their number changed only).
+ *
+ * @param t The octree
+ * @param n Number of atoms
+ * @param x,y,z The coordinates
+ */
+void octree_update(OCTREE* t, uint32_t n, const double x[], const double y[], const double z[])
+{
+  if(t->nbuilt == 0 || t->nbuilt != n)
+  {
+    octree_build(t,n,x,y,z);
+    return;
+  }
+
+  uint32_t moved = 0;
+  for(uint32_t i=0; i<n; i++)
+  {
+    const int32_t k = t->leaf[i];
+    if(octree_contains(&(t->nodes[k]),x[i],y[i],z[i]))
+      continue;
+
+    octree_unlink(t,i);
+    for(int32_t p=k; p>=0; p=t->nodes[p].parent)
+      t->nodes[p].count--;
+    octree_insert(t,i,x,y,z);
+    moved++;
+  }
+
+  if(moved > 0)
+  {
+    octree_merge(t,0);
+    octree_shrink(t);
+  }
+
+  t->nmoved += moved;
+  t->nupdate++;
+}
+
+/// pushes the node k on the traversal stack
+static inline void octree_push(OCTREE* t, uint32_t* top, int32_t k)
+{
+  if(*top == t->scapacity)
+  {
+    t->scapacity = 2*t->scapacity + 64;
+    t->stack = realloc(t->stack,t->scapacity*sizeof(int32_t));
+  }
+  t->stack[(*top)++] = k;
+}
+
+/// squared distance between two cubes, 0 if they overlap or touch
+static inline double octree_dist2(const OCTNODE* a, const OCTNODE* b)
+{
+  double d2 = 0.0;
+  for(uint32_t d=0; d<3; d++)
+  {
+    const double gap = fmax(a->lo[d] - (b->lo[d]+b->edge), b->lo[d] - (a->lo[d]+a->edge));
+    d2 += (gap > 0.0) ? gap*gap : 0.0;
+  }
+  return d2;
+}
+
+/**
+ * @brief Lists the non empty leaves, depth first, and for each of them the non empty leaves whose cube is closer than r
+ *  to its own (itself included) : the pairs of atoms closer than r are among the atoms of these leaves.
+ *  The slot of each non empty leaf gives its row in lstart and lnear.
+ *
+ * @param t The octree, built or updated with the current coordinates
+ * @param r Search distance
+ */
+void octree_near_leaves(OCTREE* t, double r)
+{
+  const double r2 = r*r;
+  uint32_t top = 0;
+
+  t->nleaves = 0;
+  octree_push(t,&top,0);
+  while(top > 0)
+  {
+    const int32_t k = t->stack[--top];
+    if(t->nodes[k].count == 0)
+      continue;
+
+    if(t->nodes[k].child >= 0)
+    {
+      // pushed in reverse so that the children are visited in order
+      for(int32_t c=7; c>=0; c--)
+        octree_push(t,&top,t->nodes[k].child+c);
+      continue;
+    }
+
+    if(t->nleaves+1 >= t->lcapacity)
+    {
+      t->lcapacity = 2*t->lcapacity + 64;
+      t->leaves = realloc(t->leaves,t->lcapacity*sizeof(int32_t));
+      t->lstart = realloc(t->lstart,t->lcapacity*sizeof(uint32_t));
+    }
+    t->nodes[k].slot = (int32_t) t->nleaves;
+    t->leaves[t->nleaves++] = k;
+  }
+
+  uint32_t nn = 0;
+  for(uint32_t s=0; s<t->nleaves; s++)
+  {
+    const OCTNODE* a = &(t->nodes[t->leaves[s]]);
+    t->lstart[s] = nn;
+
+    octree_push(t,&top,0);
+    while(top > 0)
+    {
+      const int32_t k = t->stack[--top];
+      const OCTNODE* nd = &(t->nodes[k]);
+      if(nd->count == 0 || octree_dist2(a,nd) >= r2)
+        continue;
+
+      if(nd->child >= 0)
+      {
+        for(int32_t c=7; c>=0; c--)
+          octree_push(t,&top,nd->child+c);
+        continue;
+      }
+
+      if(nn == t->ncapacity)
+      {
+        t->ncapacity = 2*t->ncapacity + 256;
+        t->lnear = realloc(t->lnear,t->ncapacity*sizeof(int32_t));
+      }
+      t->lnear[nn++] = k;
+    }
+  }
+  t->lstart[t->nleaves] = nn;
+}
+
+/// depth of the subtree of k, 0 for a leaf
+static uint32_t octree_depth_from(const OCTREE* t, int32_t k)
+{
+  const int32_t g = t->nodes[k].child;
+  if(g < 0)
+    return 0;
+
+  uint32_t dmax = 0;
+  for(int32_t c=g; c<g+8; c++)
+  {
+    const uint32_t d = octree_depth_from(t,c);
+    dmax = (d > dmax) ? d : dmax;
+  }
+  return dmax+1;
+}
+
+/**
+ * @brief Depth of the octree
+ *
+ * @param t The octree
+ * @return The number of levels below the root
+ */
+uint32_t octree_depth(const OCTREE* t)
+{
+  return (t->nnodes > 0) ? octree_depth_from(t,0) : 0;
+}
+
+/**
+ * @brief Memory allocated by the octree
+ *
+ * @param t The octree
+ * @return The size in bytes
+ */
+size_t octree_memory(const OCTREE* t)
+{
+  return sizeof(OCTREE) + (size_t)t->capacity*sizeof(OCTNODE) + 3*(size_t)t->natom*sizeof(int32_t)
+       + (size_t)t->lcapacity*(sizeof(int32_t)+sizeof(uint32_t)) + (size_t)t->ncapacity*sizeof(int32_t)
+       + (size_t)t->scapacity*sizeof(int32_t);
+}
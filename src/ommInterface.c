@@ -14,13 +14,16 @@
  */
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include "logger.h"
+#include "minimiser.h"
 #include "ommInterface.h"
 
-const char* ommPlatformName[4] = { "Reference\0", "CPU\0", "CUDA\0", "OpenCL\0" };
-const char* integratorsName[2] = { "LANGEVIN\0", "BROWNIAN\0" };
+/// force group of the Lennard-Jones NonbondedForce, the only one evaluated by getEnergy_omm
+#define OMM_LJ_GROUP 1
 
 /*
  * modification of omm example file HelloSodiumChlorideInC.c
@@ -53,14 +56,20 @@ MyOpenMMData* init_omm(ATOM atoms[], DATA* dat)
     * System takes ownership of the force objects; don't delete them yourself. */
   omm->system = OpenMM_System_create();
   nonbond     = OpenMM_NonbondedForce_create();
-  OpenMM_NonbondedForce_setNonbondedMethod(nonbond,OpenMM_NonbondedForce_CutoffNonPeriodic);
+  // NONBOND PBC : minimum image convention in the orthorhombic box, the cutoff being checked when parsing
+  OpenMM_NonbondedForce_setNonbondedMethod(nonbond,dat->pbc ? OpenMM_NonbondedForce_CutoffPeriodic
+                                                            : OpenMM_NonbondedForce_CutoffNonPeriodic);
   
   OpenMM_Boolean testPBC = OpenMM_NonbondedForce_usesPeriodicBoundaryConditions(nonbond);
-  if(testPBC == OpenMM_True)
+  if((testPBC == OpenMM_True) != (dat->pbc != 0))
   {
-    LOG_PRINT(LOG_ERROR,"Error : nonbonded force claims to use PBC but this should be impossible !\n");
+    LOG_PRINT(LOG_ERROR,"Error : nonbonded force %s PBC while NONBOND %s was requested !\n",
+              (testPBC == OpenMM_True) ? "uses" : "does not use", dat->pbc ? "PBC" : "NOPBC");
     exit(-1);
   }
+
+  if(dat->pbc)
+    OpenMM_NonbondedForce_setCutoffDistance(nonbond,dat->cutoff);
   
   if(isfinite(dat->cuton) && isfinite(dat->cutoff) && (dat->cuton < dat->cutoff))
   {
@@ -70,9 +79,18 @@ MyOpenMMData* init_omm(ATOM atoms[], DATA* dat)
     OpenMM_NonbondedForce_setCutoffDistance(nonbond,dat->cutoff);
   }
   
+  // in its own force group, so that getEnergy_omm asks the platform for this term only
+  OpenMM_Force_setForceGroup((OpenMM_Force*)nonbond,OMM_LJ_GROUP);
   OpenMM_System_addForce(omm->system, (OpenMM_Force*)nonbond);
   
-//   OpenMM_System_setDefaultPeriodicBoxVectors(omm->system,&a,&b,&c);
+  if(dat->pbc)
+  {
+    const OpenMM_Vec3 a = {dat->box[0], 0.0, 0.0};
+    const OpenMM_Vec3 b = {0.0, dat->box[1], 0.0};
+    const OpenMM_Vec3 c = {0.0, 0.0, dat->box[2]};
+    OpenMM_System_setDefaultPeriodicBoxVectors(omm->system,&a,&b,&c);
+    LOG_PRINT(LOG_INFO," Periodic box of %lf x %lf x %lf nm for openMM.\n",dat->box[0],dat->box[1],dat->box[2]);
+  }
 
   /* Specify the atoms and their properties:
   *  (1) System needs to know the masses.
@@ -82,12 +100,14 @@ MyOpenMMData* init_omm(ATOM atoms[], DATA* dat)
   initialPosInNm = OpenMM_Vec3Array_create(0);
   for(uint32_t n=0; n < dat->natom; n++)
   {
-    OpenMM_System_addParticle(omm->system, atoms[n].pars.mass);
+    const PARAMS* p = &(dat->species.pars[atoms[n].type]);
+
+    OpenMM_System_addParticle(omm->system, p->mass);
     
     // add particle
-    OpenMM_NonbondedForce_addParticle(nonbond,atoms[n].pars.charge,
-                                      atoms[n].pars.sig,
-                                      atoms[n].pars.eps
+    OpenMM_NonbondedForce_addParticle(nonbond,p->charge,
+                                      p->sig,
+                                      p->eps
     );
     
     // open mm expects nanometers for the unit of distance, so we need to convert from Angstroems to nm 
@@ -153,7 +173,36 @@ MyOpenMMData* init_omm(ATOM atoms[], DATA* dat)
   }
   
   
-  omm->context = OpenMM_Context_create_2(omm->system, omm->integrator, platform);
+  const char* pname = OpenMM_Platform_getName(platform);
+  OpenMM_PropertyMap* properties = OpenMM_PropertyMap_create();
+
+  // the CPU platform uses as many threads as the native engine (NTHREADS keyword)
+  if(!strcmp(pname,"CPU"))
+  {
+    char nthreads[32]="";
+    sprintf(nthreads,"%d",dat->nthreads);
+    OpenMM_PropertyMap_set(properties,"Threads",nthreads);
+  }
+
+  // only the CUDA and OpenCL platforms have a Precision property : CPU is always mixed and Reference always double
+  if(dat->precision != PREC_DEFAULT)
+  {
+    if(!strcmp(pname,"CUDA") || !strcmp(pname,"OpenCL"))
+      OpenMM_PropertyMap_set(properties,"Precision",precisionsName[dat->precision]);
+    else
+      LOG_PRINT(LOG_WARNING,"Warning : PRECISION %s ignored by the OpenMM platform %s\n",precisionsName[dat->precision],pname);
+  }
+
+  // the splitting of the Lennard-Jones interaction is only implemented by the native engine
+  if(dat->respaSteps > 1)
+    LOG_PRINT(LOG_WARNING,"Warning : RESPA ignored by the OpenMM platform %s, use PLATFORM NATIVE\n",pname);
+
+  // the OpenMM platforms already sort the atoms spatially in their own data structures
+  if(dat->reorder != NO_REORDER)
+    LOG_PRINT(LOG_WARNING,"Warning : REORDER ignored by the OpenMM platform %s, which sorts the atoms itself\n",pname);
+
+  omm->context = OpenMM_Context_create_3(omm->system, omm->integrator, platform, properties);
+  OpenMM_PropertyMap_destroy(properties);
   
 //   omm->context = OpenMM_Context_create(omm->system, omm->integrator);
   
@@ -166,6 +215,14 @@ MyOpenMMData* init_omm(ATOM atoms[], DATA* dat)
   
   // set velocities to initial temperature
   OpenMM_Context_setVelocitiesToTemperature(omm->context,dat->T,dat->seeds[0]);
+
+  // created only if energies of other positions are requested, see getEnergy_omm
+  omm->econtext    = NULL;
+  omm->eintegrator = NULL;
+  omm->epos        = NULL;
+
+  omm->minimiser   = (MINIMISERS) dat->minimiser;
+  omm->minimHistory = dat->minimHistory;
     
   return omm;
 }
@@ -227,12 +284,165 @@ void getState_omm(MyOpenMMData* omm, int wantEnergy,
     case BROWNIAN:
       *currentTemperature = OpenMM_BrownianIntegrator_getTemperature((OpenMM_BrownianIntegrator*)omm->integrator);
       break;
+
+    default:
+      break;
   }
   
   OpenMM_State_destroy(state);
   
 }
 
+// -----------------------------------------------------------------------------
+//          POTENTIAL ENERGY ONLY, OF THE CURRENT OR OF OTHER POSITIONS
+// -----------------------------------------------------------------------------
+/**
+ * @brief Potential energy without forces nor velocities : only OpenMM_State_Energy of the force group of the
+ *  Lennard-Jones NonbondedForce (OMM_LJ_GROUP) is requested, so that the platform evaluates this energy term only
+ *  and nothing else is transferred.
+ *
+ * Other positions (e.g. Monte Carlo trial moves) are evaluated in a second Context on the same System,
+ * platform and properties, created at the first call, so that the state of the simulation is not modified.
+ *
+ * @param omm OpenMM data
+ * @param atoms Positions in angstroems, or NULL for the current positions of the simulation
+ * @return The potential energy in kJ/mol
+ */
+double getEnergy_omm(MyOpenMMData* omm, const ATOM atoms[])
+{
+  OpenMM_Context* cont = omm->context;
+
+  if(atoms != NULL)
+  {
+    const int n = OpenMM_System_getNumParticles(omm->system);
+
+    if(omm->econtext == NULL)
+    {
+      // same platform and same property values (threads, precision, device...) than the simulation context
+      OpenMM_Platform* platform = OpenMM_Context_getPlatform(omm->context);
+      const OpenMM_StringArray* names = OpenMM_Platform_getPropertyNames(platform);
+      OpenMM_PropertyMap* properties = OpenMM_PropertyMap_create();
+      for(int k=0; k<OpenMM_StringArray_getSize(names); k++)
+      {
+        const char* name = OpenMM_StringArray_get(names,k);
+        OpenMM_PropertyMap_set(properties,name,OpenMM_Platform_getPropertyValue(platform,omm->context,name));
+      }
+
+      omm->eintegrator = (OpenMM_Integrator*)OpenMM_VerletIntegrator_create(0.001);
+      omm->econtext    = OpenMM_Context_create_3(omm->system,omm->eintegrator,platform,properties);
+      omm->epos        = OpenMM_Vec3Array_create(n);
+      OpenMM_PropertyMap_destroy(properties);
+    }
+
+    for(int i=0; i<n; i++)
+    {
+      const OpenMM_Vec3* posInAng = (const OpenMM_Vec3*) &(atoms[i].xyz);
+      OpenMM_Vec3Array_set(omm->epos,i,OpenMM_Vec3_scale(*posInAng,OpenMM_NmPerAngstrom));
+    }
+
+    OpenMM_Context_setPositions(omm->econtext,omm->epos);
+    cont = omm->econtext;
+  }
+
+  OpenMM_State* state = OpenMM_Context_getState_2(cont, OpenMM_State_Energy, 0, 1<<OMM_LJ_GROUP);
+  const double epot = OpenMM_State_getPotentialEnergy(state);
+  OpenMM_State_destroy(state);
+
+  return epot;
+}
+
+// -----------------------------------------------------------------------------
+//                     LOCAL ENERGY MINIMISATION USING OpenMM
+// -----------------------------------------------------------------------------
+
+/// positions and forces of the context copied as a structure of arrays for the minimisers of minimiser.c
+typedef struct
+{
+  MyOpenMMData* omm;
+  uint32_t n;
+  double *x,*y,*z;
+  double *fx,*fy,*fz;
+  OpenMM_Vec3Array* pos;
+} OMM_MINIM;
+
+/// sets the positions of the context and gets back its forces : the context is never rebuilt
+static double minim_forces_omm(void* ctx)
+{
+  OMM_MINIM* m = (OMM_MINIM*)ctx;
+
+  for(uint32_t i=0; i<m->n; i++)
+  {
+    const OpenMM_Vec3 p = {m->x[i], m->y[i], m->z[i]};
+    OpenMM_Vec3Array_set(m->pos,i,p);
+  }
+  OpenMM_Context_setPositions(m->omm->context,m->pos);
+
+  OpenMM_State* state = OpenMM_Context_getState(m->omm->context,OpenMM_State_Forces|OpenMM_State_Energy,0);
+  const OpenMM_Vec3Array* forces = OpenMM_State_getForces(state);
+  for(uint32_t i=0; i<m->n; i++)
+  {
+    const OpenMM_Vec3* f = OpenMM_Vec3Array_get(forces,i);
+    m->fx[i] = f->x;
+    m->fy[i] = f->y;
+    m->fz[i] = f->z;
+  }
+  const double epot = OpenMM_State_getPotentialEnergy(state);
+  OpenMM_State_destroy(state);
+
+  return epot;
+}
+
+/**
+ * @brief Local energy minimisation with the algorithm of the MINIMIZE keyword : FIRE or L-BFGS on the forces of the context,
+ *  or OpenMM_LocalEnergyMinimizer for LOCAL ; velocities are not modified
+ *
+ * @param omm OpenMM data
+ * @param tolerance root mean square of the force components for convergence, in kJ/mol/nm
+ * @param maxSteps maximum number of iterations, 0 means until convergence
+ */
+void minimise_omm(MyOpenMMData* omm, double tolerance, int maxSteps)
+{
+  if(omm->minimiser == LOCAL)
+  {
+    OpenMM_LocalEnergyMinimizer_minimize(omm->context,tolerance,maxSteps);
+    return;
+  }
+
+  OMM_MINIM m;
+  m.omm = omm;
+  m.n   = (uint32_t) OpenMM_System_getNumParticles(omm->system);
+  m.x   = malloc(7*(size_t)m.n*sizeof(double));
+  m.y   = m.x+m.n;
+  m.z   = m.x+2*m.n;
+  m.fx  = m.x+3*m.n;
+  m.fy  = m.x+4*m.n;
+  m.fz  = m.x+5*m.n;
+  m.pos = OpenMM_Vec3Array_create(m.n);
+  double* mass = m.x+6*m.n;
+
+  OpenMM_State* state = OpenMM_Context_getState(omm->context,OpenMM_State_Positions,0);
+  const OpenMM_Vec3Array* pos = OpenMM_State_getPositions(state);
+  for(uint32_t i=0; i<m.n; i++)
+  {
+    const OpenMM_Vec3* p = OpenMM_Vec3Array_get(pos,i);
+    m.x[i] = p->x;
+    m.y[i] = p->y;
+    m.z[i] = p->z;
+    mass[i] = OpenMM_System_getParticleMass(omm->system,(int)i);
+  }
+  OpenMM_State_destroy(state);
+
+  MINIM_SYS sys = { m.n, m.x, m.y, m.z, m.fx, m.fy, m.fz, mass, &minim_forces_omm, &m };
+  MINIM_STATS st;
+  minim_run(&sys,omm->minimiser,tolerance,(uint32_t)maxSteps,omm->minimHistory,&st);
+
+  LOG_PRINT(LOG_DEBUG,"OpenMM %s minimisation : %d iterations, %d force evaluations, final epot = %lf kJ/mol, rms force = %le kJ/mol/nm%s\n",
+            minimisersName[omm->minimiser],st.iter,st.nforces,st.epot,st.frms,st.converged ? "" : " (not converged)");
+
+  OpenMM_Vec3Array_destroy(m.pos);
+  free(m.x);
+}
+
 // -----------------------------------------------------------------------------
 //             OpenMM print some information about current platform
 // -----------------------------------------------------------------------------
@@ -265,6 +475,12 @@ void infos_omm(const MyOpenMMData* omm)
 // -----------------------------------------------------------------------------
 void terminate_omm(MyOpenMMData* omm) {
     /* Clean up top-level heap allocated objects that we're done with now. */
+    if(omm->econtext != NULL)
+    {
+      OpenMM_Context_destroy(omm->econtext);
+      OpenMM_Integrator_destroy(omm->eintegrator);
+      OpenMM_Vec3Array_destroy(omm->epos);
+    }
     OpenMM_Context_destroy(omm->context);
     OpenMM_Integrator_destroy(omm->integrator);
     OpenMM_System_destroy(omm->system);
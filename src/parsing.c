@@ -23,10 +23,26 @@
 #include "io.h"
 #include "tools.h"
 #include "logger.h"
-#include "ommInterface.h"
+#include "engine.h"
 
-///the array of params size
-static uint32_t pars_size = 0 ;
+/// value following the option opt of the keyword kw on the current line of the input file : exits with an error if it is missing
+static const char* option_value(const char kw[], const char opt[])
+{
+    const char* val = strtok(NULL," \n\t");
+    if (val == NULL)
+    {
+        LOG_PRINT(LOG_ERROR,"%s %s should be followed by a value.\n",kw,opt);
+        exit(-1);
+    }
+    return val;
+}
+
+/// yes/no value following the option opt of the keyword kw : YES, ON or 1 are true, anything else false
+static uint8_t option_yes_no(const char kw[], const char opt[])
+{
+    const char* yn = option_value(kw,opt);
+    return (uint8_t) (!strcasecmp(yn,"YES") || !strcasecmp(yn,"ON") || !strcmp(yn,"1"));
+}
 
 /**
  * @brief his function parses the input file, fills fields of the DATA structure,
@@ -40,10 +56,44 @@ static uint32_t pars_size = 0 ;
  */
 void parse_from_file(char fname[], DATA *dat, ATOM **at)
 {
-    PARAMS *pars=NULL;
+    SPECIES *sp = &(dat->species);
 
     char buff1[FILENAME_MAX]="", *buff2=NULL, *buff3=NULL ;
 
+    // default values for keywords which are optional
+    dat->platform = AUTO;
+    dat->precision = PREC_DEFAULT;
+    dat->skin = 0.1;
+    dat->pbc = 0;
+    dat->box[0] = dat->box[1] = dat->box[2] = 0.0;
+    dat->tableBins = 0;
+    dat->domains = 0;
+    dat->octree = 0;
+    dat->adaptDisp = 0.0;
+    dat->adaptDtMin = 0.0;
+    dat->adaptGrowth = 1.1;
+    dat->respaSteps = 0;
+    dat->respaSplit = 0.0;
+    dat->respaHeal = 0.1;
+    dat->reorder = NO_REORDER;
+    dat->reorderEvery = 1000;
+    dat->minimiser = FIRE;
+    dat->minimTol = 10.0;
+    dat->minimMaxIter = 0;
+    dat->minimHistory = 8;
+    dat->minimBlocks = 1;
+    dat->evapCheck = 0;
+    dat->evapRadius = 0.0;
+    dat->evapStop = 0.0;
+    dat->evap = NULL;
+    dat->nevap = 0;
+    dat->nthreads = get_ncpus_affinity();
+    dat->replicas = 1;
+    sp->n = 0;
+    sp->pars  = NULL;
+    sp->sigij = NULL;
+    sp->epsij = NULL;
+
     FILE *ifile=NULL;
     ifile=fopen(fname,"r");
 
@@ -80,6 +130,7 @@ void parse_from_file(char fname[], DATA *dat, ATOM **at)
                *  CPU  : on cpu, optimised, parallellised with OpenMP
                *  OCL  : on cpu or gpu or any accelerating device available
                *  CUDA : on nvidia gpu only probably the fastest
+               *  NATIVE : built-in Lennard-Jones engine, OpenMM not used
                */
               if (!strcasecmp(buff3,"AUTO"))
                 dat->platform = AUTO;
@@ -91,9 +142,26 @@ void parse_from_file(char fname[], DATA *dat, ATOM **at)
                 dat->platform = CUDA;
               else if (!strcasecmp(buff3,"OCL"))
                 dat->platform = OCL;
+              else if (!strcasecmp(buff3,"NATIVE"))
+                dat->platform = NATIVE;
               else
               {
-                LOG_PRINT(LOG_ERROR,"%s %s is unknown. Should be REF or CPU or CUDA or OCL.\n",buff2,buff3);
+                LOG_PRINT(LOG_ERROR,"%s %s is unknown. Should be AUTO or REF or CPU or CUDA or OCL or NATIVE.\n",buff2,buff3);
+                exit(-1);
+              }
+            }
+            /// floating point precision of the forces, for the native engine and the OpenMM platforms having a Precision property
+            else if (!strcasecmp(buff2,"PRECISION"))
+            {
+              if (!strcasecmp(buff3,"SINGLE"))
+                dat->precision = SINGLE;
+              else if (!strcasecmp(buff3,"MIXED"))
+                dat->precision = MIXED;
+              else if (!strcasecmp(buff3,"DOUBLE"))
+                dat->precision = DOUBLE;
+              else
+              {
+                LOG_PRINT(LOG_ERROR,"%s %s is unknown. Should be SINGLE or MIXED or DOUBLE.\n",buff2,buff3);
                 exit(-1);
               }
             }
@@ -104,9 +172,13 @@ void parse_from_file(char fname[], DATA *dat, ATOM **at)
                   dat->method = LANGEVIN;
                 else if (!strcasecmp(buff3,"BROWNIAN"))
                   dat->method = BROWNIAN;
+                else if (!strcasecmp(buff3,"BAOAB"))
+                  dat->method = BAOAB;
+                else if (!strcasecmp(buff3,"BROWNIAN_LM"))
+                  dat->method = BROWNIAN_LM;
                 else
                 {
-                    LOG_PRINT(LOG_ERROR,"%s %s is unknown. Should be LANGEVIN or BROWNIAN.\n",buff2,buff3);
+                    LOG_PRINT(LOG_ERROR,"%s %s is unknown. Should be LANGEVIN or BROWNIAN or BAOAB or BROWNIAN_LM.\n",buff2,buff3);
                     exit(-1);
                 }
                 
@@ -117,14 +189,35 @@ void parse_from_file(char fname[], DATA *dat, ATOM **at)
                 tstep = strtok(NULL," \n\t");
                 dat->friction = atof(friction);
                 dat->timestep = atof(tstep);
+                dat->integrator = dat->method;
             }
             /// get the nonbonded parameters
             else if (!strcasecmp(buff2,"NONBOND"))
             {
-              // error if something else than nopbc given 
-              if (strcasecmp(buff3,"NOPBC"))
+              // isolated cluster, or orthorhombic periodic box whose edges are given in nm
+              if (!strcasecmp(buff3,"PBC"))
               {
-                LOG_PRINT(LOG_ERROR,"%s is not a valid keyword for PBC. Should be NOPBC and nothing else with current code.\n",buff3);
+                char *box=strtok(NULL," \n\t");
+                if (box==NULL || strcasecmp(box,"BOX"))
+                {
+                  LOG_PRINT(LOG_ERROR,"NONBOND PBC should be followed by BOX and the 3 edges of the box in nm.\n");
+                  exit(-1);
+                }
+                dat->pbc = 1;
+                for (uint32_t d=0; d<3; d++)
+                {
+                  box = strtok(NULL," \n\t");
+                  dat->box[d] = (box!=NULL) ? atof(box) : 0.0;
+                  if (!(dat->box[d] > 0.0))
+                  {
+                    LOG_PRINT(LOG_ERROR,"NONBOND PBC BOX requires 3 strictly positive edges in nm.\n");
+                    exit(-1);
+                  }
+                }
+              }
+              else if (strcasecmp(buff3,"NOPBC"))
+              {
+                LOG_PRINT(LOG_ERROR,"%s is not a valid keyword for PBC. Should be NOPBC or PBC BOX a b c.\n",buff3);
                 exit(-1);
               }
               
@@ -145,8 +238,232 @@ void parse_from_file(char fname[], DATA *dat, ATOM **at)
                 dat->cuton = atof(cuton);
                 dat->cutoff = atof(cutoff);
               }
+              
+              // optional keywords at the end of the line
+              char *opt=NULL;
+              while((opt = strtok(NULL," \n\t")) != NULL)
+              {
+                // skin of the Verlet neighbour lists, used by the NATIVE platform
+                if (!strcasecmp(opt,"SKIN"))
+                {
+                  dat->skin = atof(option_value(buff2,opt));
+                }
+                // tabulated pair potentials with the given number of bins, used by the NATIVE platform
+                else if (!strcasecmp(opt,"TABLE"))
+                {
+                  dat->tableBins = (uint32_t) atoi(option_value(buff2,opt));
+                }
+                // half neighbour list split in one domain per thread, used by the NATIVE platform
+                else if (!strcasecmp(opt,"DOMAINS"))
+                {
+                  dat->domains = option_yes_no(buff2,opt);
+                }
+                // neighbour lists built from an adaptive octree instead of the cell grid, used by the NATIVE platform
+                else if (!strcasecmp(opt,"OCTREE"))
+                {
+                  dat->octree = option_yes_no(buff2,opt);
+                }
+                else
+                {
+                  LOG_PRINT(LOG_ERROR,"%s is not a valid option of the NONBOND keyword.\n",opt);
+                  exit(-1);
+                }
+              }
+
+              // minimum image convention : an atom interacts with one image of each other atom at most
+              if (dat->pbc)
+              {
+                const double half = 0.5*fmin(dat->box[0],fmin(dat->box[1],dat->box[2]));
+                if (!isfinite(dat->cutoff) || dat->cutoff > half)
+                {
+                  LOG_PRINT(LOG_ERROR,"NONBOND PBC requires a cutoff not larger than half the smallest edge of the box (%lf nm).\n",half);
+                  exit(-1);
+                }
+              }
                 
             }
+            /// local energy minimisation at startup and after each block of TRSAVE steps
+            else if (!strcasecmp(buff2,"MINIMIZE"))
+            {
+              if (!strcasecmp(buff3,"FIRE"))
+                dat->minimiser = FIRE;
+              else if (!strcasecmp(buff3,"LOCAL"))
+                dat->minimiser = LOCAL;
+              else if (!strcasecmp(buff3,"LBFGS"))
+                dat->minimiser = LBFGS;
+              else if (!strcasecmp(buff3,"NONE"))
+                dat->minimiser = NO_MINIM;
+              else
+              {
+                LOG_PRINT(LOG_ERROR,"%s %s is unknown. Should be FIRE or LBFGS or LOCAL or NONE.\n",buff2,buff3);
+                exit(-1);
+              }
+
+              // optional keywords at the end of the line
+              char *opt=NULL;
+              while((opt = strtok(NULL," \n\t")) != NULL)
+              {
+                // rms force tolerance in kJ/mol/nm
+                if (!strcasecmp(opt,"TOLERANCE"))
+                {
+                  dat->minimTol = atof(option_value(buff2,opt));
+                }
+                // maximum number of iterations, 0 means until convergence
+                else if (!strcasecmp(opt,"MAXITER"))
+                {
+                  dat->minimMaxIter = (uint32_t) atoi(option_value(buff2,opt));
+                }
+                // number of corrections kept by L-BFGS
+                else if (!strcasecmp(opt,"HISTORY"))
+                {
+                  dat->minimHistory = (uint32_t) atoi(option_value(buff2,opt));
+                  if (dat->minimHistory == 0)
+                  {
+                    LOG_PRINT(LOG_ERROR,"MINIMIZE HISTORY should be at least 1.\n");
+                    exit(-1);
+                  }
+                }
+                // minimisation after each block of TRSAVE steps or only at startup
+                else if (!strcasecmp(opt,"BLOCKS"))
+                {
+                  dat->minimBlocks = option_yes_no(buff2,opt);
+                }
+                else
+                {
+                  LOG_PRINT(LOG_ERROR,"%s is not a valid option of the MINIMIZE keyword.\n",opt);
+                  exit(-1);
+                }
+              }
+            }
+            /// adaptive timestep : the timestep of METHOD is reduced so that no atom moves by more than MAXDISP nm in one step
+            else if (!strcasecmp(buff2,"ADAPTIVE"))
+            {
+              for(char *opt=buff3; opt != NULL; opt = strtok(NULL," \n\t"))
+              {
+                if (!strcasecmp(opt,"MAXDISP"))
+                {
+                  dat->adaptDisp = atof(option_value(buff2,opt));
+                }
+                // smallest timestep in ps
+                else if (!strcasecmp(opt,"DTMIN"))
+                {
+                  dat->adaptDtMin = atof(option_value(buff2,opt));
+                }
+                // largest growth factor of the timestep from one step to the next
+                else if (!strcasecmp(opt,"GROWTH"))
+                {
+                  dat->adaptGrowth = atof(option_value(buff2,opt));
+                }
+                else
+                {
+                  LOG_PRINT(LOG_ERROR,"%s is not a valid option of the ADAPTIVE keyword.\n",opt);
+                  exit(-1);
+                }
+              }
+
+              if (!(dat->adaptDisp > 0.0) || !(dat->adaptGrowth > 1.0))
+              {
+                LOG_PRINT(LOG_ERROR,"ADAPTIVE requires a positive MAXDISP (%lf nm given) and a GROWTH larger than 1 (%lf given).\n",
+                          dat->adaptDisp,dat->adaptGrowth);
+                exit(-1);
+              }
+            }
+            /// detection of the atoms evaporated from the cluster, dropped from the engine, and optional end of the run
+            else if (!strcasecmp(buff2,"EVAPORATION"))
+            {
+              dat->evapCheck = 1;
+              for(char *opt=buff3; opt != NULL; opt = strtok(NULL," \n\t"))
+              {
+                // connection distance in nm, by default the cutoff
+                if (!strcasecmp(opt,"RADIUS"))
+                {
+                  dat->evapRadius = atof(option_value(buff2,opt));
+                }
+                // largest fraction of evaporated atoms, 0 for no limit
+                else if (!strcasecmp(opt,"STOP"))
+                {
+                  dat->evapStop = atof(option_value(buff2,opt));
+                }
+                else
+                {
+                  LOG_PRINT(LOG_ERROR,"%s is not a valid option of the EVAPORATION keyword.\n",opt);
+                  exit(-1);
+                }
+              }
+
+              if (dat->evapRadius < 0.0 || dat->evapStop < 0.0 || dat->evapStop >= 1.0)
+              {
+                LOG_PRINT(LOG_ERROR,"EVAPORATION requires a positive RADIUS (%lf nm given) and a STOP fraction from 0 to 1 (%lf given).\n",
+                          dat->evapRadius,dat->evapStop);
+                exit(-1);
+              }
+            }
+            /// r-RESPA multiple timestepping : the interaction is split at SPLIT nm, the outer part evaluated every STEPS steps
+            else if (!strcasecmp(buff2,"RESPA"))
+            {
+              for(char *opt=buff3; opt != NULL; opt = strtok(NULL," \n\t"))
+              {
+                if (!strcasecmp(opt,"SPLIT"))
+                {
+                  dat->respaSplit = atof(option_value(buff2,opt));
+                }
+                else if (!strcasecmp(opt,"STEPS"))
+                {
+                  dat->respaSteps = (uint32_t) atoi(option_value(buff2,opt));
+                }
+                // width of the switching region of the inner part, ending at SPLIT
+                else if (!strcasecmp(opt,"HEAL"))
+                {
+                  dat->respaHeal = atof(option_value(buff2,opt));
+                }
+                else
+                {
+                  LOG_PRINT(LOG_ERROR,"%s is not a valid option of the RESPA keyword.\n",opt);
+                  exit(-1);
+                }
+              }
+
+              if (dat->respaSteps > 1 && !(dat->respaHeal > 0.0 && dat->respaSplit > dat->respaHeal))
+              {
+                LOG_PRINT(LOG_ERROR,"RESPA SPLIT (%lf nm) should be larger than HEAL (%lf nm), itself positive.\n",
+                          dat->respaSplit,dat->respaHeal);
+                exit(-1);
+              }
+            }
+            /// the native engine sorts the atoms in memory along a space filling curve every EVERY steps
+            else if (!strcasecmp(buff2,"REORDER"))
+            {
+              if (!strcasecmp(buff3,"HILBERT"))
+                dat->reorder = HILBERT;
+              else if (!strcasecmp(buff3,"MORTON"))
+                dat->reorder = MORTON;
+              else if (!strcasecmp(buff3,"NONE"))
+                dat->reorder = NO_REORDER;
+              else
+              {
+                LOG_PRINT(LOG_ERROR,"%s %s is unknown. Should be HILBERT or MORTON or NONE.\n",buff2,buff3);
+                exit(-1);
+              }
+
+              char *opt=NULL;
+              while((opt = strtok(NULL," \n\t")) != NULL)
+              {
+                if (!strcasecmp(opt,"EVERY"))
+                {
+                  dat->reorderEvery = (uint32_t) atoi(option_value(buff2,opt));
+                  if (dat->reorderEvery == 0)
+                  {
+                    LOG_PRINT(LOG_ERROR,"REORDER EVERY should be at least 1.\n");
+                    exit(-1);
+                  }
+                }
+                else
+                {
+                  LOG_PRINT(LOG_ERROR,"%s is not a valid option of the REORDER keyword.\n",opt);
+                  exit(-1);
+                }
+              }
+            }
             /// section where saving of energy, coordinates and trajectory is handled
             else if (!strcasecmp(buff2,"SAVE"))
             {
@@ -196,9 +513,23 @@ void parse_from_file(char fname[], DATA *dat, ATOM **at)
             else if (!strcasecmp(buff2,"NATOMS"))
             {
                 dat->natom = (uint32_t) atoi(buff3);
-                *at = malloc(dat->natom*sizeof(ATOM));
+                *at = calloc(dat->natom,sizeof(ATOM));
                 build_cluster(*at,dat,0,dat->natom,-1);	///< initialise the cluster with atoms at infinity initially
             }
+            /// number of threads ; 0 means all the cpus of the affinity mask
+            else if (!strcasecmp(buff2,"NTHREADS"))
+            {
+                dat->nthreads = (uint32_t) atoi(buff3);
+                if (dat->nthreads == 0)
+                    dat->nthreads = get_ncpus_affinity();
+            }
+            /// number of independent replicas of the cluster integrated in lockstep by the native engine
+            else if (!strcasecmp(buff2,"REPLICAS"))
+            {
+                dat->replicas = (uint32_t) atoi(buff3);
+                if (dat->replicas == 0)
+                    dat->replicas = 1;
+            }
             /// define temperature
             else if (!strcasecmp(buff2,"TEMP"))
                 dat->T = atof(buff3);
@@ -210,31 +541,32 @@ void parse_from_file(char fname[], DATA *dat, ATOM **at)
             {
                 char *type=buff3 , *mass=NULL, *epsi=NULL , *sigma=NULL ;
 
-                /// the array grows each time a LJPARAMS section is detected
-                pars=(PARAMS*)realloc(pars,(pars_size+1)*sizeof(PARAMS));
+                /// the species table grows each time a PARAMS section is detected
+                sp->pars=(PARAMS*)realloc(sp->pars,(sp->n+1)*sizeof(PARAMS));
+                PARAMS *p = &(sp->pars[sp->n]);
 
-                sprintf(pars[pars_size].sym,"%s",type);
+                snprintf(p->sym,sizeof(p->sym),"%s",type);
 
                 mass=strtok(NULL," \n\t");
                 mass=strtok(NULL," \n\t");
-                pars[pars_size].mass=atof(mass);
+                p->mass=atof(mass);
                 
-                pars[pars_size].charge=0.0;
+                p->charge=0.0;
                 
                 epsi=strtok(NULL," \n\t");
                 epsi=strtok(NULL," \n\t");
-                pars[pars_size].eps=atof(epsi);
+                p->eps=atof(epsi);
 
                 sigma=strtok(NULL," \n\t");
                 sigma=strtok(NULL," \n\t");
-                pars[pars_size].sig=atof(sigma);
+                p->sig=atof(sigma);
 
-                pars_size++;
+                sp->n++;
             }
             /// for building atom list manually
             else if (!strcasecmp(buff2,"ATOM"))
             {
-                uint32_t i=0,j=0,k=0,l=0;
+                uint32_t i=0,j=0,k=0;
                 char *from=buff3, *to=NULL, *type=NULL, *coor=NULL;
                 
                 to=strtok(NULL," \n\t");
@@ -254,21 +586,16 @@ void parse_from_file(char fname[], DATA *dat, ATOM **at)
 
                 LOG_PRINT(LOG_INFO,"Building an atomic list from index %d to %d and of type  %s.\n",j,k-1,type);
                 
-                for(i=j; i<k; i++)
+                const int32_t t = species_find(sp,type);
+                if (t < 0)
                 {
-                    sprintf((*at)[i].sym,"%s",type);
-                    for(l=0; l<pars_size; l++)
-                    {
-                        if (!strcasecmp(pars[l].sym,(*at)[i].sym))
-                        {
-                            (*at)[i].pars.mass=pars[l].mass;
-                            (*at)[i].pars.charge=pars[l].charge;
-                            (*at)[i].pars.eps=pars[l].eps;
-                            (*at)[i].pars.sig=pars[l].sig;
-                            break;
-                        }
-                    }
+                    LOG_PRINT(LOG_ERROR,"Atom type %s has to be defined with the PARAMS keyword before being used by ATOM.\n",type);
+                    exit(-1);
                 }
+
+                for(i=j; i<k; i++)
+                    (*at)[i].type = (uint32_t) t;
+
                 ///randomly distribute atoms
                 if(!strcasecmp(coor,"RANDOM"))
                 {
@@ -310,5 +637,9 @@ void parse_from_file(char fname[], DATA *dat, ATOM **at)
     }
 
     fclose(ifile);
-    free(pars);
+
+    // only the species of the atoms are kept, then the Lorentz-Berthelot parameters of each couple of species
+    //  are computed once for all the pair kernels
+    species_compact(sp,*at,dat->natom);
+    species_mix(sp);
 }
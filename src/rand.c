@@ -18,11 +18,34 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include "global.h"
 #include "rand.h"
 #include "logger.h"
+#include "cpuDispatch.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/**
+ * @brief Re-fills the cache of uniform random numbers dat->rn
+ *
+ * @param dat Common simulation data
+ */
+static void refill(DATA *dat)
+{
+#ifdef STDRAND
+    uint32_t i;
+    for (i=0; i<2048; i++)
+        dat->rn[i]=rand()/(double)RAND_MAX;
+#else
+    dsfmt_fill_array_open_open(&dat->dsfmt,dat->rn,2048);
+#endif
+    dat->nrn=0;
+}
 
 /**
  * @brief Call this function for obtaining a uniformly distributed random number in the range (0, 1)
@@ -34,21 +57,58 @@ double get_next(DATA *dat)
 {
     // if array empty of fully used re-fill it
     if (dat->nrn==2048)
-    {
-#ifdef STDRAND
-        uint32_t i;
-        for (i=0; i<2048; i++)
-            dat->rn[i]=rand()/(double)RAND_MAX;
-#else
-        dsfmt_fill_array_open_open(&dat->dsfmt,dat->rn,(int32_t)dat->nrn);
-#endif
-        dat->nrn=0;
-    }
+        refill(dat);
     // return a number from the array and increase the counter
     dat->nrn += 1;
     return dat->rn[dat->nrn-1] ;
 }
 
+/**
+ * @brief Returns a double precision number normally distributed around 0 with a unit standard deviation.
+ *  It uses the basic form of the Box Muller algorithm, see http://en.wikipedia.org/wiki/Box%E2%80%93Muller_transform
+ *
+ * @param dat Common simulation data
+ * @return A random number following the standard normal distribution
+ */
+double get_BoxMuller(DATA *dat)
+{
+    const double u = get_next(dat);
+    const double v = get_next(dat);
+    return sqrt(-2.*log(u))*cos(2.*M_PI*v);
+}
+
+/**
+ * @brief Fills an array with numbers normally distributed around 0 with a unit standard deviation :
+ *  uniform numbers are copied by blocks from the cache of get_next, then transformed in bulk
+ *  by the vectorised Box-Muller kernel selected at run time (see vecKernels.c)
+ *
+ * @param dat Common simulation data
+ * @param g The array to fill
+ * @param n Size of g
+ */
+void get_BoxMuller_array(DATA *dat, double g[], uint32_t n)
+{
+    // the transformation works on couples, the last number of an odd array is drawn separately
+    const uint32_t m = n & ~1u;
+
+    uint32_t k = 0;
+    while (k<m)
+    {
+        if (dat->nrn==2048)
+            refill(dat);
+        const uint32_t avail = 2048 - dat->nrn;
+        const uint32_t len = (m-k < avail) ? m-k : avail;
+        memcpy(g+k,dat->rn+dat->nrn,len*sizeof(double));
+        dat->nrn += len;
+        k += len;
+    }
+
+    kernels.gauss_transform(g,m/2);
+
+    if (m<n)
+        g[m] = get_BoxMuller(dat);
+}
+
 /**
  * @brief Returns a double precision number normally distributed around 0,
  *  following a standard deviation taken from spdat->weps
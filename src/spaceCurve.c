@@ -0,0 +1,159 @@
+/**
+ * \file spaceCurve.c
+ *
+ * \brief Ordering of the atoms along a Morton (Z-order) or Hilbert space filling curve, so that atoms close in space
+ *  are close in memory : the neighbours gathered by the pair kernels then share cache lines and pages.
+ *
+ * \details Positions are quantised on a grid of 2^SFC_BITS points per axis spanning the bounding box of the atoms
+ *          (the clusters are unbounded, a few evaporated atoms only lowering the resolution), then sorted on their
+ *          position along the curve. The Hilbert curve has no jumps between distant octants as the Morton one,
+ *          which is cheaper to compute.
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "spaceCurve.h"
+
+/// spreads the SFC_BITS low bits of v so that bit k goes to bit 3k
+static inline uint64_t sfc_spread(uint64_t v)
+{
+  v &= 0x1fffffULL;
+  v = (v | v << 32) & 0x1f00000000ffffULL;
+  v = (v | v << 16) & 0x1f0000ff0000ffULL;
+  v = (v | v << 8)  & 0x100f00f00f00f00fULL;
+  v = (v | v << 4)  & 0x10c30c30c30c30c3ULL;
+  v = (v | v << 2)  & 0x1249249249249249ULL;
+  return v;
+}
+
+/**
+ * @brief Position along the Morton curve : the bits of the three coordinates interleaved, x being the most significant
+ */
+uint64_t sfc_morton_key(uint32_t ix, uint32_t iy, uint32_t iz)
+{
+  return (sfc_spread(ix) << 2) | (sfc_spread(iy) << 1) | sfc_spread(iz);
+}
+
+/**
+ * @brief Position along the Hilbert curve : the coordinates are transformed into the "transposed" Hilbert index
+ *  (J. Skilling, Programming the Hilbert curve, AIP Conf. Proc. 707, 381 (2004)), whose bits are then interleaved
+ */
+uint64_t sfc_hilbert_key(uint32_t ix, uint32_t iy, uint32_t iz)
+{
+  uint32_t X[3] = {ix, iy, iz};
+  const uint32_t M = 1u << (SFC_BITS-1);
+
+  // inverse undo of the excess work
+  for(uint32_t Q=M; Q>1; Q>>=1)
+  {
+    const uint32_t P = Q-1;
+    for(uint32_t i=0; i<3; i++)
+    {
+      if(X[i] & Q)
+        X[0] ^= P;
+      else
+      {
+        const uint32_t t = (X[0] ^ X[i]) & P;
+        X[0] ^= t;
+        X[i] ^= t;
+      }
+    }
+  }
+
+  // Gray encoding
+  X[1] ^= X[0];
+  X[2] ^= X[1];
+  uint32_t t = 0;
+  for(uint32_t Q=M; Q>1; Q>>=1)
+    if(X[2] & Q)
+      t ^= Q-1;
+  for(uint32_t i=0; i<3; i++)
+    X[i] ^= t;
+
+  return sfc_morton_key(X[0],X[1],X[2]);
+}
+
+/**
+ * @brief Order of the atoms along a space filling curve
+ *
+ * @param n Number of atoms
+ * @param x,y,z Positions, in any unit
+ * @param curve MORTON or HILBERT
+ * @param order On output, order[k] is the index of the k-th atom along the curve
+ */
+void sfc_order(uint32_t n, const double x[], const double y[], const double z[],
+               REORDERS curve, uint32_t order[])
+{
+  double lo[3] = { INFINITY, INFINITY, INFINITY};
+  double hi[3] = {-INFINITY,-INFINITY,-INFINITY};
+  for(uint32_t i=0; i<n; i++)
+  {
+    lo[0] = fmin(lo[0],x[i]);  hi[0] = fmax(hi[0],x[i]);
+    lo[1] = fmin(lo[1],y[i]);  hi[1] = fmax(hi[1],y[i]);
+    lo[2] = fmin(lo[2],z[i]);  hi[2] = fmax(hi[2],z[i]);
+  }
+
+  // the same scale on the three axes, so that the curve is not distorted
+  const double ext = fmax(fmax(hi[0]-lo[0],hi[1]-lo[1]),hi[2]-lo[2]);
+  const double scale = (ext > 0.0) ? ((double)((1u << SFC_BITS)-1))/ext : 0.0;
+
+  uint64_t* kbuf = malloc(2*(size_t)n*sizeof(uint64_t));
+  uint32_t* obuf = malloc(n*sizeof(uint32_t));
+  uint64_t *key = kbuf, *ktmp = kbuf+n;
+  uint32_t *ord = order, *otmp = obuf;
+
+  for(uint32_t i=0; i<n; i++)
+  {
+    const uint32_t ix = (uint32_t)((x[i]-lo[0])*scale);
+    const uint32_t iy = (uint32_t)((y[i]-lo[1])*scale);
+    const uint32_t iz = (uint32_t)((z[i]-lo[2])*scale);
+    key[i] = (curve == HILBERT) ? sfc_hilbert_key(ix,iy,iz) : sfc_morton_key(ix,iy,iz);
+    ord[i] = i;
+  }
+
+  // least significant digit radix sort on 16 bits digits : stable, O(n) per pass
+  const uint32_t nbins = 1u << 16;
+  uint32_t* count = malloc(nbins*sizeof(uint32_t));
+  for(uint32_t shift=0; shift<3*SFC_BITS; shift+=16)
+  {
+    memset(count,0,nbins*sizeof(uint32_t));
+    for(uint32_t i=0; i<n; i++)
+      count[(key[i] >> shift) & 0xffff]++;
+
+    uint32_t sum = 0;
+    for(uint32_t b=0; b<nbins; b++)
+    {
+      const uint32_t c = count[b];
+      count[b] = sum;
+      sum += c;
+    }
+
+    for(uint32_t i=0; i<n; i++)
+    {
+      const uint32_t k = count[(key[i] >> shift) & 0xffff]++;
+      ktmp[k] = key[i];
+      otmp[k] = ord[i];
+    }
+
+    uint64_t* kt = key;  key = ktmp;  ktmp = kt;
+    uint32_t* ot = ord;  ord = otmp;  otmp = ot;
+  }
+
+  if(ord != order)
+    memcpy(order,ord,n*sizeof(uint32_t));
+
+  free(count);
+  free(kbuf);
+  free(obuf);
+}
@@ -13,15 +13,26 @@
  *
  */
 
+// for sched_getaffinity
+#define _GNU_SOURCE
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <math.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 #include "global.h"
 #include "tools.h"
 #include "rand.h"
 #include "logger.h"
+#include "cellGrid.h"
+#include "cpuDispatch.h"
 
 /**
  * \def CONFLICT -1
@@ -35,6 +46,13 @@
  */
 #define NO_CONFLICT 0
 
+/**
+ * \def ATOM_STRIDE
+ * \brief Distance in doubles between the coordinates of two consecutive atoms of an ATOM array, for the strided kernels of vecKernels.c
+ */
+#define ATOM_STRIDE (sizeof(ATOM)/sizeof(double))
+_Static_assert(sizeof(ATOM)%sizeof(double) == 0, "the size of ATOM has to be a multiple of the size of a double");
+
 /**
  * @brief Fills partially or fully a X,Y,Z vector whith random numbers distributed 
  * in the (-0.5;0.5) range (Reversible Markov Chain, Detailed Balance).
@@ -71,6 +89,7 @@ void get_vector(DATA *dat, int32_t mv_direction, double vec[3])
  * @param from first atom of the list on which to work
  * @param to last atom of the list on which to work
  * @param mode Building mode : -1 sets coordinates to 9999.9 (infinity), 0 sets all atom at the origin, 1 sets atom at a random position (with constraints)
+ *  or, in a periodic box, on the sites of a simple cubic lattice filling the box with a small random displacement
  */
 void build_cluster(ATOM at[], DATA *dat, uint32_t from, uint32_t to, int32_t mode)
 {
@@ -89,12 +108,50 @@ void build_cluster(ATOM at[], DATA *dat, uint32_t from, uint32_t to, int32_t mod
         for (i=from; i<to; i++)
             at[i].x=at[i].y=at[i].z=0.0;
     }
+    else if (mode==1 && dat->pbc)	//periodic box : a random cluster would leave most of the box empty
+    {
+        double randvec[3] = {0.0} ;
+
+        // m^3 >= natom sites, the atom i being on the site i whatever the ATOM line it belongs to
+        uint32_t m = (uint32_t) ceil(cbrt((double)dat->natom));
+        while ((uint64_t)m*m*m < dat->natom)
+            m++;
+
+        const double a[3] = {10.0*dat->box[0]/m,10.0*dat->box[1]/m,10.0*dat->box[2]/m};
+
+        double sigmax = 0.0;
+        for (i=from; i<to; i++)
+            sigmax = (dat->species.pars[at[i].type].sig > sigmax) ? dat->species.pars[at[i].type].sig : sigmax;
+        if (fmin(a[0],fmin(a[1],a[2])) < 10.0*sigmax)
+            LOG_PRINT(LOG_WARNING,"Warning : the lattice spacing of the initial structure (%lf A) is smaller than sigma (%lf A) : "
+                      "box too small for %d atoms\n",fmin(a[0],fmin(a[1],a[2])),10.0*sigmax,dat->natom);
+
+        for (i=from; i<to; i++)
+        {
+            get_vector(dat,-1,randvec);
+            at[i].x = a[0]*((i%m) + 0.5 + 0.05*randvec[0]);
+            at[i].y = a[1]*(((i/m)%m) + 0.5 + 0.05*randvec[1]);
+            at[i].z = a[2]*((i/(m*m)) + 0.5 + 0.05*randvec[2]);
+        }
+    }
     else if (mode==1)	//random mode
     {
         double randvec[3] = {0.0} ;
 
         dat->inid = (dat->natom < 256) ? (sqrt(dat->natom)) : (sqrt(dat->natom) - sqrt(dat->natom)/4.0);
 
+        /*
+         * the hashed cell grid is built from the atoms already placed, with cells as large as the largest
+         * clash distance, so that each trial position is only compared to the atoms of the neighbouring cells
+         */
+        double sigmax = 0.0;
+        for (i=0; i<to; i++)
+            sigmax = (dat->species.pars[at[i].type].sig > sigmax) ? dat->species.pars[at[i].type].sig : sigmax;
+
+        CELLGRID* grid = cellgrid_alloc(to,(sigmax > 0.0) ? 10.0*sigmax : 1.0);
+        for (i=0; i<from; i++)
+            cellgrid_insert(grid,i,at[i].x,at[i].y,at[i].z);
+
         for (i=from; i<to; i++)
         {
 
@@ -105,8 +162,12 @@ void build_cluster(ATOM at[], DATA *dat, uint32_t from, uint32_t to, int32_t mod
                 at[i].y = dat->inid*randvec[1];
                 at[i].z = dat->inid*randvec[2];
             }
-            while(  no_conflict(at,i) != NO_CONFLICT );
+            while(  no_conflict(at,&(dat->species),grid,i) != NO_CONFLICT );
+
+            cellgrid_insert(grid,i,at[i].x,at[i].y,at[i].z);
         }
+
+        cellgrid_free(grid);
     }
 }
 
@@ -115,26 +176,35 @@ void build_cluster(ATOM at[], DATA *dat, uint32_t from, uint32_t to, int32_t mod
  * @brief Checks if an atom randomly placed is not far enough from the other ones.
  *          Positioning is valid if the distance is larger than their sigma_i_j LJ interaction term multiplied by something
  * @param at Atom array
+ * @param sp Species table
+ * @param grid Hashed cell grid containing the atoms already placed, cells not smaller than the clash distance
  * @param i Atomic index
  * @return NO_CONFLICT if no steric clash, CONFLICT otherwise
  */
-int32_t  no_conflict(ATOM at[],uint32_t i)
+int32_t  no_conflict(ATOM at[], const SPECIES* sp, const CELLGRID* grid, uint32_t i)
 {
-    uint32_t j=0;
     double d=0.0;
     
-//     fprintf(stdout,"In no_conflict for %d\n",i);
-//     fflush(stdout);
-    
-    for (j=0; j<i; j++)
+    const int32_t cx = cellgrid_coord(grid,at[i].x);
+    const int32_t cy = cellgrid_coord(grid,at[i].y);
+    const int32_t cz = cellgrid_coord(grid,at[i].z);
+
+    for (int32_t nx=cx-1; nx<=cx+1; nx++)
+    for (int32_t ny=cy-1; ny<=cy+1; ny++)
+    for (int32_t nz=cz-1; nz<=cz+1; nz++)
     {
-        d = X2(at[i].x-at[j].x) +  X2(at[i].y-at[j].y) + X2(at[i].z-at[j].z) ;
-        d = sqrt(d);
-        if (d < (5.0*(at[i].pars.sig+at[j].pars.sig)))
+        for (int32_t j=grid->head[cellgrid_hash(grid,nx,ny,nz)]; j>=0; j=grid->next[j])
         {
-//             fprintf(stderr,"[Info] Atoms %3d and %3d too close for starting configuration : generating new coordinates for atom %3d\n",j,i,i);
-            LOG_PRINT(LOG_INFO,"Atoms %d and %d too close for starting configuration : generating new coordinates for atom %3d\n",j,i,i);
-            return CONFLICT;
+            if (grid->cx[j]!=nx || grid->cy[j]!=ny || grid->cz[j]!=nz)
+                continue;
+
+            d = X2(at[i].x-at[j].x) +  X2(at[i].y-at[j].y) + X2(at[i].z-at[j].z) ;
+            d = sqrt(d);
+            if (d < (5.0*(sp->pars[at[i].type].sig+sp->pars[at[j].type].sig)))
+            {
+                LOG_PRINT(LOG_INFO,"Atoms %d and %d too close for starting configuration : generating new coordinates for atom %3d\n",j,i,i);
+                return CONFLICT;
+            }
         }
     }
     return NO_CONFLICT;
@@ -142,7 +212,8 @@ int32_t  no_conflict(ATOM at[],uint32_t i)
 
 /**
  * @brief Get the center of mass of the system.
- * As we don't really have mass here this is in fact the barycentre of the system
+ * As we don't really have mass here this is in fact the barycentre of the system ;
+ * the evaporated atoms (see evaporation.c) are not part of the system any more and are not counted
  * 
  * @param at Atom list
  * @param dat Common data
@@ -151,20 +222,28 @@ int32_t  no_conflict(ATOM at[],uint32_t i)
 CM getCM(ATOM at[],DATA *dat)
 {
     CM cm;
-    cm.cx=0.0;
-    cm.cy=0.0;
-    cm.cz=0.0;
+    double s[3];
 
-    for(uint32_t i=0; i<dat->natom; i++)
+    uint32_t n = dat->natom;
+    if (dat->evap != NULL && dat->nevap > 0 && dat->nevap < n)
     {
-        cm.cx += at[i].x;
-        cm.cy += at[i].y;
-        cm.cz += at[i].z;
+        // the evaporated atoms are far away : they are skipped rather than summed then subtracted, which would cancel
+        s[0] = s[1] = s[2] = 0.0;
+        for (uint32_t i=0; i<dat->natom; i++)
+            if (!dat->evap[i])
+            {
+                s[0] += at[i].x;
+                s[1] += at[i].y;
+                s[2] += at[i].z;
+            }
+        n -= dat->nevap;
     }
+    else
+        kernels.sum_xyz(&(at[0].x),ATOM_STRIDE,dat->natom,s);
 
-    cm.cx /= dat->natom;
-    cm.cy /= dat->natom;
-    cm.cz /= dat->natom;
+    cm.cx = s[0]/n;
+    cm.cy = s[1]/n;
+    cm.cz = s[2]/n;
 
     return cm;
 }
@@ -179,11 +258,153 @@ CM getCM(ATOM at[],DATA *dat)
 void recentre(ATOM at[],DATA *dat)
 {
     CM cm = getCM(at,dat);
+    const double s[3] = {cm.cx,cm.cy,cm.cz};
+
+    kernels.shift_xyz(&(at[0].x),ATOM_STRIDE,dat->natom,s);
+}
+
+/**
+ * Replaces the coordinates by those of their image in the periodic box, from 0 to the edge along each axis :
+ * recentring would be meaningless in a periodic system, and the engines never wrap the coordinates themselves
+ * 
+ * @param at Atom list, coordinates in angstroems
+ * @param dat Common data, with the edges of the box in nm
+ */
+void wrap_box(ATOM at[],DATA *dat)
+{
+    const double L[3] = {10.0*dat->box[0],10.0*dat->box[1],10.0*dat->box[2]};
+
+    for (uint32_t i=0; i<dat->natom; i++)
+    {
+        double* r = &(at[i].x);
+        for (uint32_t d=0; d<3; d++)
+        {
+            r[d] -= L[d]*floor(r[d]/L[d]);
+            // rounding of values just below 0
+            if (r[d] >= L[d])
+                r[d] -= L[d];
+        }
+    }
+}
+
+/**
+ * @brief Looks for a species in the species table
+ *
+ * @param sp Species table
+ * @param sym Symbol of the species, case insensitive
+ * @return The index of the species, or -1 if not found
+ */
+int32_t species_find(const SPECIES* sp, const char sym[])
+{
+    for (uint32_t t=0; t<sp->n; t++)
+        if (!strcasecmp(sp->pars[t].sym,sym))
+            return (int32_t) t;
+
+    return -1;
+}
+
+/**
+ * @brief Removes from the table the species used by none of the atoms (input files usually declare the PARAMS of all
+ *  the rare gases), the atoms being renumbered : a cluster of a single element then has a table of a single species,
+ *  for which the native engine uses the kernels specialised for one species (see LJ_SPECIALISE in ljKernelSimd.c)
+ *
+ * @param sp Species table, before species_mix
+ * @param at Atoms, their species being renumbered
+ * @param natom Number of atoms
+ */
+void species_compact(SPECIES* sp, ATOM at[], uint32_t natom)
+{
+    if (sp->n == 0)
+        return;
+
+    int32_t* idx = malloc(sp->n*sizeof(int32_t));
+    for (uint32_t t=0; t<sp->n; t++)
+        idx[t] = -1;
+    for (uint32_t i=0; i<natom; i++)
+        idx[at[i].type] = 0;
+
+    uint32_t m = 0;
+    for (uint32_t t=0; t<sp->n; t++)
+    {
+        if (idx[t] < 0)
+            continue;
+        sp->pars[m] = sp->pars[t];
+        idx[t] = (int32_t) m++;
+    }
+
+    for (uint32_t i=0; i<natom; i++)
+        at[i].type = (uint32_t) idx[at[i].type];
+
+    if (m < sp->n)
+        LOG_PRINT(LOG_INFO,"%d species declared with PARAMS, %d used by the atoms\n",sp->n,m);
+    sp->n = m;
+
+    free(idx);
+}
+
+/**
+ * @brief Computes the Lennard-Jones parameters of each couple of species with the Lorentz-Berthelot rules,
+ *  as done by OpenMM's NonbondedForce : sigma_ij = (sigma_i+sigma_j)/2 and epsilon_ij = sqrt(epsilon_i*epsilon_j)
+ *
+ * @param sp Species table, the pars array being already filled ; sigij and epsij are (re)allocated
+ */
+void species_mix(SPECIES* sp)
+{
+    const uint32_t n = sp->n;
+
+    sp->sigij = realloc(sp->sigij,(size_t)n*n*sizeof(double));
+    sp->epsij = realloc(sp->epsij,(size_t)n*n*sizeof(double));
 
-    for(uint32_t i=0; i<dat->natom; i++)
+    for (uint32_t a=0; a<n; a++)
     {
-        at[i].x -= cm.cx;
-        at[i].y -= cm.cy;
-        at[i].z -= cm.cz;
+        for (uint32_t b=0; b<n; b++)
+        {
+            sp->sigij[a*n+b] = 0.5*(sp->pars[a].sig+sp->pars[b].sig);
+            sp->epsij[a*n+b] = sqrt(sp->pars[a].eps*sp->pars[b].eps);
+        }
     }
 }
+
+/**
+ * @brief Frees the arrays of the species table
+ *
+ * @param sp Species table
+ */
+void species_free(SPECIES* sp)
+{
+    free(sp->pars);
+    free(sp->sigij);
+    free(sp->epsij);
+    sp->pars  = NULL;
+    sp->sigij = NULL;
+    sp->epsij = NULL;
+    sp->n = 0;
+}
+
+/**
+ * @brief Number of cpus this process is allowed to run on (affinity mask), used as the default number of threads
+ *
+ * @return The number of cpus in the affinity mask, or 1 if unknown
+ */
+uint32_t get_ncpus_affinity()
+{
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0,sizeof(cpu_set_t),&mask) == 0)
+        return (uint32_t) CPU_COUNT(&mask);
+#endif
+    return 1;
+}
+
+/**
+ * @brief Wall clock time from a monotonic clock, for timings
+ *
+ * @return The time in seconds from an arbitrary origin
+ */
+double get_wtime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (double)ts.tv_sec + 1.0e-9*(double)ts.tv_nsec;
+}
@@ -0,0 +1,366 @@
+/**
+ * \file vecKernels.c
+ *
+ * \brief Hot loops over the atoms other than the pair forces : integrators updates, centre of mass,
+ *        and transformation of uniform random numbers to normal ones
+ *
+ * \details These are plain loops over the structures of arrays, written so that the compiler vectorises them :
+ *          this file is not compiled on its own but included by kernelsSse2.c, kernelsAvx2.c and kernelsAvx512.c,
+ *          each one compiled with its own instruction set flags ; the variant used is selected at run time (see cpuDispatch.c).
+ *
+ * \authors Florent Hédin (École des Ponts - ParisTech) \n
+ *          Tony Lelièvre (École des Ponts - ParisTech)
+ *
+ * \copyright Copyright (c) 2016-2017, Florent Hédin, Tony Lelièvre, and École des Ponts - ParisTech \n
+ *            All rights reserved. \n
+ *            The 3-clause BSD license is applied to this software. \n
+ *            See LICENSE.txt
+ *
+ */
+
+#ifndef KNAME
+#error "vecKernels.c is a template : compile kernelsSse2.c, kernelsAvx2.c or kernelsAvx512.c instead"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "global.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+#ifndef M_SQRT2
+#define M_SQRT2 1.41421356237309504880
+#endif
+#ifndef M_LN2
+#define M_LN2 0.69314718055994530942
+#endif
+
+/**
+ * @brief One step of the leap-frog Langevin integrator of OpenMM, for all the atoms
+ *
+ * @param n Number of atoms
+ * @param mass Masses in amu
+ * @param dt Timestep in ps
+ * @param vscale exp(-friction*dt)
+ * @param fscale (1-vscale)/friction, or dt without friction
+ * @param nscale sqrt(kT*(1-vscale^2)) : standard deviation of the noise times sqrt(mass)
+ * @param fx,fy,fz Forces in kJ/mol/nm
+ * @param gx,gy,gz Standard normal random numbers, one per degree of freedom
+ * @param vx,vy,vz Velocities in nm/ps, updated
+ * @param x,y,z Positions in nm, updated
+ */
+void KNAME(langevin_update)(uint32_t n, const double* restrict mass,
+                            double dt, double vscale, double fscale, double nscale,
+                            const double* restrict fx, const double* restrict fy, const double* restrict fz,
+                            const double* restrict gx, const double* restrict gy, const double* restrict gz,
+                            double* restrict vx, double* restrict vy, double* restrict vz,
+                            double* restrict x, double* restrict y, double* restrict z)
+{
+  for(uint32_t i=0; i<n; i++)
+  {
+    const double im = 1.0/mass[i];
+    const double sd = nscale*sqrt(im);
+    vx[i] = vscale*vx[i] + fscale*im*fx[i] + sd*gx[i];
+    vy[i] = vscale*vy[i] + fscale*im*fy[i] + sd*gy[i];
+    vz[i] = vscale*vz[i] + fscale*im*fz[i] + sd*gz[i];
+    x[i] += dt*vx[i];
+    y[i] += dt*vy[i];
+    z[i] += dt*vz[i];
+  }
+}
+
+/**
+ * @brief One step of the Euler-Maruyama Brownian integrator of OpenMM, for all the atoms ;
+ *  the velocities are set to displacement/dt
+ *
+ * @param n Number of atoms
+ * @param mass Masses in amu
+ * @param dt Timestep in ps
+ * @param friction Friction in ps^-1, strictly positive
+ * @param kT Thermal energy in kJ/mol
+ * @param fx,fy,fz Forces in kJ/mol/nm
+ * @param gx,gy,gz Standard normal random numbers, one per degree of freedom
+ * @param vx,vy,vz Velocities in nm/ps, overwritten
+ * @param x,y,z Positions in nm, updated
+ */
+void KNAME(brownian_update)(uint32_t n, const double* restrict mass,
+                            double dt, double friction, double kT,
+                            const double* restrict fx, const double* restrict fy, const double* restrict fz,
+                            const double* restrict gx, const double* restrict gy, const double* restrict gz,
+                            double* restrict vx, double* restrict vy, double* restrict vz,
+                            double* restrict x, double* restrict y, double* restrict z)
+{
+  const double idt = 1.0/dt;
+
+  for(uint32_t i=0; i<n; i++)
+  {
+    const double fscale = dt/(friction*mass[i]);
+    const double sd = sqrt(2.0*kT*fscale);
+    const double dx = fscale*fx[i] + sd*gx[i];
+    const double dy = fscale*fy[i] + sd*gy[i];
+    const double dz = fscale*fz[i] + sd*gz[i];
+    x[i] += dx;
+    y[i] += dy;
+    z[i] += dz;
+    vx[i] = dx*idt;
+    vy[i] = dy*idt;
+    vz[i] = dz*idt;
+  }
+}
+
+/**
+ * @brief One step of the Leimkuhler-Matthews overdamped Langevin integrator, for all the atoms : as Euler-Maruyama
+ *  but the noise is the average of the normal numbers of this step and of the previous one, which removes
+ *  the first order error of the configurational averages for the same cost ; the velocities are set to displacement/dt
+ *
+ * @param n Number of atoms
+ * @param mass Masses in amu
+ * @param dt Timestep in ps
+ * @param friction Friction in ps^-1, strictly positive
+ * @param kT Thermal energy in kJ/mol
+ * @param fx,fy,fz Forces in kJ/mol/nm
+ * @param gx,gy,gz Standard normal random numbers of this step
+ * @param hx,hy,hz Standard normal random numbers of the previous step
+ * @param vx,vy,vz Velocities in nm/ps, overwritten
+ * @param x,y,z Positions in nm, updated
+ */
+void KNAME(brownian_lm_update)(uint32_t n, const double* restrict mass,
+                               double dt, double friction, double kT,
+                               const double* restrict fx, const double* restrict fy, const double* restrict fz,
+                               const double* restrict gx, const double* restrict gy, const double* restrict gz,
+                               const double* restrict hx, const double* restrict hy, const double* restrict hz,
+                               double* restrict vx, double* restrict vy, double* restrict vz,
+                               double* restrict x, double* restrict y, double* restrict z)
+{
+  const double idt = 1.0/dt;
+
+  for(uint32_t i=0; i<n; i++)
+  {
+    const double fscale = dt/(friction*mass[i]);
+    const double sd = sqrt(0.5*kT*fscale);
+    const double dx = fscale*fx[i] + sd*(gx[i]+hx[i]);
+    const double dy = fscale*fy[i] + sd*(gy[i]+hy[i]);
+    const double dz = fscale*fz[i] + sd*(gz[i]+hz[i]);
+    x[i] += dx;
+    y[i] += dy;
+    z[i] += dz;
+    vx[i] = dx*idt;
+    vy[i] = dy*idt;
+    vz[i] = dz*idt;
+  }
+}
+
+/**
+ * @brief The B-A-O-A part of one step of the BAOAB Langevin integrator (Leimkuhler and Matthews), for all the atoms :
+ *  kick with the current forces, half drift, exact Ornstein-Uhlenbeck step on the velocities, half drift.
+ *  The final B (kick with the new forces) is merged with the first one of the next step, see kick_update.
+ *
+ * @param n Number of atoms
+ * @param mass Masses in amu
+ * @param kick Duration of the kick in ps : dt/2 for the first step, dt when the last kick of the previous step is merged
+ * @param hdt Half the timestep in ps
+ * @param vscale exp(-friction*dt)
+ * @param nscale sqrt(kT*(1-vscale^2)) : standard deviation of the noise times sqrt(mass)
+ * @param fx,fy,fz Forces in kJ/mol/nm
+ * @param gx,gy,gz Standard normal random numbers, one per degree of freedom
+ * @param vx,vy,vz Velocities in nm/ps, updated
+ * @param x,y,z Positions in nm, updated
+ */
+void KNAME(baoab_update)(uint32_t n, const double* restrict mass,
+                         double kick, double hdt, double vscale, double nscale,
+                         const double* restrict fx, const double* restrict fy, const double* restrict fz,
+                         const double* restrict gx, const double* restrict gy, const double* restrict gz,
+                         double* restrict vx, double* restrict vy, double* restrict vz,
+                         double* restrict x, double* restrict y, double* restrict z)
+{
+  for(uint32_t i=0; i<n; i++)
+  {
+    const double im = 1.0/mass[i];
+    const double sd = nscale*sqrt(im);
+    const double ux = vx[i] + kick*im*fx[i];
+    const double uy = vy[i] + kick*im*fy[i];
+    const double uz = vz[i] + kick*im*fz[i];
+    const double wx = vscale*ux + sd*gx[i];
+    const double wy = vscale*uy + sd*gy[i];
+    const double wz = vscale*uz + sd*gz[i];
+    x[i] += hdt*(ux + wx);
+    y[i] += hdt*(uy + wy);
+    z[i] += hdt*(uz + wz);
+    vx[i] = wx;
+    vy[i] = wy;
+    vz[i] = wz;
+  }
+}
+
+/**
+ * @brief Kick of the velocities by the forces : v += kick*f/m
+ *
+ * @param n Number of atoms
+ * @param mass Masses in amu
+ * @param kick Duration of the kick in ps
+ * @param fx,fy,fz Forces in kJ/mol/nm
+ * @param vx,vy,vz Velocities in nm/ps, updated
+ */
+void KNAME(kick_update)(uint32_t n, const double* restrict mass, double kick,
+                        const double* restrict fx, const double* restrict fy, const double* restrict fz,
+                        double* restrict vx, double* restrict vy, double* restrict vz)
+{
+  for(uint32_t i=0; i<n; i++)
+  {
+    const double ki = kick/mass[i];
+    vx[i] += ki*fx[i];
+    vy[i] += ki*fy[i];
+    vz[i] += ki*fz[i];
+  }
+}
+
+/*
+ * Logarithm and sine/cosine for the Box-Muller transformation, written with arithmetic, comparisons
+ * and bit manipulations only so that the loop is vectorised : the calls to log, sin and cos of the libm are not,
+ * and cost about 20 ns per normal number. Accurate to a few ulps on the range of the uniform numbers.
+ */
+
+/// log(u) for u in (0,1], normal : u = 2^k m, and log(m) = 2 atanh((m-1)/(m+1)) with m in [sqrt(2)/2,sqrt(2))
+static inline double bm_log(double u)
+{
+  uint64_t b;
+  memcpy(&b,&u,sizeof(double));
+
+  // the biased exponent as a double, through the mantissa of 2^52
+  const uint64_t eb = (b >> 52) | 0x4330000000000000ULL;
+  const uint64_t mb = (b & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL;
+  double k, m;
+  memcpy(&k,&eb,sizeof(double));
+  memcpy(&m,&mb,sizeof(double));
+  k -= 4503599627370496.0 + 1023.0;
+
+  const double big = (m > M_SQRT2) ? 1.0 : 0.0;
+  m = (m > M_SQRT2) ? 0.5*m : m;
+  k += big;
+
+  // |s| < 0.172 : the series is truncated after s^23
+  const double s  = (m-1.0)/(m+1.0);
+  const double s2 = s*s;
+  double p = 1.0/23.0;
+  p = 1.0/21.0 + s2*p;
+  p = 1.0/19.0 + s2*p;
+  p = 1.0/17.0 + s2*p;
+  p = 1.0/15.0 + s2*p;
+  p = 1.0/13.0 + s2*p;
+  p = 1.0/11.0 + s2*p;
+  p = 1.0/9.0  + s2*p;
+  p = 1.0/7.0  + s2*p;
+  p = 1.0/5.0  + s2*p;
+  p = 1.0/3.0  + s2*p;
+  p = 1.0      + s2*p;
+
+  return k*M_LN2 + 2.0*s*p;
+}
+
+/// sin(2 pi v) and cos(2 pi v) for v in [0,1), from the Taylor series of sin(t) and cos(t) on |t| <= pi/2
+static inline void bm_sincos(double v, double* sn, double* cs)
+{
+  // both change sign when v moves by 1/2 ; then with v = 1/4 + t/(2 pi) : sin(2 pi v) = cos(t), cos(2 pi v) = -sin(t)
+  const double sg = (v < 0.5) ? 1.0 : -1.0;
+  const double w  = ((v < 0.5) ? v : v-0.5) - 0.25;
+  const double t  = 2.0*M_PI*w;
+  const double t2 = t*t;
+
+  double ps = -1.0/121645100408832000.0;
+  ps =  1.0/355687428096000.0 + t2*ps;
+  ps = -1.0/1307674368000.0   + t2*ps;
+  ps =  1.0/6227020800.0      + t2*ps;
+  ps = -1.0/39916800.0        + t2*ps;
+  ps =  1.0/362880.0          + t2*ps;
+  ps = -1.0/5040.0            + t2*ps;
+  ps =  1.0/120.0             + t2*ps;
+  ps = -1.0/6.0               + t2*ps;
+  ps =  1.0                   + t2*ps;
+
+  double pc =  1.0/2432902008176640000.0;
+  pc = -1.0/6402373705728000.0 + t2*pc;
+  pc =  1.0/20922789888000.0   + t2*pc;
+  pc = -1.0/87178291200.0      + t2*pc;
+  pc =  1.0/479001600.0        + t2*pc;
+  pc = -1.0/3628800.0          + t2*pc;
+  pc =  1.0/40320.0            + t2*pc;
+  pc = -1.0/720.0              + t2*pc;
+  pc =  1.0/24.0               + t2*pc;
+  pc = -1.0/2.0                + t2*pc;
+  pc =  1.0                    + t2*pc;
+
+  *sn =  sg*pc;
+  *cs = -sg*t*ps;
+}
+
+/**
+ * @brief Box-Muller transformation in bulk, using both the cosine and the sine outputs :
+ *  the 2h uniform numbers in (0,1) of u are replaced by 2h independent standard normal numbers
+ *
+ * @param u Array of size 2h, u[k] and u[k+h] being a couple of uniform numbers
+ * @param h Half the size of u
+ */
+void KNAME(gauss_transform)(double* restrict u, uint32_t h)
+{
+  double* restrict v = u+h;
+
+  for(uint32_t k=0; k<h; k++)
+  {
+    const double r = sqrt(-2.0*bm_log(u[k]));
+    double sn, cs;
+    bm_sincos(v[k],&sn,&cs);
+    u[k] = r*cs;
+    v[k] = r*sn;
+  }
+}
+
+/**
+ * @brief Sum of n triplets of coordinates stored with a given stride, e.g. in an array of ATOM
+ *
+ * @param p Address of the first x coordinate, y and z following it
+ * @param stride Distance between two consecutive triplets, in number of doubles
+ * @param n Number of triplets
+ * @param s The sum of the x, y and z coordinates
+ */
+void KNAME(sum_xyz)(const double* restrict p, size_t stride, uint32_t n, double s[3])
+{
+  double sx=0.0, sy=0.0, sz=0.0;
+
+  // the reduction is vectorised only if reordering the sum is allowed
+#ifdef _OPENMP
+#pragma omp simd reduction(+:sx,sy,sz)
+#endif
+  for(uint32_t i=0; i<n; i++)
+  {
+    sx += p[i*stride];
+    sy += p[i*stride+1];
+    sz += p[i*stride+2];
+  }
+
+  s[0] = sx;
+  s[1] = sy;
+  s[2] = sz;
+}
+
+/**
+ * @brief Subtracts a vector from n triplets of coordinates stored with a given stride, e.g. in an array of ATOM
+ *
+ * @param p Address of the first x coordinate, y and z following it
+ * @param stride Distance between two consecutive triplets, in number of doubles
+ * @param n Number of triplets
+ * @param s The vector subtracted
+ */
+void KNAME(shift_xyz)(double* restrict p, size_t stride, uint32_t n, const double s[3])
+{
+  const double sx = s[0], sy = s[1], sz = s[2];
+
+  for(uint32_t i=0; i<n; i++)
+  {
+    p[i*stride]   -= sx;
+    p[i*stride+1] -= sy;
+    p[i*stride+2] -= sz;
+  }
+}